@@ -1,44 +1,42 @@
 let currentRules = [];
 let editingRuleId = null;
 let debugMode = false; // Debug mode flag
+let activeRuleData = {}; // Last /api/snapshot body, kept current by /api/events
 
-// Load and display active rule
+// Load and display active rule (/api/snapshot includes temperature and hour;
+// unchanged, it revalidates to a 304)
 async function loadActiveRule() {
     try {
-        // Fetch active rule data
-        const ruleResponse = await fetch('/api/rules/active');
-        let ruleData = {};
-        if (ruleResponse.ok) {
-            ruleData = await ruleResponse.json();
-        }
-        
-        // Fetch current temperature
-        const tempResponse = await fetch('/api/temp');
-        let tempData = {};
-        if (tempResponse.ok) {
-            tempData = await tempResponse.json();
-        }
-        
-        // Fetch system info for current time
-        const systemResponse = await fetch('/api/system');
-        let systemData = {};
-        if (systemResponse.ok) {
-            systemData = await systemResponse.json();
+        const response = await fetch('/api/snapshot');
+        if (response.ok) {
+            activeRuleData = await response.json();
         }
-        
-        // Combine all data
-        const combinedData = {
-            ...ruleData,
-            currentTemp: tempData.temp,
-            currentHour: systemData.currentHour
-        };
-        
-        updateActiveRuleDisplay(combinedData);
+        updateActiveRuleDisplay(activeRuleData);
     } catch (error) {
         document.getElementById('active-rule-status').innerHTML = '<span style="color: red;">❌ 加载激活规则时出错</span>';
     }
 }
 
+// The controller pushes the active rule and temperature when they change;
+// without EventSource fall back to polling
+function connectEvents() {
+    if (!window.EventSource) {
+        loadActiveRule();
+        setInterval(loadActiveRule, 30000);
+        return;
+    }
+    const source = new EventSource('/api/events');
+    const merge = event => {
+        Object.assign(activeRuleData, JSON.parse(event.data));
+        updateActiveRuleDisplay(activeRuleData);
+    };
+    source.addEventListener('rule', event => {
+        activeRuleData = {};  // activeRule is absent when no rule matches
+        merge(event);
+    });
+    source.addEventListener('temp', merge);
+}
+
 function updateActiveRuleDisplay(data) {
     const statusDiv = document.getElementById('active-rule-status');
     let statusHtml = `<div style="display: grid; grid-template-columns: repeat(auto-fit, minmax(200px, 1fr)); gap: 15px;">`;
@@ -69,10 +67,7 @@ function updateActiveRuleDisplay(data) {
             statusHtml += `<div style="margin-top: 15px; padding: 15px; background: #e8f5e8; border-radius: 8px; border-left: 4px solid #28a745;">`;
             statusHtml += `<h4 style="margin: 0 0 10px 0; color: #28a745;">✅ ${rule.name} (ID: ${rule.id})</h4>`;
             
-            const conditionsHtml = [];
-            if (rule.startHour !== -1 && rule.endHour !== -1) {
-                conditionsHtml.push(`🕐 ${rule.startHour}:00-${rule.endHour}:00`);
-            }
+            const conditionsHtml = formatScheduleConditions(rule);
             if (rule.minTemp !== -999 || rule.maxTemp !== -999) {
                 const minStr = rule.minTemp !== -999 ? `≥${rule.minTemp}°C` : '';
                 const maxStr = rule.maxTemp !== -999 ? `≤${rule.maxTemp}°C` : '';
@@ -103,6 +98,35 @@ function updateActiveRuleDisplay(data) {
     statusDiv.innerHTML = statusHtml;
 }
 
+// Minute of day <-> "HH:MM" (-1 / '' = any time)
+function minuteToTime(minute) {
+    if (minute === undefined || minute === -1) return '';
+    return `${String(Math.floor(minute / 60)).padStart(2, '0')}:${String(minute % 60).padStart(2, '0')}`;
+}
+
+function timeToMinute(value) {
+    if (!value) return -1;
+    const [hours, minutes] = value.split(':').map(Number);
+    return hours * 60 + minutes;
+}
+
+// Time window, weekdays and exceptions of a rule for the condition summaries
+function formatScheduleConditions(rule) {
+    const conditions = [];
+    if (rule.startMinute !== -1 && rule.endMinute !== -1) {
+        conditions.push(`🕐 ${minuteToTime(rule.startMinute)}-${minuteToTime(rule.endMinute)}`);
+    }
+    const weekdays = rule.weekdays ?? 0x7F;
+    if (weekdays !== 0x7F) {
+        const names = ['日', '一', '二', '三', '四', '五', '六'].filter((name, day) => weekdays & (1 << day));
+        conditions.push(`📅 周${names.join('')}`);
+    }
+    if (rule.exceptions && rule.exceptions.length > 0) {
+        conditions.push(`🏖️ ${rule.exceptions.length} 个例外`);
+    }
+    return conditions;
+}
+
 // Load and display all rules
 async function loadRules() {
     try {
@@ -131,10 +155,7 @@ function updateRulesDisplay() {
         const statusText = rule.enabled ? '✅ ON' : '❌ OFF';
         
         // Build condition display
-        const conditions = [];
-        if (rule.startHour !== -1 && rule.endHour !== -1) {
-            conditions.push(`🕐 ${rule.startHour}:00-${rule.endHour}:00`);
-        }
+        const conditions = formatScheduleConditions(rule);
         if (rule.minTemp !== -999 || rule.maxTemp !== -999) {
             const minStr = rule.minTemp !== -999 ? `≥${rule.minTemp}°C` : '';
             const maxStr = rule.maxTemp !== -999 ? `≤${rule.maxTemp}°C` : '';
@@ -198,9 +219,17 @@ function editRule(ruleId) {
     // Populate form
     document.getElementById('rule-id').value = rule.id;
     document.getElementById('rule-name').value = rule.name;
+    document.getElementById('rule-priority').value = rule.priority ?? 0;
     document.getElementById('rule-enabled').checked = rule.enabled;
-    document.getElementById('rule-start-hour').value = rule.startHour === -1 ? '' : rule.startHour;
-    document.getElementById('rule-end-hour').value = rule.endHour === -1 ? '' : rule.endHour;
+    document.getElementById('rule-start-time').value = minuteToTime(rule.startMinute);
+    document.getElementById('rule-end-time').value = minuteToTime(rule.endMinute);
+    const weekdays = rule.weekdays ?? 0x7F;
+    document.querySelectorAll('.rule-weekday').forEach(box => {
+        box.checked = (weekdays & Number(box.value)) !== 0;
+    });
+    document.getElementById('rule-exceptions').value = (rule.exceptions || [])
+        .map(range => range.from === range.to ? range.from : `${range.from}..${range.to}`)
+        .join(', ');
     document.getElementById('rule-min-temp').value = rule.minTemp === -999 ? '' : rule.minTemp;
     document.getElementById('rule-max-temp').value = rule.maxTemp === -999 ? '' : rule.maxTemp;
     document.getElementById('rule-ac-on').checked = rule.acOn;
@@ -235,13 +264,21 @@ document.addEventListener('DOMContentLoaded', function() {
                 params.append(key, value ? 'true' : 'false');
             } else if (key === 'minTemp' || key === 'maxTemp') {
                 params.append(key, value === '' ? '-999' : value);
-            } else if (key === 'startHour' || key === 'endHour') {
-                params.append(key, value === '' ? '-1' : value);
+            } else if (key === 'startTime' || key === 'endTime') {
+                params.append(key === 'startTime' ? 'startMinute' : 'endMinute', timeToMinute(value));
             } else {
                 params.append(key, value);
             }
         }
         
+        let weekdays = 0;
+        document.querySelectorAll('.rule-weekday:checked').forEach(box => weekdays |= Number(box.value));
+        if (weekdays === 0) {
+            showNotification('⚠️ 请至少选择一天', 'error');
+            return;
+        }
+        params.append('weekdays', weekdays);
+        
         try {
             const response = await fetch('/api/rules', {
                 method: 'PUT',
@@ -255,7 +292,8 @@ document.addEventListener('DOMContentLoaded', function() {
                 await loadActiveRule();
                 showNotification('✅ [SUCCESS] Rule saved successfully', 'success');
             } else {
-                showNotification('❌ [ERROR] Failed to save rule', 'error');
+                const errorData = await response.json();
+                showNotification(`❌ [ERROR] Failed to save rule: ${errorData.message}`, 'error');
             }
         } catch (error) {
             showNotification('🚫 [ERROR] Connection failed', 'error');
@@ -433,7 +471,6 @@ async function loadDebugMode() {
 // Initialize page
 window.addEventListener('load', function() {
     loadRules();
-    loadActiveRule();
     loadDebugMode(); // Load debug mode setting
-    setInterval(loadActiveRule, 30000); // Refresh active rule every 30 seconds
+    connectEvents(); // Active rule arrives as the first event
 });
@@ -0,0 +1,131 @@
+#ifndef AC_BACKEND_H
+#define AC_BACKEND_H
+
+#include <stdint.h>
+#include "ac_state.h"
+#include "gree_codec.h"
+#include "midea_codec.h"
+#include "daikin_codec.h"
+
+// AC protocol backends: each maps ACState (our power/mode/fan/swing/
+// temperature model) to one protocol's state bytes and IR timings.
+// Dispatch is resolved at compile time. Code that works for any protocol
+// (the frame cache, the transmitter, the conformance tests) is a template
+// over the backend, and a firmware build picks one with a build flag, so it
+// only links the encoder it sends with.
+//
+// A backend derives from ACBackend<itself> and provides:
+//   name(), STATE_LENGTH, FRAME_TIMINGS, CARRIER_KHZ, MIN_TEMP, MAX_TEMP
+//   encodeState(state, bytes)               ACState -> protocol bytes
+//   encodeTimings(bytes, timings)           protocol bytes -> mark/space us
+//   decodeTimings(timings, count, bytes)    false unless one valid frame
+//   decodeState(bytes, state)               protocol bytes -> ACState
+//   checksumValid(bytes)
+// ACBackend adds the steps built from those.
+
+template <typename Backend>
+struct ACFrame {
+  uint8_t state[Backend::STATE_LENGTH];
+  uint16_t timings[Backend::FRAME_TIMINGS];
+};
+
+template <typename Impl>
+class ACBackend {
+public:
+    static void encodeFrame(const ACState& state, ACFrame<Impl>& frame) {
+        Impl::encodeState(state, frame.state);
+        Impl::encodeTimings(frame.state, frame.timings);
+    }
+
+    static bool decodeFrame(const uint16_t* timings, uint16_t count, ACState& out) {
+        uint8_t bytes[Impl::STATE_LENGTH];
+        if (!Impl::decodeTimings(timings, count, bytes)) return false;
+        Impl::decodeState(bytes, out);
+        return true;
+    }
+
+    // What the unit ends up doing for `state`: fields the protocol cannot
+    // carry are dropped, out-of-range values clamped, mode locks applied
+    static ACState normalize(const ACState& state) {
+        uint8_t bytes[Impl::STATE_LENGTH];
+        Impl::encodeState(state, bytes);
+        ACState out;
+        Impl::decodeState(bytes, out);
+        return out;
+    }
+
+    static bool supportsTemperature(uint8_t temp) {
+        return temp >= Impl::MIN_TEMP && temp <= Impl::MAX_TEMP;
+    }
+};
+
+class GreeBackend : public ACBackend<GreeBackend> {
+public:
+    static const char* name() { return "gree"; }
+    static const uint16_t STATE_LENGTH = GREE_STATE_LENGTH;
+    static const uint16_t FRAME_TIMINGS = GREE_FRAME_TIMINGS;
+    static const uint16_t CARRIER_KHZ = GREE_CARRIER_KHZ;
+    static const uint8_t MIN_TEMP = GREE_MIN_TEMP;
+    static const uint8_t MAX_TEMP = GREE_MAX_TEMP;
+
+    static void encodeState(const ACState& state, uint8_t* out) { greeEncodeState(state, out); }
+    static uint16_t encodeTimings(const uint8_t* state, uint16_t* out) { return greeEncodeTimings(state, out); }
+    static bool decodeTimings(const uint16_t* timings, uint16_t count, uint8_t* out) {
+        return greeDecodeTimings(timings, count, out);
+    }
+    static void decodeState(const uint8_t* state, ACState& out) { greeDecodeState(state, out); }
+    static bool checksumValid(const uint8_t* state) {
+        return greeChecksum(state) == state[GREE_STATE_LENGTH - 1] >> 4;
+    }
+};
+
+class MideaBackend : public ACBackend<MideaBackend> {
+public:
+    static const char* name() { return "midea"; }
+    static const uint16_t STATE_LENGTH = MIDEA_STATE_LENGTH;
+    static const uint16_t FRAME_TIMINGS = MIDEA_FRAME_TIMINGS;
+    static const uint16_t CARRIER_KHZ = MIDEA_CARRIER_KHZ;
+    static const uint8_t MIN_TEMP = MIDEA_MIN_TEMP;
+    static const uint8_t MAX_TEMP = MIDEA_MAX_TEMP;
+
+    static void encodeState(const ACState& state, uint8_t* out) { mideaEncodeState(state, out); }
+    static uint16_t encodeTimings(const uint8_t* state, uint16_t* out) { return mideaEncodeTimings(state, out); }
+    static bool decodeTimings(const uint16_t* timings, uint16_t count, uint8_t* out) {
+        return mideaDecodeTimings(timings, count, out);
+    }
+    static void decodeState(const uint8_t* state, ACState& out) { mideaDecodeState(state, out); }
+    static bool checksumValid(const uint8_t* state) {
+        return mideaChecksum(state) == state[MIDEA_STATE_LENGTH - 1];
+    }
+};
+
+class DaikinBackend : public ACBackend<DaikinBackend> {
+public:
+    static const char* name() { return "daikin"; }
+    static const uint16_t STATE_LENGTH = DAIKIN_STATE_LENGTH;
+    static const uint16_t FRAME_TIMINGS = DAIKIN_FRAME_TIMINGS;
+    static const uint16_t CARRIER_KHZ = DAIKIN_CARRIER_KHZ;
+    static const uint8_t MIN_TEMP = DAIKIN_MIN_TEMP;
+    static const uint8_t MAX_TEMP = DAIKIN_MAX_TEMP;
+
+    static void encodeState(const ACState& state, uint8_t* out) { daikinEncodeState(state, out); }
+    static uint16_t encodeTimings(const uint8_t* state, uint16_t* out) { return daikinEncodeTimings(state, out); }
+    static bool decodeTimings(const uint16_t* timings, uint16_t count, uint8_t* out) {
+        return daikinDecodeTimings(timings, count, out);
+    }
+    static void decodeState(const uint8_t* state, ACState& out) { daikinDecodeState(state, out); }
+    static bool checksumValid(const uint8_t* state) { return daikinChecksumsValid(state); }
+};
+
+// Backend of this build: -DAC_BACKEND_MIDEA or -DAC_BACKEND_DAIKIN in the
+// platformio.ini environment, Gree otherwise
+#if defined(AC_BACKEND_MIDEA)
+typedef MideaBackend ACProtocol;
+#elif defined(AC_BACKEND_DAIKIN)
+typedef DaikinBackend ACProtocol;
+#else
+#define AC_BACKEND_GREE
+typedef GreeBackend ACProtocol;
+#endif
+
+#endif
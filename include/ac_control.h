@@ -2,29 +2,39 @@
 #define AC_CONTROL_H
 
 #include "config.h"
+#include "control_schedule.h"
+#include <time.h>
 
 // AC control functions
 void initTime();
+void configureTime();   // Hand the configured NTP servers and UTC offset to SNTP
 void controlTask(void* param);
-void logToCloud(float temp);
+// One evaluation of the control loop at local time `now`: match the rules,
+// send IR if the target state changed and return when to evaluate next.
+// controlTask() runs it after every wake; the host simulator calls it directly.
+ControlWakePlan runControlStep(const struct tm& now, float temp);
+void logToCloud(float temp);   // Called by the sensor task for every valid sample
 
-// AC state functions
-struct ACState {
-  bool power;
-  uint8_t temperature;
-  uint8_t fanSpeed;
-  uint8_t mode;
-  int vSwing;
-  int hSwing;
-};
-
-ACState getCurrentACState();
+// Event-driven control loop: controlTask sleeps until the next rule boundary
+// and is woken early by these task notification bits
+#define CONTROL_EVENT_CROSSING 0x01  // Temperature left the band of the active decision
+#define CONTROL_EVENT_RULES    0x02  // A new rule snapshot was published
+#define CONTROL_EVENT_CONFIG   0x04  // debugMode or AC_CONTROL_MAX_SLEEP_MS changed
+#define CONTROL_EVENT_TIME     0x08  // NTP servers or UTC offset changed
 
-// Function to safely copy rules for thread-safe access
-int copyRulesThreadSafe(ACRule localRules[], int maxRules);
+struct ControlWakeStats {
+  uint32_t samples;        // Sensor task wakeups
+  uint32_t wakeups;        // Control loop wakeups below
+  uint32_t timerWakes;     // Rule boundary or heartbeat deadline reached
+  uint32_t crossingWakes;
+  uint32_t ruleWakes;
+  uint32_t configWakes;
+};
 
-// Helper functions for state management
-bool hasACStateChanged(bool power, uint8_t temp, uint8_t fan, uint8_t mode, int vSwing, int hSwing);
-void updatePreviousACState(bool power, uint8_t temp, uint8_t fan, uint8_t mode, int vSwing, int hSwing);
+void notifyControlTask(uint32_t events);
+// Called by the sensor task after each sample; returns how long it may sleep
+// before the next one (controlSampleMs() against the current band)
+uint32_t reportTemperatureSample(float temp);
+ControlWakeStats getControlWakeStats();
 
 #endif
@@ -0,0 +1,148 @@
+#ifndef AC_FRAME_CACHE_H
+#define AC_FRAME_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "ac_backend.h"
+
+struct ACFrameCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+};
+
+// Pre-encoded frames for the handful of states a household cycles through,
+// for any backend (ac_backend.h). Keyed by the packed state word.
+// Capacity follows a RAM budget; when full the least recently used frame goes.
+// Entries live in one preallocated array and lookup is a scan of their keys,
+// which beats hashing at these sizes. Returned frames stay valid until the
+// next get()/put()/setBudget(). Not thread-safe.
+template <typename Backend>
+class ACFrameCache {
+public:
+    typedef ACFrame<Backend> Frame;
+
+    explicit ACFrameCache(size_t budgetBytes);
+
+    // Cached frame for `state`, encoding it on a miss
+    const Frame* get(const ACState& state);
+    // Lookup only (counts a hit); nullptr on a miss
+    const Frame* find(const ACState& state);
+    // Store a frame built from explicit protocol bytes, e.g. IRGreeAC's own
+    const Frame* put(const ACState& state, const uint8_t bytes[Backend::STATE_LENGTH]);
+
+    void setBudget(size_t budgetBytes);   // Evicts down to the new capacity
+    void clear() { entries.clear(); }
+
+    int size() const { return (int)entries.size(); }
+    int capacity() const { return (int)maxEntries; }
+    size_t getMemoryUsage() const { return entries.capacity() * sizeof(Entry); }
+    ACFrameCacheStats getStats() const { return stats; }
+
+    static size_t entryBytes() { return sizeof(Entry); }
+
+private:
+    struct Entry {
+        uint32_t key;
+        uint32_t lastUse;
+        Frame frame;
+    };
+
+    void moveOldestToBack();
+    Frame* slotFor(uint32_t key);
+
+    std::vector<Entry> entries;
+    size_t maxEntries;
+    uint32_t useClock;
+    ACFrameCacheStats stats;
+};
+
+template <typename Backend>
+ACFrameCache<Backend>::ACFrameCache(size_t budgetBytes) : maxEntries(0), useClock(0), stats{0, 0, 0} {
+  setBudget(budgetBytes);
+}
+
+template <typename Backend>
+void ACFrameCache<Backend>::setBudget(size_t budgetBytes) {
+  maxEntries = budgetBytes / sizeof(Entry);
+  while (entries.size() > maxEntries) {
+    moveOldestToBack();
+    entries.pop_back();
+    stats.evictions++;
+  }
+  // Rebuild at the exact size so the budget also bounds the allocation
+  std::vector<Entry> resized;
+  resized.reserve(maxEntries);
+  resized.assign(entries.begin(), entries.end());
+  entries.swap(resized);
+}
+
+template <typename Backend>
+const ACFrame<Backend>* ACFrameCache<Backend>::find(const ACState& state) {
+  for (Entry& entry : entries) {
+    if (entry.key == state.bits) {
+      entry.lastUse = ++useClock;
+      stats.hits++;
+      return &entry.frame;
+    }
+  }
+  return nullptr;
+}
+
+// Overwrite the least recently used entry with the last one, leaving the
+// back slot free for reuse or removal
+template <typename Backend>
+void ACFrameCache<Backend>::moveOldestToBack() {
+  size_t oldest = 0;
+  for (size_t i = 1; i < entries.size(); i++) {
+    if (entries[i].lastUse < entries[oldest].lastUse) oldest = i;
+  }
+  if (oldest != entries.size() - 1) entries[oldest] = entries.back();
+}
+
+// Slot for a new key: a free one while under capacity, else the least recently used one
+template <typename Backend>
+ACFrame<Backend>* ACFrameCache<Backend>::slotFor(uint32_t key) {
+  if (maxEntries == 0) return nullptr;
+  if (entries.size() < maxEntries) {
+    entries.push_back(Entry());
+  } else {
+    moveOldestToBack();
+    stats.evictions++;
+  }
+  Entry& entry = entries.back();
+  entry.key = key;
+  entry.lastUse = ++useClock;
+  return &entry.frame;
+}
+
+template <typename Backend>
+const ACFrame<Backend>* ACFrameCache<Backend>::put(const ACState& state, const uint8_t bytes[Backend::STATE_LENGTH]) {
+  Frame* frame = nullptr;
+  for (Entry& entry : entries) {
+    if (entry.key == state.bits) {
+      entry.lastUse = ++useClock;
+      frame = &entry.frame;
+      break;
+    }
+  }
+  if (!frame) frame = slotFor(state.bits);
+  if (!frame) return nullptr;
+  memcpy(frame->state, bytes, Backend::STATE_LENGTH);
+  Backend::encodeTimings(frame->state, frame->timings);
+  return frame;
+}
+
+template <typename Backend>
+const ACFrame<Backend>* ACFrameCache<Backend>::get(const ACState& state) {
+  const Frame* frame = find(state);
+  if (frame) return frame;
+  stats.misses++;
+  uint8_t bytes[Backend::STATE_LENGTH];
+  Backend::encodeState(state, bytes);
+  return put(state, bytes);
+}
+
+#endif
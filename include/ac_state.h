@@ -0,0 +1,127 @@
+#ifndef AC_STATE_H
+#define AC_STATE_H
+
+#include <stdint.h>
+
+// AC settings as passed to GreeACController, packed into one word so states
+// compare, hash and queue as a single uint32_t:
+//
+//   bit  0      power
+//   bits 1-7    temperature (whole °C)
+//   bits 8-11   fan speed (ACFanSpeed)
+//   bits 12-15  mode (ACMode)
+//   bits 16-19  vertical swing (ACSwingV)
+//   bits 20-23  horizontal swing (ACSwingH)
+#define AC_STATE_POWER_SHIFT 0
+#define AC_STATE_TEMP_SHIFT 1
+#define AC_STATE_FAN_SHIFT 8
+#define AC_STATE_MODE_SHIFT 12
+#define AC_STATE_SWING_V_SHIFT 16
+#define AC_STATE_SWING_H_SHIFT 20
+
+#define AC_STATE_POWER_MASK ((uint32_t)0x01 << AC_STATE_POWER_SHIFT)
+#define AC_STATE_TEMP_MASK ((uint32_t)0x7F << AC_STATE_TEMP_SHIFT)
+#define AC_STATE_FAN_MASK ((uint32_t)0x0F << AC_STATE_FAN_SHIFT)
+#define AC_STATE_MODE_MASK ((uint32_t)0x0F << AC_STATE_MODE_SHIFT)
+#define AC_STATE_SWING_V_MASK ((uint32_t)0x0F << AC_STATE_SWING_V_SHIFT)
+#define AC_STATE_SWING_H_MASK ((uint32_t)0x0F << AC_STATE_SWING_H_SHIFT)
+
+struct ACState {
+    uint32_t bits;
+
+    bool power() const { return (bits & AC_STATE_POWER_MASK) != 0; }
+    uint8_t temperature() const { return (bits & AC_STATE_TEMP_MASK) >> AC_STATE_TEMP_SHIFT; }
+    uint8_t fanSpeed() const { return (bits & AC_STATE_FAN_MASK) >> AC_STATE_FAN_SHIFT; }
+    uint8_t mode() const { return (bits & AC_STATE_MODE_MASK) >> AC_STATE_MODE_SHIFT; }
+    int vSwing() const { return (bits & AC_STATE_SWING_V_MASK) >> AC_STATE_SWING_V_SHIFT; }
+    int hSwing() const { return (bits & AC_STATE_SWING_H_MASK) >> AC_STATE_SWING_H_SHIFT; }
+
+    void setPower(bool on) { setField(AC_STATE_POWER_MASK, AC_STATE_POWER_SHIFT, on); }
+    void setTemperature(uint8_t temp) { setField(AC_STATE_TEMP_MASK, AC_STATE_TEMP_SHIFT, temp); }
+    void setFanSpeed(uint8_t fan) { setField(AC_STATE_FAN_MASK, AC_STATE_FAN_SHIFT, fan); }
+    void setMode(uint8_t mode) { setField(AC_STATE_MODE_MASK, AC_STATE_MODE_SHIFT, mode); }
+    void setVSwing(int position) { setField(AC_STATE_SWING_V_MASK, AC_STATE_SWING_V_SHIFT, position); }
+    void setHSwing(int position) { setField(AC_STATE_SWING_H_MASK, AC_STATE_SWING_H_SHIFT, position); }
+
+private:
+    void setField(uint32_t mask, int shift, uint32_t value) {
+        bits = (bits & ~mask) | ((value << shift) & mask);
+    }
+};
+
+constexpr ACState makeACState(bool power, uint8_t temperature, uint8_t fanSpeed, uint8_t mode, int vSwing,
+                              int hSwing) {
+  return ACState{(uint32_t)(((uint32_t)power << AC_STATE_POWER_SHIFT) |
+                            (((uint32_t)temperature << AC_STATE_TEMP_SHIFT) & AC_STATE_TEMP_MASK) |
+                            (((uint32_t)fanSpeed << AC_STATE_FAN_SHIFT) & AC_STATE_FAN_MASK) |
+                            (((uint32_t)mode << AC_STATE_MODE_SHIFT) & AC_STATE_MODE_MASK) |
+                            (((uint32_t)vSwing << AC_STATE_SWING_V_SHIFT) & AC_STATE_SWING_V_MASK) |
+                            (((uint32_t)hSwing << AC_STATE_SWING_H_SHIFT) & AC_STATE_SWING_H_MASK))};
+}
+
+// State tracked after an OFF command sent because no rule matched
+#define AC_STATE_OFF makeACState(false, 24, 0, 0, 0, 0)
+
+inline bool acStateEquals(const ACState& a, const ACState& b) {
+  return a.bits == b.bits;
+}
+
+// Dirty bits: which fields differ between two states
+#define AC_DIRTY_POWER 0x01
+#define AC_DIRTY_TEMP 0x02
+#define AC_DIRTY_FAN 0x04
+#define AC_DIRTY_MODE 0x08
+#define AC_DIRTY_SWING_V 0x10
+#define AC_DIRTY_SWING_H 0x20
+
+inline uint8_t acStateDiff(const ACState& a, const ACState& b) {
+  uint32_t changed = a.bits ^ b.bits;
+  if (changed == 0) return 0;
+  return ((changed & AC_STATE_POWER_MASK) ? AC_DIRTY_POWER : 0) |
+         ((changed & AC_STATE_TEMP_MASK) ? AC_DIRTY_TEMP : 0) |
+         ((changed & AC_STATE_FAN_MASK) ? AC_DIRTY_FAN : 0) |
+         ((changed & AC_STATE_MODE_MASK) ? AC_DIRTY_MODE : 0) |
+         ((changed & AC_STATE_SWING_V_MASK) ? AC_DIRTY_SWING_V : 0) |
+         ((changed & AC_STATE_SWING_H_MASK) ? AC_DIRTY_SWING_H : 0);
+}
+
+struct ACStateChange {
+  uint32_t ms;        // millis() when the change was recorded
+  ACState state;      // State after the change
+  uint8_t dirty;      // AC_DIRTY_* fields that changed
+  uint8_t source;     // Who asked (IrTxSource on the device)
+};
+
+#define AC_STATE_HISTORY_LENGTH 16
+
+// The one record of what the AC has been told to do. Every writer (rules,
+// web remote) goes through update(), which drops requests that change
+// nothing and keeps the last AC_STATE_HISTORY_LENGTH changes.
+// Not thread-safe; the firmware guards it with the IR transmitter's mutex.
+class ACStateTracker {
+public:
+    explicit ACStateTracker(const ACState& initial);
+
+    // Record `next`; returns the changed AC_DIRTY_* fields, 0 for a no-op
+    // (nothing recorded, nothing to send)
+    uint8_t update(const ACState& next, uint8_t source, uint32_t ms);
+    // Take back the latest change, which never reached the AC: `previous`
+    // is current() from before that update()
+    void revert(const ACState& previous);
+
+    const ACState& current() const { return state; }
+    uint32_t getVersion() const { return version; }     // Changes recorded so far
+    uint32_t getNoOps() const { return noOps; }         // Updates dropped as unchanged
+    uint8_t getLastSource() const;                      // Source of the latest change
+
+    // Up to maxCount changes, newest first; returns the count written
+    int getHistory(ACStateChange* out, int maxCount) const;
+
+private:
+    ACState state;
+    uint32_t version;
+    uint32_t noOps;
+    ACStateChange history[AC_STATE_HISTORY_LENGTH];
+};
+
+#endif
@@ -2,10 +2,17 @@
 #define CONFIG_H
 
 #include <Arduino.h>
-
-// WiFi Configuration
-extern const char* ssid;
-extern const char* password;
+#include "rule_types.h"
+#include "rule_set.h"
+#include "rule_store.h"
+
+// WiFi Configuration (settable through /api/config, see config_store.h)
+#define WIFI_SSID_MAX 32
+#define WIFI_PASSWORD_MAX 64
+extern char ssid[WIFI_SSID_MAX + 1];
+extern char password[WIFI_PASSWORD_MAX + 1];
+extern const char* const defaultSsid;       // Tried when the saved network is not found
+extern const char* const defaultPassword;
 
 // ESP32-S3 Pin Definitions
 // Note: IR_RECV_PIN removed - no IR receiver required for Gree AC
@@ -19,56 +26,36 @@ extern const char* password;
 #define SCREEN_HEIGHT 32
 
 // Time Configuration
-extern const char* ntpServer;
-extern const long gmtOffset_sec;
-extern const int daylightOffset_sec;
+#define NTP_SERVER_COUNT 3        // As many as configTime() takes
+#define NTP_SERVER_MAX 64
+extern char ntpServers[NTP_SERVER_COUNT][NTP_SERVER_MAX + 1];   // "" = unused
+extern int32_t gmtOffset_sec;
+extern int32_t daylightOffset_sec;
 
 // Debug mode flag
 extern bool debugMode;
 
-// Rule-based AC Control Structure
-struct ACRule {
-  int id;                    // Unique rule ID
-  String name;               // Rule name/description
-  bool enabled;              // Rule active/inactive
-  
-  // Time conditions (optional - use -1 to ignore)
-  int startHour;             // Start hour (0-23, -1 = any)
-  int endHour;               // End hour (0-23, -1 = any)
-  
-  // Temperature conditions (optional - use -999 to ignore)
-  float minTemp;             // Minimum temperature (-999 = any)
-  float maxTemp;             // Maximum temperature (-999 = any)
-  
-  // AC Actions
-  bool acOn;                 // Turn AC on/off
-  float setTemp;             // Target temperature
-  int fanSpeed;              // Fan speed (0-3)
-  int mode;                  // AC mode (0=cool, 1=heat, 2=dry, 3=fan, 4=auto)
-  int vSwing;                // Vertical swing (0=auto, 1=top, 2=mid, 3=bottom)
-  int hSwing;                // Horizontal swing (0=auto, 1=left, 2=mid, 3=right)
-};
-
-#define MAX_RULES 10
+#define MAX_RULES 1024   // Heap guard only; rule storage is sized dynamically
 
 // Global Variables
 extern float currentTemp;
-extern ACRule rules[MAX_RULES];
-extern int ruleCount;
+extern RuleSet ruleSet;             // Editable rules, looked up by ID
+extern RuleNamePool ruleNames;      // Names referenced by ruleSet's nameIds
 extern int activeRuleId;
+extern RuleStore ruleStore;        // Published snapshots, read without blocking by controlTask
 
 // System configuration
-extern uint32_t AC_CONTROL_LOOP_INTERVAL_MS; // Sleep time for control loop in milliseconds
+extern uint32_t SENSOR_SAMPLE_INTERVAL_MS;   // Temperature sampling period in milliseconds
+extern uint32_t AC_CONTROL_MAX_SLEEP_MS;     // Longest control loop sleep without an event (keep < 1 hour)
 extern uint32_t DISPLAY_REFRESH_INTERVAL_MS;    // Sleep time for display refresh in milliseconds
+extern uint32_t IR_COALESCE_WINDOW_MS;       // Quiet time that ends a burst of web IR commands (0 = send each)
 
-// Mutex for thread-safe rule access
+// Mutex for thread-safe rule access (serializes edits of ruleSet)
 extern SemaphoreHandle_t rulesMutex;
 
 // Function declarations
 void initDefaultRules();
-void sortRules();
-void saveRulesToSPIFFS();
-void loadRulesFromSPIFFS();
 void initRulesMutex();
+void markRulesChanged();
 
 #endif
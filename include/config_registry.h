@@ -0,0 +1,57 @@
+#ifndef CONFIG_REGISTRY_H
+#define CONFIG_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// Typed settings that can be changed at run time. Each entry describes one
+// live variable: its name in JSON and NVS, its type and the values it
+// accepts. config_store.h holds the firmware's table; everything here works
+// on any table, so it is tested on the host.
+
+enum ConfigType : uint8_t {
+  CONFIG_BOOL,     // bool
+  CONFIG_INT,      // int32_t
+  CONFIG_UINT,     // uint32_t
+  CONFIG_STRING    // char[maxValue + 1]; min/max bound the length
+};
+
+#define CONFIG_SECRET 0x01   // Write-only string: reads only tell whether it is set
+#define CONFIG_REBOOT 0x02   // Read once at boot; a new value applies after a restart
+
+#define CONFIG_NAME_MAX 15   // NVS key length limit
+#define CONFIG_MAX_SETTINGS 32  // Changes are reported as a bit per setting
+
+struct ConfigSetting {
+  const char* name;
+  ConfigType type;
+  uint8_t flags;
+  void* value;
+  int32_t minValue;
+  int32_t maxValue;
+};
+
+struct ConfigApplyResult {
+  uint32_t changed;    // Bit i: settings[i] took a different value
+  char error[80];
+};
+
+const ConfigSetting* configFind(const ConfigSetting* settings, int count, const char* name);
+
+// Whether `value` has the setting's type and range; the reason if not
+bool configCheck(const ConfigSetting& setting, JsonVariantConst value, char* error, size_t errorSize);
+// Store a checked value; true if it differs from the current one
+bool configStore(const ConfigSetting& setting, JsonVariantConst value);
+
+// Apply {"name": value, ...} all or nothing: an unknown name or an invalid
+// value leaves every setting unchanged
+bool configApplyJson(const ConfigSetting* settings, int count, JsonObjectConst body,
+                     ConfigApplyResult& result);
+
+// Current values, secrets left out
+void configValuesToJson(const ConfigSetting* settings, int count, JsonObject out);
+// Type, range and flags of each setting, and whether secrets are set
+void configSchemaToJson(const ConfigSetting* settings, int count, JsonArray out);
+
+#endif
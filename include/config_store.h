@@ -0,0 +1,57 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config_registry.h"
+
+// Runtime settings of config.h, saved in NVS (namespace "config") and served
+// by GET/PUT /api/config. Values not in NVS keep their compiled defaults.
+// Numbers are read straight from their globals (32-bit reads are atomic);
+// strings are copied with copyConfigString().
+enum ConfigId {
+  CONFIG_WIFI_SSID,
+  CONFIG_WIFI_PASSWORD,
+  CONFIG_NTP_SERVER_1,
+  CONFIG_NTP_SERVER_2,
+  CONFIG_NTP_SERVER_3,
+  CONFIG_GMT_OFFSET,
+  CONFIG_DST_OFFSET,
+  CONFIG_DEBUG_MODE,
+  CONFIG_SENSOR_SAMPLE,
+  CONFIG_CONTROL_SLEEP,
+  CONFIG_DISPLAY_REFRESH,
+  CONFIG_IR_COALESCE,
+  CONFIG_COUNT
+};
+
+#define CONFIG_BIT(id) (1u << (id))
+#define CONFIG_TIME_SETTINGS (CONFIG_BIT(CONFIG_NTP_SERVER_1) | CONFIG_BIT(CONFIG_NTP_SERVER_2) | \
+                              CONFIG_BIT(CONFIG_NTP_SERVER_3) | CONFIG_BIT(CONFIG_GMT_OFFSET) | \
+                              CONFIG_BIT(CONFIG_DST_OFFSET))
+
+#define CONFIG_MAX_SUBSCRIBERS 8
+
+// Load saved values over the defaults. Call first in setup(), before the
+// globals are used.
+void initConfigStore();
+
+// Apply a PUT /api/config body (see configApplyJson()), save what changed and
+// notify the subscribers of those settings. `saved` is false if NVS refused
+// the write; the new values are live either way.
+bool updateConfig(JsonObjectConst body, ConfigApplyResult& result, bool& saved);
+
+// {"settings": {...}, "schema": [...]} for GET /api/config
+void configToJson(JsonDocument& doc);
+
+const ConfigSetting& configSetting(ConfigId id);
+void copyConfigString(ConfigId id, char* out, size_t size);
+
+// When any of `settings` (CONFIG_BIT mask) changes, xTaskNotify(task, events,
+// eSetBits). Tasks wait on their notification value instead of vTaskDelay()
+// and re-read the globals when woken.
+void configSubscribe(uint32_t settings, TaskHandle_t task, uint32_t events);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef CONTROL_SCHEDULE_H
+#define CONTROL_SCHEDULE_H
+
+#include <stdint.h>
+#include "rule_calendar.h"
+#include "rule_store.h"
+#include "ac_state.h"
+
+// When controlTask must next re-evaluate the rules.
+//
+// The decision for (time, temperature) can only change at a week slot whose
+// compiled row differs from the current one, at the midnight where a date
+// exception starts or ends, or when the temperature leaves the band of the
+// current table segment. Everything in between is a no-op,
+// so the control loop sleeps until the deadline and the sensor task wakes
+// it early on a band crossing.
+struct ControlWakePlan {
+    uint32_t sleepMs;   // Until the next slot or date change, capped at maxSleepMs
+    int32_t bandLow;    // Decision holds while bandLow <= temp < bandHigh
+    int32_t bandHigh;   // (centi-degrees)
+};
+
+// Extra delay past a minute boundary so the wall clock has rolled over on wake
+#define CONTROL_WAKE_SLACK_MS 500
+
+// `day` is the local date (ruleDayNumber()), `minuteOfWeek` the local time
+// (weekMinute()) and `secondsIntoMinute` the seconds past it
+ControlWakePlan planControlWake(const RuleCalendar& calendar, int32_t day, int minuteOfWeek,
+                                int secondsIntoMinute, int16_t tempCenti, uint32_t maxSleepMs);
+
+// True if a new sample may select a different rule than the plan was made for
+inline bool controlWakeCrossed(const ControlWakePlan& plan, int16_t tempCenti) {
+  return tempCenti < plan.bandLow || tempCenti >= plan.bandHigh;
+}
+
+// Sensor sampling away from the band edges. A crossing must be seen within
+// one base period, but a room needs minutes to move a degree, so a reading
+// well inside the band can wait longer for the next one.
+#define CONTROL_SAMPLE_GUARD_CENTI 30          // Noise and ripple: base period this close to an edge
+#define CONTROL_SAMPLE_SLEW_CENTI_PER_MIN 30   // Fastest room drift assumed, 0.3 °C a minute
+#define CONTROL_SAMPLE_MAX_MS 60000            // One sample per temperature history minute
+
+// Period until the next sample after reading `tempCenti` against `plan`:
+// sampleMs near an edge or after a crossing, up to CONTROL_SAMPLE_MAX_MS
+// (never below sampleMs) when the drift cannot reach an edge sooner
+uint32_t controlSampleMs(const ControlWakePlan& plan, int16_t tempCenti, uint32_t sampleMs);
+
+// AC settings a rule asks for while it matches
+ACState ruleTargetState(const ACRule& rule);
+
+// What the rules ask for at one (date, time, temperature) sample.
+// Shared by controlTask and the offline trace replay so both decide alike.
+struct ControlDecision {
+  int ruleIndex;      // Into snapshot.rules, -1 = no rule matched
+  ACState target;     // AC_STATE_OFF when no rule matched
+};
+
+ControlDecision decideControl(const RuleSnapshot& snapshot, int32_t day, int minuteOfWeek, int16_t tempCenti);
+
+// True if applying `decision` on top of the last sent state needs an IR
+// command: a matched rule sends on any difference, no match only turns a
+// running AC off
+inline bool controlNeedsCommand(const ControlDecision& decision, const ACState& current) {
+  return decision.ruleIndex != -1 ? !acStateEquals(decision.target, current) : current.power();
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef DAIKIN_CODEC_H
+#define DAIKIN_CODEC_H
+
+#include <stdint.h>
+#include "control_schedule.h"
+
+// Daikin (ARC4xx remote, IRDaikinESP) frame encoding and decoding without
+// IRremoteESP8266, the counterpart of gree_codec.h for Daikin units.
+//
+// The 35 byte state is IRDaikinESP's: three sections of 8, 8 and 19 bytes,
+// each starting 0x11 0xDA 0x27 and ending in a sum-of-bytes checksum. The
+// waveform is what IRsend::sendDaikin() emits: a 5 bit leader of zeros, then
+// each section with its own header, LSB first, followed by a gap.
+
+#define DAIKIN_STATE_LENGTH 35
+#define DAIKIN_FRAME_TIMINGS 584    // Alternating mark/space durations in us
+#define DAIKIN_CARRIER_KHZ 38
+
+#define DAIKIN_HDR_MARK 3650
+#define DAIKIN_HDR_SPACE 1623
+#define DAIKIN_BIT_MARK 428
+#define DAIKIN_ONE_SPACE 1280
+#define DAIKIN_ZERO_SPACE 428
+#define DAIKIN_GAP 29000            // Follows the zero space after each part
+#define DAIKIN_LEADER_BITS 5
+#define DAIKIN_SECTION1_LENGTH 8
+#define DAIKIN_SECTION2_LENGTH 8
+#define DAIKIN_SECTION3_LENGTH 19
+
+// Protocol field values (same numbers as the kDaikin* constants)
+#define DAIKIN_MODE_AUTO 0
+#define DAIKIN_MODE_DRY 2
+#define DAIKIN_MODE_COOL 3
+#define DAIKIN_MODE_HEAT 4
+#define DAIKIN_MODE_FAN 6
+#define DAIKIN_FAN_MIN 1
+#define DAIKIN_FAN_MAX 5
+#define DAIKIN_FAN_AUTO 0x0A
+#define DAIKIN_FAN_QUIET 0x0B
+#define DAIKIN_SWING_ON 0x0F
+#define DAIKIN_SWING_OFF 0x00
+#define DAIKIN_MIN_TEMP 10
+#define DAIKIN_MAX_TEMP 32
+
+// ACState -> protocol bytes. Daikin vanes either swing or hold, so auto
+// swing maps to swinging and any fixed position to holding.
+void daikinEncodeState(const ACState& state, uint8_t out[DAIKIN_STATE_LENGTH]);
+// Sum of a section's bytes before its last (checksum) byte
+uint8_t daikinChecksum(const uint8_t* section, uint8_t length);
+bool daikinChecksumsValid(const uint8_t state[DAIKIN_STATE_LENGTH]);
+
+// Protocol bytes -> raw timings for IRsend::sendRaw(); returns the entry count
+uint16_t daikinEncodeTimings(const uint8_t state[DAIKIN_STATE_LENGTH], uint16_t out[DAIKIN_FRAME_TIMINGS]);
+
+// Raw timings -> protocol bytes with IRrecv's matching (ir_timing.h); the
+// final gap may be missing. False if the timings are not one Daikin frame or
+// a section checksum is wrong.
+bool daikinDecodeTimings(const uint16_t* timings, uint16_t count, uint8_t out[DAIKIN_STATE_LENGTH]);
+
+// Protocol bytes -> ACState. Held vanes read as the middle position; timers,
+// powerful and econo are dropped.
+void daikinDecodeState(const uint8_t state[DAIKIN_STATE_LENGTH], ACState& out);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef GREE_CODEC_H
+#define GREE_CODEC_H
+
+#include <stdint.h>
+#include "control_schedule.h"
+
+// Gree (YAW1F remote) frame encoding and decoding without IRremoteESP8266,
+// so frames can be built, cached, checked and benchmarked on the host.
+//
+// The 8 byte state uses the IRGreeAC layout and checksum. The waveform is
+// what IRsend::sendGree() emits: header, bytes 0-3 LSB first, a 3 bit block
+// footer (0b010), a message gap, bytes 4-7 and a final gap.
+
+#define GREE_STATE_LENGTH 8
+#define GREE_FRAME_TIMINGS 140      // Alternating mark/space durations in us
+#define GREE_CARRIER_KHZ 38
+
+#define GREE_HDR_MARK 9000
+#define GREE_HDR_SPACE 4500
+#define GREE_BIT_MARK 620
+#define GREE_ONE_SPACE 1600
+#define GREE_ZERO_SPACE 540
+#define GREE_MSG_SPACE 19980
+#define GREE_BLOCK_FOOTER 0b010
+#define GREE_BLOCK_FOOTER_BITS 3
+
+// Protocol field values (same numbers as the kGree* constants)
+#define GREE_MODE_AUTO 0
+#define GREE_MODE_COOL 1
+#define GREE_MODE_DRY 2
+#define GREE_MODE_FAN 3
+#define GREE_MODE_HEAT 4
+#define GREE_SWING_V_AUTO 1
+#define GREE_SWING_V_UP 2
+#define GREE_SWING_V_MIDDLE 4
+#define GREE_SWING_V_DOWN 6
+#define GREE_SWING_H_AUTO 1
+#define GREE_SWING_H_LEFT 3
+#define GREE_SWING_H_MIDDLE 4
+#define GREE_SWING_H_RIGHT 5
+#define GREE_MIN_TEMP 16
+#define GREE_MAX_TEMP 30
+
+// ACState -> protocol bytes with the same mapping as GreeACController's
+// setters, including the library's AUTO (25 °C) and DRY (fan 1) locks
+void greeEncodeState(const ACState& state, uint8_t out[GREE_STATE_LENGTH]);
+uint8_t greeChecksum(const uint8_t state[GREE_STATE_LENGTH]);
+
+// Protocol bytes -> raw timings for IRsend::sendRaw(); returns the entry count
+uint16_t greeEncodeTimings(const uint8_t state[GREE_STATE_LENGTH], uint16_t out[GREE_FRAME_TIMINGS]);
+
+// Raw timings -> protocol bytes, matched with IRrecv's tolerance and mark
+// excess (ir_timing.h). Accepts IRrecvDumpV2 captures, whose final gap is
+// usually missing. False if the timings are not one Gree frame or the checksum is wrong.
+bool greeDecodeTimings(const uint16_t* timings, uint16_t count, uint8_t out[GREE_STATE_LENGTH]);
+
+// Protocol bytes -> ACState. Remote settings ACState has no field for (timer,
+// light, sleep, ...) are dropped and swing positions round to the nearest.
+void greeDecodeState(const uint8_t state[GREE_STATE_LENGTH], ACState& out);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef HTTP_ETAG_H
+#define HTTP_ETAG_H
+
+#include <string.h>
+
+// If-None-Match test of a conditional GET: true when `ifNoneMatch` lists
+// `etag` (a quoted entity tag) or is "*", i.e. the answer is 304.
+// Browsers may send several tags ("a", "b") and mark them weak (W/"a");
+// If-None-Match uses the weak comparison, so the W/ prefix is ignored.
+inline bool etagMatches(const char* ifNoneMatch, const char* etag) {
+  if (ifNoneMatch == nullptr || etag == nullptr) return false;
+  if (strncmp(etag, "W/", 2) == 0) etag += 2;
+  size_t etagLength = strlen(etag);
+
+  const char* p = ifNoneMatch;
+  for (;;) {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (*p == '\0') return false;
+    if (*p == '*') return true;
+    if (strncmp(p, "W/", 2) == 0) p += 2;
+
+    // One tag: a quoted string (no commas inside) or, from sloppy clients,
+    // a bare token up to the next comma
+    const char* end = p;
+    if (*p == '"') {
+      end = strchr(p + 1, '"');
+      end = end ? end + 1 : p + strlen(p);
+    } else {
+      while (*end != '\0' && *end != ',') end++;
+      while (end > p && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    }
+    if ((size_t)(end - p) == etagLength && strncmp(p, etag, etagLength) == 0) return true;
+    p = end;
+  }
+}
+
+#endif
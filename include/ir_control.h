@@ -5,6 +5,8 @@
 #include <IRsend.h>
 #include <ir_Gree.h>
 #include "config.h"
+#include "control_schedule.h"
+#include "ac_backend.h"
 
 // Gree AC Control Interface
 class GreeACController {
@@ -49,6 +51,10 @@ public:
     void clearTimer();
     
     // Command Control
+    void applyState(const ACState& state); // Configure every setting, nothing sent
+    void sendFrame();                      // One frame, no repeats or delays (see ir_transmitter.h)
+    void sendRawFrame(const uint16_t* timings, uint16_t count); // Pre-encoded frame (gree_codec.h)
+    const uint8_t* getRawState();          // Protocol bytes of the configured state
     void sendCommand();
     void sendAllSettings(); // Send all configured settings at once
     void sendRawCommand(); // Alternative method for Chinese ACs
@@ -69,8 +75,53 @@ struct GreeACSetting {
     uint16_t timer;       // minutes, 0=off
 };
 
+// Controller for backends sent straight from our encoder (ac_backend.h)
+// rather than an IRremoteESP8266 class: applyState() builds the frame and
+// it goes out through IRsend::sendRaw(). Same interface irTransmitTask uses
+// on GreeACController.
+template <typename Backend>
+class CodecACController {
+private:
+    IRsend irsend;
+    ACState state;
+    ACFrame<Backend> frame;     // Encoded state; a member so the IR task's stack stays small
+
+public:
+    CodecACController() : irsend(IR_SEND_PIN), state(AC_STATE_OFF) {
+        Backend::encodeFrame(state, frame);
+    }
+
+    void init() {
+        irsend.begin();
+        Serial.printf("Initializing %s AC (frames from our encoder)\n", Backend::name());
+        sendFrame();
+        delay(500);
+        sendFrame(); // Send twice for reliability
+        Serial.println("AC ready for control");
+    }
+
+    void applyState(const ACState& next) {
+        state = next;
+        Backend::encodeFrame(state, frame);
+    }
+    void sendFrame() { sendRawFrame(frame.timings, Backend::FRAME_TIMINGS); }
+    void sendRawFrame(const uint16_t* timings, uint16_t count) {
+        irsend.sendRaw(timings, count, Backend::CARRIER_KHZ);
+    }
+    const uint8_t* getRawState() { return frame.state; }
+    bool isReady() { return true; }
+};
+
+// The controller this build sends with: IRGreeAC for Gree, our encoder for
+// the other backends
+#ifdef AC_BACKEND_GREE
+typedef GreeACController ACController;
+#else
+typedef CodecACController<ACProtocol> ACController;
+#endif
+
 // Global AC controller instance
-extern GreeACController greeAC;
+extern ACController acController;
 
 // Simplified API functions (backward compatibility)
 void initIR();
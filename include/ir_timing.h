@@ -0,0 +1,69 @@
+#ifndef IR_TIMING_H
+#define IR_TIMING_H
+
+#include <stdint.h>
+
+// Pulse-distance bits shared by the protocol codecs (gree_codec.h,
+// midea_codec.h, daikin_codec.h): every bit is a mark followed by a short (0)
+// or long (1) space. Matching follows IRrecv, so a capture from a real
+// receiver decodes here exactly when it would with the library.
+#define IR_TOLERANCE_PERCENT 25   // IRrecv's kTolerance
+#define IR_MARK_EXCESS 50         // kMarkExcess: receivers stretch marks
+
+struct IrBitTimings {
+  uint16_t mark;
+  uint16_t oneSpace;
+  uint16_t zeroSpace;
+};
+
+inline bool irMatch(uint16_t measured, int32_t expected) {
+  int32_t delta = expected * IR_TOLERANCE_PERCENT / 100;
+  return measured >= expected - delta && measured <= expected + delta;
+}
+
+inline bool irMatchMark(uint16_t measured, int32_t expected) {
+  return irMatch(measured, expected + IR_MARK_EXCESS);
+}
+
+inline bool irMatchSpace(uint16_t measured, int32_t expected) {
+  return irMatch(measured, expected - IR_MARK_EXCESS);
+}
+
+// Message gaps are only bounded below, as in IRrecv::matchAtLeast()
+inline bool irMatchGap(uint16_t measured, int32_t expected) {
+  return measured >= (expected - IR_MARK_EXCESS) * (100 - IR_TOLERANCE_PERCENT) / 100;
+}
+
+// `bits` bits of `value` as mark/space pairs, LSB first unless `msbFirst`;
+// returns the next free slot
+inline uint16_t* irEncodeBits(uint16_t* out, uint32_t value, int bits, const IrBitTimings& timing,
+                              bool msbFirst = false) {
+  for (int i = 0; i < bits; i++) {
+    uint32_t bit = msbFirst ? (value >> (bits - 1 - i)) & 1 : (value >> i) & 1;
+    *out++ = timing.mark;
+    *out++ = bit ? timing.oneSpace : timing.zeroSpace;
+  }
+  return out;
+}
+
+// Bits from mark/space pairs, the inverse of irEncodeBits(); advances `p`.
+// False on a pulse that is neither bit.
+inline bool irDecodeBits(const uint16_t*& p, int bits, const IrBitTimings& timing, uint32_t& value,
+                         bool msbFirst = false) {
+  value = 0;
+  for (int i = 0; i < bits; i++, p += 2) {
+    if (!irMatchMark(p[0], timing.mark)) return false;
+    uint32_t bit;
+    if (irMatchSpace(p[1], timing.oneSpace)) {
+      bit = 1;
+    } else if (irMatchSpace(p[1], timing.zeroSpace)) {
+      bit = 0;
+    } else {
+      return false;
+    }
+    value |= bit << (msbFirst ? bits - 1 - i : i);
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef IR_TRANSMITTER_H
+#define IR_TRANSMITTER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "control_schedule.h"
+#include "ac_frame_cache.h"
+
+// Non-blocking IR output. Callers queue the AC state they want and return
+// immediately; irTransmitTask applies it to acController and owns the repeat and
+// spacing policy, so the control task and web handlers never sit in delay().
+//
+// The transmitter also owns the one authoritative AC state (an
+// ACStateTracker): what the last accepted request told the AC to do. The
+// control loop, web remote and display all read it via getCurrentACState().
+
+// Who asked for a state; selects the repeat policy
+enum IrTxSource : uint8_t {
+  IR_TX_RULE = 0,     // controlTask rule decisions
+  IR_TX_MANUAL = 1    // Web remote buttons
+};
+
+// Frames per command and the gaps around them. Chinese-market Gree units miss
+// single frames now and then, so every command is repeated.
+struct IrRepeatPolicy {
+  uint8_t frames;
+  uint16_t spacingMs;   // Between repeats of one command
+  uint16_t settleMs;    // After the last repeat, before the next command
+};
+
+enum IrTxResult : uint8_t {
+  IR_TX_QUEUED = 0,
+  IR_TX_UNCHANGED = 1,   // The AC already has this state; nothing queued
+  IR_TX_FAILED = 2
+};
+
+struct IrTxStats {
+  uint32_t commands;        // Commands fully transmitted
+  uint32_t frames;
+  uint32_t dropped;         // Oldest requests discarded because the queue was full
+  uint32_t coalesced;       // Requests merged into a later one instead of being sent
+  uint32_t unchanged;       // Requests that matched the current state, never queued
+  uint32_t suppressed;      // Merged requests that ended where the last transmission left the AC
+  uint32_t framesSaved;     // Frames those merged requests would have sent
+  uint32_t queueDepth;      // Requests waiting right now
+  uint32_t maxQueueDepth;
+  uint32_t lastLatencyMs;   // First merged request queued to start of frame, latest frame
+  uint32_t maxLatencyMs;
+  uint64_t latencySumMs;    // Divide by frames for the mean
+  uint64_t airtimeUs;       // Total time spent emitting frames
+  uint32_t cachedFrames;    // Frames sent from the pre-encoded cache
+  uint32_t libraryFrames;   // Frames sent by acController.sendFrame() instead
+  uint32_t controllerEncodes; // Commands acController encoded (cache misses, or all with IR_VERIFY_FRAMES)
+  uint32_t codecMismatches; // Cached bytes that disagreed with the controller and were replaced
+  ACFrameCacheStats frameCache;
+  int frameCacheEntries;
+  uint32_t frameCacheBytes;
+};
+
+#define IR_TX_QUEUE_LENGTH 8
+#define IR_COALESCE_MAX_WINDOWS 4   // Bounds the wait while clicks keep arriving
+#define IR_FRAME_CACHE_BYTES 4096   // RAM for pre-encoded frames (13 Gree, 9 Midea or 3 Daikin states)
+
+void initIrTransmitter();   // Create the queue; call before the first queueACState()
+void irTransmitTask(void* param);
+
+// Record `state` as the AC's state and queue it for transmission. A state
+// equal to the current one is a no-op (IR_TX_UNCHANGED) unless `force` is
+// set (debug mode). Never blocks: when the queue is full the oldest request
+// is dropped, since only the latest state matters. A request that still
+// cannot be queued (IR_TX_FAILED) leaves the recorded state as it was.
+IrTxResult queueACState(const ACState& state, IrTxSource source, bool force = false);
+
+// Take one request (waiting up to `wait` ticks) and transmit it with its
+// repeat policy. Returns false if none arrived. irTransmitTask loops on this;
+// the host simulator calls it with 0 to drain the queue.
+//
+// Requests carry complete states, so bursts coalesce last-writer-wins: any
+// request already queued replaces the one taken, and after a web request the
+// task keeps merging until IR_COALESCE_WINDOW_MS passes without a new one
+// (at most IR_COALESCE_MAX_WINDOWS windows). Five quick "temp up" clicks
+// become one command for the final temperature. Rule requests do not wait.
+// If a burst ends where the last transmission left the AC (up then down),
+// nothing is sent.
+//
+// Frames come from an ACFrameCache for the build's backend (ac_backend.h).
+// A hit is sent without touching the controller. On a miss the controller
+// encodes the state and its bytes are cached; on Gree builds that is
+// IRGreeAC, so the library stays the reference encoding for new states.
+// Build with -DIR_VERIFY_FRAMES to have the controller encode every command
+// and replace cached bytes that differ (counted in codecMismatches).
+bool serviceIrTransmitQueue(TickType_t wait);
+
+// Encode the frames for every enabled rule's target and for OFF, so rule
+// commands go out without encoding. Called when the rules change; LRU
+// eviction keeps the cache within IR_FRAME_CACHE_BYTES.
+void precomputeIrFrames(const ACRule* rules, int count);
+
+// Latest accepted state, i.e. where the AC is heading, and who made that
+// change. False if the state lock timed out; there is no safe default to
+// build a command on, so callers must not guess.
+bool getCurrentACState(ACState& state, IrTxSource* source = NULL);
+// Recent state changes, newest first; returns the count written
+int getACStateHistory(ACStateChange* out, int maxCount);
+IrTxStats getIrTxStats();
+
+#endif
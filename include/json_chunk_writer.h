@@ -0,0 +1,124 @@
+#ifndef JSON_CHUNK_WRITER_H
+#define JSON_CHUNK_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+// ArduinoJson writer (serializeJson(doc, writer)) into a response send
+// buffer: the first `capacity` bytes go to `buffer`, anything past that is
+// appended to `carry` for the next buffer. Every byte is written once, so a
+// body produced piece by piece costs one serialization in total.
+class JsonChunkWriter {
+public:
+    JsonChunkWriter(uint8_t* buffer, size_t capacity, std::string& carry)
+        : buffer(buffer), capacity(capacity), used(0), carry(carry) {}
+
+    size_t write(uint8_t c) {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t length) {
+        size_t count = length < capacity - used ? length : capacity - used;
+        memcpy(buffer + used, data, count);
+        used += count;
+        if (count < length) carry.append((const char*)data + count, length - count);
+        return length;
+    }
+
+    size_t write(const char* text) {
+        return write((const uint8_t*)text, strlen(text));
+    }
+
+    size_t copied() const { return used; }       // Bytes placed in the buffer
+    bool full() const { return used == capacity; }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    std::string& carry;
+};
+
+// Body of the form  prefix item,item,...,item suffix  sent through a chunked
+// response filler one item at a time, so neither the list nor its text is
+// ever held whole: the heap carries at most the tail of one item that did
+// not fit the previous send buffer. Items are numbered [first, end) and read
+// when their turn comes.
+class JsonListStream {
+public:
+    // Writer handed to the item callback; puts the separating comma in front
+    // of the item's first byte, so an item that writes nothing leaves no gap
+    class ItemWriter {
+    public:
+        size_t write(uint8_t c) {
+            return write(&c, 1);
+        }
+
+        size_t write(const uint8_t* data, size_t length) {
+            if (length == 0) return 0;
+            if (!wrote && comma) out.write((uint8_t)',');
+            wrote = true;
+            return out.write(data, length);
+        }
+
+        size_t write(const char* text) {
+            return write((const uint8_t*)text, strlen(text));
+        }
+
+    private:
+        friend class JsonListStream;
+        ItemWriter(JsonChunkWriter& out, bool comma) : out(out), comma(comma), wrote(false) {}
+
+        JsonChunkWriter& out;
+        bool comma;
+        bool wrote;
+    };
+
+    JsonListStream(const std::string& prefix, const std::string& suffix, uint32_t first, uint32_t end)
+        : prefix(prefix), suffix(suffix), next(first), end(end), part(PREFIX), items(0) {}
+
+    // Fill `buffer` with the next bytes of the body; returns 0 once it is all
+    // sent. writeItem(index, ItemWriter&) writes item `index` (serializeJson()
+    // or raw text) or nothing to leave it out.
+    template <typename WriteItem>
+    size_t fill(uint8_t* buffer, size_t maxLen, WriteItem writeItem) {
+        size_t used = carry.size() < maxLen ? carry.size() : maxLen;
+        memcpy(buffer, carry.data(), used);
+        carry.erase(0, used);
+
+        while (used < maxLen && part != DONE) {
+            JsonChunkWriter out(buffer + used, maxLen - used, carry);
+            if (part == PREFIX) {
+                out.write((const uint8_t*)prefix.data(), prefix.size());
+                part = ITEMS;
+            } else if (part == ITEMS && next < end) {
+                ItemWriter item(out, items > 0);
+                writeItem(next++, item);
+                if (item.wrote) items++;
+            } else {
+                out.write((const uint8_t*)suffix.data(), suffix.size());
+                part = DONE;
+            }
+            used += out.copied();
+        }
+        return used;
+    }
+
+    uint32_t itemsWritten() const { return items; }
+    size_t carried() const { return carry.capacity(); }   // Heap held between fills
+
+private:
+    enum Part { PREFIX, ITEMS, DONE };   // Suffix follows the last item
+
+    std::string prefix;
+    std::string suffix;
+    uint32_t next;
+    uint32_t end;
+    Part part;
+    uint32_t items;
+    std::string carry;      // Bytes written past the end of the last buffer
+};
+
+#endif
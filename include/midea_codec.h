@@ -0,0 +1,57 @@
+#ifndef MIDEA_CODEC_H
+#define MIDEA_CODEC_H
+
+#include <stdint.h>
+#include "control_schedule.h"
+
+// Midea (R05D/R51 style remote) frame encoding and decoding without
+// IRremoteESP8266, the counterpart of gree_codec.h for Midea units.
+//
+// The 6 byte state is IRMideaAC's 48 bit command word in transmit order:
+// byte 0 is the header/type byte, byte 5 the checksum. The waveform is what
+// IRsend::sendMidea() emits: the word MSB first, then the same word with
+// every bit inverted, each with its own header and gap.
+
+#define MIDEA_STATE_LENGTH 6
+#define MIDEA_FRAME_TIMINGS 200     // Two 48 bit copies, alternating mark/space in us
+#define MIDEA_CARRIER_KHZ 38
+
+#define MIDEA_HDR_MARK 4480
+#define MIDEA_HDR_SPACE 4480
+#define MIDEA_BIT_MARK 560
+#define MIDEA_ONE_SPACE 1680
+#define MIDEA_ZERO_SPACE 560
+#define MIDEA_MIN_GAP 5600
+
+// Protocol field values (same numbers as the kMideaAC* constants)
+#define MIDEA_HEADER_COMMAND 0xA1   // Header 0b10100, type 0b001 (command)
+#define MIDEA_MODE_COOL 0
+#define MIDEA_MODE_DRY 1
+#define MIDEA_MODE_AUTO 2
+#define MIDEA_MODE_HEAT 3
+#define MIDEA_MODE_FAN 4
+#define MIDEA_FAN_AUTO 0
+#define MIDEA_FAN_LOW 1
+#define MIDEA_FAN_MED 2
+#define MIDEA_FAN_HIGH 3
+#define MIDEA_MIN_TEMP 17
+#define MIDEA_MAX_TEMP 30
+#define MIDEA_MIN_TEMP_F 62         // Temperature field origin in Fahrenheit mode
+
+// ACState -> protocol bytes (Celsius, no timer, room sensor off). Swing is a
+// separate toggle message on Midea, so both swing fields are ignored.
+void mideaEncodeState(const ACState& state, uint8_t out[MIDEA_STATE_LENGTH]);
+uint8_t mideaChecksum(const uint8_t state[MIDEA_STATE_LENGTH]);
+
+// Protocol bytes -> raw timings for IRsend::sendRaw(); returns the entry count
+uint16_t mideaEncodeTimings(const uint8_t state[MIDEA_STATE_LENGTH], uint16_t out[MIDEA_FRAME_TIMINGS]);
+
+// Raw timings -> protocol bytes with IRrecv's matching (ir_timing.h); the
+// final gap may be missing. False if the timings are not one Midea command,
+// the inverted copy disagrees or the checksum is wrong.
+bool mideaDecodeTimings(const uint16_t* timings, uint16_t count, uint8_t out[MIDEA_STATE_LENGTH]);
+
+// Protocol bytes -> ACState; Fahrenheit frames are converted, swing reads as auto
+void mideaDecodeState(const uint8_t state[MIDEA_STATE_LENGTH], ACState& out);
+
+#endif
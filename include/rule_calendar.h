@@ -0,0 +1,52 @@
+#ifndef RULE_CALENDAR_H
+#define RULE_CALENDAR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "rule_types.h"
+#include "rule_engine.h"
+
+// Weekly decision tables switched by date for holiday exceptions.
+//
+// Table 0 is compiled from every rule. Each distinct set of rules excluded
+// by overlapping date exceptions gets its own table, and the calendar is cut
+// into date spans at every exception start and end, each pointing at the
+// table for its excluded set. An exception covers the windows that start on
+// its dates, so for an overnight rule the set also changes the morning after
+// its first and last day (see RULE_EXCLUDED_YESTERDAY). Answering "which rule applies now" is therefore
+// a span search over the (few) exception edges plus a weekly table lookup,
+// and "when does the set next change" is the nearer of the table's next slot
+// and the next span edge.
+class RuleCalendar {
+public:
+    RuleCalendar();
+
+    // Rules in evaluation order; exceptions for unknown or disabled rules are ignored
+    void compile(const ACRule rules[], int count, const RuleDateException exceptions[], int exceptionCount);
+    void clear();
+
+    // Decision table for this date (days since 2000-01-01, see ruleDayNumber())
+    const RuleDecisionTable& tableFor(int32_t day) const;
+    // Days from `day` until a different table applies, or 0 if never
+    int daysUntilChange(int32_t day) const;
+
+    int lookup(int32_t day, int minuteOfWeek, int16_t tempCenti) const {
+        return tableFor(day).lookup(minuteOfWeek, tempCenti);
+    }
+
+    bool isCompiled() const { return tables[0].isCompiled(); }
+    int getTableCount() const { return (int)tables.size(); }
+    int getSpanCount() const { return (int)spanStart.size(); }
+    size_t getMemoryUsage() const;
+
+private:
+    int findSpan(int32_t day) const;
+
+    std::vector<RuleDecisionTable> tables;  // [0] applies outside every exception
+    // Span i covers days [spanStart[i], spanStart[i + 1]), the last one onwards
+    std::vector<int32_t> spanStart;
+    std::vector<uint16_t> spanTable;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "rule_types.h"
+
+// Rule condition helpers (shared by the linear scan and the rule compiler)
+// Times are minutes of the week (see weekMinute()), temperatures are
+// fixed-point centi-degrees (see tempToCenti())
+bool ruleActiveAt(const ACRule& rule, int minuteOfWeek);
+bool ruleMatchesTemp(const ACRule& rule, int16_t tempCenti);
+
+// A date exception excludes a rule's windows that start on the excepted
+// date, so an overnight window is matched against the day it started on:
+// its early-morning tail is excluded the day after.
+#define RULE_EXCLUDED_TODAY     0x01  // Windows starting on the table's date
+#define RULE_EXCLUDED_YESTERDAY 0x02  // Overnight tails of the day before's windows
+#define RULE_EXCLUDED_ALL       (RULE_EXCLUDED_TODAY | RULE_EXCLUDED_YESTERDAY)
+
+// True if the rule has an overnight window (equal ends cover 24 hours)
+bool ruleOvernight(const ACRule& rule);
+
+// Reference first-match scan over the rule list.
+// Returns the index of the first enabled matching rule, or -1 if none match.
+int findMatchingRuleLinear(const ACRule rules[], int count, int minuteOfWeek, int16_t tempCenti);
+
+// Precomputed decision table: week time slot x temperature interval -> winning rule index.
+//
+// The week is split at every window start/end and weekday edge of the
+// compiled rules, so the same rules are active for the whole of a slot. The
+// temperature axis is split at every distinct minTemp and maxTemp + 1, so
+// every temperature inside a bucket matches exactly the same set of rules.
+// compile() resolves first-match priority once per (slot, bucket) cell and
+// stores each slot's row as an interval index: adjacent buckets with the same
+// winner are merged into one segment, slots with identical rows share storage
+// and adjacent slots with the same row are merged. Size therefore grows with
+// the number of distinct decisions. lookup() finds the slot through an
+// hour-of-week index, then binary-searches its segments. Rebuild only when the
+// rule set changes.
+class RuleDecisionTable {
+public:
+    RuleDecisionTable();
+
+    // Compile rules given in evaluation order (see ruleHigherPriority()).
+    // Returned indices refer to this array. `excluded` holds RULE_EXCLUDED_*
+    // bits per rule for the date the table applies to (date exceptions, see
+    // RuleCalendar).
+    void compile(const ACRule rules[], int count, const uint8_t* excluded = nullptr);
+    void clear();
+
+    // Index of the winning rule at this minute of the week/temperature, or -1
+    int lookup(int minuteOfWeek, int16_t tempCenti) const;
+
+    // Minutes from `minuteOfWeek` until the decision row next changes
+    // (1-10079), or 0 if it is the same all week
+    int minutesUntilChange(int minuteOfWeek) const;
+    // Temperature interval [low, high) around tempCenti over which lookup()
+    // returns the same rule for this slot (INT32_MIN/INT32_MAX when unbounded)
+    void getTempBand(int minuteOfWeek, int16_t tempCenti, int32_t& low, int32_t& high) const;
+
+    bool isCompiled() const { return compiled; }
+    int getBucketCount() const { return bucketCount; }
+    int getSlotCount() const { return (int)slotStart.size(); }
+    int getRowCount() const { return (int)rowBegin.size(); }
+    int getSegmentCount() const { return (int)segmentStart.size(); }
+    size_t getMemoryUsage() const;
+
+private:
+    int findSlot(int minuteOfWeek) const;
+    int findSegment(int row, int16_t tempCenti) const;
+
+    // Slot s covers minutes [slotStart[s], slotStart[s + 1]) and decides by slotRow[s]
+    std::vector<uint16_t> slotStart;
+    std::vector<uint16_t> slotRow;
+    uint16_t hourSlot[7 * 24];         // Slot containing the start of each hour of the week
+
+    // Row r is segments [rowBegin[r], rowEnd[r]); segment s covers
+    // temperatures [segmentStart[s], segmentStart[s + 1])
+    std::vector<uint32_t> rowBegin;
+    std::vector<uint32_t> rowEnd;
+    std::vector<int32_t> segmentStart;
+    std::vector<int16_t> segmentRule;
+    int bucketCount;
+    bool compiled;
+};
+
+#endif
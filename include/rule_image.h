@@ -0,0 +1,73 @@
+#ifndef RULE_IMAGE_H
+#define RULE_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "rule_types.h"
+#include "rule_set.h"
+#include "rule_store.h"
+
+// Binary rule image: the saved form of a whole rule set, read in place.
+//
+//   header      32 bytes, see below
+//   records     ruleCount x recordSize: packed rule fields + u16 name index
+//   exceptions  exceptionCount x exceptionSize: u16 rule ID, first, last day
+//   names       nameCount x u32 offset into the text
+//   text        NUL-terminated names, stringBytes in total
+//
+// Header (little-endian): magic "RIM1", u16 version, u16 header size,
+// u16 rule count, u16 record size, u16 exception count, u16 exception size,
+// u16 name count, u16 reserved, u32 text bytes, u32 image size, u32 CRC-32
+// of the first 28 header bytes and everything after the header.
+//
+// Records are in evaluation order and exceptions sorted by exceptionLess().
+// Readers take the record and exception sizes from the header, so fields
+// appended in a later version are skipped by older firmware; the version
+// only changes for layouts they could not read. The image checks itself and
+// needs no parsing, so it works the same from a file read into RAM or from
+// a flash partition mapped into the address space.
+
+#define RULE_IMAGE_MAGIC 0x314D4952u   // "RIM1"
+#define RULE_IMAGE_VERSION 1
+#define RULE_IMAGE_HEADER_SIZE 32
+#define RULE_FIELDS_SIZE 22            // Packed ACRule without nameId
+#define RULE_IMAGE_RECORD_SIZE (RULE_FIELDS_SIZE + 2)
+#define RULE_IMAGE_EXCEPTION_SIZE 6
+
+// ACRule fields shared by image records and change log entries (rule_log.h).
+// Decoding leaves nameId at 0 and fails on a rule that could not have been
+// saved (ID 0, minute out of range).
+void ruleFieldsEncode(const ACRule& rule, uint8_t out[RULE_FIELDS_SIZE]);
+bool ruleFieldsDecode(const uint8_t in[RULE_FIELDS_SIZE], ACRule& rule);
+
+void ruleImageEncode(const RuleSnapshot& snapshot, std::vector<uint8_t>& out);
+
+// View of a checked image; points into the caller's buffer, copies nothing
+struct RuleImage {
+  const uint8_t* records;
+  const uint8_t* exceptions;
+  const uint8_t* nameOffsets;
+  const char* text;
+  uint16_t ruleCount;
+  uint16_t recordSize;
+  uint16_t exceptionCount;
+  uint16_t exceptionSize;
+  uint16_t nameCount;
+  uint32_t textBytes;
+  uint32_t size;       // Image bytes; the buffer may be longer (partition)
+};
+
+// Check header, section bounds and CRC. False for anything else, e.g. a
+// JSON record or an image of a newer version.
+bool ruleImageOpen(const uint8_t* data, size_t size, RuleImage& image);
+
+// Rule `index` in evaluation order; `name` points into the image
+bool ruleImageRule(const RuleImage& image, int index, ACRule& rule, const char*& name);
+RuleDateException ruleImageException(const RuleImage& image, int index);
+
+// Replace `rules` / `names` with the image's rules. Returns false, with the
+// rules part-loaded, on an invalid record or a duplicate ID.
+bool ruleImageLoad(const RuleImage& image, RuleSet& rules, RuleNamePool& names);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef RULE_JOURNAL_H
+#define RULE_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Crash-safe records for the saved rules.
+//
+// A record is the payload followed by a 16-byte trailer:
+//   magic "RJ01", sequence, payload length, CRC-32
+// (little-endian uint32 each), the CRC covering the payload and the first
+// 12 trailer bytes. The trailer is written last, so a write cut short at
+// any byte leaves a record whose trailer is missing, misplaced or fails the
+// CRC. Saves alternate between two slot files and never overwrite the slot
+// holding the newest valid record; loading takes the newest record that
+// checks out, which after an interrupted save is the previous one.
+
+#define JOURNAL_MAGIC 0x31304A52u   // "RJ01"
+#define JOURNAL_TRAILER_SIZE 16
+#define JOURNAL_SLOT_COUNT 2
+
+struct JournalRecord {
+  uint32_t sequence;   // Higher = newer, compared with wraparound
+  uint32_t length;     // Payload bytes, starting at offset 0
+};
+
+// CRC-32 (IEEE 802.3); pass the previous result to continue a running CRC
+uint32_t journalCrc32(uint32_t crc, const uint8_t* data, size_t length);
+
+// Checks a whole record (file contents) and fills `record` if it is valid
+bool journalCheck(const uint8_t* data, size_t size, JournalRecord& record);
+
+// True if sequence a was written after b
+inline bool journalNewer(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) > 0;
+}
+
+// Slot of the newest valid record, or -1 if there is none
+int journalNewestSlot(const bool valid[JOURNAL_SLOT_COUNT], const JournalRecord records[JOURNAL_SLOT_COUNT]);
+
+// Slot the next save must go to: never the one holding the newest record
+inline int journalNextSlot(int newestSlot) {
+  return newestSlot < 0 ? 0 : (newestSlot + 1) % JOURNAL_SLOT_COUNT;
+}
+
+// `payloadCrc` is journalCrc32() of the payload; the trailer fields are added to it
+void journalEncodeTrailer(uint32_t sequence, uint32_t length, uint32_t payloadCrc, uint8_t out[JOURNAL_TRAILER_SIZE]);
+
+// Print-style writer (serializeJson(doc, writer)) that passes bytes through
+// to `out` and finish() appends the trailer. Works with SPIFFS File and any
+// type with the same two write() overloads.
+template <typename Output>
+class JournalWriter {
+public:
+    explicit JournalWriter(Output& out) : out(out), crc(0), length(0), shortWrite(false) {}
+
+    size_t write(uint8_t c) {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t size) {
+        size_t written = out.write(data, size);
+        crc = journalCrc32(crc, data, written);
+        length += written;
+        if (written != size) shortWrite = true;
+        return written;
+    }
+
+    // Appends the trailer; false if any write came up short (disk full)
+    bool finish(uint32_t sequence) {
+        uint8_t trailer[JOURNAL_TRAILER_SIZE];
+        journalEncodeTrailer(sequence, length, crc, trailer);
+        return out.write(trailer, sizeof(trailer)) == sizeof(trailer) && !shortWrite;
+    }
+
+    uint32_t size() const { return length; }
+
+private:
+    Output& out;
+    uint32_t crc;
+    uint32_t length;
+    bool shortWrite;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef RULE_JSON_H
+#define RULE_JSON_H
+
+#include <ArduinoJson.h>
+#include <string>
+#include <vector>
+#include "rule_types.h"
+#include "rule_set.h"
+#include "rule_store.h"
+
+// /rules.json format version. Version 2 replaced whole-hour windows with
+// minute windows and added weekdays and date exceptions.
+#define RULES_FILE_VERSION 2
+
+// Map packed rules to and from the JSON format used by /rules.json and the
+// REST API. Absent conditions are written as -1 (times) / -999 (temperatures),
+// temperatures as floating-point degrees and dates as "YYYY-MM-DD".
+// The rule's exceptions are taken from the snapshot it belongs to.
+void ruleToJson(const ACRule& rule, const RuleSnapshot& snapshot, JsonObject out);
+
+// Missing fields fall back to the same defaults as a newly created rule;
+// ID and priority fall back to the given values. Version 1 "startHour" /
+// "endHour" are used when the minute fields are absent.
+void ruleFromJson(JsonObjectConst in, ACRule& rule, RuleNamePool& names, int fallbackId, int fallbackPriority);
+
+// [{"from": "YYYY-MM-DD", "to": "YYYY-MM-DD"}, ...]; invalid entries are
+// skipped and make it return false
+bool exceptionsFromJson(JsonArrayConst in, std::vector<RuleDateException>& out);
+
+// Outcome of applyRuleBatch(); failedOp is -1 when the body itself is wrong
+struct RuleBatchResult {
+  int created;
+  int updated;
+  int deleted;
+  int failedOp;
+  char error[80];
+};
+
+// PUT /api/rules/batch body, either a whole rule set or a list of edits:
+//   {"rules": [{rule}, ...]}
+//   {"ops": [{"op": "create", "rule": {rule}},
+//            {"op": "update", "id": 3, "rule": {fields to change}},
+//            {"op": "delete", "id": 4}]}
+// Rules use the ruleToJson() format plus optional "exceptions"; fields of the
+// wrong type or out of range are rejected rather than defaulted. Operations
+// apply in order, so a later one sees the earlier ones. Stops at the first
+// invalid operation and returns false with `rules` / `names` part-way
+// edited: apply to copies and keep them only on success.
+bool applyRuleBatch(JsonObjectConst batch, RuleSet& rules, RuleNamePool& names, int maxRules,
+                    RuleBatchResult& result);
+
+#define RULE_BATCH_MAX_ITEM 4096   // Longest single rule or op a RuleBatchStream takes
+
+// applyRuleBatch() for a body that arrives in pieces, as the web server
+// receives it: each element of "rules" / "ops" is parsed and applied on its
+// own, so the body is never held whole and a MAX_RULES set fits in RAM.
+// Same semantics and errors, except that a body with both lists is refused.
+// Only the elements are checked as JSON; the text around them is scanned
+// for brackets and the "rules" / "ops" key.
+class RuleBatchStream {
+public:
+    // Edits `rules` / `names` as elements arrive: pass copies
+    RuleBatchStream(RuleSet& rules, RuleNamePool& names, int maxRules);
+
+    // False once the batch has failed; later bytes are ignored
+    bool feed(const char* data, size_t length);
+    // Call after the last byte: false if the body was cut short or had no list
+    bool finish();
+    const RuleBatchResult& getResult() const { return result; }
+
+private:
+    enum ListKind : uint8_t { LIST_NONE, LIST_RULES, LIST_OPS };
+
+    bool fail(int failedOp, const char* format, const char* detail);
+    bool applyItem();
+
+    RuleSet& rules;
+    RuleNamePool& names;
+    int maxRules;
+    RuleBatchResult result;
+    ListKind list;
+    int depth;          // Open brackets, the body's own included
+    int op;             // Index of the element being collected
+    bool started;
+    bool closed;
+    bool failed;
+    bool inString;
+    bool escape;
+    bool inItem;
+    std::string key;    // Latest string at the body's top level
+    std::string item;   // Text of the element being collected
+    JsonDocument itemDoc;
+};
+
+// The type and range checks applyRuleBatch() makes on a rule's fields, for
+// other writers (the form-encoded PUT /api/rules). Absent fields pass.
+// Returns false with a message in `error` for the first bad one.
+bool checkRuleFields(JsonObjectConst in, char* error, size_t size);
+
+// Form format: "YYYY-MM-DD..YYYY-MM-DD" or single dates, comma separated.
+// Returns false (leaving `out` partially filled) on the first invalid entry.
+bool exceptionsFromText(const char* text, std::vector<RuleDateException>& out);
+
+bool parseRuleDate(const char* text, int32_t& day);
+void formatRuleDate(int32_t day, char* buffer, size_t size);   // Needs 11 bytes
+
+#endif
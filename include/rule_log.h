@@ -0,0 +1,80 @@
+#ifndef RULE_LOG_H
+#define RULE_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+#include "rule_types.h"
+#include "rule_set.h"
+#include "rule_store.h"
+
+// Per-rule change log kept next to the full rule record (rule_journal.h).
+//
+// A save appends one entry per rule that changed since the last save instead
+// of rewriting every rule; loading reads the full record and replays the log
+// on top. Entries name the sequence of the full record they apply to, so
+// after a compaction (new full record, log emptied) entries left over from
+// an interrupted compaction are recognized and skipped.
+//
+// Entry: u16 size, u8 op, u32 base sequence, payload, u32 CRC-32 of
+// everything before it (little-endian). PUT carries a rule record, DELETE
+// the rule ID. Replay stops at the first entry that is cut short or fails
+// its CRC (a save interrupted by a reset).
+
+#define RULE_LOG_PUT 1
+#define RULE_LOG_DELETE 2
+#define RULE_LOG_ENTRY_OVERHEAD 11   // size + op + base + CRC
+#define RULE_LOG_COMPACT_BYTES 8192  // Log size worth a new full record (at least)
+
+// Fold the log into a new full record once appending `pending` bytes would
+// make it bigger than both RULE_LOG_COMPACT_BYTES and the full record itself,
+// so loading never reads more than about twice the rule set
+inline bool ruleLogNeedsCompaction(size_t logBytes, size_t pending, size_t fullRecordBytes) {
+  size_t limit = fullRecordBytes > RULE_LOG_COMPACT_BYTES ? fullRecordBytes : RULE_LOG_COMPACT_BYTES;
+  return logBytes + pending > limit;
+}
+
+// Packed rule record: the ACRule fields (ruleFieldsEncode(), 22 bytes), the
+// name (u8 length, at most 255 bytes kept) and the date exceptions (u16
+// count, u16 first and last day each)
+void ruleRecordEncode(const ACRule& rule, const char* name, const RuleDateException exceptions[], int count,
+                      std::vector<uint8_t>& out);
+// Bytes consumed, or 0 if the record is malformed or runs past `size`
+size_t ruleRecordDecode(const uint8_t* data, size_t size, ACRule& rule, RuleNamePool& names,
+                        std::vector<RuleDateException>& exceptions);
+
+struct RuleLogReplayResult {
+  int applied;         // Entries applied to the rule set
+  int stale;           // Entries for an older full record, skipped
+  size_t validBytes;   // Length of the intact part of the log
+  bool torn;           // Trailing bytes that are not a complete entry
+};
+
+// Apply the log's entries for full record `base` to `rules` / `names`, in order
+RuleLogReplayResult ruleLogReplay(const uint8_t* data, size_t size, uint32_t base, RuleSet& rules,
+                                  RuleNamePool& names);
+
+// What flash holds for each rule (full record + log), as the CRC of its
+// record, so a save can tell which rules changed. Not thread-safe: owned
+// by the persistence code.
+class RuleLogTracker {
+public:
+    RuleLogTracker();
+
+    // Flash now holds exactly `snapshot` (after a load or a full record)
+    void reset(const RuleSnapshot& snapshot);
+    // Append a PUT for every new or changed rule and a DELETE for every
+    // removed one, and record them as written. Returns the entry count.
+    int diff(const RuleSnapshot& snapshot, uint32_t base, std::vector<uint8_t>& out);
+    // A log write failed: flash no longer matches, the next save must be a full record
+    void invalidate() { synced = false; }
+    bool isSynced() const { return synced; }
+    size_t size() const { return stored.size(); }
+
+private:
+    std::unordered_map<uint16_t, uint32_t> stored;   // Rule ID -> CRC of its record
+    bool synced;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef RULE_PERSIST_H
+#define RULE_PERSIST_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+// Rule persistence on SPIFFS.
+//
+// Flash holds a full record of every rule (journal slots /rules.a and
+// /rules.b, rule_journal.h) and a change log (/rules.log, rule_log.h) with
+// one entry per rule created, changed or deleted since that record. A save
+// appends entries only for the rules that differ from what flash holds;
+// once the log outgrows the full record it is folded into a new one.
+//
+// Web edits call scheduleRulesSave(): the new rules are published at once,
+// the write is left to rulePersistTask, which waits until the edits stop
+// for RULE_SAVE_QUIET_MS (at most RULE_SAVE_MAX_DELAY_MS) so a burst of
+// clicks costs one save.
+
+#define RULE_SAVE_QUIET_MS 1500       // Edits closer together than this share a save
+#define RULE_SAVE_MAX_DELAY_MS 10000  // Longest a published edit waits for flash
+
+struct RulePersistStats {
+  uint32_t requests;        // scheduleRulesSave() calls
+  uint32_t saves;           // Saves that wrote something
+  uint32_t logEntries;      // Rule records appended to the log
+  uint32_t fullRecords;     // Full records written (first save, compaction, failed append)
+  uint64_t bytesWritten;    // Log entries and full records since boot
+  uint32_t lastSaveBytes;
+  uint32_t lastSaveMicros;  // Flash time of the latest save
+  uint32_t maxSaveMicros;
+  uint32_t logBytes;        // Current size of /rules.log
+  uint32_t fullRecordBytes; // Size of the newest full record
+};
+
+void initRulePersistence();   // Create the save queue; call before loadRulesFromSPIFFS()
+void rulePersistTask(void* param);
+
+// Take a save request (waiting up to `wait` ticks), debounce and write.
+// Returns false if none arrived. rulePersistTask loops on this.
+bool serviceRuleSaves(TickType_t wait);
+
+// Publish the edited ruleSet and queue a background save. Call after
+// editing, with rulesMutex released. Never waits for flash.
+void scheduleRulesSave();
+
+// Publish and write now (explicit save, defaults on first boot)
+void saveRulesToSPIFFS();
+// Read the newest full record and replay the log on top; falls back to
+// /rules.json and then to the defaults
+void loadRulesFromSPIFFS();
+
+RulePersistStats getRulePersistStats();
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef RULE_SET_H
+#define RULE_SET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+#include "rule_types.h"
+
+// Editable, dynamically sized rule collection owned by the writers.
+//
+// Rules are stored unordered in a dense vector with an ID -> position hash
+// map, so find/insert/remove are O(1). Evaluation order is given by
+// ACRule::priority and applied by RuleStore::publish(), not by the storage.
+// Not thread-safe: edit under rulesMutex. Pointers returned by find() are
+// invalidated by the next insert() or remove().
+class RuleSet {
+public:
+    RuleSet();
+
+    ACRule* find(uint16_t id);
+    const ACRule* find(uint16_t id) const;
+
+    // Add a rule; returns nullptr if its ID is 0 or already taken
+    ACRule* insert(const ACRule& rule);
+    // Remove by ID (the last rule moves into the freed position)
+    bool remove(uint16_t id);
+    void clear();
+    void reserve(size_t count);
+
+    // Lowest unused ID above every ID seen so far, or 0 if the ID space is full
+    uint16_t nextId() const;
+    // Priority that sorts after every current rule
+    uint16_t nextPriority() const;
+    void setPriority(uint16_t id, uint16_t priority);
+
+    // Replace the date exceptions of a rule; ruleId is taken from `id`.
+    // Exceptions are kept sorted by exceptionLess() and dropped with their rule.
+    void setExceptions(uint16_t id, const RuleDateException list[], int count);
+    int exceptionCount() const { return (int)exceptions.size(); }
+    const RuleDateException* exceptionData() const { return exceptions.data(); }
+
+    int size() const { return (int)rules.size(); }
+    ACRule* data() { return rules.data(); }
+    const ACRule* data() const { return rules.data(); }
+    ACRule& operator[](int i) { return rules[i]; }
+    const ACRule& operator[](int i) const { return rules[i]; }
+
+    size_t getMemoryUsage() const;
+
+private:
+    std::vector<ACRule> rules;
+    std::unordered_map<uint16_t, uint32_t> positions; // ID -> index in rules
+    std::vector<RuleDateException> exceptions;
+    uint16_t maxId;
+    uint16_t maxPriority;
+};
+
+#endif
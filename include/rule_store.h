@@ -0,0 +1,119 @@
+#ifndef RULE_STORE_H
+#define RULE_STORE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "rule_types.h"
+#include "rule_calendar.h"
+
+// Immutable, versioned view of the rule set handed to readers.
+// Rules are in evaluation order and exceptions sorted by exceptionLess();
+// the calendar is compiled by the writer at publish time.
+struct RuleSnapshot {
+    uint32_t version;
+    std::vector<ACRule> rules;
+    RuleNamePool names;
+    std::vector<RuleDateException> exceptions;
+    RuleCalendar calendar;
+};
+
+// Double-buffered read-copy-update rule store.
+//
+// Readers (controlTask) do not block: acquire() pins the current slot with a
+// per-slot reader count and retries only if a publish raced it.
+// Publishing does block. Writers (web handlers, persistence) are serialized
+// by an internal mutex, fill the inactive slot and flip the current index;
+// if a straggler still pins that slot the writer sleeps until the last such
+// reader's release() wakes it, so a low-priority reader is never starved by
+// a spinning writer.
+class RuleStore {
+public:
+    RuleStore();
+
+    // Copy, sort by priority, compile and publish a new rule set.
+    // The input may be in any order. Returns the new version.
+    uint32_t publish(const ACRule rules[], int count, const RuleNamePool& names,
+                     const RuleDateException exceptions[] = nullptr, int exceptionCount = 0);
+
+    // Pin the current snapshot. Every acquire() must be paired with release().
+    const RuleSnapshot* acquire();
+    void release(const RuleSnapshot* snapshot);
+
+    uint32_t getVersion() const { return version.load(std::memory_order_acquire); }
+    uint32_t getWriterWaits() const { return writerWaits.load(std::memory_order_relaxed); }
+    uint32_t getReaderRetries() const { return readerRetries.load(std::memory_order_relaxed); }
+
+private:
+    // Drop one pin; wakes a writer waiting for this slot if it was the last
+    void unpin(int idx);
+
+    RuleSnapshot slots[2];
+    std::atomic<int> readers[2];
+    std::atomic<int> current;
+    std::atomic<uint32_t> version;
+    std::atomic<uint32_t> writerWaits;
+    std::atomic<uint32_t> readerRetries;
+    std::mutex writeLock;
+
+    // Writer sleeping until readers[slot] drains; unpin() only touches
+    // drainLock when it drops the last pin of a slot a writer waits for
+    std::atomic<bool> draining[2];
+    std::mutex drainLock;
+    std::condition_variable drained;
+};
+
+// RAII helper pinning the current snapshot for the lifetime of the guard
+class RuleSnapshotGuard {
+public:
+    explicit RuleSnapshotGuard(RuleStore& store) : store(store), snapshot(store.acquire()) {}
+    ~RuleSnapshotGuard() { store.release(snapshot); }
+
+    const RuleSnapshot* operator->() const { return snapshot; }
+    const RuleSnapshot& operator*() const { return *snapshot; }
+
+private:
+    RuleSnapshotGuard(const RuleSnapshotGuard&);
+    RuleSnapshotGuard& operator=(const RuleSnapshotGuard&);
+
+    RuleStore& store;
+    const RuleSnapshot* snapshot;
+};
+
+struct RuleSnapshotCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t lastBuildMicros;   // Serialization time of the cached text
+    uint64_t savedMicros;       // Serialization time each hit did not spend
+};
+
+// Serialized form of a snapshot (e.g. the /api/rules JSON), rebuilt only when
+// a snapshot with another version is asked for, i.e. once per rule change.
+// The text is shared, so a response still sending an older version keeps it
+// alive after a rebuild.
+class RuleSnapshotCache {
+public:
+    typedef std::shared_ptr<const std::string> Text;
+    typedef void (*Serializer)(const RuleSnapshot& snapshot, std::string& out);
+
+    explicit RuleSnapshotCache(Serializer serialize);
+
+    Text get(const RuleSnapshot& snapshot);
+    void clear();
+
+    size_t getMemoryUsage() const;
+    RuleSnapshotCacheStats getStats() const;
+
+private:
+    Serializer serialize;
+    mutable std::mutex lock;
+    uint32_t version;
+    Text text;
+    RuleSnapshotCacheStats stats;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef RULE_TYPES_H
+#define RULE_TYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <type_traits>
+#include <vector>
+
+// Sentinel values for optional rule conditions in the external (JSON / form) format
+#define RULE_ANY_HOUR -1
+#define RULE_ANY_MINUTE -1
+#define RULE_ANY_TEMP -999
+
+// Calendar units
+#define MINUTES_PER_DAY 1440
+#define MINUTES_PER_WEEK (7 * MINUTES_PER_DAY)
+#define RULE_ALL_WEEKDAYS 0x7F      // Bit n = day n with 0 = Sunday (struct tm tm_wday)
+
+// Rule flags
+#define RULE_FLAG_ENABLED     0x01  // Rule active/inactive
+#define RULE_FLAG_AC_ON       0x02  // Turn AC on/off
+
+// Presence bits for optional conditions
+#define RULE_HAS_START_TIME   0x01
+#define RULE_HAS_END_TIME     0x02
+#define RULE_HAS_MIN_TEMP     0x04
+#define RULE_HAS_MAX_TEMP     0x08
+#define RULE_HAS_WINDOW       (RULE_HAS_START_TIME | RULE_HAS_END_TIME)
+
+// AC action enums (values match the web UI and the GreeACController API)
+enum ACMode : uint8_t {
+  AC_MODE_COOL = 0,
+  AC_MODE_HEAT = 1,
+  AC_MODE_DRY = 2,
+  AC_MODE_FAN = 3,
+  AC_MODE_AUTO = 4
+};
+
+enum ACFanSpeed : uint8_t {
+  AC_FAN_AUTO = 0,
+  AC_FAN_LOW = 1,
+  AC_FAN_MED = 2,
+  AC_FAN_HIGH = 3
+};
+
+enum ACSwingV : uint8_t {
+  AC_SWING_V_AUTO = 0,
+  AC_SWING_V_TOP = 1,
+  AC_SWING_V_MID = 2,
+  AC_SWING_V_BOTTOM = 3
+};
+
+enum ACSwingH : uint8_t {
+  AC_SWING_H_AUTO = 0,
+  AC_SWING_H_LEFT = 1,
+  AC_SWING_H_MID = 2,
+  AC_SWING_H_RIGHT = 3
+};
+
+// Rule-based AC Control Structure
+// Trivially copyable: temperatures are fixed-point centi-degrees, optional
+// conditions are flagged in `present` and the name lives in a RuleNamePool.
+struct ACRule {
+  uint16_t id;               // Unique rule ID
+  uint16_t nameId;           // Handle into the rule name pool
+  uint16_t priority;         // Lower value wins when several rules match
+  uint8_t flags;             // RULE_FLAG_* bits
+  uint8_t present;           // RULE_HAS_* bits for optional conditions
+
+  // Time conditions (window applies only when both ends are present).
+  // A window with end <= start runs past midnight into the next day.
+  uint16_t startMinute;      // Minute of day (0-1439)
+  uint16_t endMinute;        // Minute of day (0-1439), exclusive
+  uint8_t weekdays;          // Days the window starts on (bit 0 = Sunday), 0 = every day
+
+  // Temperature conditions in centi-degrees (inclusive bounds)
+  int16_t minTemp;
+  int16_t maxTemp;
+
+  // AC Actions
+  int16_t setTemp;           // Target temperature in centi-degrees
+  ACMode mode;
+  ACFanSpeed fanSpeed;
+  ACSwingV vSwing;
+  ACSwingH hSwing;
+};
+
+// Evaluation order: priority first, then ID so the order is total
+inline bool ruleHigherPriority(const ACRule& a, const ACRule& b) {
+  return a.priority != b.priority ? a.priority < b.priority : a.id < b.id;
+}
+
+static_assert(std::is_trivially_copyable<ACRule>::value, "ACRule must stay memcpy-able");
+static_assert(sizeof(ACRule) <= 32, "ACRule must fit in one cache line");
+
+// Fixed-point conversions. Saturates at ±327.67 °C instead of wrapping, so
+// a bad form value or hand-edited rules.json cannot turn hot into cold; NaN
+// reads as 0.
+inline int16_t tempToCenti(float temp) {
+  float centi = temp * 100.0f;
+  if (centi >= INT16_MAX) return INT16_MAX;
+  if (centi <= INT16_MIN) return INT16_MIN;
+  return centi == centi ? (int16_t)lroundf(centi) : 0;
+}
+
+inline float centiToTemp(int16_t centi) {
+  return centi / 100.0f;
+}
+
+// Accessors translating between the packed record and the external
+// representation, where -1 / -999 mean "any"
+inline bool ruleEnabled(const ACRule& rule) { return (rule.flags & RULE_FLAG_ENABLED) != 0; }
+inline bool ruleAcOn(const ACRule& rule) { return (rule.flags & RULE_FLAG_AC_ON) != 0; }
+
+inline void ruleSetFlag(ACRule& rule, uint8_t flag, bool value) {
+  rule.flags = value ? (rule.flags | flag) : (rule.flags & ~flag);
+}
+
+inline int ruleStartMinute(const ACRule& rule) {
+  return (rule.present & RULE_HAS_START_TIME) ? rule.startMinute : RULE_ANY_MINUTE;
+}
+
+inline int ruleEndMinute(const ACRule& rule) {
+  return (rule.present & RULE_HAS_END_TIME) ? rule.endMinute : RULE_ANY_MINUTE;
+}
+
+inline void ruleSetStartMinute(ACRule& rule, int minute) {
+  bool valid = minute >= 0 && minute < MINUTES_PER_DAY;
+  rule.startMinute = valid ? (uint16_t)minute : 0;
+  rule.present = valid ? (rule.present | RULE_HAS_START_TIME) : (rule.present & ~RULE_HAS_START_TIME);
+}
+
+inline void ruleSetEndMinute(ACRule& rule, int minute) {
+  bool valid = minute >= 0 && minute < MINUTES_PER_DAY;
+  rule.endMinute = valid ? (uint16_t)minute : 0;
+  rule.present = valid ? (rule.present | RULE_HAS_END_TIME) : (rule.present & ~RULE_HAS_END_TIME);
+}
+
+// A zero mask means "every day" so zero-initialized rules keep matching
+inline uint8_t ruleWeekdays(const ACRule& rule) {
+  return rule.weekdays ? (rule.weekdays & RULE_ALL_WEEKDAYS) : RULE_ALL_WEEKDAYS;
+}
+
+inline void ruleSetWeekdays(ACRule& rule, int mask) {
+  mask &= RULE_ALL_WEEKDAYS;
+  rule.weekdays = (mask == RULE_ALL_WEEKDAYS) ? 0 : (uint8_t)mask;
+}
+
+// Whole-hour setters for the version 1 format and form fields
+inline void ruleSetStartHour(ACRule& rule, int hour) {
+  ruleSetStartMinute(rule, (hour >= 0 && hour <= 23) ? hour * 60 : RULE_ANY_MINUTE);
+}
+
+inline void ruleSetEndHour(ACRule& rule, int hour) {
+  ruleSetEndMinute(rule, (hour >= 0 && hour <= 23) ? hour * 60 : RULE_ANY_MINUTE);
+}
+
+inline float ruleMinTemp(const ACRule& rule) {
+  return (rule.present & RULE_HAS_MIN_TEMP) ? centiToTemp(rule.minTemp) : RULE_ANY_TEMP;
+}
+
+inline float ruleMaxTemp(const ACRule& rule) {
+  return (rule.present & RULE_HAS_MAX_TEMP) ? centiToTemp(rule.maxTemp) : RULE_ANY_TEMP;
+}
+
+inline void ruleSetMinTemp(ACRule& rule, float temp) {
+  bool any = temp == RULE_ANY_TEMP;
+  rule.minTemp = any ? 0 : tempToCenti(temp);
+  rule.present = any ? (rule.present & ~RULE_HAS_MIN_TEMP) : (rule.present | RULE_HAS_MIN_TEMP);
+}
+
+inline void ruleSetMaxTemp(ACRule& rule, float temp) {
+  bool any = temp == RULE_ANY_TEMP;
+  rule.maxTemp = any ? 0 : tempToCenti(temp);
+  rule.present = any ? (rule.present & ~RULE_HAS_MAX_TEMP) : (rule.present | RULE_HAS_MAX_TEMP);
+}
+
+inline uint16_t rulePriorityFromInt(int value) {
+  return value < 0 ? 0 : (value > UINT16_MAX ? UINT16_MAX : (uint16_t)value);
+}
+
+// Out-of-range values fall back to the same defaults as GreeACController
+inline ACMode acModeFromInt(int value) {
+  return (value >= AC_MODE_COOL && value <= AC_MODE_AUTO) ? (ACMode)value : AC_MODE_COOL;
+}
+
+inline ACFanSpeed acFanSpeedFromInt(int value) {
+  return (value >= AC_FAN_AUTO && value <= AC_FAN_HIGH) ? (ACFanSpeed)value : AC_FAN_AUTO;
+}
+
+inline ACSwingV acSwingVFromInt(int value) {
+  return (value >= AC_SWING_V_AUTO && value <= AC_SWING_V_BOTTOM) ? (ACSwingV)value : AC_SWING_V_AUTO;
+}
+
+inline ACSwingH acSwingHFromInt(int value) {
+  return (value >= AC_SWING_H_AUTO && value <= AC_SWING_H_RIGHT) ? (ACSwingH)value : AC_SWING_H_AUTO;
+}
+
+// Minute of the week, 0 = Sunday 00:00 (matches struct tm tm_wday)
+inline int weekMinute(int weekday, int hour, int minute) {
+  return weekday * MINUTES_PER_DAY + hour * 60 + minute;
+}
+
+// Calendar dates as days since 2000-01-01 (proleptic Gregorian)
+inline int32_t ruleDayNumber(int year, int month, int day) {
+  // Days-from-civil with March-based years so leap days fall at year end
+  year -= month <= 2;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  int32_t yearOfEra = year - era * 400;
+  int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 730425; // 0000-03-01 .. 2000-01-01
+}
+
+void ruleDayToDate(int32_t dayNumber, int& year, int& month, int& day);
+
+// Days since 2000-01-01 fit a uint16_t until mid-2179
+#define RULE_MAX_DAY UINT16_MAX
+
+// Holiday / date-range exception: the rule is skipped on these local dates
+struct RuleDateException {
+  uint16_t ruleId;
+  uint16_t firstDay;         // ruleDayNumber(), inclusive
+  uint16_t lastDay;          // ruleDayNumber(), inclusive
+};
+
+static_assert(std::is_trivially_copyable<RuleDateException>::value, "RuleDateException must stay memcpy-able");
+
+inline bool exceptionLess(const RuleDateException& a, const RuleDateException& b) {
+  return a.ruleId != b.ruleId ? a.ruleId < b.ruleId : a.firstDay < b.firstDay;
+}
+
+// Interned rule names, referenced from ACRule::nameId.
+// Not thread-safe: the master pool is edited under rulesMutex and each
+// published RuleSnapshot carries its own immutable copy for readers.
+class RuleNamePool {
+public:
+    RuleNamePool();
+
+    // Return the handle of an equal name, adding it if needed
+    uint16_t intern(const char* name);
+    const char* get(uint16_t id) const;   // "" for unknown handles
+
+    // Drop names no rule references and remap the rules' nameIds
+    void compact(ACRule rules[], int count);
+    void clear();
+
+    size_t size() const { return offsets.size(); }
+    size_t getMemoryUsage() const;
+
+private:
+    void rebuildIndex();
+
+    std::vector<char> text;        // NUL-terminated names back to back
+    std::vector<uint32_t> offsets; // Start of each name in text
+    std::vector<uint16_t> index;   // Open-addressed hash of names, UINT16_MAX = empty
+};
+
+#endif
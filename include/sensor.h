@@ -2,6 +2,7 @@
 #define SENSOR_H
 
 #include "config.h"
+#include "temp_history.h"
 
 // Forward declarations
 class SHTSensor;
@@ -10,6 +11,12 @@ class SHTSensor;
 void initSensors();
 float readTemperature();
 float readHumidity();
+void sensorTask(void* param);
+
+// Recorded temperature history (thread-safe). Samples [first, end) can be
+// read one at a time; readTempHistory() fails for one overwritten meanwhile.
+void getTempHistoryRange(uint32_t& first, uint32_t& end);
+bool readTempHistory(uint32_t index, TempHistorySample& sample);
 
 // Global sensor objects
 extern SHTSensor sht;
@@ -0,0 +1,42 @@
+#ifndef TEMP_HISTORY_H
+#define TEMP_HISTORY_H
+
+#include <stdint.h>
+
+// One minute of the room: what the sensor read and what the AC was told
+struct TempHistorySample {
+  uint32_t time;        // Unix time (UTC)
+  int16_t tempCenti;    // Temperature in 1/100 °C
+  uint8_t acOn;
+  uint8_t setTemp;      // AC set temperature (°C), 0 when unknown
+};
+
+#define TEMP_HISTORY_LENGTH 1440          // 24 h of one-minute samples, 11.5 KB
+#define TEMP_HISTORY_PERIOD_SEC 60
+
+// Ring of the last TEMP_HISTORY_LENGTH samples. Samples are numbered from 0
+// in the order they were added, so a reader can walk [first(), end()) one
+// sample at a time and tell when the one it wants has been overwritten.
+// Not thread-safe; the firmware guards it with a mutex in the sensor task.
+class TempHistory {
+public:
+    TempHistory();
+
+    // Record `sample` unless one was taken less than
+    // TEMP_HISTORY_PERIOD_SEC before it; returns true if recorded
+    bool add(const TempHistorySample& sample);
+
+    uint32_t first() const;                  // Oldest sample still held
+    uint32_t end() const { return count; }   // One past the newest
+    bool get(uint32_t index, TempHistorySample& out) const;
+
+private:
+    uint32_t count;
+    TempHistorySample samples[TEMP_HISTORY_LENGTH];
+};
+
+// Sample as /api/history lists it: {"time":...,"temp":27.53,"acOn":true,"setTemp":26};
+// returns the length written (at most length - 1)
+int tempHistorySampleJson(const TempHistorySample& sample, char* text, int length);
+
+#endif
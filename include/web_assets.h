@@ -0,0 +1,23 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stdint.h>
+
+// Web UI compiled into the firmware (build with -DWEB_ASSETS_EMBEDDED).
+// tools/build_web_assets.py turns data/ into gzipped files and an index of
+// them in web_assets_data.h; the bytes stay in flash (rodata) and are sent
+// from there, so pages load without SPIFFS and without a RAM copy.
+struct WebAsset {
+  const char* path;        // URL path, e.g. "/index.html"
+  const char* mimeType;
+  const char* hash;        // Content hash of the gzipped bytes, sent as ETag
+  const uint8_t* data;     // Gzipped body
+  uint32_t length;
+};
+
+// Embedded asset for a URL path ("/" means "/index.html"); nullptr when the
+// path is not embedded or the build has no embedded assets
+const WebAsset* findWebAsset(const char* path);
+int getWebAssetCount();
+
+#endif
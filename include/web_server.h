@@ -13,6 +13,25 @@ void setupWebServer();
 String getWebContent();
 String readFile(String path);
 void handleSystemInfo(AsyncWebServerRequest *request);
+void handleSnapshot(AsyncWebServerRequest *request);   // Conditional GET (ETag)
+void handleGetHistory(AsyncWebServerRequest *request);  // Streamed, chunked
+
+// Server-Sent Events (/api/events): the pages get temperature, active rule
+// and AC state pushed when they change instead of polling the JSON APIs.
+// Event names: "temp", "rule", "ac"; a new client gets all three at once.
+struct WebStats {
+  uint32_t requests;        // HTTP requests received, all routes
+  uint32_t notModified;     // Conditional GETs answered 304 without a body
+  uint32_t largestJson;     // Longest JSON body streamed (bytes)
+  uint32_t flashAssets;     // Pages/scripts sent from the firmware image (web_assets.h)
+  uint32_t eventClients;    // Open /api/events streams
+  uint32_t eventConnects;
+  uint32_t eventsSent;      // Events pushed (one send reaches every client)
+  uint32_t eventBytes;      // Payload bytes of those events
+};
+
+void publishStatusEvents();   // Called by the sensor task after each sample
+WebStats getWebStats();
 
 // Rule management functions
 void handleGetRules(AsyncWebServerRequest *request);
@@ -20,16 +39,23 @@ void handleCreateRule(AsyncWebServerRequest *request);
 void handleUpdateRule(AsyncWebServerRequest *request);
 void handleDeleteRule(AsyncWebServerRequest *request);
 void handleGetActiveRule(AsyncWebServerRequest *request);
+void handleRuleBatch(AsyncWebServerRequest *request);   // PUT /api/rules/batch, JSON body
+void handleRuleBatchBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
 
 // Rule persistence functions
 void handleSaveRules(AsyncWebServerRequest *request);
 void handleLoadRules(AsyncWebServerRequest *request);
 void handleResetRules(AsyncWebServerRequest *request);
 
-// Debug mode functions
+// Debug mode functions (debugMode is also a /api/config setting)
 void handleGetDebugMode(AsyncWebServerRequest *request);
 void handleSetDebugMode(AsyncWebServerRequest *request);
 
+// Runtime settings (config_store.h)
+void handleGetConfig(AsyncWebServerRequest *request);
+void handleSetConfig(AsyncWebServerRequest *request);   // PUT /api/config, JSON body
+void handleConfigBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+
 // Global web server object
 extern AsyncWebServer server;
 
@@ -0,0 +1,95 @@
+#include "room_model.h"
+#include <math.h>
+
+#define MS_PER_HOUR 3600000.0
+#define MODEL_STEP_MS 1000u   // Integration step; the thermostat reacts within one step
+
+RoomParams defaultRoomParams() {
+  RoomParams params;
+  params.initialTemp = 28.0f;
+  params.outdoorMean = 30.0f;
+  params.outdoorSwing = 5.0f;
+  params.envelopeHours = 6.0f;
+  params.internalGain = 0.4f;
+  params.coolingCapacity = 4.0f;
+  params.heatingCapacity = 4.0f;
+  params.hysteresis = 0.5f;
+  params.minOffMs = 180000;
+  return params;
+}
+
+RoomModel::RoomModel(const RoomParams& params, float comfortLow, float comfortHigh)
+    : params(params), comfortLow(comfortLow), comfortHigh(comfortHigh), roomTemp(params.initialTemp),
+      modelMs(0), compressorOn(false), compressorDirection(0), compressorOffAt(0) {
+  unit = SimGreeFrame{false, 25, kGreeAuto, kGreeFanAuto, false, kGreeSwingLastPos, kGreeSwingHOff};
+  stats = RoomStats{0, 0, 0, roomTemp, roomTemp, 0};
+}
+
+// Daily sine peaking at 15:00 plus a slow deterministic day-to-day "weather" drift
+float RoomModel::outdoorTemp(uint64_t ms) const {
+  double hours = ms / MS_PER_HOUR;
+  double days = hours / 24.0;
+  double daily = sin((hours - 9.0) * M_PI / 12.0);
+  double weather = 1.5 * sin(days * 0.9) + 0.8 * sin(days * 2.3 + 1.0);
+  return (float)(params.outdoorMean + params.outdoorSwing * daily + weather);
+}
+
+void RoomModel::receiveFrame(const uint8_t state[kGreeStateLength]) {
+  unit.power = (state[0] & 0x08) != 0;
+  unit.temp = (state[1] & 0x0F) + kGreeMinTempC;
+  unit.mode = state[0] & 0x07;
+  unit.fan = (state[0] >> 4) & 0x03;
+  unit.swingVAuto = (state[0] & 0x40) != 0;
+  unit.swingV = state[4] & 0x0F;
+  unit.swingH = (state[4] >> 4) & 0x07;
+}
+
+// Thermostat of the indoor unit: does it want the compressor, and which way
+bool RoomModel::wantsCompressor(float& direction) const {
+  if (!unit.power || unit.mode == kGreeFan) {
+    return false;
+  }
+  float set = unit.temp;
+  float band = compressorOn ? -params.hysteresis : params.hysteresis;  // Hysteresis around the set point
+  bool cool = unit.mode == kGreeCool || unit.mode == kGreeDry ||
+              (unit.mode == kGreeAuto && roomTemp > set);
+  direction = cool ? -1.0f : 1.0f;
+  return cool ? roomTemp > set + band : roomTemp < set - band;
+}
+
+void RoomModel::step(uint64_t ms, uint32_t dtMs) {
+  float direction = 0;
+  bool want = wantsCompressor(direction);
+  if (compressorOn && (!want || direction != compressorDirection)) {
+    compressorOn = false;
+    compressorOffAt = ms;
+  } else if (!compressorOn && want && ms >= compressorOffAt + params.minOffMs) {
+    compressorOn = true;
+    compressorDirection = direction;
+    stats.compressorStarts++;
+  }
+
+  static const float fanScale[4] = {1.0f, 0.6f, 0.8f, 1.0f};  // Auto, low, med, high
+  float hours = dtMs / (float)MS_PER_HOUR;
+  float drift = (outdoorTemp(ms) - roomTemp) / params.envelopeHours + params.internalGain;
+  if (compressorOn) {
+    float capacity = compressorDirection < 0 ? params.coolingCapacity : params.heatingCapacity;
+    float scale = fanScale[unit.fan & 3] * (unit.mode == kGreeDry ? 0.5f : 1.0f);
+    drift += compressorDirection * capacity * scale;
+    stats.compressorOnMs += dtMs;
+  }
+  roomTemp += drift * hours;
+
+  if (roomTemp < comfortLow || roomTemp > comfortHigh) stats.outOfBandMs += dtMs;
+  if (roomTemp < stats.minTemp) stats.minTemp = roomTemp;
+  if (roomTemp > stats.maxTemp) stats.maxTemp = roomTemp;
+  stats.tempSumMs += (double)roomTemp * dtMs;
+}
+
+void RoomModel::advanceTo(uint64_t ms) {
+  while (modelMs < ms) {
+    uint32_t dt = (uint32_t)(ms - modelMs < MODEL_STEP_MS ? ms - modelMs : MODEL_STEP_MS);
+    step(modelMs, dt);
+    modelMs += dt;
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef ROOM_MODEL_H
+#define ROOM_MODEL_H
+
+#include <stdint.h>
+#include <ir_Gree.h>
+
+// First-order room thermal model with a thermostat-driven air conditioner.
+//
+// The room relaxes toward the outdoor temperature with time constant
+// envelopeHours and gains internalGain °C/h; a running compressor moves it by
+// the unit's capacity (scaled by fan speed) in °C/h. The unit applies the
+// last IR frame it received and cycles its compressor around the set point
+// with a hysteresis and an anti-short-cycle delay, like a non-inverter split.
+struct RoomParams {
+    float initialTemp;        // °C at the start of the run
+    float outdoorMean;        // Daily mean outdoor temperature (°C)
+    float outdoorSwing;       // Half the daily peak-to-trough range (°C)
+    float envelopeHours;      // Envelope time constant
+    float internalGain;       // People, sun, appliances (°C/h)
+    float coolingCapacity;    // Compressor effect at full fan (°C/h)
+    float heatingCapacity;
+    float hysteresis;         // Compressor switches at set point ± this (°C)
+    uint32_t minOffMs;        // Anti-short-cycle delay after the compressor stops
+};
+
+RoomParams defaultRoomParams();
+
+struct RoomStats {
+    uint32_t compressorStarts;
+    uint64_t compressorOnMs;
+    uint64_t outOfBandMs;     // Room outside the comfort band
+    float minTemp;
+    float maxTemp;
+    double tempSumMs;         // Integral of room temperature over time (for the mean)
+};
+
+class RoomModel {
+public:
+    RoomModel(const RoomParams& params, float comfortLow, float comfortHigh);
+
+    // Integrate from the current model time up to `ms` (virtual clock time)
+    void advanceTo(uint64_t ms);
+    // A decoded IR frame (protocol bytes) reached the indoor unit at the
+    // current model time
+    void receiveFrame(const uint8_t state[kGreeStateLength]);
+
+    float getRoomTemp() const { return roomTemp; }
+    float outdoorTemp(uint64_t ms) const;
+    bool isCompressorOn() const { return compressorOn; }
+    const RoomStats& getStats() const { return stats; }
+
+private:
+    void step(uint64_t ms, uint32_t dtMs);
+    bool wantsCompressor(float& direction) const;
+
+    RoomParams params;
+    float comfortLow;
+    float comfortHigh;
+    float roomTemp;
+    uint64_t modelMs;
+
+    SimGreeFrame unit;          // Last state received over IR
+    bool compressorOn;
+    float compressorDirection;  // -1 cooling, +1 heating
+    uint64_t compressorOffAt;
+
+    RoomStats stats;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Minimal Arduino core for the host simulator (env:sim). Only what the
+// firmware sources compiled into the simulator use; time comes from the
+// virtual clock in sim_clock.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define PROGMEM
+#define F(x) x
+
+class String {
+public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    String(const std::string& text) : value(text) {}
+    String(char c) : value(1, c) {}
+    String(int number) : value(std::to_string(number)) {}
+    String(unsigned number) : value(std::to_string(number)) {}
+    String(long number) : value(std::to_string(number)) {}
+    String(unsigned long number) : value(std::to_string(number)) {}
+    String(float number, unsigned decimals = 2) : value(format(number, decimals)) {}
+    String(double number, unsigned decimals = 2) : value(format(number, decimals)) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned length() const { return (unsigned)value.size(); }
+    bool isEmpty() const { return value.empty(); }
+    int toInt() const { return atoi(value.c_str()); }
+    float toFloat() const { return (float)atof(value.c_str()); }
+    bool reserve(unsigned size) { value.reserve(size); return true; }
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* other) { value += other; return *this; }
+    String& operator+=(char c) { value += c; return *this; }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* other) const { return value == other; }
+    bool operator!=(const String& other) const { return value != other.value; }
+    bool operator!=(const char* other) const { return value != other; }
+    char operator[](unsigned i) const { return value[i]; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+
+private:
+    static std::string format(double number, unsigned decimals) {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+        return buffer;
+    }
+
+    std::string value;
+};
+
+// Serial output is dropped unless the simulator runs with --verbose
+class Print {
+public:
+    size_t printf(const char* format, ...);
+    size_t print(const String& text) { return write(text.c_str()); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(int number) { return printf("%d", number); }
+    size_t println(const String& text) { return write(text.c_str()) + write("\n"); }
+    size_t println(const char* text = "") { return write(text) + write("\n"); }
+    size_t println(int number) { return printf("%d\n", number); }
+    size_t println(float number) { return printf("%.2f\n", number); }
+
+    bool enabled = false;
+
+private:
+    size_t write(const char* text);
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// Virtual clock (sim_clock.cpp); delay() advances it
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+inline int xPortGetCoreID() { return 1; }
+
+// NTP stand-ins: local time is the virtual clock
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
+
+#endif
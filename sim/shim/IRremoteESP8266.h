@@ -0,0 +1,6 @@
+#ifndef SIM_IRREMOTEESP8266_H
+#define SIM_IRREMOTEESP8266_H
+
+#include <stdint.h>
+
+#endif
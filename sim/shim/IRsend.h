@@ -0,0 +1,36 @@
+#ifndef SIM_IRSEND_H
+#define SIM_IRSEND_H
+
+#include <stdint.h>
+
+#define SIM_IR_CAPTURE_MAX 1024   // Room for the longest backend frame (Daikin, 584 timings)
+
+// Implemented by the simulator: called with each frame's mark/space
+// durations (us, starting with a mark) as the LED would have emitted them
+void simIrFrameSent(const uint16_t* timings, uint16_t count, uint16_t khz);
+
+// Transmitter stand-in that records the waveform instead of driving GPIO.
+// mark()/space() build the frame like the library's; sendRaw() and
+// sendGree() hand each finished frame to simIrFrameSent().
+class IRsend {
+public:
+    explicit IRsend(uint16_t pin) : count(0), khz(38) { (void)pin; }
+    void begin() {}
+
+    void enableIROut(uint32_t freq) { khz = (uint16_t)(freq < 1000 ? freq : freq / 1000); }
+    void mark(uint16_t usec);
+    void space(uint32_t usec);
+
+    void sendRaw(const uint16_t buf[], uint16_t len, uint16_t hz);
+    void sendGree(const uint8_t data[], uint16_t nbytes, uint16_t repeat = 0);
+
+private:
+    void sendBits(uint64_t data, uint16_t nbits);
+    void flush();
+
+    uint16_t timings[SIM_IR_CAPTURE_MAX];
+    uint16_t count;
+    uint16_t khz;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+// NVS kept in memory for the run: every simulation starts from the
+// compiled-in settings, as a device with erased flash does. Only the calls
+// config_store.cpp makes.
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        std::map<std::string, Namespace>& all = namespaces();
+        if (readOnly && all.find(name) == all.end()) return false;  // NVS fails the same way
+        current = &all[name];
+        return true;
+    }
+    void end() { current = nullptr; }
+
+    bool isKey(const char* key) { return current && current->count(key) > 0; }
+
+    size_t putBool(const char* key, bool value) { return put(key, value ? "1" : "0") ? 1 : 0; }
+    size_t putInt(const char* key, int32_t value) { return put(key, std::to_string(value)) ? 4 : 0; }
+    size_t putUInt(const char* key, uint32_t value) { return put(key, std::to_string(value)) ? 4 : 0; }
+    size_t putString(const char* key, const char* value) { return put(key, value) ? strlen(value) : 0; }
+
+    bool getBool(const char* key, bool defaultValue = false) { return isKey(key) ? get(key) == "1" : defaultValue; }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) {
+        return isKey(key) ? (int32_t)strtol(get(key).c_str(), nullptr, 10) : defaultValue;
+    }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) {
+        return isKey(key) ? (uint32_t)strtoul(get(key).c_str(), nullptr, 10) : defaultValue;
+    }
+    String getString(const char* key, const String defaultValue = String()) {
+        return isKey(key) ? String(get(key)) : defaultValue;
+    }
+
+private:
+    typedef std::map<std::string, std::string> Namespace;
+
+    static std::map<std::string, Namespace>& namespaces() {
+        static std::map<std::string, Namespace> all;
+        return all;
+    }
+
+    bool put(const char* key, const std::string& value) {
+        if (!current) return false;
+        (*current)[key] = value;
+        return true;
+    }
+    std::string get(const char* key) { return (*current)[key]; }
+
+    Namespace* current = nullptr;
+};
+
+#endif
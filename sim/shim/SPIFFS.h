@@ -0,0 +1,56 @@
+#ifndef SIM_SPIFFS_H
+#define SIM_SPIFFS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+
+// SPIFFS backed by a host directory (simulator --spiffs DIR). Without a
+// root every open() fails, which the firmware treats as an empty filesystem.
+class File {
+public:
+    File() : handle(nullptr) {}
+    explicit File(FILE* handle) : handle(handle) {}
+
+    operator bool() const { return handle != nullptr; }
+    void close() {
+        if (handle) fclose(handle);
+        handle = nullptr;
+    }
+
+    size_t size() const {
+        if (!handle) return 0;
+        long position = ftell(handle);
+        fseek(handle, 0, SEEK_END);
+        long end = ftell(handle);
+        fseek(handle, position, SEEK_SET);
+        return end < 0 ? 0 : (size_t)end;
+    }
+
+    // Reader/writer interface used by ArduinoJson
+    int read() { return handle ? fgetc(handle) : -1; }
+    size_t readBytes(char* buffer, size_t length) { return handle ? fread(buffer, 1, length, handle) : 0; }
+    size_t write(uint8_t c) { return handle && fputc(c, handle) != EOF ? 1 : 0; }
+    size_t write(const uint8_t* buffer, size_t length) { return handle ? fwrite(buffer, 1, length, handle) : 0; }
+
+private:
+    FILE* handle;
+};
+
+class SPIFFSFS {
+public:
+    bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+    void setRoot(const char* dir) { root = dir ? dir : ""; }
+
+    File open(const char* path, const char* mode = "r") {
+        if (root.empty()) return File();
+        return File(fopen((root + path).c_str(), mode));
+    }
+
+private:
+    std::string root;
+};
+
+extern SPIFFSFS SPIFFS;
+
+#endif
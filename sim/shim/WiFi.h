@@ -0,0 +1,14 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#define WL_CONNECTED 3
+
+// The simulated network is always up
+class WiFiClass {
+public:
+    int status() { return WL_CONNECTED; }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,42 @@
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <WiFi.h>
+#include "sim_clock.h"
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+SPIFFSFS SPIFFS;
+
+size_t Print::printf(const char* format, ...) {
+  if (!enabled) return 0;
+  va_list args;
+  va_start(args, format);
+  int written = vprintf(format, args);
+  va_end(args);
+  return written < 0 ? 0 : (size_t)written;
+}
+
+size_t Print::write(const char* text) {
+  if (!enabled) return 0;
+  fputs(text, stdout);
+  return strlen(text);
+}
+
+unsigned long millis() {
+  return (unsigned long)simNowMs();
+}
+
+unsigned long micros() {
+  return (unsigned long)(simNowMs() * 1000);
+}
+
+// Blocking waits in firmware code (IR repeat spacing, retries) take virtual time
+void delay(unsigned long ms) {
+  simAdvanceMs(ms);
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+  (void)ms;
+  simLocalTime(*info);
+  return true;
+}
@@ -0,0 +1,19 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+// Single-threaded FreeRTOS stand-ins for the host simulator. The simulator
+// calls runControlStep() directly, so tasks and notifications never block.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef void* TaskHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define portMAX_DELAY UINT32_MAX
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif
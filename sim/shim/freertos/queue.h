@@ -0,0 +1,45 @@
+#ifndef SIM_FREERTOS_QUEUE_H
+#define SIM_FREERTOS_QUEUE_H
+
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "FreeRTOS.h"
+
+// Copying FIFO like the real queue. Nothing else runs in the simulator, so a
+// receive on an empty queue returns at once instead of blocking.
+struct SimQueue {
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+typedef SimQueue* QueueHandle_t;
+
+// Tests set this to make the next sends fail, as on a device where another
+// task refilled the queue in between
+inline int simQueueFailSends = 0;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize) {
+    return new SimQueue{length, itemSize, {}};
+}
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t) {
+    if (simQueueFailSends > 0) {
+        simQueueFailSends--;
+        return pdFALSE;
+    }
+    if (queue->items.size() >= queue->length) return pdFALSE;
+    const uint8_t* bytes = (const uint8_t*)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    return pdTRUE;
+}
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t) {
+    if (queue->items.empty()) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+inline uint32_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return (uint32_t)queue->items.size();
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef SIM_IR_GREE_H
+#define SIM_IR_GREE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "IRsend.h"
+
+// Protocol constants as in IRremoteESP8266's ir_Gree.h
+const uint16_t kGreeStateLength = 8;
+const uint16_t kGreeHdrMark = 9000, kGreeHdrSpace = 4500, kGreeBitMark = 620;
+const uint16_t kGreeOneSpace = 1600, kGreeZeroSpace = 540, kGreeMsgSpace = 19980;
+const uint8_t kGreeBlockFooter = 0b010, kGreeBlockFooterBits = 3;
+const uint8_t kGreeAuto = 0, kGreeCool = 1, kGreeDry = 2, kGreeFan = 3, kGreeHeat = 4;
+const uint8_t kGreeFanAuto = 0, kGreeFanMin = 1, kGreeFanMed = 2, kGreeFanMax = 3;
+const uint8_t kGreeSwingLastPos = 0, kGreeSwingAuto = 1, kGreeSwingUp = 2, kGreeSwingMiddle = 4, kGreeSwingDown = 6;
+const uint8_t kGreeSwingHOff = 0, kGreeSwingHAuto = 1, kGreeSwingHLeft = 3, kGreeSwingHMiddle = 4, kGreeSwingHRight = 5;
+const uint8_t kGreeMinTempC = 16, kGreeMaxTempC = 30;
+
+// What the air conditioner applies from one received frame
+struct SimGreeFrame {
+    bool power;
+    uint8_t temp;
+    uint8_t mode;       // kGree* mode
+    uint8_t fan;        // kGreeFan*
+    bool swingVAuto;
+    uint8_t swingV;
+    uint8_t swingH;
+};
+
+// Byte image and setters of IRGreeAC for the YAW1F remote, with the same
+// field layout, mode locks and checksum; send() goes through
+// IRsend::sendGree() so the waveform is captured.
+class IRGreeAC {
+public:
+    explicit IRGreeAC(uint16_t pin) : irsend(pin) { stateReset(); }
+
+    void begin() { irsend.begin(); }
+    void send() { irsend.sendGree(getRaw(), kGreeStateLength); }
+    void stateReset() {
+        static const uint8_t reset[kGreeStateLength] = {0x00, 0x09, 0x20, 0x50, 0x00, 0x20, 0x00, 0x00};
+        memcpy(raw, reset, kGreeStateLength);
+        timer = 0;
+    }
+
+    void on() { setPower(true); }
+    void off() { setPower(false); }
+    void setPower(bool on) {
+        setBits(0, 3, 1, on);
+        setBits(2, 6, 1, on);    // ModelA: the YAW1F second power bit
+    }
+    bool getPower() const { return raw[0] & 0x08; }
+    void setTemp(uint8_t temp) {
+        if (getMode() == kGreeAuto) temp = 25;
+        temp = temp < kGreeMinTempC ? kGreeMinTempC : (temp > kGreeMaxTempC ? kGreeMaxTempC : temp);
+        setBits(1, 0, 4, temp - kGreeMinTempC);
+    }
+    uint8_t getTemp() const { return (raw[1] & 0x0F) + kGreeMinTempC; }
+    void setFan(uint8_t fan) {
+        if (getMode() == kGreeDry) fan = kGreeFanMin;
+        setBits(0, 4, 2, fan > kGreeFanMax ? kGreeFanMax : fan);
+    }
+    uint8_t getFan() const { return (raw[0] >> 4) & 0x03; }
+    void setMode(uint8_t mode) {
+        if (mode > kGreeHeat) mode = kGreeAuto;
+        if (mode == kGreeAuto) setTemp(25);   // AUTO is locked to 25 °C, DRY to fan 1
+        if (mode == kGreeDry) setFan(kGreeFanMin);
+        setBits(0, 0, 3, mode);
+    }
+    uint8_t getMode() const { return raw[0] & 0x07; }
+    void setSwingVertical(bool automatic, uint8_t position) {
+        setBits(0, 6, 1, automatic);
+        setBits(4, 0, 4, automatic ? kGreeSwingAuto : position);
+    }
+    bool getSwingVerticalAuto() const { return raw[0] & 0x40; }
+    uint8_t getSwingVerticalPosition() const { return raw[4] & 0x0F; }
+    void setSwingHorizontal(uint8_t position) { setBits(4, 4, 3, position); }
+    uint8_t getSwingHorizontal() const { return (raw[4] >> 4) & 0x07; }
+    void setTimer(uint16_t minutes) { timer = minutes; }   // Not encoded; the sim never sets one
+    uint16_t getTimer() const { return timer; }
+    uint8_t* getRaw() {
+        uint8_t sum = 10;
+        for (int i = 0; i < 4; i++) sum += raw[i] & 0x0F;
+        for (int i = 4; i < kGreeStateLength - 1; i++) sum += raw[i] >> 4;
+        setBits(7, 4, 4, sum & 0x0F);
+        return raw;
+    }
+
+private:
+    void setBits(int byte, int offset, int bits, uint8_t value) {
+        uint8_t mask = ((1 << bits) - 1) << offset;
+        raw[byte] = (raw[byte] & ~mask) | ((value << offset) & mask);
+    }
+
+    IRsend irsend;
+    uint8_t raw[kGreeStateLength];
+    uint16_t timer;
+};
+
+#endif
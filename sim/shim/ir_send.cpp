@@ -0,0 +1,65 @@
+#include "IRsend.h"
+#include "ir_Gree.h"
+
+// Adjacent marks (or spaces) merge, as they would on the wire
+void IRsend::mark(uint16_t usec) {
+  if (usec == 0) return;
+  if (count % 2 == 1) {
+    timings[count - 1] += usec;
+  } else if (count < SIM_IR_CAPTURE_MAX) {
+    timings[count++] = usec;
+  }
+}
+
+void IRsend::space(uint32_t usec) {
+  if (usec == 0 || count == 0) return;   // Idle before the first mark is not part of the frame
+  if (count % 2 == 0) {
+    timings[count - 1] += (uint16_t)usec;
+  } else if (count < SIM_IR_CAPTURE_MAX) {
+    timings[count++] = (uint16_t)usec;
+  }
+}
+
+void IRsend::flush() {
+  if (count > 0) simIrFrameSent(timings, count, khz);
+  count = 0;
+}
+
+// Odd entries are marks, even ones spaces, as in the library
+void IRsend::sendRaw(const uint16_t buf[], uint16_t len, uint16_t hz) {
+  enableIROut(hz);
+  for (uint16_t i = 0; i < len; i++) {
+    if (i % 2 == 0) {
+      mark(buf[i]);
+    } else {
+      space(buf[i]);
+    }
+  }
+  flush();
+}
+
+void IRsend::sendBits(uint64_t data, uint16_t nbits) {
+  for (uint16_t i = 0; i < nbits; i++, data >>= 1) {
+    mark(kGreeBitMark);
+    space((data & 1) ? kGreeOneSpace : kGreeZeroSpace);
+  }
+}
+
+// Same sequence as IRsend::sendGree(): header, bytes 0-3, block footer and
+// gap, bytes 4-7 and gap, all LSB first
+void IRsend::sendGree(const uint8_t data[], uint16_t nbytes, uint16_t repeat) {
+  if (nbytes < kGreeStateLength) return;
+  enableIROut(38);
+  for (uint16_t r = 0; r <= repeat; r++) {
+    mark(kGreeHdrMark);
+    space(kGreeHdrSpace);
+    for (uint16_t i = 0; i < 4; i++) sendBits(data[i], 8);
+    sendBits(kGreeBlockFooter, kGreeBlockFooterBits);
+    mark(kGreeBitMark);
+    space(kGreeMsgSpace);
+    for (uint16_t i = 4; i < nbytes; i++) sendBits(data[i], 8);
+    mark(kGreeBitMark);
+    space(kGreeMsgSpace);
+    flush();
+  }
+}
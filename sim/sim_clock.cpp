@@ -0,0 +1,45 @@
+#include "sim_clock.h"
+#include <string.h>
+#include "rule_types.h"
+
+#define MS_PER_DAY 86400000ull
+
+static int32_t clockStartDay = 0;
+static uint64_t clockNowMs = 0;
+
+void simClockStart(int32_t startDay) {
+  clockStartDay = startDay;
+  clockNowMs = 0;
+}
+
+uint64_t simNowMs() {
+  return clockNowMs;
+}
+
+void simAdvanceMs(uint64_t ms) {
+  clockNowMs += ms;
+}
+
+void simAdvanceTo(uint64_t ms) {
+  if (ms > clockNowMs) clockNowMs = ms;
+}
+
+void simLocalTime(struct tm& out) {
+  simLocalTimeAt(clockNowMs, out);
+}
+
+void simLocalTimeAt(uint64_t ms, struct tm& out) {
+  int32_t day = clockStartDay + (int32_t)(ms / MS_PER_DAY);
+  uint32_t msOfDay = (uint32_t)(ms % MS_PER_DAY);
+  int year, month, date;
+  ruleDayToDate(day, year, month, date);
+
+  memset(&out, 0, sizeof(out));
+  out.tm_year = year - 1900;
+  out.tm_mon = month - 1;
+  out.tm_mday = date;
+  out.tm_wday = (int)(((day % 7) + 7 + 6) % 7);   // 2000-01-01 was a Saturday
+  out.tm_hour = (int)(msOfDay / 3600000);
+  out.tm_min = (int)(msOfDay / 60000 % 60);
+  out.tm_sec = (int)(msOfDay / 1000 % 60);
+}
@@ -0,0 +1,18 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Virtual wall clock for the simulator: milliseconds since local midnight
+// of the start date. Only advances when the simulator (or delay()) moves it.
+void simClockStart(int32_t startDay);   // ruleDayNumber() of the first day
+uint64_t simNowMs();
+void simAdvanceMs(uint64_t ms);
+void simAdvanceTo(uint64_t ms);         // No-op if already past `ms`
+
+// Local calendar time of the virtual clock (tm_yday and tm_isdst are left 0)
+void simLocalTime(struct tm& out);
+void simLocalTimeAt(uint64_t ms, struct tm& out);
+
+#endif
@@ -0,0 +1,209 @@
+// Host simulator: runs the firmware's control step, rule engine and
+// GreeACController against a virtual clock and a room thermal model.
+//
+//   pio run -e sim && .pio/build/sim/program --days 30
+//
+// Options:
+//   --days N            Simulated days (default 30)
+//   --start YYYY-MM-DD  First simulated day (default 2026-07-01)
+//   --spiffs DIR        Load rules.json from DIR instead of the default rules
+//   --comfort LOW:HIGH  Comfort band in °C (default 24:28)
+//   --outdoor MEAN:SWING  Outdoor daily mean and half-range in °C (default 30:5)
+//   --verbose           Print the firmware's serial log
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <chrono>
+#include <vector>
+#include "config.h"
+#include "config_store.h"
+#include "ac_control.h"
+#include "ir_control.h"
+#include "ir_transmitter.h"
+#include "gree_codec.h"
+#include "rule_json.h"
+#include "rule_persist.h"
+#include "sim_clock.h"
+#include "room_model.h"
+
+#ifndef AC_BACKEND_GREE
+#error "The room model receives Gree frames; build the simulator without an AC_BACKEND_* flag"
+#endif
+
+#define MS_PER_DAY 86400000ull
+#define FRAME_BURST_GAP_MS 2000   // Frames closer than this belong to one command
+
+static RoomModel* room = nullptr;
+
+struct IrStats {
+  uint32_t frames;
+  uint32_t commands;
+  uint32_t rejected;        // Waveforms that did not decode as a Gree frame
+  uint64_t lastFrameMs;
+  uint64_t decodeNs;
+};
+static IrStats irStats = {0, 0, 0, 0, 0};
+static uint8_t lastFrame[GREE_STATE_LENGTH];   // Bytes of the last decoded frame
+
+// Every frame the firmware emits is decoded from its captured waveform, so
+// the whole path from rule to GPIO timings is exercised
+void simIrFrameSent(const uint16_t* timings, uint16_t count, uint16_t khz) {
+  uint64_t now = simNowMs();
+  uint8_t state[GREE_STATE_LENGTH];
+  auto decodeStart = std::chrono::steady_clock::now();
+  bool decoded = khz == GREE_CARRIER_KHZ && greeDecodeTimings(timings, count, state);
+  irStats.decodeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - decodeStart).count();
+  if (!decoded) {
+    irStats.rejected++;
+    return;
+  }
+  memcpy(lastFrame, state, GREE_STATE_LENGTH);
+  if (room) {
+    room->advanceTo(now);
+    room->receiveFrame(state);
+  }
+  if (irStats.frames == 0 || now - irStats.lastFrameMs > FRAME_BURST_GAP_MS) {
+    irStats.commands++;
+  }
+  irStats.frames++;
+  irStats.lastFrameMs = now;
+}
+
+// Library path check: every rule target set through GreeACController and
+// sent by IRGreeAC::send() must decode to the bytes the frame cache sends.
+// Returns the number of states that did not.
+static int checkLibraryFrames() {
+  std::vector<ACState> states(1, AC_STATE_OFF);
+  {
+    RuleSnapshotGuard snapshot(ruleStore);
+    for (const ACRule& rule : snapshot->rules) {
+      if (ruleEnabled(rule)) states.push_back(ruleTargetState(rule));
+    }
+  }
+  int mismatches = 0;
+  for (const ACState& state : states) {
+    uint8_t expected[GREE_STATE_LENGTH];
+    greeEncodeState(state, expected);
+    uint32_t framesBefore = irStats.frames;
+    acController.applyState(state);
+    acController.sendFrame();
+    if (irStats.frames != framesBefore + 1 || memcmp(lastFrame, expected, GREE_STATE_LENGTH) != 0) {
+      fprintf(stderr, "❌ IRGreeAC frame for power=%d temp=%d fan=%d mode=%d differs from the codec\n",
+              state.power(), state.temperature(), state.fanSpeed(), state.mode());
+      mismatches++;
+    }
+  }
+  printf("🔬 Library frames checked: %d states, %d mismatches\n", (int)states.size(), mismatches);
+  return mismatches;
+}
+
+static bool parsePair(const char* text, float& first, float& second) {
+  return sscanf(text, "%f:%f", &first, &second) == 2;
+}
+
+int main(int argc, char** argv) {
+  int days = 30;
+  int32_t startDay = ruleDayNumber(2026, 7, 1);
+  const char* spiffsDir = nullptr;
+  float comfortLow = 24.0f, comfortHigh = 28.0f;
+  RoomParams params = defaultRoomParams();
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--days") == 0 && hasValue) {
+      days = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--start") == 0 && hasValue) {
+      if (!parseRuleDate(argv[++i], startDay)) {
+        fprintf(stderr, "Invalid start date: %s\n", argv[i]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--spiffs") == 0 && hasValue) {
+      spiffsDir = argv[++i];
+    } else if (strcmp(argv[i], "--comfort") == 0 && hasValue) {
+      if (!parsePair(argv[++i], comfortLow, comfortHigh)) return 2;
+    } else if (strcmp(argv[i], "--outdoor") == 0 && hasValue) {
+      if (!parsePair(argv[++i], params.outdoorMean, params.outdoorSwing)) return 2;
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      Serial.enabled = true;
+    } else {
+      fprintf(stderr, "Usage: %s [--days N] [--start YYYY-MM-DD] [--spiffs DIR] "
+                      "[--comfort LOW:HIGH] [--outdoor MEAN:SWING] [--verbose]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (days <= 0) return 2;
+
+  // Same bring-up as setup(), minus hardware
+  simClockStart(startDay);
+  SPIFFS.setRoot(spiffsDir);
+  initConfigStore();
+  initRulesMutex();
+  initRulePersistence();
+  loadRulesFromSPIFFS();
+  acController.init();
+  initIrTransmitter();
+  if (checkLibraryFrames() != 0) return 1;
+  irStats = IrStats{0, 0, 0, 0, 0};   // Start-up test frames are not rule decisions
+
+  RoomModel model(params, comfortLow, comfortHigh);
+  room = &model;
+
+  // Sensor task and event-driven control loop, as on the device
+  ControlWakePlan plan = {0, INT32_MAX, INT32_MIN};
+  uint64_t deadline = 0;
+  uint64_t end = (uint64_t)days * MS_PER_DAY;
+  uint64_t nextSample = simNowMs();
+  uint32_t samples = 0, evaluations = 0, crossingWakes = 0;
+
+  auto wallStart = std::chrono::steady_clock::now();
+  while (simNowMs() < end) {
+    simAdvanceTo(nextSample < deadline ? nextSample : deadline);
+    model.advanceTo(simNowMs());
+
+    bool crossed = false;
+    if (simNowMs() >= nextSample) {
+      // SHT sensor resolution
+      currentTemp = roundf(model.getRoomTemp() * 100.0f) / 100.0f;
+      crossed = controlWakeCrossed(plan, tempToCenti(currentTemp));
+      nextSample = simNowMs() + controlSampleMs(plan, tempToCenti(currentTemp), SENSOR_SAMPLE_INTERVAL_MS);
+      samples++;
+    }
+    if (!crossed && simNowMs() < deadline) continue;
+
+    struct tm now;
+    simLocalTime(now);
+    plan = runControlStep(now, currentTemp);
+    while (serviceIrTransmitQueue(0)) {}       // The IR task's work; repeats advance the clock
+    deadline = simNowMs() + plan.sleepMs;
+    // A band edge near the last reading wakes the sensor task at once
+    if (simNowMs() + controlSampleMs(plan, tempToCenti(currentTemp), SENSOR_SAMPLE_INTERVAL_MS) < nextSample) {
+      nextSample = simNowMs();
+    }
+    evaluations++;
+    if (crossed) crossingWakes++;
+  }
+  model.advanceTo(end);
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  const RoomStats& stats = model.getStats();
+  double hours = end / 3600000.0;
+  printf("🧪 Simulated %d days in %.2f s (%.0fx real time)\n", days, wallSeconds, end / 1000.0 / wallSeconds);
+  printf("📡 IR commands sent:     %u (%u frames)\n", (unsigned)irStats.commands, (unsigned)irStats.frames);
+  IrTxStats txStats = getIrTxStats();
+  printf("〰️  IR waveforms decoded: %u, %u rejected, %.0f ns/frame; %u cached, %u library, "
+         "%u controller encodes, %u codec mismatches\n",
+         (unsigned)irStats.frames, (unsigned)irStats.rejected,
+         irStats.frames + irStats.rejected ? (double)irStats.decodeNs / (irStats.frames + irStats.rejected) : 0.0,
+         (unsigned)txStats.cachedFrames, (unsigned)txStats.libraryFrames, (unsigned)txStats.controllerEncodes,
+         (unsigned)txStats.codecMismatches);
+  printf("🔁 Control evaluations:  %u (%u on band crossings), %u sensor samples\n", (unsigned)evaluations,
+         (unsigned)crossingWakes, (unsigned)samples);
+  printf("🌡️  Out of comfort band:  %.1f h of %.0f h (%.1f%%), band %.1f-%.1f°C\n",
+         stats.outOfBandMs / 3600000.0, hours, 100.0 * stats.outOfBandMs / end, comfortLow, comfortHigh);
+  printf("❄️  Compressor cycles:    %u, running %.1f h (%.1f%%)\n", (unsigned)stats.compressorStarts,
+         stats.compressorOnMs / 3600000.0, 100.0 * stats.compressorOnMs / end);
+  printf("📈 Room temperature:     min %.2f°C, mean %.2f°C, max %.2f°C\n",
+         stats.minTemp, stats.tempSumMs / end, stats.maxTemp);
+  return 0;
+}
@@ -1,6 +1,9 @@
 #include "ac_control.h"
 #include "sensor.h"
-#include "ir_control.h"
+#include "ir_transmitter.h"
+#include "rule_store.h"
+#include "control_schedule.h"
+#include "config_store.h"
 #include <IRremoteESP8266.h>
 #include <ir_Gree.h>
 #include <time.h>
@@ -8,52 +11,94 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
-// Track previous AC state to avoid unnecessary commands
-static ACState previousACState = {false, 24, 0, 0, 0, 0};
+// Last decision applied by the control loop. The AC state itself lives in
+// the IR transmitter (getCurrentACState()); this only tells whether the
+// rules changed their mind since, so a web remote setting holds until then.
+static int lastDecisionRuleId = -2;   // Nothing decided yet
+static ACState lastDecisionTarget = AC_STATE_OFF;
 
-// Helper function to check if AC state has changed
-bool hasACStateChanged(bool power, uint8_t temp, uint8_t fan, uint8_t mode, int vSwing, int hSwing) {
-  return (previousACState.power != power ||
-          previousACState.temperature != temp ||
-          previousACState.fanSpeed != fan ||
-          previousACState.mode != mode ||
-          previousACState.vSwing != vSwing ||
-          previousACState.hSwing != hSwing);
+// Event-driven scheduling state. The band is written by controlTask after
+// each evaluation and checked by the sensor task on every sample; it starts
+// empty so the first valid reading wakes the control loop. The sensor task
+// leaves its handle and next sample time here so a new band that needs a
+// sooner sample can wake it.
+static TaskHandle_t controlTaskHandle = NULL;
+static TaskHandle_t sensorTaskHandle = NULL;
+static volatile int32_t wakeBandLow = INT32_MAX;
+static volatile int32_t wakeBandHigh = INT32_MIN;
+static volatile uint32_t nextSampleMs = 0;   // millis() of the next sample
+static ControlWakeStats wakeStats = {0, 0, 0, 0, 0, 0};
+
+// Retry period when the AC state could not be read
+#define AC_STATE_RETRY_MS 1000
+
+void notifyControlTask(uint32_t events) {
+  TaskHandle_t handle = controlTaskHandle;
+  if (handle != NULL) {
+    xTaskNotify(handle, events, eSetBits);
+  }
 }
 
-// Helper function to update previous AC state
-void updatePreviousACState(bool power, uint8_t temp, uint8_t fan, uint8_t mode, int vSwing, int hSwing) {
-  previousACState.power = power;
-  previousACState.temperature = temp;
-  previousACState.fanSpeed = fan;
-  previousACState.mode = mode;
-  previousACState.vSwing = vSwing;
-  previousACState.hSwing = hSwing;
+uint32_t reportTemperatureSample(float temp) {
+  sensorTaskHandle = xTaskGetCurrentTaskHandle();
+  wakeStats.samples++;
+  uint32_t sampleMs = SENSOR_SAMPLE_INTERVAL_MS;
+  if (!isnan(temp)) {
+    ControlWakePlan band = {0, wakeBandLow, wakeBandHigh};
+    int16_t tempCenti = tempToCenti(temp);
+    if (controlWakeCrossed(band, tempCenti)) {
+      notifyControlTask(CONTROL_EVENT_CROSSING);
+    }
+    sampleMs = controlSampleMs(band, tempCenti, sampleMs);
+  }
+  nextSampleMs = millis() + sampleMs;
+  return sampleMs;
 }
 
-// Function to get current AC state
-ACState getCurrentACState() {
-  return previousACState;
+// A reading well inside the old band may sit near an edge of the new one;
+// wake the sensor task if it would otherwise sample later than the new band
+// allows
+static void checkSamplePeriod(const ControlWakePlan& plan, float temp) {
+  TaskHandle_t handle = sensorTaskHandle;
+  if (handle == NULL) return;
+  uint32_t due = millis() + controlSampleMs(plan, tempToCenti(temp), SENSOR_SAMPLE_INTERVAL_MS);
+  if ((int32_t)(nextSampleMs - due) > 0) {
+    xTaskNotify(handle, 1, eSetBits);
+  }
 }
 
-// Function to safely copy rules for thread-safe access
-// Returns the number of rules copied, or -1 if mutex acquisition failed
-int copyRulesThreadSafe(ACRule localRules[], int maxRules) {
-  int localRuleCount = 0;
-  
-  // Acquire mutex to safely copy rules
-  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    // Copy rules to local array
-    for (int i = 0; i < ruleCount && i < maxRules; i++) {
-      localRules[i] = rules[i];
-    }
-    localRuleCount = ruleCount;
-    xSemaphoreGive(rulesMutex);
-    return localRuleCount;
+ControlWakeStats getControlWakeStats() {
+  return wakeStats;
+}
+
+// Block until the deadline or until a crossing / rule publish / setting
+// change is signalled; returns the CONTROL_EVENT_* bits received
+static uint32_t waitForControlEvent(uint32_t timeoutMs) {
+  uint32_t events = 0;
+  if (xTaskNotifyWait(0, UINT32_MAX, &events, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+    wakeStats.timerWakes++;
   } else {
-    Serial.println("⚠️ Failed to acquire rules mutex for reading");
-    return -1;
+    if (events & CONTROL_EVENT_CROSSING) wakeStats.crossingWakes++;
+    if (events & CONTROL_EVENT_RULES) wakeStats.ruleWakes++;
+    if (events & (CONTROL_EVENT_CONFIG | CONTROL_EVENT_TIME)) wakeStats.configWakes++;
+  }
+  wakeStats.wakeups++;
+  return events;
+}
+
+// SNTP keeps the server name pointers, so they live here rather than on the
+// stack. Called again after a change; only controlTask does after boot.
+static char sntpServers[NTP_SERVER_COUNT][NTP_SERVER_MAX + 1];
+
+void configureTime() {
+  for (int i = 0; i < NTP_SERVER_COUNT; i++) {
+    copyConfigString((ConfigId)(CONFIG_NTP_SERVER_1 + i), sntpServers[i], sizeof(sntpServers[i]));
   }
+  configTime(gmtOffset_sec, daylightOffset_sec, sntpServers[0],
+             sntpServers[1][0] ? sntpServers[1] : nullptr,
+             sntpServers[2][0] ? sntpServers[2] : nullptr);
+  Serial.printf("🕒 NTP %s, UTC%+ld s, DST %+ld s\n", sntpServers[0],
+                (long)gmtOffset_sec, (long)daylightOffset_sec);
 }
 
 void initTime() {
@@ -76,10 +121,7 @@ void initTime() {
   }
   
   // Configure NTP with multiple servers for reliability
-  configTime(gmtOffset_sec, daylightOffset_sec, 
-            "pool.ntp.org", 
-            "time.nist.gov", 
-            "time.cloudflare.com");
+  configureTime();
   
   Serial.println("📡 Requesting time from NTP servers...");
   
@@ -93,13 +135,14 @@ void initTime() {
       // Check if we got a reasonable time (after year 2020)
       if (timeinfo.tm_year > (2020 - 1900)) {
         timeSet = true;
-        Serial.printf("✅ Time synchronized: %04d-%02d-%02d %02d:%02d:%02d (GMT+8)\n",
+        Serial.printf("✅ Time synchronized: %04d-%02d-%02d %02d:%02d:%02d (UTC%+.1f h)\n",
                      timeinfo.tm_year + 1900, 
                      timeinfo.tm_mon + 1, 
                      timeinfo.tm_mday,
                      timeinfo.tm_hour, 
                      timeinfo.tm_min, 
-                     timeinfo.tm_sec);
+                     timeinfo.tm_sec,
+                     gmtOffset_sec / 3600.0f);
         break;
       }
     }
@@ -116,155 +159,151 @@ void initTime() {
   }
 }
 
-void controlTask(void* param) {
-  Serial.println("AC Control Task started on Core " + String(xPortGetCoreID()));
-  
-  for (;;) {
-    time_t now = time(nullptr);
-    struct tm* timeinfo = localtime(&now);
-    int hour = timeinfo->tm_hour;
+ControlWakePlan runControlStep(const struct tm& timeinfo, float temp) {
+  int32_t day = ruleDayNumber(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday);
+  int minuteOfWeek = weekMinute(timeinfo.tm_wday, timeinfo.tm_hour, timeinfo.tm_min);
 
-    // Read temperature
-    currentTemp = readTemperature();
-    
-    // Check if temperature reading is valid
-    if (isnan(currentTemp)) {
-      Serial.println("Failed to read temperature, waiting for valid reading");
-      vTaskDelay(pdMS_TO_TICKS(AC_CONTROL_LOOP_INTERVAL_MS)); // Use global configuration - power efficient delay
-      continue;
-    }
-    
-    Serial.printf("Current Temperature: %.2f°C\n", currentTemp);
+  Serial.printf("Current Temperature: %.2f°C\n", temp);
 
-    // Rule-based AC Control Logic
-    activeRuleId = -1; // Reset active rule
-    
-    // Create local copy of rules for thread-safe access
-    ACRule localRules[MAX_RULES];
-    int localRuleCount = copyRulesThreadSafe(localRules, MAX_RULES);
-    
-    // Check if rule copying was successful
-    if (localRuleCount == -1) {
-      Serial.println("⚠️ Skipping this cycle due to mutex acquisition failure");
-      vTaskDelay(pdMS_TO_TICKS(AC_CONTROL_LOOP_INTERVAL_MS));
-      continue;
+  // Rule-based AC Control Logic
+  ControlDecision decision;
+  ControlWakePlan plan;
+  
+  // Pin the current rule snapshot (never blocks, no copy) and evaluate its
+  // precompiled calendar with a single lookup
+  {
+    RuleSnapshotGuard snapshot(ruleStore);
+    int16_t tempCenti = tempToCenti(temp);
+    decision = decideControl(*snapshot, day, minuteOfWeek, tempCenti);
+    plan = planControlWake(snapshot->calendar, day, minuteOfWeek, timeinfo.tm_sec, tempCenti,
+                           AC_CONTROL_MAX_SLEEP_MS);
+    activeRuleId = -1;
+    if (decision.ruleIndex != -1) {
+      const ACRule& rule = snapshot->rules[decision.ruleIndex];
+      activeRuleId = rule.id;
+      
+      Serial.printf("Rule %d matches: %s (Temp: %.1f°C, Time: %02d:%02d, rules v%u)\n", 
+                   rule.id, snapshot->names.get(rule.nameId), temp, timeinfo.tm_hour, timeinfo.tm_min,
+                   (unsigned)snapshot->version);
     }
+  } // Snapshot released before any IR transmission
+  wakeBandLow = plan.bandLow;
+  wakeBandHigh = plan.bandHigh;
+  const ACState& target = decision.target;
+  ACState current;
+  IrTxSource currentSource;
+  if (!getCurrentACState(current, &currentSource)) {
+    // A guessed state could turn the AC off; decide again shortly instead
+    Serial.println("⚠️ AC state busy, rules re-applied on the next wake");
+    if (plan.sleepMs > AC_STATE_RETRY_MS) plan.sleepMs = AC_STATE_RETRY_MS;
+    return plan;
+  }
+  bool decisionChanged = activeRuleId != lastDecisionRuleId || !acStateEquals(target, lastDecisionTarget);
+  lastDecisionRuleId = activeRuleId;
+  lastDecisionTarget = target;
+  bool manualHold = !decisionChanged && currentSource == IR_TX_MANUAL;
+  
+  if (activeRuleId != -1) {
+    // Check if AC state needs to change OR if debug mode is enabled
+    bool stateChanged = controlNeedsCommand(decision, current) && !manualHold;
     
-    // Find first matching rule using local copy
-    for (int i = 0; i < localRuleCount; i++) {
-      if (!localRules[i].enabled) continue;
-      
-      bool timeMatch = true;
-      bool tempMatch = true;
-      
-      // Check time conditions
-      if (localRules[i].startHour != -1 && localRules[i].endHour != -1) {
-        if (localRules[i].endHour > localRules[i].startHour) {
-          // Normal time range (e.g., 8-19)
-          timeMatch = (hour >= localRules[i].startHour && hour < localRules[i].endHour);
-        } else {
-          // Overnight time range (e.g., 19-8)
-          timeMatch = (hour >= localRules[i].startHour || hour < localRules[i].endHour);
-        }
+    if (stateChanged || debugMode) {
+      if (debugMode && !stateChanged) {
+        Serial.printf("🔧 DEBUG MODE: Force sending IR command for Rule %d (no state change)\n", activeRuleId);
+      } else {
+        Serial.printf("AC State Change Detected - Applying Rule %d\n", activeRuleId);
       }
       
-      // Check temperature conditions
-      if (localRules[i].minTemp != -999 && currentTemp < localRules[i].minTemp) {
-        tempMatch = false;
-      }
-      if (localRules[i].maxTemp != -999 && currentTemp > localRules[i].maxTemp) {
-        tempMatch = false;
+      // Queued for irTransmitTask, which owns the repeats and records the
+      // new AC state - no blocking here
+      queueACState(target, IR_TX_RULE, debugMode);
+      if (target.power()) {
+        Serial.printf("AC ON: %d°C, Fan %d, Mode %d, VSwing %d, HSwing %d %s\n", 
+                     target.temperature(), target.fanSpeed(), target.mode(), 
+                     target.vSwing(), target.hSwing(),
+                     debugMode ? "[DEBUG]" : "");
+      } else {
+        Serial.printf("AC OFF %s\n", debugMode ? "[DEBUG]" : "");
       }
-      
-      // If both conditions match, apply this rule
-      if (timeMatch && tempMatch) {
-        activeRuleId = localRules[i].id;
-        
-        Serial.printf("Rule %d matches: %s (Temp: %.1f°C, Time: %02d:00)\n", 
-                     localRules[i].id, localRules[i].name.c_str(), currentTemp, hour);
-        
-        // Check if AC state needs to change OR if debug mode is enabled
-        bool stateChanged = hasACStateChanged(localRules[i].acOn, (uint8_t)localRules[i].setTemp, 
-                                            localRules[i].fanSpeed, localRules[i].mode, 
-                                            localRules[i].vSwing, localRules[i].hSwing);
-        
-        if (stateChanged || debugMode) {
-          if (debugMode && !stateChanged) {
-            Serial.printf("🔧 DEBUG MODE: Force sending IR command for Rule %d (no state change)\n", localRules[i].id);
-          } else {
-            Serial.printf("AC State Change Detected - Applying Rule %d\n", localRules[i].id);
-          }
-          
-          if (localRules[i].acOn) {
-            // Configure all AC settings first
-            greeAC.powerOn();
-            greeAC.setTemperature((uint8_t)localRules[i].setTemp);
-            greeAC.setFanSpeed(localRules[i].fanSpeed);
-            greeAC.setMode(localRules[i].mode);
-            greeAC.setSwingVPosition(localRules[i].vSwing);
-            greeAC.setSwingHPosition(localRules[i].hSwing);
-            
-            // Send all settings at once
-            greeAC.sendAllSettings();
-            
-            Serial.printf("AC ON: %.1f°C, Fan %d, Mode %d, VSwing %d, HSwing %d %s\n", 
-                         localRules[i].setTemp, localRules[i].fanSpeed, localRules[i].mode, 
-                         localRules[i].vSwing, localRules[i].hSwing,
-                         debugMode ? "[DEBUG]" : "");
-          } else {
-            greeAC.powerOff();
-            greeAC.sendAllSettings(); // Send the OFF command
-            Serial.printf("AC OFF %s\n", debugMode ? "[DEBUG]" : "");
-          }
-          
-          // Update tracked state
-          updatePreviousACState(localRules[i].acOn, (uint8_t)localRules[i].setTemp, 
-                              localRules[i].fanSpeed, localRules[i].mode, 
-                              localRules[i].vSwing, localRules[i].hSwing);
-        } else {
-          if (debugMode) {
-            Serial.printf("🔧 DEBUG MODE: Force sending IR command for Rule %d (no state change)\n", localRules[i].id);
-          } else {
-            Serial.printf("AC State Unchanged - Rule %d already applied\n", localRules[i].id);
-          }
-        }
-        
-        break; // Stop at first match
+    } else {
+      if (debugMode) {
+        Serial.printf("🔧 DEBUG MODE: Force sending IR command for Rule %d (no state change)\n", activeRuleId);
+      } else if (manualHold) {
+        Serial.printf("AC State Held - Manual setting kept until Rule %d changes\n", activeRuleId);
+      } else {
+        Serial.printf("AC State Unchanged - Rule %d already applied\n", activeRuleId);
       }
     }
+  }
+  
+  if (activeRuleId == -1) {
+    Serial.println("No matching rules found");
     
-    if (activeRuleId == -1) {
-      Serial.println("No matching rules found");
-      
-      // Check if AC should be turned off (no rules match and AC was previously on)
-      if (previousACState.power || debugMode) {
-        if (debugMode && !previousACState.power) {
-          Serial.println("🔧 DEBUG MODE: Force sending AC OFF command (already off)");
-        } else {
-          Serial.println("Turning AC OFF - No active rules");
-        }
-        greeAC.powerOff();
-        greeAC.sendAllSettings(); // Send the OFF command
-        updatePreviousACState(false, 24, 0, 0, 0, 0); // Reset to default off state
+    // Check if AC should be turned off (no rules match and AC was previously on)
+    if ((controlNeedsCommand(decision, current) && !manualHold) || debugMode) {
+      if (debugMode && !current.power()) {
+        Serial.println("🔧 DEBUG MODE: Force sending AC OFF command (already off)");
       } else {
-        Serial.println("AC already OFF - No change needed");
+        Serial.println("Turning AC OFF - No active rules");
       }
+      queueACState(target, IR_TX_RULE, debugMode); // Send the OFF command
+    } else if (manualHold && current.power()) {
+      Serial.println("AC left on - Manual setting kept until a rule matches");
+    } else {
+      Serial.println("AC already OFF - No change needed");
     }
+  }
+  return plan;
+}
+
+void controlTask(void* param) {
+  Serial.println("AC Control Task started on Core " + String(xPortGetCoreID()));
+  controlTaskHandle = xTaskGetCurrentTaskHandle();
+  configSubscribe(CONFIG_BIT(CONFIG_DEBUG_MODE) | CONFIG_BIT(CONFIG_CONTROL_SLEEP), controlTaskHandle,
+                  CONTROL_EVENT_CONFIG);
+  configSubscribe(CONFIG_TIME_SETTINGS, controlTaskHandle, CONTROL_EVENT_TIME);
+  uint32_t events = 0;
+  
+  for (;;) {
+    // Local time shifts with the offset, so apply it before reading the clock
+    if (events & CONTROL_EVENT_TIME) configureTime();
+    
+    time_t now = time(nullptr);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo); // localtime() shares one buffer between tasks
 
-    // Log status
-    logToCloud(currentTemp);
+    // Latest reading from the sensor task
+    float temp = currentTemp;
     
-    vTaskDelay(pdMS_TO_TICKS(AC_CONTROL_LOOP_INTERVAL_MS));
+    // Check if temperature reading is valid
+    if (isnan(temp)) {
+      Serial.println("No valid temperature reading, waiting for sensor");
+      wakeBandLow = INT32_MAX; // Any valid sample wakes us
+      wakeBandHigh = INT32_MIN;
+      events = waitForControlEvent(AC_CONTROL_MAX_SLEEP_MS);
+      continue;
+    }
+    
+    ControlWakePlan plan = runControlStep(timeinfo, temp);
+    checkSamplePeriod(plan, temp);
+    
+    // Nothing can change the decision before the next row change or band crossing
+    Serial.printf("💤 Next evaluation in %lu s or when temperature leaves [%.2f, %.2f)°C\n",
+                 (unsigned long)(plan.sleepMs / 1000),
+                 plan.bandLow == INT32_MIN ? -INFINITY : plan.bandLow / 100.0f,
+                 plan.bandHigh == INT32_MAX ? INFINITY : plan.bandHigh / 100.0f);
+    events = waitForControlEvent(plan.sleepMs);
   }
 }
 
 void logToCloud(float temp) {
   // Enhanced logging with timestamp
   time_t now = time(nullptr);
-  struct tm* timeinfo = localtime(&now);
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
   
   Serial.printf("[%02d:%02d:%02d] IoT Log - Temp: %.1f°C\n", 
-                timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, temp);
+                timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, temp);
   
   // Here you could add actual cloud logging (MQTT, HTTP POST, etc.)
   // Example: Send to ThingSpeak, AWS IoT, or similar service
@@ -0,0 +1,33 @@
+#include "ac_state.h"
+
+ACStateTracker::ACStateTracker(const ACState& initial) : state(initial), version(0), noOps(0), history{} {
+}
+
+uint8_t ACStateTracker::update(const ACState& next, uint8_t source, uint32_t ms) {
+  uint8_t dirty = acStateDiff(state, next);
+  if (dirty == 0) {
+    noOps++;
+    return 0;
+  }
+  state = next;
+  history[version % AC_STATE_HISTORY_LENGTH] = {ms, next, dirty, source};
+  version++;
+  return dirty;
+}
+
+void ACStateTracker::revert(const ACState& previous) {
+  if (version > 0) version--;
+  state = previous;
+}
+
+uint8_t ACStateTracker::getLastSource() const {
+  return version > 0 ? history[(version - 1) % AC_STATE_HISTORY_LENGTH].source : 0;
+}
+
+int ACStateTracker::getHistory(ACStateChange* out, int maxCount) const {
+  int count = 0;
+  for (uint32_t i = version; i > 0 && count < maxCount && count < AC_STATE_HISTORY_LENGTH; i--) {
+    out[count++] = history[(i - 1) % AC_STATE_HISTORY_LENGTH];
+  }
+  return count;
+}
@@ -1,36 +1,44 @@
 #include "config.h"
 #include <Arduino.h>
-#include <SPIFFS.h>
-#include <ArduinoJson.h>
+#include "ac_control.h"
+#include "ir_transmitter.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
+// Compiled-in defaults below; values saved through /api/config replace
+// them at boot (initConfigStore())
+
 // WiFi Configuration
-const char* ssid = "TP-LINK_0B75";
-const char* password = "bafe@123";
+const char* const defaultSsid = "TP-LINK_0B75";
+const char* const defaultPassword = "bafe@123";
+char ssid[WIFI_SSID_MAX + 1] = "TP-LINK_0B75";
+char password[WIFI_PASSWORD_MAX + 1] = "bafe@123";
 
 // Time Configuration
-const char* ntpServer = "pool.ntp.org";
-const long gmtOffset_sec = 3600 * 8;  // GMT+8
-const int daylightOffset_sec = 0;
+char ntpServers[NTP_SERVER_COUNT][NTP_SERVER_MAX + 1] = {"pool.ntp.org", "time.nist.gov", "time.cloudflare.com"};
+int32_t gmtOffset_sec = 3600 * 8;  // GMT+8
+int32_t daylightOffset_sec = 0;
 
 // Debug mode flag - when true, always send IR commands regardless of state change
 bool debugMode = false;
 
 // Global Variables
-float currentTemp = 0.0;
+float currentTemp = NAN;  // Updated by the sensor task, NAN until the first valid sample
 
 // Rule-based control system
-ACRule rules[MAX_RULES];
-int ruleCount = 0;
+RuleSet ruleSet;
+RuleNamePool ruleNames;
 int activeRuleId = -1;
+RuleStore ruleStore;
 
 // Mutex for thread-safe access to rules
 SemaphoreHandle_t rulesMutex = NULL;
 
 // System timing configuration (in milliseconds)
-uint32_t AC_CONTROL_LOOP_INTERVAL_MS = 5000;  // 60 seconds for AC control loop
+uint32_t SENSOR_SAMPLE_INTERVAL_MS = 5000;    // 5 seconds between samples near a rule threshold, up to 1 min away from one
+uint32_t AC_CONTROL_MAX_SLEEP_MS = 900000;    // 15 minutes heartbeat for the event-driven control loop
 uint32_t DISPLAY_REFRESH_INTERVAL_MS = 5000;   // 5 seconds for display refresh
+uint32_t IR_COALESCE_WINDOW_MS = 400;         // Merge web IR commands closer together than this
 
 // Initialize the rules mutex
 void initRulesMutex() {
@@ -44,220 +52,76 @@ void initRulesMutex() {
   }
 }
 
+// Publish the edited ruleSet as a new immutable snapshot for readers
+// (controlTask, web GET handlers). Call with rulesMutex held.
+void markRulesChanged() {
+  ruleNames.compact(ruleSet.data(), ruleSet.size()); // Drop names of deleted/renamed rules
+  uint32_t version = ruleStore.publish(ruleSet.data(), ruleSet.size(), ruleNames,
+                                      ruleSet.exceptionData(), ruleSet.exceptionCount());
+  Serial.printf("📦 Published rule snapshot v%u (%d rules)\n", (unsigned)version, ruleSet.size());
+  precomputeIrFrames(ruleSet.data(), ruleSet.size());
+  notifyControlTask(CONTROL_EVENT_RULES); // Re-evaluate now instead of at the next deadline
+}
+
 // Initialize default rules
 void initDefaultRules() {
+  ruleSet.clear();
+  ruleNames.clear();
+  
   // Rule 1: Cool during hot days
-  rules[0] = {
+  ruleSet.insert({
     .id = 1,
-    .name = "Cool Day",
-    .enabled = true,
-    .startHour = 8,
-    .endHour = 19,
-    .minTemp = 26.0,
-    .maxTemp = -999,
-    .acOn = true,
-    .setTemp = 27.0,
-    .fanSpeed = 3,
-    .mode = 0,
-    .vSwing = 0,  // Auto vertical swing
-    .hSwing = 0   // Auto horizontal swing
-  };
+    .nameId = ruleNames.intern("Cool Day"),
+    .priority = 0,
+    .flags = RULE_FLAG_ENABLED | RULE_FLAG_AC_ON,
+    .present = RULE_HAS_WINDOW | RULE_HAS_MIN_TEMP,
+    .startMinute = 8 * 60,
+    .endMinute = 19 * 60,
+    .weekdays = RULE_ALL_WEEKDAYS,
+    .minTemp = 2600,
+    .maxTemp = 0,
+    .setTemp = 2700,
+    .mode = AC_MODE_COOL,
+    .fanSpeed = AC_FAN_HIGH,
+    .vSwing = AC_SWING_V_AUTO,
+    .hSwing = AC_SWING_H_AUTO
+  });
   
   // Rule 2: Quiet cooling at night
-  rules[1] = {
+  ruleSet.insert({
     .id = 2,
-    .name = "Cool Night",
-    .enabled = true,
-    .startHour = 19,
-    .endHour = 8,
-    .minTemp = 26.0,
-    .maxTemp = -999,
-    .acOn = true,
-    .setTemp = 28.0,
-    .fanSpeed = 1,
-    .mode = 0,
-    .vSwing = 2,  // Mid vertical swing (less air movement for sleep)
-    .hSwing = 2   // Mid horizontal swing
-  };
+    .nameId = ruleNames.intern("Cool Night"),
+    .priority = 1,
+    .flags = RULE_FLAG_ENABLED | RULE_FLAG_AC_ON,
+    .present = RULE_HAS_WINDOW | RULE_HAS_MIN_TEMP,
+    .startMinute = 19 * 60,
+    .endMinute = 8 * 60,
+    .weekdays = RULE_ALL_WEEKDAYS,
+    .minTemp = 2600,
+    .maxTemp = 0,
+    .setTemp = 2800,
+    .mode = AC_MODE_COOL,
+    .fanSpeed = AC_FAN_LOW,
+    .vSwing = AC_SWING_V_MID,  // Mid vertical swing (less air movement for sleep)
+    .hSwing = AC_SWING_H_MID   // Mid horizontal swing
+  });
   
   // Rule 3: Turn off when cool
-  rules[2] = {
+  ruleSet.insert({
     .id = 3,
-    .name = "Turn Off When Cool",
-    .enabled = true,
-    .startHour = -1,
-    .endHour = -1,
-    .minTemp = -999,
-    .maxTemp = 25.9,
-    .acOn = false,
-    .setTemp = 24.0,
-    .fanSpeed = 1,
-    .mode = 0,
-    .vSwing = 0,  // Auto (doesn't matter when AC is off)
-    .hSwing = 0   // Auto (doesn't matter when AC is off)
-  };
-  
-  ruleCount = 3;
-}
-
-// Sort rules by start time and then by minimum temperature
-void sortRules() {
-  if (ruleCount <= 1) return; // No need to sort if 0 or 1 rule
-  
-  // Simple bubble sort - sufficient for small arrays (max 10 rules)
-  for (int i = 0; i < ruleCount - 1; i++) {
-    for (int j = 0; j < ruleCount - i - 1; j++) {
-      bool shouldSwap = false;
-      
-      // Compare start times first
-      int startA = rules[j].startHour == -1 ? 999 : rules[j].startHour;     // -1 (any time) goes to end
-      int startB = rules[j+1].startHour == -1 ? 999 : rules[j+1].startHour; // -1 (any time) goes to end
-      
-      if (startA > startB) {
-        shouldSwap = true;
-      } else if (startA == startB) {
-        // If start times are equal, compare minimum temperatures
-        float minTempA = rules[j].minTemp == -999 ? 999.0 : rules[j].minTemp;     // -999 (any temp) goes to end
-        float minTempB = rules[j+1].minTemp == -999 ? 999.0 : rules[j+1].minTemp; // -999 (any temp) goes to end
-        
-        if (minTempA > minTempB) {
-          shouldSwap = true;
-        }
-      }
-      
-      if (shouldSwap) {
-        // Swap rules[j] and rules[j+1]
-        ACRule temp = rules[j];
-        rules[j] = rules[j+1];
-        rules[j+1] = temp;
-      }
-    }
-  }
-}
-
-// Save rules to SPIFFS
-void saveRulesToSPIFFS() {
-  // Acquire mutex for thread-safe access
-  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    // Sort rules before saving
-    sortRules();
-    JsonDocument doc;
-    JsonArray rulesArray = doc["rules"].to<JsonArray>();
-    
-    for (int i = 0; i < ruleCount; i++) {
-      JsonObject rule = rulesArray.add<JsonObject>();
-      rule["id"] = rules[i].id;
-      rule["name"] = rules[i].name;
-      rule["enabled"] = rules[i].enabled;
-      rule["startHour"] = rules[i].startHour;
-      rule["endHour"] = rules[i].endHour;
-      rule["minTemp"] = rules[i].minTemp;
-      rule["maxTemp"] = rules[i].maxTemp;
-      rule["acOn"] = rules[i].acOn;
-      rule["setTemp"] = rules[i].setTemp;
-      rule["fanSpeed"] = rules[i].fanSpeed;
-      rule["mode"] = rules[i].mode;
-      rule["vSwing"] = rules[i].vSwing;
-      rule["hSwing"] = rules[i].hSwing;
-    }
-    
-    doc["count"] = ruleCount;
-    doc["version"] = 1; // For future migration compatibility
-    
-    // Release mutex before file I/O to minimize lock time
-    xSemaphoreGive(rulesMutex);
-    
-    File file = SPIFFS.open("/rules.json", "w");
-    if (file) {
-      serializeJson(doc, file);
-      file.close();
-      Serial.printf("✅ Saved %d rules to SPIFFS\n", ruleCount);
-    } else {
-      Serial.println("❌ Failed to save rules to SPIFFS");
-    }
-  } else {
-    Serial.println("⚠️ Failed to acquire rules mutex for saving");
-  }
-}
-
-// Load rules from SPIFFS
-void loadRulesFromSPIFFS() {
-  File file = SPIFFS.open("/rules.json", "r");
-  if (!file) {
-    Serial.println("📄 No saved rules found, creating defaults");
-    // Acquire mutex for thread-safe access
-    if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-      initDefaultRules();
-      xSemaphoreGive(rulesMutex);
-      saveRulesToSPIFFS(); // Save defaults for next time
-    } else {
-      Serial.println("⚠️ Failed to acquire rules mutex for default initialization");
-    }
-    return;
-  }
-  
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, file);
-  file.close();
-  
-  if (error) {
-    Serial.printf("❌ Failed to parse rules.json: %s\n", error.c_str());
-    Serial.println("📄 Using default rules instead");
-    // Acquire mutex for thread-safe access
-    if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-      initDefaultRules();
-      xSemaphoreGive(rulesMutex);
-      saveRulesToSPIFFS(); // Overwrite corrupted file
-    } else {
-      Serial.println("⚠️ Failed to acquire rules mutex for default initialization");
-    }
-    return;
-  }
-  
-  // Acquire mutex for thread-safe access
-  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    // Load rules from JSON
-    JsonArray rulesArray = doc["rules"];
-    ruleCount = 0;
-    
-    for (JsonObject rule : rulesArray) {
-      if (ruleCount >= MAX_RULES) {
-        Serial.printf("⚠️ Maximum rules (%d) reached, skipping remaining\n", MAX_RULES);
-        break;
-      }
-      
-      rules[ruleCount].id = rule["id"] | (ruleCount + 1); // Fallback ID
-      rules[ruleCount].name = rule["name"] | String("Rule " + String(ruleCount + 1));
-      rules[ruleCount].enabled = rule["enabled"] | true;
-      rules[ruleCount].startHour = rule["startHour"] | -1;
-      rules[ruleCount].endHour = rule["endHour"] | -1;
-      rules[ruleCount].minTemp = rule["minTemp"] | -999.0f;
-      rules[ruleCount].maxTemp = rule["maxTemp"] | -999.0f;
-      rules[ruleCount].acOn = rule["acOn"] | true;
-      rules[ruleCount].setTemp = rule["setTemp"] | 25.0f;
-      rules[ruleCount].fanSpeed = rule["fanSpeed"] | 2;
-      rules[ruleCount].mode = rule["mode"] | 0;
-      rules[ruleCount].vSwing = rule["vSwing"] | 0;
-      rules[ruleCount].hSwing = rule["hSwing"] | 0;
-      
-      ruleCount++;
-    }
-    
-    // Release mutex
-    xSemaphoreGive(rulesMutex);
-    
-    Serial.printf("✅ Loaded %d rules from SPIFFS\n", ruleCount);
-    
-    // If no rules were loaded, create defaults
-    if (ruleCount == 0) {
-      Serial.println("📄 No valid rules loaded, creating defaults");
-      if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        initDefaultRules();
-        xSemaphoreGive(rulesMutex);
-        saveRulesToSPIFFS();
-      }
-    }
-  } else {
-    Serial.println("⚠️ Failed to acquire rules mutex for loading");
-  }
+    .nameId = ruleNames.intern("Turn Off When Cool"),
+    .priority = 2,
+    .flags = RULE_FLAG_ENABLED,
+    .present = RULE_HAS_MAX_TEMP,
+    .startMinute = 0,
+    .endMinute = 0,
+    .weekdays = RULE_ALL_WEEKDAYS,
+    .minTemp = 0,
+    .maxTemp = 2590,
+    .setTemp = 2400,
+    .mode = AC_MODE_COOL,
+    .fanSpeed = AC_FAN_LOW,
+    .vSwing = AC_SWING_V_AUTO,  // Auto (doesn't matter when AC is off)
+    .hSwing = AC_SWING_H_AUTO   // Auto (doesn't matter when AC is off)
+  });
 }
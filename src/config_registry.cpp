@@ -0,0 +1,130 @@
+#include "config_registry.h"
+#include <string.h>
+#include <stdio.h>
+
+const ConfigSetting* configFind(const ConfigSetting* settings, int count, const char* name) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(settings[i].name, name) == 0) return &settings[i];
+  }
+  return nullptr;
+}
+
+bool configCheck(const ConfigSetting& setting, JsonVariantConst value, char* error, size_t errorSize) {
+  switch (setting.type) {
+    case CONFIG_BOOL:
+      if (value.is<bool>()) return true;
+      snprintf(error, errorSize, "\"%s\" must be true or false", setting.name);
+      return false;
+    case CONFIG_INT:
+    case CONFIG_UINT:
+      // 64-bit so a huge or negative number is out of range, not wrapped
+      if (value.is<int64_t>() && value.as<int64_t>() >= setting.minValue &&
+          value.as<int64_t>() <= setting.maxValue) {
+        return true;
+      }
+      snprintf(error, errorSize, "\"%s\" must be an integer %ld..%ld", setting.name,
+               (long)setting.minValue, (long)setting.maxValue);
+      return false;
+    case CONFIG_STRING:
+      if (value.is<const char*>()) {
+        size_t length = strlen(value.as<const char*>());
+        if (length >= (size_t)setting.minValue && length <= (size_t)setting.maxValue) return true;
+      }
+      snprintf(error, errorSize, "\"%s\" must be a string of %ld..%ld characters", setting.name,
+               (long)setting.minValue, (long)setting.maxValue);
+      return false;
+  }
+  return false;
+}
+
+bool configStore(const ConfigSetting& setting, JsonVariantConst value) {
+  switch (setting.type) {
+    case CONFIG_BOOL: {
+      bool* target = (bool*)setting.value;
+      bool next = value.as<bool>();
+      if (*target == next) return false;
+      *target = next;
+      return true;
+    }
+    case CONFIG_INT: {
+      int32_t* target = (int32_t*)setting.value;
+      int32_t next = (int32_t)value.as<int64_t>();
+      if (*target == next) return false;
+      *target = next;
+      return true;
+    }
+    case CONFIG_UINT: {
+      uint32_t* target = (uint32_t*)setting.value;
+      uint32_t next = (uint32_t)value.as<int64_t>();
+      if (*target == next) return false;
+      *target = next;
+      return true;
+    }
+    case CONFIG_STRING: {
+      char* target = (char*)setting.value;
+      const char* next = value.as<const char*>();
+      if (strcmp(target, next) == 0) return false;
+      strncpy(target, next, setting.maxValue);
+      target[setting.maxValue] = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+bool configApplyJson(const ConfigSetting* settings, int count, JsonObjectConst body,
+                     ConfigApplyResult& result) {
+  result = ConfigApplyResult();
+  if (body.isNull()) {
+    snprintf(result.error, sizeof(result.error), "%s", "Settings must be a JSON object");
+    return false;
+  }
+
+  // Check everything before the first write
+  for (JsonPairConst field : body) {
+    const ConfigSetting* setting = configFind(settings, count, field.key().c_str());
+    if (setting == nullptr) {
+      snprintf(result.error, sizeof(result.error), "Unknown setting \"%s\"", field.key().c_str());
+      return false;
+    }
+    if (!configCheck(*setting, field.value(), result.error, sizeof(result.error))) return false;
+  }
+
+  for (JsonPairConst field : body) {
+    const ConfigSetting* setting = configFind(settings, count, field.key().c_str());
+    if (configStore(*setting, field.value())) result.changed |= 1u << (setting - settings);
+  }
+  return true;
+}
+
+void configValuesToJson(const ConfigSetting* settings, int count, JsonObject out) {
+  for (int i = 0; i < count; i++) {
+    const ConfigSetting& setting = settings[i];
+    if (setting.flags & CONFIG_SECRET) continue;
+    switch (setting.type) {
+      case CONFIG_BOOL: out[setting.name] = *(const bool*)setting.value; break;
+      case CONFIG_INT: out[setting.name] = *(const int32_t*)setting.value; break;
+      case CONFIG_UINT: out[setting.name] = *(const uint32_t*)setting.value; break;
+      case CONFIG_STRING: out[setting.name] = (const char*)setting.value; break;
+    }
+  }
+}
+
+void configSchemaToJson(const ConfigSetting* settings, int count, JsonArray out) {
+  static const char* const typeNames[] = {"bool", "int", "uint", "string"};
+  for (int i = 0; i < count; i++) {
+    const ConfigSetting& setting = settings[i];
+    JsonObject entry = out.add<JsonObject>();
+    entry["name"] = setting.name;
+    entry["type"] = typeNames[setting.type];
+    if (setting.type != CONFIG_BOOL) {
+      entry["min"] = setting.minValue;
+      entry["max"] = setting.maxValue;
+    }
+    if (setting.flags & CONFIG_SECRET) {
+      entry["secret"] = true;
+      entry["set"] = ((const char*)setting.value)[0] != '\0';
+    }
+    if (setting.flags & CONFIG_REBOOT) entry["reboot"] = true;
+  }
+}
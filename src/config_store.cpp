@@ -0,0 +1,159 @@
+#include "config_store.h"
+#include "config.h"
+#include <Preferences.h>
+#include <freertos/semphr.h>
+#include <string.h>
+
+static const char* const CONFIG_NAMESPACE = "config";
+
+// Same order as ConfigId. Names are also the NVS keys (CONFIG_NAME_MAX).
+static const ConfigSetting configSettings[CONFIG_COUNT] = {
+  {"wifiSsid",        CONFIG_STRING, CONFIG_REBOOT,                 ssid,                        1, WIFI_SSID_MAX},
+  {"wifiPassword",    CONFIG_STRING, CONFIG_REBOOT | CONFIG_SECRET, password,                    0, WIFI_PASSWORD_MAX},
+  {"ntpServer1",      CONFIG_STRING, 0,                             ntpServers[0],               1, NTP_SERVER_MAX},
+  {"ntpServer2",      CONFIG_STRING, 0,                             ntpServers[1],               0, NTP_SERVER_MAX},
+  {"ntpServer3",      CONFIG_STRING, 0,                             ntpServers[2],               0, NTP_SERVER_MAX},
+  {"gmtOffsetSec",    CONFIG_INT,    0,                             &gmtOffset_sec,         -43200, 50400},    // UTC-12..UTC+14
+  {"dstOffsetSec",    CONFIG_INT,    0,                             &daylightOffset_sec,         0, 7200},
+  {"debugMode",       CONFIG_BOOL,   0,                             &debugMode,                  0, 1},
+  {"sensorSampleMs",  CONFIG_UINT,   0,                             &SENSOR_SAMPLE_INTERVAL_MS, 500, 60000},
+  // pdMS_TO_TICKS() overflows past ~71 minutes
+  {"controlSleepMs",  CONFIG_UINT,   0,                             &AC_CONTROL_MAX_SLEEP_MS, 10000, 3600000},
+  {"displayPeriodMs", CONFIG_UINT,   0,                             &DISPLAY_REFRESH_INTERVAL_MS, 500, 600000},
+  {"irCoalesceMs",    CONFIG_UINT,   0,                             &IR_COALESCE_WINDOW_MS,      0, 2000},
+};
+
+struct ConfigSubscriber {
+  uint32_t settings;
+  TaskHandle_t task;
+  uint32_t events;
+};
+
+// Writers of the globals and of the subscriber list hold configMutex
+static SemaphoreHandle_t configMutex = NULL;
+static ConfigSubscriber subscribers[CONFIG_MAX_SUBSCRIBERS];
+static int subscriberCount = 0;
+
+// Type-checked read of one saved value; out-of-range values (a firmware with
+// a narrower range) keep the default
+static bool loadSetting(Preferences& prefs, const ConfigSetting& setting) {
+  JsonDocument doc;
+  switch (setting.type) {
+    case CONFIG_BOOL: doc["value"] = prefs.getBool(setting.name); break;
+    case CONFIG_INT: doc["value"] = prefs.getInt(setting.name); break;
+    case CONFIG_UINT: doc["value"] = prefs.getUInt(setting.name); break;
+    case CONFIG_STRING: doc["value"] = prefs.getString(setting.name); break;
+  }
+  char error[80];
+  if (!configCheck(setting, doc["value"], error, sizeof(error))) {
+    Serial.printf("⚠️ Saved setting ignored: %s\n", error);
+    return false;
+  }
+  configStore(setting, doc["value"]);
+  return true;
+}
+
+void initConfigStore() {
+  if (configMutex != NULL) return;
+  configMutex = xSemaphoreCreateMutex();
+  if (configMutex == NULL) {
+    Serial.println("❌ Failed to create config mutex!");
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(CONFIG_NAMESPACE, true)) {  // Read-only open fails until the first save
+    Serial.println("⚙️ No saved settings, using defaults");
+    return;
+  }
+  int loaded = 0;
+  for (const ConfigSetting& setting : configSettings) {
+    if (prefs.isKey(setting.name) && loadSetting(prefs, setting)) loaded++;
+  }
+  prefs.end();
+  Serial.printf("✅ Loaded %d settings from NVS\n", loaded);
+}
+
+// Write the settings in `changed`; a failed put leaves the old NVS value
+static bool saveSettings(uint32_t changed) {
+  Preferences prefs;
+  if (!prefs.begin(CONFIG_NAMESPACE, false)) return false;
+  bool saved = true;
+  for (int i = 0; i < CONFIG_COUNT; i++) {
+    if (!(changed & CONFIG_BIT(i))) continue;
+    const ConfigSetting& setting = configSettings[i];
+    size_t expected = setting.type == CONFIG_BOOL ? 1 : 4;
+    size_t written = 0;
+    switch (setting.type) {
+      case CONFIG_BOOL: written = prefs.putBool(setting.name, *(const bool*)setting.value); break;
+      case CONFIG_INT: written = prefs.putInt(setting.name, *(const int32_t*)setting.value); break;
+      case CONFIG_UINT: written = prefs.putUInt(setting.name, *(const uint32_t*)setting.value); break;
+      case CONFIG_STRING:
+        // Returns the string length, so "" (an unused NTP server) is saved when 0
+        expected = strlen((const char*)setting.value);
+        written = prefs.putString(setting.name, (const char*)setting.value);
+        break;
+    }
+    if (written != expected) saved = false;
+  }
+  prefs.end();
+  return saved;
+}
+
+bool updateConfig(JsonObjectConst body, ConfigApplyResult& result, bool& saved) {
+  saved = true;
+  if (configMutex == NULL || xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    result = ConfigApplyResult();
+    snprintf(result.error, sizeof(result.error), "%s", "Failed to acquire config lock");
+    return false;
+  }
+  bool applied = configApplyJson(configSettings, CONFIG_COUNT, body, result);
+  if (applied && result.changed != 0) saved = saveSettings(result.changed);
+
+  // Copy the subscribers so the tasks are woken without the lock held
+  ConfigSubscriber notify[CONFIG_MAX_SUBSCRIBERS];
+  int notifyCount = subscriberCount;
+  memcpy(notify, subscribers, sizeof(ConfigSubscriber) * notifyCount);
+  xSemaphoreGive(configMutex);
+
+  if (!applied || result.changed == 0) return applied;
+  for (int i = 0; i < CONFIG_COUNT; i++) {
+    if (result.changed & CONFIG_BIT(i)) {
+      Serial.printf("⚙️ Setting %s changed%s\n", configSettings[i].name,
+                    (configSettings[i].flags & CONFIG_REBOOT) ? " (applies after restart)" : "");
+    }
+  }
+  for (int i = 0; i < notifyCount; i++) {
+    if (notify[i].settings & result.changed) xTaskNotify(notify[i].task, notify[i].events, eSetBits);
+  }
+  if (!saved) Serial.println("❌ Failed to save settings to NVS");
+  return true;
+}
+
+void configToJson(JsonDocument& doc) {
+  // The lock keeps strings from changing while they are copied into doc
+  bool locked = configMutex != NULL && xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE;
+  configValuesToJson(configSettings, CONFIG_COUNT, doc["settings"].to<JsonObject>());
+  configSchemaToJson(configSettings, CONFIG_COUNT, doc["schema"].to<JsonArray>());
+  if (locked) xSemaphoreGive(configMutex);
+}
+
+const ConfigSetting& configSetting(ConfigId id) {
+  return configSettings[id];
+}
+
+void copyConfigString(ConfigId id, char* out, size_t size) {
+  bool locked = configMutex != NULL && xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE;
+  strncpy(out, (const char*)configSettings[id].value, size - 1);
+  out[size - 1] = '\0';
+  if (locked) xSemaphoreGive(configMutex);
+}
+
+void configSubscribe(uint32_t settings, TaskHandle_t task, uint32_t events) {
+  if (configMutex == NULL || xSemaphoreTake(configMutex, portMAX_DELAY) != pdTRUE) return;
+  if (subscriberCount < CONFIG_MAX_SUBSCRIBERS) {
+    subscribers[subscriberCount++] = {settings, task, events};
+  } else {
+    Serial.println("❌ Too many config subscribers");
+  }
+  xSemaphoreGive(configMutex);
+}
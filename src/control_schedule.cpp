@@ -0,0 +1,54 @@
+#include "control_schedule.h"
+
+ControlWakePlan planControlWake(const RuleCalendar& calendar, int32_t day, int minuteOfWeek,
+                                int secondsIntoMinute, int16_t tempCenti, uint32_t maxSleepMs) {
+  const RuleDecisionTable& table = calendar.tableFor(day);
+  ControlWakePlan plan;
+  table.getTempBand(minuteOfWeek, tempCenti, plan.bandLow, plan.bandHigh);
+
+  // Nearest of the next slot change and the next date span change, 0 = none
+  int64_t minutes = table.minutesUntilChange(minuteOfWeek);
+  int days = calendar.daysUntilChange(day);
+  if (days > 0) {
+    int64_t untilDate = (int64_t)days * MINUTES_PER_DAY - minuteOfWeek % MINUTES_PER_DAY;
+    if (minutes == 0 || untilDate < minutes) {
+      minutes = untilDate;
+    }
+  }
+
+  plan.sleepMs = maxSleepMs;
+  if (minutes > 0) {
+    int64_t untilChangeMs = (minutes * 60 - secondsIntoMinute) * 1000 + CONTROL_WAKE_SLACK_MS;
+    if (untilChangeMs < (int64_t)plan.sleepMs) {
+      plan.sleepMs = (uint32_t)untilChangeMs;
+    }
+  }
+  return plan;
+}
+
+uint32_t controlSampleMs(const ControlWakePlan& plan, int16_t tempCenti, uint32_t sampleMs) {
+  if (controlWakeCrossed(plan, tempCenti)) return sampleMs;
+  // Centi-degrees the reading can drift before it could leave the band
+  int64_t margin = (int64_t)tempCenti - plan.bandLow;
+  int64_t toHigh = (int64_t)plan.bandHigh - 1 - tempCenti;
+  if (toHigh < margin) margin = toHigh;
+  margin -= CONTROL_SAMPLE_GUARD_CENTI;
+  if (margin <= 0 || sampleMs >= CONTROL_SAMPLE_MAX_MS) return sampleMs;
+
+  int64_t periodMs = margin * 60000 / CONTROL_SAMPLE_SLEW_CENTI_PER_MIN;
+  if (periodMs > CONTROL_SAMPLE_MAX_MS) return CONTROL_SAMPLE_MAX_MS;
+  return periodMs > sampleMs ? (uint32_t)periodMs : sampleMs;
+}
+
+ACState ruleTargetState(const ACRule& rule) {
+  return makeACState(ruleAcOn(rule), (uint8_t)(rule.setTemp / 100), rule.fanSpeed, rule.mode, rule.vSwing,
+                     rule.hSwing);
+}
+
+ControlDecision decideControl(const RuleSnapshot& snapshot, int32_t day, int minuteOfWeek, int16_t tempCenti) {
+  ControlDecision decision = {snapshot.calendar.lookup(day, minuteOfWeek, tempCenti), AC_STATE_OFF};
+  if (decision.ruleIndex != -1) {
+    decision.target = ruleTargetState(snapshot.rules[decision.ruleIndex]);
+  }
+  return decision;
+}
@@ -0,0 +1,157 @@
+#include "daikin_codec.h"
+#include "ir_timing.h"
+#include <string.h>
+
+// IRDaikinESP::stateReset() before checksums: the three section headers, the
+// fixed bit in byte 21 and timers 27-28 / 31 left as the library sets them
+static const uint8_t daikinTemplate[DAIKIN_STATE_LENGTH] = {
+  0x11, 0xDA, 0x27, 0x00, 0xC5, 0x00, 0x00, 0x00,
+  0x11, 0xDA, 0x27, 0x00, 0x42, 0x00, 0x00, 0x00,
+  0x11, 0xDA, 0x27, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x60, 0x00, 0x00, 0xC0,
+  0x00, 0x00, 0x00
+};
+
+#define DAIKIN_SECTION2_START DAIKIN_SECTION1_LENGTH
+#define DAIKIN_SECTION3_START (DAIKIN_SECTION1_LENGTH + DAIKIN_SECTION2_LENGTH)
+#define DAIKIN_BYTE_POWER_MODE 21
+#define DAIKIN_BYTE_TEMP 22
+#define DAIKIN_BYTE_FAN_SWING_V 24
+#define DAIKIN_BYTE_SWING_H 25
+
+static const IrBitTimings daikinBits = {DAIKIN_BIT_MARK, DAIKIN_ONE_SPACE, DAIKIN_ZERO_SPACE};
+
+static uint8_t daikinMode(uint8_t mode) {
+  switch (mode) {
+    case AC_MODE_COOL: return DAIKIN_MODE_COOL;
+    case AC_MODE_HEAT: return DAIKIN_MODE_HEAT;
+    case AC_MODE_DRY: return DAIKIN_MODE_DRY;
+    case AC_MODE_FAN: return DAIKIN_MODE_FAN;
+    case AC_MODE_AUTO: return DAIKIN_MODE_AUTO;
+    default: return DAIKIN_MODE_COOL;
+  }
+}
+
+// IRDaikinESP::setFan() takes 1-5 and stores it offset by 2; ours are 1-3
+static uint8_t daikinFan(uint8_t fanSpeed) {
+  switch (fanSpeed) {
+    case AC_FAN_LOW: return DAIKIN_FAN_MIN + 2;
+    case AC_FAN_MED: return (DAIKIN_FAN_MIN + DAIKIN_FAN_MAX) / 2 + 2;
+    case AC_FAN_HIGH: return DAIKIN_FAN_MAX + 2;
+    default: return DAIKIN_FAN_AUTO;
+  }
+}
+
+uint8_t daikinChecksum(const uint8_t* section, uint8_t length) {
+  uint8_t sum = 0;
+  for (int i = 0; i < length - 1; i++) sum += section[i];
+  return sum;
+}
+
+static void setChecksums(uint8_t state[DAIKIN_STATE_LENGTH]) {
+  state[DAIKIN_SECTION2_START - 1] = daikinChecksum(state, DAIKIN_SECTION1_LENGTH);
+  state[DAIKIN_SECTION3_START - 1] = daikinChecksum(state + DAIKIN_SECTION2_START, DAIKIN_SECTION2_LENGTH);
+  state[DAIKIN_STATE_LENGTH - 1] = daikinChecksum(state + DAIKIN_SECTION3_START, DAIKIN_SECTION3_LENGTH);
+}
+
+bool daikinChecksumsValid(const uint8_t state[DAIKIN_STATE_LENGTH]) {
+  return state[DAIKIN_SECTION2_START - 1] == daikinChecksum(state, DAIKIN_SECTION1_LENGTH) &&
+         state[DAIKIN_SECTION3_START - 1] == daikinChecksum(state + DAIKIN_SECTION2_START, DAIKIN_SECTION2_LENGTH) &&
+         state[DAIKIN_STATE_LENGTH - 1] == daikinChecksum(state + DAIKIN_SECTION3_START, DAIKIN_SECTION3_LENGTH);
+}
+
+void daikinEncodeState(const ACState& state, uint8_t out[DAIKIN_STATE_LENGTH]) {
+  uint8_t temp = state.temperature();
+  if (temp < DAIKIN_MIN_TEMP) temp = DAIKIN_MIN_TEMP;
+  if (temp > DAIKIN_MAX_TEMP) temp = DAIKIN_MAX_TEMP;
+  uint8_t swingV = state.vSwing() == AC_SWING_V_AUTO ? DAIKIN_SWING_ON : DAIKIN_SWING_OFF;
+  uint8_t swingH = state.hSwing() == AC_SWING_H_AUTO ? DAIKIN_SWING_ON : DAIKIN_SWING_OFF;
+
+  memcpy(out, daikinTemplate, DAIKIN_STATE_LENGTH);
+  out[DAIKIN_BYTE_POWER_MODE] |= (state.power() ? 0x01 : 0) | (daikinMode(state.mode()) << 4);
+  out[DAIKIN_BYTE_TEMP] = temp << 1;
+  out[DAIKIN_BYTE_FAN_SWING_V] = swingV | (daikinFan(state.fanSpeed()) << 4);
+  out[DAIKIN_BYTE_SWING_H] = swingH;
+  setChecksums(out);
+}
+
+// Header, `length` bytes LSB first, footer mark and gap
+static uint16_t* encodeSection(uint16_t* p, const uint8_t* section, int length) {
+  *p++ = DAIKIN_HDR_MARK;
+  *p++ = DAIKIN_HDR_SPACE;
+  for (int i = 0; i < length; i++) p = irEncodeBits(p, section[i], 8, daikinBits);
+  *p++ = DAIKIN_BIT_MARK;
+  *p++ = DAIKIN_ZERO_SPACE + DAIKIN_GAP;
+  return p;
+}
+
+uint16_t daikinEncodeTimings(const uint8_t state[DAIKIN_STATE_LENGTH], uint16_t out[DAIKIN_FRAME_TIMINGS]) {
+  uint16_t* p = irEncodeBits(out, 0, DAIKIN_LEADER_BITS, daikinBits);
+  *p++ = DAIKIN_BIT_MARK;
+  *p++ = DAIKIN_ZERO_SPACE + DAIKIN_GAP;
+  p = encodeSection(p, state, DAIKIN_SECTION1_LENGTH);
+  p = encodeSection(p, state + DAIKIN_SECTION2_START, DAIKIN_SECTION2_LENGTH);
+  p = encodeSection(p, state + DAIKIN_SECTION3_START, DAIKIN_SECTION3_LENGTH);
+  return (uint16_t)(p - out);
+}
+
+// One section up to and including its footer mark; advances `p` to the gap
+static bool decodeSection(const uint16_t*& p, uint8_t* out, int length) {
+  if (!irMatchMark(p[0], DAIKIN_HDR_MARK) || !irMatchSpace(p[1], DAIKIN_HDR_SPACE)) return false;
+  p += 2;
+  uint32_t value;
+  for (int i = 0; i < length; i++) {
+    if (!irDecodeBits(p, 8, daikinBits, value)) return false;
+    out[i] = (uint8_t)value;
+  }
+  if (!irMatchMark(p[0], DAIKIN_BIT_MARK)) return false;
+  p++;
+  return true;
+}
+
+bool daikinDecodeTimings(const uint16_t* timings, uint16_t count, uint8_t out[DAIKIN_STATE_LENGTH]) {
+  if (count != DAIKIN_FRAME_TIMINGS && count != DAIKIN_FRAME_TIMINGS - 1) return false;
+  const uint16_t* p = timings;
+  uint32_t leader;
+  if (!irDecodeBits(p, DAIKIN_LEADER_BITS, daikinBits, leader) || leader != 0) return false;
+  if (!irMatchMark(p[0], DAIKIN_BIT_MARK) || !irMatchGap(p[1], DAIKIN_GAP)) return false;
+  p += 2;
+  if (!decodeSection(p, out, DAIKIN_SECTION1_LENGTH) || !irMatchGap(*p++, DAIKIN_GAP)) return false;
+  if (!decodeSection(p, out + DAIKIN_SECTION2_START, DAIKIN_SECTION2_LENGTH) || !irMatchGap(*p++, DAIKIN_GAP)) {
+    return false;
+  }
+  if (!decodeSection(p, out + DAIKIN_SECTION3_START, DAIKIN_SECTION3_LENGTH)) return false;
+  if (count == DAIKIN_FRAME_TIMINGS && !irMatchGap(*p, DAIKIN_GAP)) return false;
+  return daikinChecksumsValid(out);
+}
+
+void daikinDecodeState(const uint8_t state[DAIKIN_STATE_LENGTH], ACState& out) {
+  out = AC_STATE_OFF;
+  out.setPower((state[DAIKIN_BYTE_POWER_MODE] & 0x01) != 0);
+  switch ((state[DAIKIN_BYTE_POWER_MODE] >> 4) & 0x07) {
+    case DAIKIN_MODE_AUTO: out.setMode(AC_MODE_AUTO); break;
+    case DAIKIN_MODE_DRY: out.setMode(AC_MODE_DRY); break;
+    case DAIKIN_MODE_HEAT: out.setMode(AC_MODE_HEAT); break;
+    case DAIKIN_MODE_FAN: out.setMode(AC_MODE_FAN); break;
+    default: out.setMode(AC_MODE_COOL); break;
+  }
+  out.setTemperature((state[DAIKIN_BYTE_TEMP] >> 1) & 0x3F);
+
+  uint8_t fan = state[DAIKIN_BYTE_FAN_SWING_V] >> 4;
+  uint8_t speed = fan - 2;       // Daikin speed 1-5 for the numbered settings
+  if (fan == DAIKIN_FAN_QUIET) {
+    out.setFanSpeed(AC_FAN_LOW);
+  } else if (fan < DAIKIN_FAN_MIN + 2 || fan > DAIKIN_FAN_MAX + 2) {
+    out.setFanSpeed(AC_FAN_AUTO);
+  } else if (speed < 3) {
+    out.setFanSpeed(AC_FAN_LOW);
+  } else if (speed == 3) {
+    out.setFanSpeed(AC_FAN_MED);
+  } else {
+    out.setFanSpeed(AC_FAN_HIGH);
+  }
+
+  bool swingV = (state[DAIKIN_BYTE_FAN_SWING_V] & 0x0F) != DAIKIN_SWING_OFF;
+  bool swingH = (state[DAIKIN_BYTE_SWING_H] & 0x0F) != DAIKIN_SWING_OFF;
+  out.setVSwing(swingV ? AC_SWING_V_AUTO : AC_SWING_V_MID);
+  out.setHSwing(swingH ? AC_SWING_H_AUTO : AC_SWING_H_MID);
+}
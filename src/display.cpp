@@ -1,4 +1,6 @@
 #include "display.h"
+#include "ir_transmitter.h"
+#include "config_store.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <Wire.h>
@@ -24,13 +26,23 @@ void initDisplay() {
 
 void updateDisplay() {
   time_t now = time(nullptr);
-  struct tm* timeinfo = localtime(&now);
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
 
   display.clearDisplay();
   display.setCursor(0, 0);
   display.printf("Temp: %.1f C\n", currentTemp);
   display.printf("Rule: %s\n", activeRuleId != -1 ? "Active" : "None");
-  display.printf("Time: %02d:%02d\n", timeinfo->tm_hour, timeinfo->tm_min);
+  ACState acState;
+  IrTxSource acSource;
+  if (!getCurrentACState(acState, &acSource)) {
+    display.printf("AC: --\n");   // State busy, next refresh shows it
+  } else if (acState.power()) {
+    display.printf("AC: ON %dC%s\n", acState.temperature(), acSource == IR_TX_MANUAL ? " (manual)" : "");
+  } else {
+    display.printf("AC: OFF\n");
+  }
+  display.printf("Time: %02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min);
   
   // Show IP address if connected to WiFi
   if (WiFi.status() == WL_CONNECTED) {
@@ -44,12 +56,13 @@ void updateDisplay() {
 
 void displayTask(void* param) {
   Serial.println("Display Task started on Core " + String(xPortGetCoreID()));
+  configSubscribe(CONFIG_BIT(CONFIG_DISPLAY_REFRESH), xTaskGetCurrentTaskHandle(), 1);
   
   for (;;) {
     updateDisplay();
     
-    // Use vTaskDelay for power efficiency - allows core to sleep
-    // Use global configuration for display refresh timing
-    vTaskDelay(pdMS_TO_TICKS(DISPLAY_REFRESH_INTERVAL_MS));
+    // Blocked wait for power efficiency - allows core to sleep. A new
+    // refresh interval (/api/config) wakes it early to take effect.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DISPLAY_REFRESH_INTERVAL_MS));
   }
 }
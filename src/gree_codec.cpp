@@ -0,0 +1,143 @@
+#include "gree_codec.h"
+#include "ir_timing.h"
+#include <string.h>
+
+// Byte 3 and 5 carry fixed bits IRGreeAC::stateReset() sets (unknown1 = 0b0101,
+// unknown2 = 0b100); byte 2 has the light on and the YAW1F second power bit.
+#define GREE_BYTE2_LIGHT 0x20
+#define GREE_BYTE2_POWER2 0x40
+#define GREE_BYTE3_FIXED 0x50
+#define GREE_BYTE5_FIXED 0x20
+#define GREE_CHECKSUM_START 10
+
+static uint8_t greeMode(uint8_t mode) {
+  switch (mode) {
+    case AC_MODE_COOL: return GREE_MODE_COOL;
+    case AC_MODE_HEAT: return GREE_MODE_HEAT;
+    case AC_MODE_DRY: return GREE_MODE_DRY;
+    case AC_MODE_FAN: return GREE_MODE_FAN;
+    case AC_MODE_AUTO: return GREE_MODE_AUTO;
+    default: return GREE_MODE_COOL;
+  }
+}
+
+static uint8_t greeSwingV(int position) {
+  switch (position) {
+    case AC_SWING_V_TOP: return GREE_SWING_V_UP;
+    case AC_SWING_V_MID: return GREE_SWING_V_MIDDLE;
+    case AC_SWING_V_BOTTOM: return GREE_SWING_V_DOWN;
+    default: return GREE_SWING_V_AUTO;
+  }
+}
+
+static uint8_t greeSwingH(int position) {
+  switch (position) {
+    case AC_SWING_H_LEFT: return GREE_SWING_H_LEFT;
+    case AC_SWING_H_MID: return GREE_SWING_H_MIDDLE;
+    case AC_SWING_H_RIGHT: return GREE_SWING_H_RIGHT;
+    default: return GREE_SWING_H_AUTO;
+  }
+}
+
+// Kelvinator block checksum: low nibbles of bytes 0-3 plus high nibbles of 4-6
+uint8_t greeChecksum(const uint8_t state[GREE_STATE_LENGTH]) {
+  uint8_t sum = GREE_CHECKSUM_START;
+  for (int i = 0; i < 4; i++) sum += state[i] & 0x0F;
+  for (int i = 4; i < GREE_STATE_LENGTH - 1; i++) sum += state[i] >> 4;
+  return sum & 0x0F;
+}
+
+void greeEncodeState(const ACState& state, uint8_t out[GREE_STATE_LENGTH]) {
+  uint8_t mode = greeMode(state.mode());
+  uint8_t fan = state.fanSpeed() > 3 ? 0 : state.fanSpeed();
+  uint8_t temp = state.temperature();
+  if (temp < GREE_MIN_TEMP) temp = GREE_MIN_TEMP;
+  if (temp > GREE_MAX_TEMP) temp = GREE_MAX_TEMP;
+  if (mode == GREE_MODE_AUTO) temp = 25;   // IRGreeAC::setMode() locks AUTO to 25 °C
+  if (mode == GREE_MODE_DRY) fan = 1;      // ... and DRY to the lowest fan
+  uint8_t swingV = greeSwingV(state.vSwing());
+
+  memset(out, 0, GREE_STATE_LENGTH);
+  out[0] = mode | (state.power() ? 0x08 : 0) | (fan << 4) | (swingV == GREE_SWING_V_AUTO ? 0x40 : 0);
+  out[1] = temp - GREE_MIN_TEMP;
+  out[2] = GREE_BYTE2_LIGHT | (state.power() ? GREE_BYTE2_POWER2 : 0);
+  out[3] = GREE_BYTE3_FIXED;
+  out[4] = swingV | (greeSwingH(state.hSwing()) << 4);
+  out[5] = GREE_BYTE5_FIXED;
+  out[7] = greeChecksum(out) << 4;
+}
+
+static const IrBitTimings greeBits = {GREE_BIT_MARK, GREE_ONE_SPACE, GREE_ZERO_SPACE};
+
+uint16_t greeEncodeTimings(const uint8_t state[GREE_STATE_LENGTH], uint16_t out[GREE_FRAME_TIMINGS]) {
+  uint16_t* p = out;
+  *p++ = GREE_HDR_MARK;
+  *p++ = GREE_HDR_SPACE;
+  for (int i = 0; i < 4; i++) p = irEncodeBits(p, state[i], 8, greeBits);
+  p = irEncodeBits(p, GREE_BLOCK_FOOTER, GREE_BLOCK_FOOTER_BITS, greeBits);
+  *p++ = GREE_BIT_MARK;
+  *p++ = GREE_MSG_SPACE;
+  for (int i = 4; i < GREE_STATE_LENGTH; i++) p = irEncodeBits(p, state[i], 8, greeBits);
+  *p++ = GREE_BIT_MARK;
+  *p++ = GREE_MSG_SPACE;
+  return (uint16_t)(p - out);
+}
+
+bool greeDecodeTimings(const uint16_t* timings, uint16_t count, uint8_t out[GREE_STATE_LENGTH]) {
+  if (count != GREE_FRAME_TIMINGS && count != GREE_FRAME_TIMINGS - 1) return false;
+  const uint16_t* p = timings;
+  if (!irMatchMark(p[0], GREE_HDR_MARK) || !irMatchSpace(p[1], GREE_HDR_SPACE)) return false;
+  p += 2;
+
+  uint32_t value;
+  for (int i = 0; i < 4; i++) {
+    if (!irDecodeBits(p, 8, greeBits, value)) return false;
+    out[i] = (uint8_t)value;
+  }
+  if (!irDecodeBits(p, GREE_BLOCK_FOOTER_BITS, greeBits, value) || value != GREE_BLOCK_FOOTER) return false;
+  if (!irMatchMark(p[0], GREE_BIT_MARK) || !irMatchGap(p[1], GREE_MSG_SPACE)) return false;
+  p += 2;
+  for (int i = 4; i < GREE_STATE_LENGTH; i++) {
+    if (!irDecodeBits(p, 8, greeBits, value)) return false;
+    out[i] = (uint8_t)value;
+  }
+  if (!irMatchMark(p[0], GREE_BIT_MARK)) return false;
+  if (count == GREE_FRAME_TIMINGS && !irMatchGap(p[1], GREE_MSG_SPACE)) return false;
+  return greeChecksum(out) == out[GREE_STATE_LENGTH - 1] >> 4;
+}
+
+void greeDecodeState(const uint8_t state[GREE_STATE_LENGTH], ACState& out) {
+  out = AC_STATE_OFF;
+  out.setPower((state[0] & 0x08) != 0);
+  out.setTemperature((state[1] & 0x0F) + GREE_MIN_TEMP);
+  out.setFanSpeed((state[0] >> 4) & 0x03);
+  switch (state[0] & 0x07) {
+    case GREE_MODE_AUTO: out.setMode(AC_MODE_AUTO); break;
+    case GREE_MODE_DRY: out.setMode(AC_MODE_DRY); break;
+    case GREE_MODE_FAN: out.setMode(AC_MODE_FAN); break;
+    case GREE_MODE_HEAT: out.setMode(AC_MODE_HEAT); break;
+    default: out.setMode(AC_MODE_COOL); break;
+  }
+
+  uint8_t swingV = state[4] & 0x0F;
+  if ((state[0] & 0x40) || swingV <= GREE_SWING_V_AUTO) {
+    out.setVSwing(AC_SWING_V_AUTO);
+  } else if (swingV < GREE_SWING_V_MIDDLE) {
+    out.setVSwing(AC_SWING_V_TOP);
+  } else if (swingV == GREE_SWING_V_MIDDLE) {
+    out.setVSwing(AC_SWING_V_MID);
+  } else {
+    out.setVSwing(AC_SWING_V_BOTTOM);
+  }
+
+  uint8_t swingH = (state[4] >> 4) & 0x07;
+  if (swingH <= GREE_SWING_H_AUTO) {
+    out.setHSwing(AC_SWING_H_AUTO);
+  } else if (swingH < GREE_SWING_H_MIDDLE) {
+    out.setHSwing(AC_SWING_H_LEFT);
+  } else if (swingH == GREE_SWING_H_MIDDLE) {
+    out.setHSwing(AC_SWING_H_MID);
+  } else {
+    out.setHSwing(AC_SWING_H_RIGHT);
+  }
+}
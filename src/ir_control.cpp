@@ -1,8 +1,9 @@
 #include "ir_control.h"
 #include "config.h"
+#include "gree_codec.h"
 
-// Global Gree AC controller instance
-GreeACController greeAC;
+// Global AC controller instance
+ACController acController;
 
 // Constructor
 GreeACController::GreeACController() : ac(IR_SEND_PIN), irsend(IR_SEND_PIN) {
@@ -208,6 +209,34 @@ void GreeACController::clearTimer() {
     Serial.println("AC: Timer cleared (not sent yet)");
 }
 
+// Configure the full state in one go; irTransmitTask sends it afterwards.
+// Mode goes first: IRGreeAC locks AUTO to 25 °C and DRY to fan 1, and
+// setting temperature or fan before leaving those modes would keep the lock.
+void GreeACController::applyState(const ACState& state) {
+    if (state.power()) {
+        powerOn();
+    } else {
+        powerOff();
+    }
+    setMode(state.mode());
+    setTemperature(state.temperature());
+    setFanSpeed(state.fanSpeed());
+    setSwingVPosition(state.vSwing());
+    setSwingHPosition(state.hSwing());
+}
+
+void GreeACController::sendFrame() {
+    ac.send();
+}
+
+void GreeACController::sendRawFrame(const uint16_t* timings, uint16_t count) {
+    irsend.sendRaw(timings, count, GREE_CARRIER_KHZ);
+}
+
+const uint8_t* GreeACController::getRawState() {
+    return ac.getRaw();
+}
+
 // Send command to AC
 void GreeACController::sendCommand() {
     Serial.println("=== Sending IR Command ===");
@@ -282,9 +311,9 @@ String GreeACController::getStateString() {
 
 // Legacy API compatibility functions
 void initIR() {
-    greeAC.init();
+    acController.init();
 }
 
 bool isIRReadyForControl() {
-    return greeAC.isReady();
+    return acController.isReady();
 }
@@ -0,0 +1,288 @@
+#include "ir_transmitter.h"
+#include "ir_control.h"
+#include "config.h"
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <string.h>
+
+struct IrTxRequest {
+  ACState state;
+  IrTxSource source;
+  bool force;
+  uint32_t queuedMs;
+};
+
+// Indexed by IrTxSource. Rule changes keep the triple send that used to live
+// in sendAllSettings(), web buttons the double send of sendCommand().
+static const IrRepeatPolicy repeatPolicies[] = {
+  {3, 500, 100},   // IR_TX_RULE
+  {2, 200, 100}    // IR_TX_MANUAL
+};
+
+static QueueHandle_t irTxQueue = NULL;
+static SemaphoreHandle_t acStateMutex = NULL;
+static ACStateTracker acState(AC_STATE_OFF);    // Matches acController.init()
+
+// Bumped by queueACState() callers (control and web tasks) and by the
+// transmit task, so every access holds txStatsMutex; a copy never mixes two
+// updates or half a 64-bit counter. A count is dropped if the lock times out.
+static IrTxStats txStats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, {0, 0, 0}, 0, 0};
+static SemaphoreHandle_t txStatsMutex = NULL;
+
+static bool lockTxStats() {
+  return txStatsMutex != NULL && xSemaphoreTake(txStatsMutex, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+// What the last command put on the air; only the transmit task touches it
+static ACState transmittedState = AC_STATE_OFF;
+static bool hasTransmitted = false;
+
+// Shared by the transmit task and precomputeIrFrames() (web handlers)
+static ACFrameCache<ACProtocol> frameCache(IR_FRAME_CACHE_BYTES);
+static SemaphoreHandle_t frameCacheMutex = NULL;
+
+void initIrTransmitter() {
+  if (irTxQueue != NULL) return;
+  irTxQueue = xQueueCreate(IR_TX_QUEUE_LENGTH, sizeof(IrTxRequest));
+  acStateMutex = xSemaphoreCreateMutex();
+  frameCacheMutex = xSemaphoreCreateMutex();
+  txStatsMutex = xSemaphoreCreateMutex();
+  if (irTxQueue == NULL || acStateMutex == NULL || frameCacheMutex == NULL || txStatsMutex == NULL) {
+    Serial.println("❌ Failed to create IR transmit queue!");
+  } else {
+    Serial.println("✅ IR transmit queue created successfully");
+  }
+}
+
+IrTxResult queueACState(const ACState& state, IrTxSource source, bool force) {
+  if (irTxQueue == NULL) {
+    Serial.println("⚠️ IR transmitter not initialized, command dropped");
+    return IR_TX_FAILED;
+  }
+  // Held until the request is queued, so the tracker and the queue see
+  // concurrent callers in the same order
+  if (xSemaphoreTake(acStateMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    Serial.println("⚠️ AC state busy, command dropped");
+    return IR_TX_FAILED;
+  }
+  ACState previous = acState.current();
+  uint8_t dirty = acState.update(state, source, millis());
+  if (dirty == 0 && !force) {
+    xSemaphoreGive(acStateMutex);
+    if (lockTxStats()) {
+      txStats.unchanged++;
+      xSemaphoreGive(txStatsMutex);
+    }
+    return IR_TX_UNCHANGED;
+  }
+
+  IrTxRequest request = {state, source, force, (uint32_t)millis()};
+  uint32_t dropped = 0;
+  bool queued = xQueueSend(irTxQueue, &request, 0) == pdTRUE;
+  if (!queued) {
+    IrTxRequest oldest;
+    if (xQueueReceive(irTxQueue, &oldest, 0) == pdTRUE) {
+      dropped++;
+    }
+    queued = xQueueSend(irTxQueue, &request, 0) == pdTRUE;
+    if (!queued) {
+      Serial.println("⚠️ IR transmit queue full, request dropped");
+      dropped++;
+    }
+  }
+  // The AC never hears of a dropped state, so asking for it again must queue it
+  if (!queued && dirty != 0) acState.revert(previous);
+  uint32_t depth = uxQueueMessagesWaiting(irTxQueue);
+  xSemaphoreGive(acStateMutex);
+  if (lockTxStats()) {
+    txStats.dropped += dropped;
+    txStats.queueDepth = depth;
+    if (depth > txStats.maxQueueDepth) txStats.maxQueueDepth = depth;
+    xSemaphoreGive(txStatsMutex);
+  }
+  return queued ? IR_TX_QUEUED : IR_TX_FAILED;
+}
+
+// Replace `request` with a newer one, keeping the time the burst started
+static void coalesceInto(IrTxRequest& request, const IrTxRequest& newer) {
+  if (lockTxStats()) {
+    txStats.coalesced++;
+    txStats.framesSaved += repeatPolicies[request.source].frames;
+    xSemaphoreGive(txStatsMutex);
+  }
+  uint32_t firstQueuedMs = request.queuedMs;
+  bool force = request.force;
+  request = newer;
+  request.queuedMs = firstQueuedMs;
+  request.force = request.force || force;
+}
+
+void precomputeIrFrames(const ACRule* rules, int count) {
+  if (frameCacheMutex == NULL || xSemaphoreTake(frameCacheMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    return;   // Frames get encoded on first use instead
+  }
+  ACState off = AC_STATE_OFF;
+  frameCache.get(off);
+  for (int i = 0; i < count; i++) {
+    if (ruleEnabled(rules[i])) frameCache.get(ruleTargetState(rules[i]));
+  }
+  int entries = frameCache.size();
+  xSemaphoreGive(frameCacheMutex);
+  Serial.printf("📡 IR frame cache: %d frames ready\n", entries);
+}
+
+#ifndef IR_VERIFY_FRAMES
+static bool findCachedFrame(const ACState& state, ACFrame<ACProtocol>& frame) {
+  if (frameCacheMutex == NULL || xSemaphoreTake(frameCacheMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    return false;
+  }
+  const ACFrame<ACProtocol>* cached = frameCache.find(state);
+  if (cached != NULL) frame = *cached;
+  xSemaphoreGive(frameCacheMutex);
+  return cached != NULL;
+}
+#endif
+
+// Put the frame for `state` in `frame`. A cached frame is sent as is; only a
+// miss (or every command with IR_VERIFY_FRAMES) has acController encode the
+// state, and its bytes, the reference, replace whatever the cache held.
+// Returns false if they fail the checksum: acController then holds the
+// state and its own send path is used.
+static bool loadCachedFrame(const ACState& state, ACFrame<ACProtocol>& frame) {
+#ifndef IR_VERIFY_FRAMES
+  if (findCachedFrame(state, frame)) return true;
+#endif
+  acController.applyState(state);
+  const uint8_t* referenceBytes = acController.getRawState();
+  bool valid = referenceBytes != NULL && ACProtocol::checksumValid(referenceBytes);
+  bool mismatch = false;
+  const ACFrame<ACProtocol>* cached = NULL;
+  if (valid && frameCacheMutex != NULL && xSemaphoreTake(frameCacheMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    cached = frameCache.find(state);
+    mismatch = cached != NULL && memcmp(cached->state, referenceBytes, ACProtocol::STATE_LENGTH) != 0;
+    if (cached == NULL || mismatch) cached = frameCache.put(state, referenceBytes);
+    if (cached != NULL) frame = *cached;
+    xSemaphoreGive(frameCacheMutex);
+  }
+  if (lockTxStats()) {
+    txStats.controllerEncodes++;
+    if (mismatch) txStats.codecMismatches++;
+    xSemaphoreGive(txStatsMutex);
+  }
+  return cached != NULL;
+}
+
+bool serviceIrTransmitQueue(TickType_t wait) {
+  IrTxRequest request;
+  if (irTxQueue == NULL || xQueueReceive(irTxQueue, &request, wait) != pdTRUE) {
+    return false;
+  }
+
+  IrTxRequest newer;
+  while (xQueueReceive(irTxQueue, &newer, 0) == pdTRUE) {
+    coalesceInto(request, newer);
+  }
+  if (request.source == IR_TX_MANUAL && IR_COALESCE_WINDOW_MS > 0) {
+    uint32_t windowStart = millis();
+    uint32_t maxWaitMs = IR_COALESCE_WINDOW_MS * IR_COALESCE_MAX_WINDOWS;
+    for (;;) {
+      uint32_t waitedMs = (uint32_t)millis() - windowStart;
+      if (waitedMs >= maxWaitMs) break;
+      uint32_t timeoutMs = maxWaitMs - waitedMs;
+      if (timeoutMs > IR_COALESCE_WINDOW_MS) timeoutMs = IR_COALESCE_WINDOW_MS;
+      if (xQueueReceive(irTxQueue, &newer, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) break;
+      coalesceInto(request, newer);
+    }
+  }
+  uint32_t depth = uxQueueMessagesWaiting(irTxQueue);
+  bool suppressed = !request.force && hasTransmitted && acStateEquals(request.state, transmittedState);
+  if (lockTxStats()) {
+    txStats.queueDepth = depth;
+    if (suppressed) txStats.suppressed++;
+    xSemaphoreGive(txStatsMutex);
+  }
+
+  if (suppressed) {
+    Serial.println("📡 IR burst ended on the current AC state, nothing sent");
+    return true;
+  }
+
+  const IrRepeatPolicy& policy = repeatPolicies[request.source];
+  static ACFrame<ACProtocol> frame;   // Only this task sends; Daikin frames are over 1 KB
+  bool cached = loadCachedFrame(request.state, frame);
+  for (uint8_t i = 0; i < policy.frames; i++) {
+    uint32_t latencyMs = (uint32_t)millis() - request.queuedMs;
+    uint32_t start = micros();
+    if (cached) {
+      acController.sendRawFrame(frame.timings, ACProtocol::FRAME_TIMINGS);
+    } else {
+      acController.sendFrame();
+    }
+    uint32_t airtimeUs = (uint32_t)(micros() - start);
+    if (lockTxStats()) {
+      if (cached) {
+        txStats.cachedFrames++;
+      } else {
+        txStats.libraryFrames++;
+      }
+      txStats.airtimeUs += airtimeUs;
+      txStats.frames++;
+      txStats.lastLatencyMs = latencyMs;
+      txStats.latencySumMs += latencyMs;
+      if (latencyMs > txStats.maxLatencyMs) txStats.maxLatencyMs = latencyMs;
+      xSemaphoreGive(txStatsMutex);
+    }
+
+    delay(i + 1 < policy.frames ? policy.spacingMs : policy.settleMs);
+  }
+  transmittedState = request.state;
+  hasTransmitted = true;
+  if (lockTxStats()) {
+    txStats.commands++;
+    xSemaphoreGive(txStatsMutex);
+  }
+  Serial.printf("📡 IR command sent: %d frames, %lu ms after queueing\n", policy.frames,
+                (unsigned long)((uint32_t)millis() - request.queuedMs));
+  return true;
+}
+
+void irTransmitTask(void* param) {
+  Serial.println("IR Transmit Task started on Core " + String(xPortGetCoreID()));
+  for (;;) {
+    serviceIrTransmitQueue(portMAX_DELAY);
+  }
+}
+
+bool getCurrentACState(ACState& state, IrTxSource* source) {
+  if (acStateMutex == NULL || xSemaphoreTake(acStateMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    return false;
+  }
+  state = acState.current();
+  if (source != NULL) *source = (IrTxSource)acState.getLastSource();
+  xSemaphoreGive(acStateMutex);
+  return true;
+}
+
+int getACStateHistory(ACStateChange* out, int maxCount) {
+  int count = 0;
+  if (acStateMutex != NULL && xSemaphoreTake(acStateMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    count = acState.getHistory(out, maxCount);
+    xSemaphoreGive(acStateMutex);
+  }
+  return count;
+}
+
+IrTxStats getIrTxStats() {
+  IrTxStats stats = {};
+  if (lockTxStats()) {
+    stats = txStats;
+    xSemaphoreGive(txStatsMutex);
+  }
+  if (frameCacheMutex != NULL && xSemaphoreTake(frameCacheMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    stats.frameCache = frameCache.getStats();
+    stats.frameCacheEntries = frameCache.size();
+    stats.frameCacheBytes = frameCache.getMemoryUsage();
+    xSemaphoreGive(frameCacheMutex);
+  }
+  return stats;
+}
@@ -5,10 +5,13 @@
 
 // Include all module headers
 #include "config.h"
+#include "config_store.h"
+#include "rule_persist.h"
 #include "web_server.h"
 #include "display.h"
 #include "sensor.h"
 #include "ir_control.h"
+#include "ir_transmitter.h"
 #include "ac_control.h"
 #include "power_management.h"
 #include "task_manager.h"
@@ -29,7 +32,10 @@ void setup() {
   
   Serial.println("=== ESP32-S3 AC Controller Starting ===");
   
-  // Initialize power management first for optimal efficiency
+  // Saved settings (Wi-Fi, NTP, timings) before anything reads them
+  initConfigStore();
+  
+  // Initialize power management early for optimal efficiency
   initPowerManagement();
   
   // Initialize SPIFFS file system first
@@ -49,9 +55,11 @@ void setup() {
   
   initSensors();
   initIR();
+  initIrTransmitter();
   
   // Initialize rules mutex for thread safety
   initRulesMutex();
+  initRulePersistence();
   
   // Initialize rule system with persistence (after SPIFFS is mounted)
   loadRulesFromSPIFFS();
@@ -64,12 +72,21 @@ void setup() {
   // Core 0: Critical AC control task (high priority) - Gree AC is always ready!
   // Core 1: Display task (low priority)
   
+  // Sensor sampling feeds the event-driven control loop (threshold crossings)
+  xTaskCreatePinnedToCore(sensorTask, "Sensor Task", 4096, NULL, 2, NULL, 0);
+  
+  // IR frames are sent from their own task so rule changes and web actions never block
+  xTaskCreatePinnedToCore(irTransmitTask, "IR Transmit Task", 4096, NULL, 3, NULL, 0);
+  
   // Gree AC is always ready - no learning required!
   taskManager.startControlTask();
   Serial.println("✅ AC Control Task created - Gree AC ready");
   
   xTaskCreatePinnedToCore(displayTask, "Display Task", 4096, NULL, 1, NULL, 1);
   
+  // Rule edits are written to flash here, once a burst of edits has settled
+  xTaskCreatePinnedToCore(rulePersistTask, "Rule Persist Task", 4096, NULL, 1, NULL, 1);
+  
   Serial.println("=== ESP32-S3 AC Controller Started Successfully! ===");
   Serial.printf("Web interface available at: http://%s\n", WiFi.localIP().toString().c_str());
   Serial.println("🎉 Gree AC control ready - No IR learning required!");
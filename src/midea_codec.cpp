@@ -0,0 +1,113 @@
+#include "midea_codec.h"
+#include "ir_timing.h"
+
+// Bytes 3 and 4 as IRMideaAC::stateReset() leaves them: no off timer, beep
+// disabled, room sensor disabled
+#define MIDEA_BYTE3_NO_TIMER 0xFF
+#define MIDEA_BYTE4_NO_SENSOR 0xFF
+#define MIDEA_FAHRENHEIT 0x20
+
+static const IrBitTimings mideaBits = {MIDEA_BIT_MARK, MIDEA_ONE_SPACE, MIDEA_ZERO_SPACE};
+
+static uint8_t mideaMode(uint8_t mode) {
+  switch (mode) {
+    case AC_MODE_COOL: return MIDEA_MODE_COOL;
+    case AC_MODE_HEAT: return MIDEA_MODE_HEAT;
+    case AC_MODE_DRY: return MIDEA_MODE_DRY;
+    case AC_MODE_FAN: return MIDEA_MODE_FAN;
+    case AC_MODE_AUTO: return MIDEA_MODE_AUTO;
+    default: return MIDEA_MODE_COOL;
+  }
+}
+
+static uint8_t reverseBits(uint8_t value) {
+  uint8_t reversed = 0;
+  for (int i = 0; i < 8; i++, value >>= 1) reversed = (reversed << 1) | (value & 1);
+  return reversed;
+}
+
+// IRMideaAC::calcChecksum(): two's complement of the bit-reversed bytes 0-4,
+// itself bit-reversed
+uint8_t mideaChecksum(const uint8_t state[MIDEA_STATE_LENGTH]) {
+  uint8_t sum = 0;
+  for (int i = 0; i < MIDEA_STATE_LENGTH - 1; i++) sum += reverseBits(state[i]);
+  return reverseBits((uint8_t)(256 - sum));
+}
+
+void mideaEncodeState(const ACState& state, uint8_t out[MIDEA_STATE_LENGTH]) {
+  uint8_t fan = state.fanSpeed() > AC_FAN_HIGH ? MIDEA_FAN_AUTO : state.fanSpeed();
+  uint8_t temp = state.temperature();
+  if (temp < MIDEA_MIN_TEMP) temp = MIDEA_MIN_TEMP;
+  if (temp > MIDEA_MAX_TEMP) temp = MIDEA_MAX_TEMP;
+
+  out[0] = MIDEA_HEADER_COMMAND;
+  out[1] = (state.power() ? 0x80 : 0) | (fan << 3) | mideaMode(state.mode());
+  out[2] = temp - MIDEA_MIN_TEMP;
+  out[3] = MIDEA_BYTE3_NO_TIMER;
+  out[4] = MIDEA_BYTE4_NO_SENSOR;
+  out[5] = mideaChecksum(out);
+}
+
+static uint16_t* encodeCopy(uint16_t* p, const uint8_t state[MIDEA_STATE_LENGTH], uint8_t invert) {
+  *p++ = MIDEA_HDR_MARK;
+  *p++ = MIDEA_HDR_SPACE;
+  for (int i = 0; i < MIDEA_STATE_LENGTH; i++) p = irEncodeBits(p, state[i] ^ invert, 8, mideaBits, true);
+  *p++ = MIDEA_BIT_MARK;
+  *p++ = MIDEA_MIN_GAP;
+  return p;
+}
+
+uint16_t mideaEncodeTimings(const uint8_t state[MIDEA_STATE_LENGTH], uint16_t out[MIDEA_FRAME_TIMINGS]) {
+  uint16_t* p = encodeCopy(out, state, 0x00);
+  p = encodeCopy(p, state, 0xFF);
+  return (uint16_t)(p - out);
+}
+
+// One header + 48 bits + footer mark; advances `p` past the footer mark
+static bool decodeCopy(const uint16_t*& p, uint8_t out[MIDEA_STATE_LENGTH]) {
+  if (!irMatchMark(p[0], MIDEA_HDR_MARK) || !irMatchSpace(p[1], MIDEA_HDR_SPACE)) return false;
+  p += 2;
+  uint32_t value;
+  for (int i = 0; i < MIDEA_STATE_LENGTH; i++) {
+    if (!irDecodeBits(p, 8, mideaBits, value, true)) return false;
+    out[i] = (uint8_t)value;
+  }
+  if (!irMatchMark(p[0], MIDEA_BIT_MARK)) return false;
+  p++;
+  return true;
+}
+
+bool mideaDecodeTimings(const uint16_t* timings, uint16_t count, uint8_t out[MIDEA_STATE_LENGTH]) {
+  if (count != MIDEA_FRAME_TIMINGS && count != MIDEA_FRAME_TIMINGS - 1) return false;
+  const uint16_t* p = timings;
+  uint8_t inverted[MIDEA_STATE_LENGTH];
+  if (!decodeCopy(p, out) || !irMatchGap(*p++, MIDEA_MIN_GAP)) return false;
+  if (!decodeCopy(p, inverted)) return false;
+  if (count == MIDEA_FRAME_TIMINGS && !irMatchGap(*p, MIDEA_MIN_GAP)) return false;
+  for (int i = 0; i < MIDEA_STATE_LENGTH; i++) {
+    if ((uint8_t)~inverted[i] != out[i]) return false;
+  }
+  return mideaChecksum(out) == out[MIDEA_STATE_LENGTH - 1];
+}
+
+void mideaDecodeState(const uint8_t state[MIDEA_STATE_LENGTH], ACState& out) {
+  out = AC_STATE_OFF;
+  out.setPower((state[1] & 0x80) != 0);
+  out.setFanSpeed((state[1] >> 3) & 0x03);
+  switch (state[1] & 0x07) {
+    case MIDEA_MODE_DRY: out.setMode(AC_MODE_DRY); break;
+    case MIDEA_MODE_AUTO: out.setMode(AC_MODE_AUTO); break;
+    case MIDEA_MODE_HEAT: out.setMode(AC_MODE_HEAT); break;
+    case MIDEA_MODE_FAN: out.setMode(AC_MODE_FAN); break;
+    default: out.setMode(AC_MODE_COOL); break;
+  }
+
+  uint8_t temp = state[2] & 0x1F;
+  if (state[2] & MIDEA_FAHRENHEIT) {
+    out.setTemperature((uint8_t)(((temp + MIDEA_MIN_TEMP_F - 32) * 5 + 4) / 9));   // Rounded
+  } else {
+    out.setTemperature(temp + MIDEA_MIN_TEMP);
+  }
+  out.setVSwing(AC_SWING_V_AUTO);
+  out.setHSwing(AC_SWING_H_AUTO);
+}
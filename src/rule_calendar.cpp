@@ -0,0 +1,91 @@
+#include "rule_calendar.h"
+#include <algorithm>
+#include <unordered_map>
+
+RuleCalendar::RuleCalendar() : tables(1) {
+}
+
+void RuleCalendar::clear() {
+  tables.resize(1);
+  tables[0].clear();
+  spanStart.clear();
+  spanTable.clear();
+}
+
+void RuleCalendar::compile(const ACRule rules[], int count, const RuleDateException exceptions[], int exceptionCount) {
+  clear();
+  tables[0].compile(rules, count);
+
+  // Keep exceptions that can change a decision, with their rule's index
+  std::unordered_map<uint16_t, int> indexById;
+  for (int i = 0; i < count; i++) {
+    if (ruleEnabled(rules[i])) indexById[rules[i].id] = i;
+  }
+  std::vector<std::pair<const RuleDateException*, int>> active;
+  std::vector<int32_t> edges;
+  for (int e = 0; e < exceptionCount; e++) {
+    auto it = indexById.find(exceptions[e].ruleId);
+    if (it == indexById.end() || exceptions[e].lastDay < exceptions[e].firstDay) continue;
+    active.push_back(std::make_pair(&exceptions[e], it->second));
+    edges.push_back(exceptions[e].firstDay);
+    edges.push_back((int32_t)exceptions[e].lastDay + 1);
+    if (ruleOvernight(rules[it->second])) {
+      // The tail of the last excepted night runs into the next morning
+      edges.push_back((int32_t)exceptions[e].firstDay + 1);
+      edges.push_back((int32_t)exceptions[e].lastDay + 2);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+  // One table per distinct excluded set; the empty set is table 0
+  std::vector<std::vector<uint8_t>> tableMasks(1, std::vector<uint8_t>(count, 0));
+  std::vector<uint8_t> mask(count);
+  for (int32_t day : edges) {
+    std::fill(mask.begin(), mask.end(), 0);
+    for (const auto& entry : active) {
+      // Windows are excepted by the day they start on, and only overnight
+      // ones have a tail in the next day
+      int32_t first = entry.first->firstDay;
+      int32_t last = entry.first->lastDay;
+      bool overnight = ruleOvernight(rules[entry.second]);
+      if (day >= first && day <= last) {
+        mask[entry.second] |= overnight ? RULE_EXCLUDED_TODAY : RULE_EXCLUDED_ALL;
+      }
+      if (overnight && day > first && day <= last + 1) mask[entry.second] |= RULE_EXCLUDED_YESTERDAY;
+    }
+
+    size_t table = std::find(tableMasks.begin(), tableMasks.end(), mask) - tableMasks.begin();
+    if (table == tableMasks.size()) {
+      tableMasks.push_back(mask);
+      tables.push_back(RuleDecisionTable());
+      tables.back().compile(rules, count, mask.data());
+    }
+    if (spanTable.empty() ? table == 0 : spanTable.back() == table) continue;
+    spanStart.push_back(day);
+    spanTable.push_back((uint16_t)table);
+  }
+}
+
+// Span containing this day, or -1 before the first span (table 0)
+int RuleCalendar::findSpan(int32_t day) const {
+  return (int)(std::upper_bound(spanStart.begin(), spanStart.end(), day) - spanStart.begin()) - 1;
+}
+
+const RuleDecisionTable& RuleCalendar::tableFor(int32_t day) const {
+  int span = findSpan(day);
+  return tables[span < 0 ? 0 : spanTable[span]];
+}
+
+int RuleCalendar::daysUntilChange(int32_t day) const {
+  size_t next = (size_t)(findSpan(day) + 1);
+  return next < spanStart.size() ? (int)(spanStart[next] - day) : 0;
+}
+
+size_t RuleCalendar::getMemoryUsage() const {
+  size_t total = spanStart.capacity() * sizeof(int32_t) + spanTable.capacity() * sizeof(uint16_t);
+  for (const RuleDecisionTable& table : tables) {
+    total += table.getMemoryUsage();
+  }
+  return total;
+}
@@ -0,0 +1,293 @@
+#include "rule_engine.h"
+#include <algorithm>
+
+#include <unordered_map>
+
+#define HOURS_PER_WEEK (7 * 24)
+
+// Check time conditions. A window belongs to the weekday it starts on, so an
+// overnight window started on Friday still applies early Saturday. Without a
+// complete window the rule applies all day on its weekdays.
+bool ruleActiveAt(const ACRule& rule, int minuteOfWeek) {
+  int day = minuteOfWeek / MINUTES_PER_DAY;
+  int minute = minuteOfWeek % MINUTES_PER_DAY;
+  uint8_t days = ruleWeekdays(rule);
+  if ((rule.present & RULE_HAS_WINDOW) != RULE_HAS_WINDOW) {
+    return (days & (1 << day)) != 0;
+  }
+  if (rule.endMinute > rule.startMinute) {
+    // Normal time range (e.g., 08:00-19:00)
+    return (days & (1 << day)) && minute >= rule.startMinute && minute < rule.endMinute;
+  }
+  // Overnight time range (e.g., 19:00-08:00); equal ends cover 24 hours
+  if (minute >= rule.startMinute) {
+    return (days & (1 << day)) != 0;
+  }
+  return minute < rule.endMinute && (days & (1 << ((day + 6) % 7)));
+}
+
+bool ruleOvernight(const ACRule& rule) {
+  return (rule.present & RULE_HAS_WINDOW) == RULE_HAS_WINDOW && rule.endMinute <= rule.startMinute;
+}
+
+// Which RULE_EXCLUDED_* bit excludes the rule at a minute it is active:
+// before its start an overnight window is the previous day's
+static uint8_t ruleExclusionAt(const ACRule& rule, int minuteOfWeek) {
+  if (ruleOvernight(rule) && minuteOfWeek % MINUTES_PER_DAY < rule.startMinute) {
+    return RULE_EXCLUDED_YESTERDAY;
+  }
+  return RULE_EXCLUDED_TODAY;
+}
+
+// Check temperature conditions (bounds are inclusive)
+bool ruleMatchesTemp(const ACRule& rule, int16_t tempCenti) {
+  if ((rule.present & RULE_HAS_MIN_TEMP) && tempCenti < rule.minTemp) {
+    return false;
+  }
+  if ((rule.present & RULE_HAS_MAX_TEMP) && tempCenti > rule.maxTemp) {
+    return false;
+  }
+  return true;
+}
+
+int findMatchingRuleLinear(const ACRule rules[], int count, int minuteOfWeek, int16_t tempCenti) {
+  for (int i = 0; i < count; i++) {
+    if (!ruleEnabled(rules[i])) continue;
+    if (ruleActiveAt(rules[i], minuteOfWeek) && ruleMatchesTemp(rules[i], tempCenti)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+RuleDecisionTable::RuleDecisionTable() : bucketCount(0), compiled(false) {
+  clear();
+}
+
+void RuleDecisionTable::clear() {
+  slotStart.clear();
+  slotRow.clear();
+  for (int hour = 0; hour < HOURS_PER_WEEK; hour++) {
+    hourSlot[hour] = 0;
+  }
+  rowBegin.clear();
+  rowEnd.clear();
+  segmentStart.clear();
+  segmentRule.clear();
+  bucketCount = 0;
+  compiled = false;
+}
+
+// Add the minutes of the week at which this rule starts or stops applying
+static void addTimeBoundaries(const ACRule& rule, std::vector<uint16_t>& boundaries) {
+  uint8_t days = ruleWeekdays(rule);
+  bool window = (rule.present & RULE_HAS_WINDOW) == RULE_HAS_WINDOW;
+  if (!window && days == RULE_ALL_WEEKDAYS) {
+    return;
+  }
+  for (int day = 0; day < 7; day++) {
+    if (!(days & (1 << day))) continue;
+    int start = day * MINUTES_PER_DAY;
+    int end = start + MINUTES_PER_DAY;
+    if (window) {
+      end = start + rule.endMinute + (rule.endMinute > rule.startMinute ? 0 : MINUTES_PER_DAY);
+      start += rule.startMinute;
+    }
+    boundaries.push_back((uint16_t)(start % MINUTES_PER_WEEK));
+    boundaries.push_back((uint16_t)(end % MINUTES_PER_WEEK));
+  }
+}
+
+static uint32_t hashRow(const int32_t* starts, const int16_t* winners, uint32_t length) {
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint32_t)starts[i]) * 16777619u;
+    hash = (hash ^ (uint16_t)winners[i]) * 16777619u;
+  }
+  return hash;
+}
+
+void RuleDecisionTable::compile(const ACRule rules[], int count, const uint8_t* excluded) {
+  clear();
+
+  // Collect every bucket boundary and time boundary used by an included rule
+  std::vector<int32_t> thresholds;
+  std::vector<uint16_t> boundaries(1, 0);
+  for (int i = 0; i < count; i++) {
+    if (!ruleEnabled(rules[i]) || (excluded && excluded[i] == RULE_EXCLUDED_ALL)) continue;
+    if (excluded && excluded[i]) {
+      // Half an overnight window: it stops or starts applying at midnight
+      for (int day = 1; day < 7; day++) {
+        boundaries.push_back((uint16_t)(day * MINUTES_PER_DAY));
+      }
+    }
+    if (rules[i].present & RULE_HAS_MIN_TEMP) {
+      thresholds.push_back(rules[i].minTemp);
+    }
+    if (rules[i].present & RULE_HAS_MAX_TEMP) {
+      thresholds.push_back((int32_t)rules[i].maxTemp + 1);
+    }
+    addTimeBoundaries(rules[i], boundaries);
+  }
+  std::sort(thresholds.begin(), thresholds.end());
+  thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+  std::sort(boundaries.begin(), boundaries.end());
+  boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+  auto findThreshold = [&thresholds](int32_t value) {
+    return (int)(std::lower_bound(thresholds.begin(), thresholds.end(), value) - thresholds.begin());
+  };
+
+  // Bucket b covers [thresholds[b - 1], thresholds[b])
+  bucketCount = (int)thresholds.size() + 1;
+  std::vector<int16_t> row(bucketCount);
+
+  // nextFree[b] points at the first bucket >= b not yet claimed by a
+  // higher-priority rule, so each cell is written exactly once per slot.
+  std::vector<int> nextFree(bucketCount + 1);
+  auto findFree = [&nextFree](int b) {
+    int root = b;
+    while (nextFree[root] != root) root = nextFree[root];
+    while (nextFree[b] != root) {
+      int next = nextFree[b];
+      nextFree[b] = root;
+      b = next;
+    }
+    return root;
+  };
+
+  std::unordered_multimap<uint32_t, uint32_t> rowsByHash; // Row hash -> row index
+  for (uint16_t minute : boundaries) {
+    for (int b = 0; b <= bucketCount; b++) {
+      nextFree[b] = b;
+    }
+    std::fill(row.begin(), row.end(), -1);
+
+    int unclaimed = bucketCount;
+    for (int i = 0; i < count && unclaimed > 0; i++) {
+      if (!ruleEnabled(rules[i]) || !ruleActiveAt(rules[i], minute)) continue;
+      if (excluded && (excluded[i] & ruleExclusionAt(rules[i], minute))) continue;
+
+      int lo = 0;
+      int hi = bucketCount - 1;
+      if (rules[i].present & RULE_HAS_MIN_TEMP) {
+        lo = findThreshold(rules[i].minTemp) + 1;
+      }
+      if (rules[i].present & RULE_HAS_MAX_TEMP) {
+        hi = findThreshold((int32_t)rules[i].maxTemp + 1);
+      }
+
+      for (int b = findFree(lo); b <= hi; b = findFree(b + 1)) {
+        row[b] = (int16_t)i;
+        nextFree[b] = b + 1;
+        unclaimed--;
+      }
+    }
+
+    // Merge runs of buckets with the same winner into segments
+    uint32_t begin = (uint32_t)segmentStart.size();
+    for (int b = 0; b < bucketCount; b++) {
+      if (b > 0 && row[b] == row[b - 1]) continue;
+      segmentStart.push_back(b == 0 ? INT32_MIN : thresholds[b - 1]);
+      segmentRule.push_back(row[b]);
+    }
+    uint32_t length = (uint32_t)segmentStart.size() - begin;
+
+    // Share storage with an earlier slot that compiled to the same segments
+    uint32_t hash = hashRow(&segmentStart[begin], &segmentRule[begin], length);
+    uint32_t rowIndex = (uint32_t)rowBegin.size();
+    auto range = rowsByHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      uint32_t prev = it->second;
+      if (rowEnd[prev] - rowBegin[prev] == length &&
+          std::equal(segmentRule.begin() + begin, segmentRule.end(), segmentRule.begin() + rowBegin[prev]) &&
+          std::equal(segmentStart.begin() + begin, segmentStart.end(), segmentStart.begin() + rowBegin[prev])) {
+        rowIndex = prev;
+        break;
+      }
+    }
+    if (rowIndex == rowBegin.size()) {
+      rowBegin.push_back(begin);
+      rowEnd.push_back(begin + length);
+      rowsByHash.emplace(hash, rowIndex);
+    } else {
+      segmentStart.resize(begin);
+      segmentRule.resize(begin);
+    }
+
+    // Consecutive slots deciding the same way become one slot
+    if (!slotRow.empty() && slotRow.back() == rowIndex) continue;
+    slotStart.push_back(minute);
+    slotRow.push_back((uint16_t)rowIndex);
+  }
+
+  int slot = 0;
+  for (int hour = 0; hour < HOURS_PER_WEEK; hour++) {
+    while ((size_t)(slot + 1) < slotStart.size() && slotStart[slot + 1] <= hour * 60) slot++;
+    hourSlot[hour] = (uint16_t)slot;
+  }
+
+  compiled = true;
+}
+
+// Slot containing this minute: jump to its hour, then scan the few
+// boundaries inside that hour
+int RuleDecisionTable::findSlot(int minuteOfWeek) const {
+  int slot = hourSlot[minuteOfWeek / 60];
+  while ((size_t)(slot + 1) < slotStart.size() && slotStart[slot + 1] <= minuteOfWeek) slot++;
+  return slot;
+}
+
+// Index of the segment of this row containing tempCenti
+int RuleDecisionTable::findSegment(int row, int16_t tempCenti) const {
+  // The first segment of every row starts at INT32_MIN, so it always precedes the match
+  std::vector<int32_t>::const_iterator first = segmentStart.begin() + rowBegin[row];
+  std::vector<int32_t>::const_iterator last = segmentStart.begin() + rowEnd[row];
+  std::vector<int32_t>::const_iterator next = std::upper_bound(first, last, (int32_t)tempCenti);
+  return (int)(next - segmentStart.begin()) - 1;
+}
+
+int RuleDecisionTable::lookup(int minuteOfWeek, int16_t tempCenti) const {
+  if (!compiled || minuteOfWeek < 0 || minuteOfWeek >= MINUTES_PER_WEEK) {
+    return -1;
+  }
+  return segmentRule[findSegment(slotRow[findSlot(minuteOfWeek)], tempCenti)];
+}
+
+int RuleDecisionTable::minutesUntilChange(int minuteOfWeek) const {
+  if (!compiled || minuteOfWeek < 0 || minuteOfWeek >= MINUTES_PER_WEEK || slotStart.size() < 2) {
+    return 0;
+  }
+  // Adjacent slots always differ, except the last and the first across the
+  // end of the week, which may be one run split in two
+  size_t slot = (size_t)findSlot(minuteOfWeek);
+  size_t last = slotStart.size() - 1;
+  int next;
+  if (slot < last) {
+    next = slotStart[slot + 1];
+  } else if (slotRow[last] != slotRow[0]) {
+    next = MINUTES_PER_WEEK;
+  } else {
+    next = MINUTES_PER_WEEK + slotStart[1];
+  }
+  return next - minuteOfWeek;
+}
+
+void RuleDecisionTable::getTempBand(int minuteOfWeek, int16_t tempCenti, int32_t& low, int32_t& high) const {
+  low = INT32_MIN;
+  high = INT32_MAX;
+  if (!compiled || minuteOfWeek < 0 || minuteOfWeek >= MINUTES_PER_WEEK) {
+    return;
+  }
+  int row = slotRow[findSlot(minuteOfWeek)];
+  int s = findSegment(row, tempCenti);
+  low = segmentStart[s];
+  if ((uint32_t)(s + 1) < rowEnd[row]) {
+    high = segmentStart[s + 1];
+  }
+}
+
+size_t RuleDecisionTable::getMemoryUsage() const {
+  return (slotStart.capacity() + slotRow.capacity()) * sizeof(uint16_t) + sizeof(hourSlot) +
+         (rowBegin.capacity() + rowEnd.capacity()) * sizeof(uint32_t) +
+         segmentStart.capacity() * sizeof(int32_t) + segmentRule.capacity() * sizeof(int16_t);
+}
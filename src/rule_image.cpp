@@ -0,0 +1,187 @@
+#include "rule_image.h"
+#include "rule_journal.h"
+#include <string.h>
+
+static void put16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+  put16(p, (uint16_t)value);
+  put16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+void ruleFieldsEncode(const ACRule& rule, uint8_t out[RULE_FIELDS_SIZE]) {
+  put16(out, rule.id);
+  put16(out + 2, rule.priority);
+  out[4] = rule.flags;
+  out[5] = rule.present;
+  put16(out + 6, rule.startMinute);
+  put16(out + 8, rule.endMinute);
+  out[10] = rule.weekdays;
+  put16(out + 11, (uint16_t)rule.minTemp);
+  put16(out + 13, (uint16_t)rule.maxTemp);
+  put16(out + 15, (uint16_t)rule.setTemp);
+  out[17] = (uint8_t)rule.mode;
+  out[18] = (uint8_t)rule.fanSpeed;
+  out[19] = (uint8_t)rule.vSwing;
+  out[20] = (uint8_t)rule.hSwing;
+  out[21] = 0;   // Reserved
+}
+
+bool ruleFieldsDecode(const uint8_t in[RULE_FIELDS_SIZE], ACRule& rule) {
+  rule = ACRule();
+  rule.id = get16(in);
+  rule.priority = get16(in + 2);
+  rule.flags = in[4];
+  rule.present = in[5];
+  rule.startMinute = get16(in + 6);
+  rule.endMinute = get16(in + 8);
+  rule.weekdays = in[10];
+  rule.minTemp = (int16_t)get16(in + 11);
+  rule.maxTemp = (int16_t)get16(in + 13);
+  rule.setTemp = (int16_t)get16(in + 15);
+  rule.mode = acModeFromInt(in[17]);
+  rule.fanSpeed = acFanSpeedFromInt(in[18]);
+  rule.vSwing = acSwingVFromInt(in[19]);
+  rule.hSwing = acSwingHFromInt(in[20]);
+  return rule.id != 0 && rule.startMinute < MINUTES_PER_DAY && rule.endMinute < MINUTES_PER_DAY;
+}
+
+void ruleImageEncode(const RuleSnapshot& snapshot, std::vector<uint8_t>& out) {
+  // Names in pool order, so a rule's nameId is its name index in the image
+  std::vector<uint32_t> nameOffsets(snapshot.names.size());
+  std::vector<char> text;
+  for (size_t id = 0; id < nameOffsets.size(); id++) {
+    const char* name = snapshot.names.get((uint16_t)id);
+    nameOffsets[id] = (uint32_t)text.size();
+    text.insert(text.end(), name, name + strlen(name) + 1);
+  }
+
+  size_t ruleCount = snapshot.rules.size();
+  size_t exceptionCount = snapshot.exceptions.size();
+  size_t size = RULE_IMAGE_HEADER_SIZE + ruleCount * RULE_IMAGE_RECORD_SIZE +
+                exceptionCount * RULE_IMAGE_EXCEPTION_SIZE + nameOffsets.size() * 4 + text.size();
+  size_t start = out.size();
+  out.resize(start + size);
+  uint8_t* header = out.data() + start;
+  put32(header, RULE_IMAGE_MAGIC);
+  put16(header + 4, RULE_IMAGE_VERSION);
+  put16(header + 6, RULE_IMAGE_HEADER_SIZE);
+  put16(header + 8, (uint16_t)ruleCount);
+  put16(header + 10, RULE_IMAGE_RECORD_SIZE);
+  put16(header + 12, (uint16_t)exceptionCount);
+  put16(header + 14, RULE_IMAGE_EXCEPTION_SIZE);
+  put16(header + 16, (uint16_t)nameOffsets.size());
+  put16(header + 18, 0);
+  put32(header + 20, (uint32_t)text.size());
+  put32(header + 24, (uint32_t)size);
+
+  uint8_t* p = header + RULE_IMAGE_HEADER_SIZE;
+  for (const ACRule& rule : snapshot.rules) {
+    ruleFieldsEncode(rule, p);
+    put16(p + RULE_FIELDS_SIZE, rule.nameId);
+    p += RULE_IMAGE_RECORD_SIZE;
+  }
+  for (const RuleDateException& exception : snapshot.exceptions) {
+    put16(p, exception.ruleId);
+    put16(p + 2, exception.firstDay);
+    put16(p + 4, exception.lastDay);
+    p += RULE_IMAGE_EXCEPTION_SIZE;
+  }
+  for (uint32_t offset : nameOffsets) {
+    put32(p, offset);
+    p += 4;
+  }
+  if (!text.empty()) memcpy(p, text.data(), text.size());
+
+  uint32_t crc = journalCrc32(0, header, 28);
+  put32(header + 28, journalCrc32(crc, header + RULE_IMAGE_HEADER_SIZE, size - RULE_IMAGE_HEADER_SIZE));
+}
+
+bool ruleImageOpen(const uint8_t* data, size_t size, RuleImage& image) {
+  if (data == nullptr || size < RULE_IMAGE_HEADER_SIZE) return false;
+  if (get32(data) != RULE_IMAGE_MAGIC || get16(data + 4) != RULE_IMAGE_VERSION) return false;
+  uint32_t headerSize = get16(data + 6);
+  image.ruleCount = get16(data + 8);
+  image.recordSize = get16(data + 10);
+  image.exceptionCount = get16(data + 12);
+  image.exceptionSize = get16(data + 14);
+  image.nameCount = get16(data + 16);
+  image.textBytes = get32(data + 20);
+  image.size = get32(data + 24);
+  if (headerSize < RULE_IMAGE_HEADER_SIZE || image.recordSize < RULE_IMAGE_RECORD_SIZE ||
+      image.exceptionSize < RULE_IMAGE_EXCEPTION_SIZE || image.size > size) {
+    return false;
+  }
+
+  // 64-bit sums: a corrupt header must not wrap around to a plausible size
+  uint64_t records = headerSize;
+  uint64_t exceptions = records + (uint64_t)image.ruleCount * image.recordSize;
+  uint64_t names = exceptions + (uint64_t)image.exceptionCount * image.exceptionSize;
+  uint64_t text = names + (uint64_t)image.nameCount * 4;
+  if (text + image.textBytes != image.size) return false;
+
+  uint32_t crc = journalCrc32(0, data, 28);
+  if (journalCrc32(crc, data + headerSize, image.size - headerSize) != get32(data + 28)) return false;
+
+  image.records = data + records;
+  image.exceptions = data + exceptions;
+  image.nameOffsets = data + names;
+  image.text = (const char*)data + text;
+  // Every name must end inside the text
+  if (image.nameCount > 0 && (image.textBytes == 0 || image.text[image.textBytes - 1] != '\0')) return false;
+  for (int i = 0; i < image.nameCount; i++) {
+    if (get32(image.nameOffsets + i * 4) >= image.textBytes) return false;
+  }
+  return true;
+}
+
+bool ruleImageRule(const RuleImage& image, int index, ACRule& rule, const char*& name) {
+  const uint8_t* record = image.records + (size_t)index * image.recordSize;
+  uint16_t nameIndex = get16(record + RULE_FIELDS_SIZE);
+  if (!ruleFieldsDecode(record, rule) || nameIndex >= image.nameCount) return false;
+  name = image.text + get32(image.nameOffsets + nameIndex * 4);
+  return true;
+}
+
+RuleDateException ruleImageException(const RuleImage& image, int index) {
+  const uint8_t* p = image.exceptions + (size_t)index * image.exceptionSize;
+  return {get16(p), get16(p + 2), get16(p + 4)};
+}
+
+bool ruleImageLoad(const RuleImage& image, RuleSet& rules, RuleNamePool& names) {
+  rules.clear();
+  rules.reserve(image.ruleCount);
+  names.clear();
+  for (int i = 0; i < image.ruleCount; i++) {
+    ACRule rule;
+    const char* name;
+    if (!ruleImageRule(image, i, rule, name)) return false;
+    rule.nameId = names.intern(name);
+    if (rules.insert(rule) == nullptr) return false;
+  }
+
+  // Sorted by rule ID, so each rule's exceptions are one run
+  std::vector<RuleDateException> run;
+  for (int i = 0; i < image.exceptionCount; i++) {
+    RuleDateException exception = ruleImageException(image, i);
+    if (!run.empty() && run[0].ruleId != exception.ruleId) {
+      rules.setExceptions(run[0].ruleId, run.data(), (int)run.size());
+      run.clear();
+    }
+    if (rules.find(exception.ruleId) == nullptr) return false;
+    run.push_back(exception);
+  }
+  if (!run.empty()) rules.setExceptions(run[0].ruleId, run.data(), (int)run.size());
+  return true;
+}
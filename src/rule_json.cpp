@@ -0,0 +1,431 @@
+#include "rule_json.h"
+#include "ac_backend.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+void ruleToJson(const ACRule& rule, const RuleSnapshot& snapshot, JsonObject out) {
+  out["id"] = rule.id;
+  out["name"] = snapshot.names.get(rule.nameId);
+  out["priority"] = rule.priority;
+  out["enabled"] = ruleEnabled(rule);
+  out["startMinute"] = ruleStartMinute(rule);
+  out["endMinute"] = ruleEndMinute(rule);
+  out["weekdays"] = ruleWeekdays(rule);
+  out["minTemp"] = ruleMinTemp(rule);
+  out["maxTemp"] = ruleMaxTemp(rule);
+  out["acOn"] = ruleAcOn(rule);
+  out["setTemp"] = centiToTemp(rule.setTemp);
+  out["fanSpeed"] = (int)rule.fanSpeed;
+  out["mode"] = (int)rule.mode;
+  out["vSwing"] = (int)rule.vSwing;
+  out["hSwing"] = (int)rule.hSwing;
+
+  JsonArray exceptions = out["exceptions"].to<JsonArray>();
+  RuleDateException key = {rule.id, 0, 0};
+  std::vector<RuleDateException>::const_iterator it =
+      std::lower_bound(snapshot.exceptions.begin(), snapshot.exceptions.end(), key, exceptionLess);
+  for (; it != snapshot.exceptions.end() && it->ruleId == rule.id; ++it) {
+    char from[11], to[11];
+    formatRuleDate(it->firstDay, from, sizeof(from));
+    formatRuleDate(it->lastDay, to, sizeof(to));
+    JsonObject range = exceptions.add<JsonObject>();
+    range["from"] = from;
+    range["to"] = to;
+  }
+}
+
+void ruleFromJson(JsonObjectConst in, ACRule& rule, RuleNamePool& names, int fallbackId, int fallbackPriority) {
+  char fallbackName[16];
+  snprintf(fallbackName, sizeof(fallbackName), "Rule %d", fallbackId);
+
+  rule = ACRule();
+  rule.id = in["id"] | fallbackId;
+  rule.nameId = names.intern(in["name"] | (const char*)fallbackName);
+  rule.priority = rulePriorityFromInt(in["priority"] | fallbackPriority);
+  ruleSetFlag(rule, RULE_FLAG_ENABLED, in["enabled"] | true);
+  ruleSetFlag(rule, RULE_FLAG_AC_ON, in["acOn"] | true);
+  if (in["startMinute"].is<int>() || in["endMinute"].is<int>()) {
+    ruleSetStartMinute(rule, in["startMinute"] | RULE_ANY_MINUTE);
+    ruleSetEndMinute(rule, in["endMinute"] | RULE_ANY_MINUTE);
+  } else {
+    ruleSetStartHour(rule, in["startHour"] | RULE_ANY_HOUR);
+    ruleSetEndHour(rule, in["endHour"] | RULE_ANY_HOUR);
+  }
+  ruleSetWeekdays(rule, in["weekdays"] | RULE_ALL_WEEKDAYS);
+  ruleSetMinTemp(rule, in["minTemp"] | (float)RULE_ANY_TEMP);
+  ruleSetMaxTemp(rule, in["maxTemp"] | (float)RULE_ANY_TEMP);
+  rule.setTemp = tempToCenti(in["setTemp"] | 25.0f);
+  rule.fanSpeed = acFanSpeedFromInt(in["fanSpeed"] | 2);
+  rule.mode = acModeFromInt(in["mode"] | 0);
+  rule.vSwing = acSwingVFromInt(in["vSwing"] | 0);
+  rule.hSwing = acSwingHFromInt(in["hSwing"] | 0);
+}
+
+// Add [first, last] if both dates are in range; ruleId is filled in by RuleSet
+static bool addException(int32_t first, int32_t last, std::vector<RuleDateException>& out) {
+  if (first < 0 || last < first || last > RULE_MAX_DAY) {
+    return false;
+  }
+  out.push_back({0, (uint16_t)first, (uint16_t)last});
+  return true;
+}
+
+bool exceptionsFromJson(JsonArrayConst in, std::vector<RuleDateException>& out) {
+  bool valid = true;
+  for (JsonObjectConst range : in) {
+    int32_t first, last;
+    const char* from = range["from"] | (const char*)"";
+    if (!parseRuleDate(from, first) || !parseRuleDate(range["to"] | from, last) ||
+        !addException(first, last, out)) {
+      valid = false;
+    }
+  }
+  return valid;
+}
+
+static bool batchError(RuleBatchResult& result, int op, const char* format, const char* detail) {
+  result.failedOp = op;
+  snprintf(result.error, sizeof(result.error), format, detail);
+  return false;
+}
+
+// Integer fields and the values they take; ruleFromJson() and the setters
+// would clamp or default anything else
+struct RuleJsonRange {
+  const char* key;
+  int min;
+  int max;
+};
+
+static const RuleJsonRange ruleJsonRanges[] = {
+  {"id", 1, UINT16_MAX},
+  {"priority", 0, UINT16_MAX},
+  {"startMinute", RULE_ANY_MINUTE, MINUTES_PER_DAY - 1},
+  {"endMinute", RULE_ANY_MINUTE, MINUTES_PER_DAY - 1},
+  {"startHour", RULE_ANY_HOUR, 23},
+  {"endHour", RULE_ANY_HOUR, 23},
+  {"weekdays", 1, RULE_ALL_WEEKDAYS},       // 0 would read back as every day
+  {"fanSpeed", AC_FAN_AUTO, AC_FAN_HIGH},
+  {"mode", AC_MODE_COOL, AC_MODE_AUTO},
+  {"vSwing", AC_SWING_V_AUTO, AC_SWING_V_BOTTOM},
+  {"hSwing", AC_SWING_H_AUTO, AC_SWING_H_RIGHT},
+};
+
+static bool fieldError(char* error, size_t size, const char* format, const char* key) {
+  snprintf(error, size, format, key);
+  return false;
+}
+
+bool checkRuleFields(JsonObjectConst in, char* error, size_t size) {
+  static const char* const temps[] = {"minTemp", "maxTemp"};
+  static const char* const flags[] = {"enabled", "acOn"};
+
+  for (const RuleJsonRange& range : ruleJsonRanges) {
+    if (in[range.key].isNull()) continue;
+    if (!in[range.key].is<int>()) return fieldError(error, size, "\"%s\" must be an integer", range.key);
+    int value = in[range.key].as<int>();
+    if (value < range.min || value > range.max) {
+      snprintf(error, size, "\"%s\" must be %d..%d", range.key, range.min, range.max);
+      return false;
+    }
+  }
+  for (const char* key : temps) {
+    if (in[key].isNull()) continue;
+    float temp = in[key] | 0.0f;
+    if (!in[key].is<float>() || (temp != RULE_ANY_TEMP && (temp < -50 || temp > 100))) {
+      return fieldError(error, size, "\"%s\" must be -50..100 or -999", key);
+    }
+  }
+  // Sent to the AC as a whole-degree setpoint, so "any" means nothing here
+  if (!in["setTemp"].isNull()) {
+    float temp = in["setTemp"] | 0.0f;
+    if (!in["setTemp"].is<float>() || temp < ACProtocol::MIN_TEMP || temp > ACProtocol::MAX_TEMP) {
+      snprintf(error, size, "\"setTemp\" must be %d..%d", ACProtocol::MIN_TEMP, ACProtocol::MAX_TEMP);
+      return false;
+    }
+  }
+  for (const char* key : flags) {
+    if (!in[key].isNull() && !in[key].is<bool>()) return fieldError(error, size, "\"%s\" must be true or false", key);
+  }
+  if (!in["name"].isNull() && !in["name"].is<const char*>()) {
+    return fieldError(error, size, "\"%s\" must be a string", "name");
+  }
+  if (!in["exceptions"].isNull() && !in["exceptions"].is<JsonArrayConst>()) {
+    return fieldError(error, size, "\"%s\" must be a list", "exceptions");
+  }
+  return true;
+}
+
+static bool checkRuleJson(JsonObjectConst in, RuleBatchResult& result, int op) {
+  if (checkRuleFields(in, result.error, sizeof(result.error))) return true;
+  result.failedOp = op;
+  return false;
+}
+
+// Replace the rule's exceptions if the JSON has any
+static bool batchExceptions(JsonObjectConst in, RuleSet& rules, uint16_t id, RuleBatchResult& result, int op) {
+  if (in["exceptions"].isNull()) return true;
+  std::vector<RuleDateException> exceptions;
+  if (!exceptionsFromJson(in["exceptions"], exceptions)) {
+    return batchError(result, op, "%s", "Invalid exception dates (use YYYY-MM-DD)");
+  }
+  rules.setExceptions(id, exceptions.data(), (int)exceptions.size());
+  return true;
+}
+
+static bool batchCreate(JsonObjectConst in, RuleSet& rules, RuleNamePool& names, int maxRules,
+                        RuleBatchResult& result, int op) {
+  if (!checkRuleJson(in, result, op)) return false;
+  if (rules.size() >= maxRules) return batchError(result, op, "%s", "Maximum number of rules reached");
+  uint16_t fallbackId = rules.nextId();
+  if (in["id"].isNull() && fallbackId == 0) return batchError(result, op, "%s", "No free rule ID");
+
+  ACRule rule;
+  ruleFromJson(in, rule, names, fallbackId, rules.nextPriority());
+  if (rules.insert(rule) == nullptr) {
+    char id[8];
+    snprintf(id, sizeof(id), "%u", (unsigned)rule.id);
+    return batchError(result, op, "Rule ID %s already exists", id);
+  }
+  result.created++;
+  return batchExceptions(in, rules, rule.id, result, op);
+}
+
+// Only the fields present change, like the form-encoded PUT /api/rules
+static bool batchUpdate(uint16_t id, JsonObjectConst in, RuleSet& rules, RuleNamePool& names,
+                        RuleBatchResult& result, int op) {
+  if (!checkRuleJson(in, result, op)) return false;
+  ACRule* rule = rules.find(id);
+  if (rule == nullptr) return batchError(result, op, "%s", "Rule not found");
+  if (!in["id"].isNull() && in["id"].as<int>() != id) return batchError(result, op, "%s", "Rule ID cannot change");
+
+  if (!in["name"].isNull()) rule->nameId = names.intern(in["name"].as<const char*>());
+  if (!in["enabled"].isNull()) ruleSetFlag(*rule, RULE_FLAG_ENABLED, in["enabled"].as<bool>());
+  if (!in["acOn"].isNull()) ruleSetFlag(*rule, RULE_FLAG_AC_ON, in["acOn"].as<bool>());
+  if (!in["startMinute"].isNull()) {
+    ruleSetStartMinute(*rule, in["startMinute"].as<int>());
+  } else if (!in["startHour"].isNull()) {
+    ruleSetStartHour(*rule, in["startHour"].as<int>());
+  }
+  if (!in["endMinute"].isNull()) {
+    ruleSetEndMinute(*rule, in["endMinute"].as<int>());
+  } else if (!in["endHour"].isNull()) {
+    ruleSetEndHour(*rule, in["endHour"].as<int>());
+  }
+  if (!in["weekdays"].isNull()) ruleSetWeekdays(*rule, in["weekdays"].as<int>());
+  if (!in["minTemp"].isNull()) ruleSetMinTemp(*rule, in["minTemp"].as<float>());
+  if (!in["maxTemp"].isNull()) ruleSetMaxTemp(*rule, in["maxTemp"].as<float>());
+  if (!in["setTemp"].isNull()) rule->setTemp = tempToCenti(in["setTemp"].as<float>());
+  if (!in["fanSpeed"].isNull()) rule->fanSpeed = acFanSpeedFromInt(in["fanSpeed"].as<int>());
+  if (!in["mode"].isNull()) rule->mode = acModeFromInt(in["mode"].as<int>());
+  if (!in["vSwing"].isNull()) rule->vSwing = acSwingVFromInt(in["vSwing"].as<int>());
+  if (!in["hSwing"].isNull()) rule->hSwing = acSwingHFromInt(in["hSwing"].as<int>());
+  if (!in["priority"].isNull()) rules.setPriority(id, rulePriorityFromInt(in["priority"].as<int>()));
+  result.updated++;
+  return batchExceptions(in, rules, id, result, op);
+}
+
+// One element of a "rules" list
+static bool applyRuleEntry(JsonVariantConst rule, RuleSet& rules, RuleNamePool& names, int maxRules,
+                           RuleBatchResult& result, int op) {
+  if (!rule.is<JsonObjectConst>()) return batchError(result, op, "%s", "Rule must be an object");
+  return batchCreate(rule, rules, names, maxRules, result, op);
+}
+
+// One element of an "ops" list
+static bool applyRuleOp(JsonObjectConst entry, RuleSet& rules, RuleNamePool& names, int maxRules,
+                        RuleBatchResult& result, int op) {
+  const char* type = entry["op"] | (const char*)"";
+  int id = entry["id"] | 0;
+  bool needsId = strcmp(type, "update") == 0 || strcmp(type, "delete") == 0;
+  if (needsId && (!entry["id"].is<int>() || id < 1 || id > UINT16_MAX)) {
+    return batchError(result, op, "%s", "\"id\" must be 1..65535");
+  }
+  if (strcmp(type, "delete") == 0) {
+    if (!rules.remove((uint16_t)id)) return batchError(result, op, "%s", "Rule not found");
+    result.deleted++;
+    return true;
+  }
+  if (strcmp(type, "create") == 0 || strcmp(type, "update") == 0) {
+    if (!entry["rule"].is<JsonObjectConst>()) return batchError(result, op, "%s", "\"rule\" object required");
+    JsonObjectConst rule = entry["rule"];
+    return needsId ? batchUpdate((uint16_t)id, rule, rules, names, result, op)
+                   : batchCreate(rule, rules, names, maxRules, result, op);
+  }
+  return batchError(result, op, "Unknown op \"%s\" (create, update or delete)", type);
+}
+
+bool applyRuleBatch(JsonObjectConst batch, RuleSet& rules, RuleNamePool& names, int maxRules,
+                    RuleBatchResult& result) {
+  result = RuleBatchResult();
+  result.failedOp = -1;
+
+  if (batch["rules"].is<JsonArrayConst>()) {
+    rules.clear();
+    names.clear();
+    int op = 0;
+    for (JsonVariantConst rule : batch["rules"].as<JsonArrayConst>()) {
+      if (!applyRuleEntry(rule, rules, names, maxRules, result, op)) return false;
+      op++;
+    }
+    return true;
+  }
+
+  if (!batch["ops"].is<JsonArrayConst>()) {
+    return batchError(result, -1, "%s", "Body needs a \"rules\" or an \"ops\" list");
+  }
+  int op = 0;
+  for (JsonObjectConst entry : batch["ops"].as<JsonArrayConst>()) {
+    if (!applyRuleOp(entry, rules, names, maxRules, result, op)) return false;
+    op++;
+  }
+  return true;
+}
+
+RuleBatchStream::RuleBatchStream(RuleSet& rules, RuleNamePool& names, int maxRules)
+    : rules(rules), names(names), maxRules(maxRules), list(LIST_NONE), depth(0), op(0), started(false),
+      closed(false), failed(false), inString(false), escape(false), inItem(false) {
+  result = RuleBatchResult();
+  result.failedOp = -1;
+}
+
+bool RuleBatchStream::fail(int failedOp, const char* format, const char* detail) {
+  failed = true;
+  return batchError(result, failedOp, format, detail);
+}
+
+// Parse and apply the element collected in `item`
+bool RuleBatchStream::applyItem() {
+  inItem = false;
+  DeserializationError error = deserializeJson(itemDoc, item.data(), item.size());
+  if (error) return fail(op, "Invalid JSON: %s", error.c_str());
+  bool applied = list == LIST_RULES
+                     ? applyRuleEntry(itemDoc.as<JsonVariantConst>(), rules, names, maxRules, result, op)
+                     : applyRuleOp(itemDoc.as<JsonObjectConst>(), rules, names, maxRules, result, op);
+  if (!applied) failed = true;
+  op++;
+  return applied;
+}
+
+// Brackets and strings are tracked only to find where each element of the
+// list starts and ends; ArduinoJson parses the elements themselves
+bool RuleBatchStream::feed(const char* data, size_t length) {
+  for (size_t i = 0; i < length && !failed; i++) {
+    char c = data[i];
+    if (inItem) {
+      if (item.size() >= RULE_BATCH_MAX_ITEM) return fail(op, "%s", "Rule entry too large");
+    }
+    if (inString) {
+      if (inItem) {
+        item.push_back(c);
+      } else if (depth == 1 && !escape && c != '"' && key.size() < 8) {
+        key.push_back(c);   // Longer keys are none of ours
+      }
+      if (escape) {
+        escape = false;
+      } else if (c == '\\') {
+        escape = true;
+      } else if (c == '"') {
+        inString = false;
+      }
+      continue;
+    }
+    if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+      if (inItem) item.push_back(c);
+      continue;
+    }
+    if (closed) return fail(-1, "%s", "Invalid JSON: trailing characters");
+    if (!started) {
+      if (c != '{') return fail(-1, "%s", "Body needs a \"rules\" or an \"ops\" list");
+      started = true;
+      depth = 1;
+      continue;
+    }
+
+    bool inList = list != LIST_NONE && depth == 2;
+    if (inItem && inList && (c == ',' || c == ']')) {
+      if (!applyItem()) return false;   // A number, string or literal ends here
+    } else if (!inItem && inList && c != ',' && c != ']') {
+      inItem = true;
+      item.clear();
+    }
+    if (inItem) item.push_back(c);
+
+    switch (c) {
+      case '"':
+        inString = true;
+        if (!inItem && depth == 1) key.clear();
+        break;
+      case '{':
+      case '[':
+        if (c == '[' && depth == 1 && (key == "rules" || key == "ops")) {
+          if (list != LIST_NONE) return fail(-1, "%s", "Body needs one \"rules\" or \"ops\" list");
+          list = key == "rules" ? LIST_RULES : LIST_OPS;
+          if (list == LIST_RULES) {
+            rules.clear();
+            names.clear();
+          }
+        }
+        depth++;
+        break;
+      case '}':
+      case ']':
+        depth--;
+        if (depth < 0) return fail(-1, "%s", "Invalid JSON: unbalanced brackets");
+        if (inItem && depth == 2 && list != LIST_NONE && !applyItem()) return false;
+        if (depth == 0) closed = true;
+        break;
+    }
+  }
+  return !failed;
+}
+
+bool RuleBatchStream::finish() {
+  if (failed) return false;
+  if (!closed) return fail(-1, "%s", started ? "Invalid JSON: IncompleteInput" : "JSON body required");
+  if (list == LIST_NONE) return fail(-1, "%s", "Body needs a \"rules\" or an \"ops\" list");
+  return true;
+}
+
+bool exceptionsFromText(const char* text, std::vector<RuleDateException>& out) {
+  const char* p = text;
+  while (*p) {
+    while (*p == ' ' || *p == ',') p++;
+    if (!*p) break;
+
+    int32_t first, last;
+    if (!parseRuleDate(p, first)) return false;
+    p += 10;
+    last = first;
+    if (strncmp(p, "..", 2) == 0) {
+      p += 2;
+      if (!parseRuleDate(p, last)) return false;
+      p += 10;
+    }
+    if (!addException(first, last, out)) return false;
+    if (*p && *p != ',' && *p != ' ') return false;
+  }
+  return true;
+}
+
+bool parseRuleDate(const char* text, int32_t& day) {
+  int year, month, date;
+  char dash1, dash2;
+  if (strlen(text) < 10 || sscanf(text, "%4d%c%2d%c%2d", &year, &dash1, &month, &dash2, &date) != 5 ||
+      dash1 != '-' || dash2 != '-' || month < 1 || month > 12 || date < 1 || date > 31) {
+    return false;
+  }
+  day = ruleDayNumber(year, month, date);
+
+  // Reject dates like 2026-02-30 that normalize into the next month
+  int checkYear, checkMonth, checkDate;
+  ruleDayToDate(day, checkYear, checkMonth, checkDate);
+  return checkMonth == month && checkDate == date;
+}
+
+void formatRuleDate(int32_t day, char* buffer, size_t size) {
+  int year, month, date;
+  ruleDayToDate(day, year, month, date);
+  snprintf(buffer, size, "%04d-%02d-%02d", year, month, date);
+}
@@ -0,0 +1,163 @@
+#include "rule_log.h"
+#include "rule_journal.h"
+#include "rule_image.h"
+#include <algorithm>
+#include <string.h>
+
+static void put16(std::vector<uint8_t>& out, uint16_t value) {
+  out.push_back((uint8_t)value);
+  out.push_back((uint8_t)(value >> 8));
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+  put16(out, (uint16_t)value);
+  put16(out, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+void ruleRecordEncode(const ACRule& rule, const char* name, const RuleDateException exceptions[], int count,
+                      std::vector<uint8_t>& out) {
+  size_t start = out.size();
+  out.resize(start + RULE_FIELDS_SIZE);
+  ruleFieldsEncode(rule, out.data() + start);
+
+  size_t nameLength = name ? strlen(name) : 0;
+  if (nameLength > UINT8_MAX) nameLength = UINT8_MAX;
+  out.push_back((uint8_t)nameLength);
+  out.insert(out.end(), (const uint8_t*)name, (const uint8_t*)name + nameLength);
+
+  put16(out, (uint16_t)count);
+  for (int i = 0; i < count; i++) {
+    put16(out, exceptions[i].firstDay);
+    put16(out, exceptions[i].lastDay);
+  }
+}
+
+size_t ruleRecordDecode(const uint8_t* data, size_t size, ACRule& rule, RuleNamePool& names,
+                        std::vector<RuleDateException>& exceptions) {
+  if (size < RULE_FIELDS_SIZE + 1) return 0;
+  size_t nameLength = data[RULE_FIELDS_SIZE];
+  size_t pos = RULE_FIELDS_SIZE + 1 + nameLength;
+  if (size < pos + 2) return 0;
+  size_t count = get16(data + pos);
+  size_t end = pos + 2 + count * 4;
+  if (size < end || !ruleFieldsDecode(data, rule)) return 0;
+
+  char name[UINT8_MAX + 1];
+  memcpy(name, data + RULE_FIELDS_SIZE + 1, nameLength);
+  name[nameLength] = '\0';
+  rule.nameId = names.intern(name);
+
+  exceptions.clear();
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* range = data + pos + 2 + i * 4;
+    exceptions.push_back({rule.id, get16(range), get16(range + 2)});
+  }
+  return end;
+}
+
+static void appendEntry(std::vector<uint8_t>& out, uint8_t op, uint32_t base, const uint8_t* payload, size_t length) {
+  size_t start = out.size();
+  put16(out, (uint16_t)(1 + 4 + length));
+  out.push_back(op);
+  put32(out, base);
+  out.insert(out.end(), payload, payload + length);
+  put32(out, journalCrc32(0, out.data() + start, out.size() - start));
+}
+
+RuleLogReplayResult ruleLogReplay(const uint8_t* data, size_t size, uint32_t base, RuleSet& rules,
+                                  RuleNamePool& names) {
+  RuleLogReplayResult result = {0, 0, 0, false};
+  std::vector<RuleDateException> exceptions;
+  size_t pos = 0;
+  while (pos < size) {
+    if (size - pos < RULE_LOG_ENTRY_OVERHEAD) break;
+    size_t body = get16(data + pos);
+    size_t length = 2 + body + 4;
+    if (body < 5 || size - pos < length) break;
+    if (journalCrc32(0, data + pos, 2 + body) != get32(data + pos + 2 + body)) break;
+
+    uint8_t op = data[pos + 2];
+    const uint8_t* payload = data + pos + 7;
+    size_t payloadLength = body - 5;
+    if (get32(data + pos + 3) != base) {
+      result.stale++;
+    } else if (op == RULE_LOG_PUT) {
+      ACRule rule;
+      if (ruleRecordDecode(payload, payloadLength, rule, names, exceptions) != payloadLength) break;
+      rules.remove(rule.id);
+      rules.insert(rule);
+      rules.setExceptions(rule.id, exceptions.data(), (int)exceptions.size());
+      result.applied++;
+    } else if (op == RULE_LOG_DELETE && payloadLength == 2) {
+      rules.remove(get16(payload));
+      result.applied++;
+    } else {
+      break;
+    }
+    pos += length;
+  }
+  result.validBytes = pos;
+  result.torn = pos < size;
+  return result;
+}
+
+RuleLogTracker::RuleLogTracker() : synced(false) {
+}
+
+// Encode each rule of the snapshot with its exceptions (sorted by rule ID)
+template <typename Visit>
+static void forEachRecord(const RuleSnapshot& snapshot, std::vector<uint8_t>& record, Visit visit) {
+  const std::vector<RuleDateException>& exceptions = snapshot.exceptions;
+  for (const ACRule& rule : snapshot.rules) {
+    RuleDateException key = {rule.id, 0, 0};
+    auto first = std::lower_bound(exceptions.begin(), exceptions.end(), key, exceptionLess);
+    auto last = first;
+    while (last != exceptions.end() && last->ruleId == rule.id) ++last;
+    record.clear();
+    ruleRecordEncode(rule, snapshot.names.get(rule.nameId), exceptions.data() + (first - exceptions.begin()),
+                     (int)(last - first), record);
+    visit(rule, record);
+  }
+}
+
+void RuleLogTracker::reset(const RuleSnapshot& snapshot) {
+  std::vector<uint8_t> record;
+  stored.clear();
+  forEachRecord(snapshot, record, [this](const ACRule& rule, const std::vector<uint8_t>& bytes) {
+    stored[rule.id] = journalCrc32(0, bytes.data(), bytes.size());
+  });
+  synced = true;
+}
+
+int RuleLogTracker::diff(const RuleSnapshot& snapshot, uint32_t base, std::vector<uint8_t>& out) {
+  std::vector<uint8_t> record;
+  std::unordered_map<uint16_t, uint32_t> current;
+  current.reserve(snapshot.rules.size());
+  int entries = 0;
+  forEachRecord(snapshot, record, [&](const ACRule& rule, const std::vector<uint8_t>& bytes) {
+    uint32_t crc = journalCrc32(0, bytes.data(), bytes.size());
+    current[rule.id] = crc;
+    auto it = stored.find(rule.id);
+    if (it == stored.end() || it->second != crc) {
+      appendEntry(out, RULE_LOG_PUT, base, bytes.data(), bytes.size());
+      entries++;
+    }
+  });
+  for (const auto& entry : stored) {
+    if (current.find(entry.first) == current.end()) {
+      uint8_t id[2] = {(uint8_t)entry.first, (uint8_t)(entry.first >> 8)};
+      appendEntry(out, RULE_LOG_DELETE, base, id, sizeof(id));
+      entries++;
+    }
+  }
+  stored.swap(current);
+  return entries;
+}
@@ -0,0 +1,396 @@
+#include "rule_persist.h"
+#include "config.h"
+#include <SPIFFS.h>
+#include <ArduinoJson.h>
+#include "rule_json.h"
+#include "rule_journal.h"
+#include "rule_image.h"
+#include "rule_log.h"
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <algorithm>
+#include <vector>
+
+// Full records are rule images (rule_image.h) alternating between two slot
+// files (rule_journal.h); the log holds the changes since the newest one
+// (rule_log.h). JSON is only read: slots written by firmware before the
+// image, and /rules.json when no slot holds a valid record (files from
+// before the journal, the filesystem image's default rules).
+static const char* const RULE_SLOT_PATHS[JOURNAL_SLOT_COUNT] = {"/rules.a", "/rules.b"};
+static const char* const LEGACY_RULES_PATH = "/rules.json";
+static const char* const RULE_LOG_PATH = "/rules.log";
+static int newestRuleSlot = -1;          // Slot of the newest valid record, -1 = none
+static uint32_t newestRuleSequence = 0;
+
+// Everything below is owned by whoever holds persistMutex
+static RuleLogTracker ruleLog;           // What flash holds, per rule
+static QueueHandle_t saveQueue = NULL;
+static SemaphoreHandle_t persistMutex = NULL;
+static RulePersistStats persistStats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+void initRulePersistence() {
+  if (saveQueue != NULL) return;
+  saveQueue = xQueueCreate(1, sizeof(uint8_t));   // One pending save covers any number of edits
+  persistMutex = xSemaphoreCreateMutex();
+  if (saveQueue == NULL || persistMutex == NULL) {
+    Serial.println("❌ Failed to create rule save queue!");
+  } else {
+    Serial.println("✅ Rule save queue created successfully");
+  }
+}
+
+// Write one record; the slot's previous contents are gone once it is opened
+static bool writeRuleRecord(int slot, uint32_t sequence, const std::vector<uint8_t>& image, uint32_t& bytes) {
+  File file = SPIFFS.open(RULE_SLOT_PATHS[slot], "w");
+  if (!file) return false;
+  JournalWriter<File> out(file);
+  out.write(image.data(), image.size());
+  bool complete = out.finish(sequence);
+  file.close();
+  bytes = out.size() + JOURNAL_TRAILER_SIZE;
+  return complete;
+}
+
+static bool appendRuleLog(const std::vector<uint8_t>& entries, uint32_t& bytes) {
+  File file = SPIFFS.open(RULE_LOG_PATH, "a");
+  if (!file) return false;
+  bytes = file.write(entries.data(), entries.size());
+  file.close();
+  return bytes == entries.size();
+}
+
+static bool readFileBytes(const char* path, std::vector<uint8_t>& out) {
+  File file = SPIFFS.open(path, "r");
+  if (!file) return false;
+  out.resize(file.size());
+  size_t read = out.empty() ? 0 : file.readBytes((char*)out.data(), out.size());
+  file.close();
+  return read == out.size();
+}
+
+// Take the newest slot whose journal CRC and contents both check out:
+// `record` holds its payload, which is a rule image (`isImage`, read in
+// place) or JSON parsed into `doc`. Damaged slots (a save cut short by a
+// reset) are logged and skipped, not overwritten: the next save goes to the
+// other slot.
+static bool readNewestRuleRecord(std::vector<uint8_t>& record, bool& isImage, JsonDocument& doc) {
+  std::vector<uint8_t> files[JOURNAL_SLOT_COUNT];
+  JournalRecord records[JOURNAL_SLOT_COUNT];
+  bool valid[JOURNAL_SLOT_COUNT];
+  for (int slot = 0; slot < JOURNAL_SLOT_COUNT; slot++) {
+    bool present = readFileBytes(RULE_SLOT_PATHS[slot], files[slot]);
+    valid[slot] = present && journalCheck(files[slot].data(), files[slot].size(), records[slot]);
+    if (present && !valid[slot]) {
+      Serial.printf("⚠️ Rule record %s is incomplete or corrupt, skipped\n", RULE_SLOT_PATHS[slot]);
+    }
+  }
+
+  int slot;
+  while ((slot = journalNewestSlot(valid, records)) >= 0) {
+    const uint8_t* payload = files[slot].data();
+    RuleImage image;
+    isImage = ruleImageOpen(payload, records[slot].length, image);
+    if (!isImage) {
+      DeserializationError error = deserializeJson(doc, (const char*)payload, records[slot].length);
+      if (error) {
+        Serial.printf("❌ Rule record %s does not parse: %s\n", RULE_SLOT_PATHS[slot], error.c_str());
+        valid[slot] = false;
+        continue;
+      }
+    }
+    newestRuleSlot = slot;
+    newestRuleSequence = records[slot].sequence;
+    persistStats.fullRecordBytes = records[slot].length + JOURNAL_TRAILER_SIZE;
+    Serial.printf("📖 Rule record #%u from %s (%s, %u bytes)\n", (unsigned)records[slot].sequence,
+                  RULE_SLOT_PATHS[slot], isImage ? "image" : "JSON", (unsigned)records[slot].length);
+    files[slot].resize(records[slot].length);
+    record.swap(files[slot]);
+    return true;
+  }
+  return false;
+}
+
+// Bring flash up to the published snapshot: a log entry per rule that
+// differs from flash, or a full record when there is no usable log (first
+// save, failed append) or the log has grown past the full record
+static void writeRules() {
+  if (xSemaphoreTake(persistMutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+    Serial.println("⚠️ Failed to acquire rule persistence lock for saving");
+    return;
+  }
+
+  RuleLogTracker written = ruleLog;   // Flash once this save lands
+  std::vector<uint8_t> entries;
+  std::vector<uint8_t> image;
+  int ruleCount;
+  int changed = 0;
+  bool full = !ruleLog.isSynced() || newestRuleSlot < 0;
+  {
+    // The published snapshot is immutable and already in priority order
+    RuleSnapshotGuard snapshot(ruleStore);
+    ruleCount = (int)snapshot->rules.size();
+    if (!full) {
+      changed = written.diff(*snapshot, newestRuleSequence, entries);
+      full = changed > 0 && ruleLogNeedsCompaction(persistStats.logBytes, entries.size(),
+                                                   persistStats.fullRecordBytes);
+    }
+    if (full) {
+      ruleImageEncode(*snapshot, image);
+      written.reset(*snapshot);
+    }
+  }
+  if (!full && changed == 0) {   // Flash already holds these rules
+    xSemaphoreGive(persistMutex);
+    return;
+  }
+
+  uint32_t bytes = 0;
+  uint32_t start = micros();
+  bool saved;
+  if (full) {
+    // Never the slot holding the newest valid record, so a power cut while
+    // writing leaves that record (and the log on top of it) readable
+    int slot = journalNextSlot(newestRuleSlot);
+    uint32_t sequence = newestRuleSequence + 1;
+    saved = writeRuleRecord(slot, sequence, image, bytes);
+    if (saved) {
+      newestRuleSlot = slot;
+      newestRuleSequence = sequence;
+      // Its entries name the previous record, so a reset before this point
+      // leaves them to be skipped as stale
+      File log = SPIFFS.open(RULE_LOG_PATH, "w");
+      if (log) log.close();
+      ruleLog = std::move(written);
+      persistStats.logBytes = 0;
+      persistStats.fullRecordBytes = bytes;
+      persistStats.fullRecords++;
+      Serial.printf("✅ Saved %d rules to SPIFFS (%s #%u, %u bytes, %lu us)\n", ruleCount, RULE_SLOT_PATHS[slot],
+                    (unsigned)sequence, (unsigned)bytes, (unsigned long)(micros() - start));
+    } else {
+      Serial.printf("❌ Failed to save rules to SPIFFS (%s), previous save kept\n", RULE_SLOT_PATHS[slot]);
+    }
+  } else {
+    saved = appendRuleLog(entries, bytes);
+    persistStats.logBytes += bytes;
+    if (saved) {
+      ruleLog = std::move(written);
+      persistStats.logEntries += changed;
+      Serial.printf("✅ Saved %d rule changes to %s (%u bytes, %lu us)\n", changed, RULE_LOG_PATH,
+                    (unsigned)bytes, (unsigned long)(micros() - start));
+    } else {
+      // A partial entry ends replay, so nothing may be appended after it
+      ruleLog.invalidate();
+      Serial.printf("❌ Failed to append to %s, next save writes all rules\n", RULE_LOG_PATH);
+    }
+  }
+
+  uint32_t elapsed = micros() - start;
+  if (saved) persistStats.saves++;
+  persistStats.bytesWritten += bytes;
+  persistStats.lastSaveBytes = bytes;
+  persistStats.lastSaveMicros = elapsed;
+  if (elapsed > persistStats.maxSaveMicros) persistStats.maxSaveMicros = elapsed;
+  xSemaphoreGive(persistMutex);
+}
+
+static bool publishRules() {
+  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    Serial.println("⚠️ Failed to acquire rules mutex for saving");
+    return false;
+  }
+  markRulesChanged();
+  xSemaphoreGive(rulesMutex);
+  return true;
+}
+
+void scheduleRulesSave() {
+  if (!publishRules()) return;
+  persistStats.requests++;
+  if (saveQueue == NULL) {
+    writeRules();   // No persistence task yet
+    return;
+  }
+  // A full queue means a save is already pending; it writes whatever is
+  // published when it runs, so this edit is included
+  uint8_t request = 0;
+  xQueueSend(saveQueue, &request, 0);
+}
+
+bool serviceRuleSaves(TickType_t wait) {
+  uint8_t request;
+  if (saveQueue == NULL || xQueueReceive(saveQueue, &request, wait) != pdTRUE) return false;
+
+  // Every edit restarts the quiet period, up to RULE_SAVE_MAX_DELAY_MS
+  uint32_t first = millis();
+  for (;;) {
+    uint32_t waited = millis() - first;
+    if (waited >= RULE_SAVE_MAX_DELAY_MS) break;
+    uint32_t quiet = std::min<uint32_t>(RULE_SAVE_QUIET_MS, RULE_SAVE_MAX_DELAY_MS - waited);
+    if (xQueueReceive(saveQueue, &request, pdMS_TO_TICKS(quiet)) != pdTRUE) break;
+  }
+  writeRules();
+  return true;
+}
+
+void rulePersistTask(void* param) {
+  while (true) {
+    serviceRuleSaves(portMAX_DELAY);
+  }
+}
+
+// Save rules to SPIFFS
+void saveRulesToSPIFFS() {
+  if (publishRules()) writeRules();
+}
+
+// Rules from a JSON record or rules.json. Call with rulesMutex held.
+static void rulesFromJson(const JsonDocument& doc) {
+  JsonArrayConst rulesArray = doc["rules"];
+  int fileVersion = doc["version"] | 1;
+  if (fileVersion < RULES_FILE_VERSION) {
+    Serial.printf("🔄 Migrating rules from version %d to %d\n", fileVersion, RULES_FILE_VERSION);
+  }
+  ruleSet.clear();
+  ruleSet.reserve(rulesArray.size());
+  ruleNames.clear();
+
+  int position = 0;
+  for (JsonObjectConst rule : rulesArray) {
+    if (ruleSet.size() >= MAX_RULES) {
+      Serial.printf("⚠️ Maximum rules (%d) reached, skipping remaining\n", MAX_RULES);
+      break;
+    }
+
+    // Files without priorities were saved in evaluation order, so position keeps it
+    ACRule loaded;
+    std::vector<RuleDateException> exceptions;
+    ruleFromJson(rule, loaded, ruleNames, position + 1, position);
+    exceptionsFromJson(rule["exceptions"], exceptions);
+    if (ruleSet.insert(loaded) == nullptr) {
+      loaded.id = ruleSet.nextId();
+      Serial.printf("⚠️ Duplicate rule ID at position %d, reassigned to %d\n", position, loaded.id);
+      ruleSet.insert(loaded);
+    }
+    ruleSet.setExceptions(loaded.id, exceptions.data(), (int)exceptions.size());
+    position++;
+  }
+}
+
+// Load the newest full record (or rules.json) and the log into ruleSet.
+// Returns false when the defaults should be used instead. Call with
+// persistMutex held.
+static bool loadSavedRules() {
+  uint32_t start = micros();
+  // Until a record is read, flash holds nothing a log entry could extend
+  newestRuleSlot = -1;
+  newestRuleSequence = 0;
+  ruleLog.invalidate();
+  JsonDocument doc;
+  std::vector<uint8_t> record;
+  std::vector<uint8_t> log;
+  bool isImage = false;
+  bool fromJournal = readNewestRuleRecord(record, isImage, doc);
+  if (fromJournal) {
+    readFileBytes(RULE_LOG_PATH, log);
+  } else {
+    File file = SPIFFS.open(LEGACY_RULES_PATH, "r");
+    if (!file) {
+      Serial.println("📄 No saved rules found, creating defaults");
+      return false;
+    }
+
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+
+    if (error) {
+      Serial.printf("❌ Failed to parse rules.json: %s\n", error.c_str());
+      Serial.println("📄 Using default rules instead");
+      return false;
+    }
+    Serial.println("📄 Loaded rules.json; the next save moves it to the rule journal");
+  }
+
+  // Acquire mutex for thread-safe access
+  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    Serial.println("⚠️ Failed to acquire rules mutex for loading");
+    return true;
+  }
+
+  // The log's entries are changes to the record, so they are dropped with it
+  bool recordLoaded = true;
+  if (isImage) {
+    RuleImage image;
+    ruleImageOpen(record.data(), record.size(), image);   // Checked by readNewestRuleRecord()
+    if (!ruleImageLoad(image, ruleSet, ruleNames)) {
+      Serial.printf("❌ Rule image %s holds an invalid rule, %s not replayed\n",
+                    RULE_SLOT_PATHS[newestRuleSlot], RULE_LOG_PATH);
+      ruleSet.clear();
+      recordLoaded = false;
+    }
+  } else {
+    rulesFromJson(doc);
+  }
+
+  RuleLogReplayResult replay = {0, 0, 0, false};
+  if (recordLoaded) {
+    replay = ruleLogReplay(log.data(), log.size(), newestRuleSequence, ruleSet, ruleNames);
+  }
+  uint32_t loadMicros = micros() - start;
+  markRulesChanged();
+  int loadedCount = ruleSet.size();
+
+  // Flash holds exactly the published rules unless the log ends in a torn
+  // entry (appending after it would hide the new entries), they came from
+  // JSON or the image would not load (entries appended to it would be
+  // dropped at every boot); the next save then writes a full record. Done
+  // before releasing the mutex so no edit can be published in between.
+  if (isImage && recordLoaded && !replay.torn) {
+    RuleSnapshotGuard snapshot(ruleStore);
+    ruleLog.reset(*snapshot);
+  } else {
+    ruleLog.invalidate();
+  }
+  persistStats.logBytes = log.size();
+
+  // Release mutex
+  xSemaphoreGive(rulesMutex);
+
+  if (recordLoaded && !log.empty()) {
+    Serial.printf("📜 Replayed %d rule changes from %s (%d stale%s)\n", replay.applied, RULE_LOG_PATH,
+                  replay.stale, replay.torn ? ", torn tail dropped" : "");
+  }
+  Serial.printf("✅ Loaded %d rules from SPIFFS (%s, %lu us)\n", loadedCount,
+                isImage ? "image" : fromJournal ? "JSON record" : "rules.json", (unsigned long)loadMicros);
+
+  // If no rules were loaded, create defaults
+  if (loadedCount == 0) {
+    Serial.println("📄 No valid rules loaded, creating defaults");
+    return false;
+  }
+  return true;
+}
+
+// Load rules from SPIFFS
+void loadRulesFromSPIFFS() {
+  // Keeps the persistence task from writing while the files are read
+  if (xSemaphoreTake(persistMutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+    Serial.println("⚠️ Failed to acquire rule persistence lock for loading");
+    return;
+  }
+  bool loaded = loadSavedRules();
+  xSemaphoreGive(persistMutex);
+  if (loaded) return;
+
+  // Acquire mutex for thread-safe access
+  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+    initDefaultRules();
+    xSemaphoreGive(rulesMutex);
+    saveRulesToSPIFFS(); // Save defaults for next time; rules.json is left for inspection
+  } else {
+    Serial.println("⚠️ Failed to acquire rules mutex for default initialization");
+  }
+}
+
+RulePersistStats getRulePersistStats() {
+  return persistStats;
+}
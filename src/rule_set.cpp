@@ -0,0 +1,107 @@
+#include "rule_set.h"
+#include <algorithm>
+
+// Range of exceptions belonging to one rule
+static std::pair<std::vector<RuleDateException>::iterator, std::vector<RuleDateException>::iterator>
+exceptionsOf(std::vector<RuleDateException>& exceptions, uint16_t id) {
+  RuleDateException first = {id, 0, 0};
+  RuleDateException last = {id, UINT16_MAX, UINT16_MAX};
+  return std::make_pair(std::lower_bound(exceptions.begin(), exceptions.end(), first, exceptionLess),
+                        std::upper_bound(exceptions.begin(), exceptions.end(), last, exceptionLess));
+}
+
+RuleSet::RuleSet() : maxId(0), maxPriority(0) {
+}
+
+ACRule* RuleSet::find(uint16_t id) {
+  auto it = positions.find(id);
+  return it == positions.end() ? nullptr : &rules[it->second];
+}
+
+const ACRule* RuleSet::find(uint16_t id) const {
+  auto it = positions.find(id);
+  return it == positions.end() ? nullptr : &rules[it->second];
+}
+
+ACRule* RuleSet::insert(const ACRule& rule) {
+  if (rule.id == 0 || !positions.emplace(rule.id, (uint32_t)rules.size()).second) {
+    return nullptr;
+  }
+  rules.push_back(rule);
+  if (rule.id > maxId) maxId = rule.id;
+  if (rule.priority > maxPriority) maxPriority = rule.priority;
+  return &rules.back();
+}
+
+bool RuleSet::remove(uint16_t id) {
+  auto it = positions.find(id);
+  if (it == positions.end()) {
+    return false;
+  }
+
+  uint32_t pos = it->second;
+  positions.erase(it);
+  if (pos != rules.size() - 1) {
+    rules[pos] = rules.back();
+    positions[rules[pos].id] = pos;
+  }
+  rules.pop_back();
+
+  auto range = exceptionsOf(exceptions, id);
+  exceptions.erase(range.first, range.second);
+  return true;
+}
+
+void RuleSet::clear() {
+  rules.clear();
+  positions.clear();
+  exceptions.clear();
+  maxId = 0;
+  maxPriority = 0;
+}
+
+void RuleSet::reserve(size_t count) {
+  rules.reserve(count);
+  positions.reserve(count);
+}
+
+uint16_t RuleSet::nextId() const {
+  if (maxId < UINT16_MAX) {
+    return maxId + 1;
+  }
+  // IDs are never handed out twice in normal use; only reuse gaps once exhausted
+  for (uint32_t id = 1; id <= UINT16_MAX; id++) {
+    if (positions.find((uint16_t)id) == positions.end()) return (uint16_t)id;
+  }
+  return 0;
+}
+
+uint16_t RuleSet::nextPriority() const {
+  if (rules.empty()) return 0;
+  return maxPriority < UINT16_MAX ? maxPriority + 1 : UINT16_MAX;
+}
+
+void RuleSet::setPriority(uint16_t id, uint16_t priority) {
+  ACRule* rule = find(id);
+  if (rule == nullptr) return;
+  rule->priority = priority;
+  if (priority > maxPriority) maxPriority = priority;
+}
+
+void RuleSet::setExceptions(uint16_t id, const RuleDateException list[], int count) {
+  auto range = exceptionsOf(exceptions, id);
+  std::vector<RuleDateException>::iterator pos = exceptions.erase(range.first, range.second);
+  size_t offset = pos - exceptions.begin();
+  exceptions.insert(pos, list, list + count);
+  for (int i = 0; i < count; i++) {
+    exceptions[offset + i].ruleId = id;
+  }
+  std::sort(exceptions.begin() + offset, exceptions.begin() + offset + count, exceptionLess);
+}
+
+size_t RuleSet::getMemoryUsage() const {
+  // Approximate: one node per entry plus the bucket array
+  return rules.capacity() * sizeof(ACRule) + exceptions.capacity() * sizeof(RuleDateException) +
+         positions.size() * (sizeof(std::pair<uint16_t, uint32_t>) + 2 * sizeof(void*)) +
+         positions.bucket_count() * sizeof(void*);
+}
@@ -0,0 +1,116 @@
+#include "rule_store.h"
+#include <algorithm>
+#include <chrono>
+
+RuleStore::RuleStore() : current(0), version(0), writerWaits(0), readerRetries(0) {
+  readers[0].store(0);
+  readers[1].store(0);
+  draining[0].store(false);
+  draining[1].store(false);
+  for (int i = 0; i < 2; i++) {
+    slots[i].version = 0;
+    slots[i].calendar.compile(nullptr, 0, nullptr, 0);
+  }
+}
+
+uint32_t RuleStore::publish(const ACRule rules[], int count, const RuleNamePool& names,
+                            const RuleDateException exceptions[], int exceptionCount) {
+  std::lock_guard<std::mutex> lock(writeLock);
+
+  int next = 1 - current.load(std::memory_order_acquire);
+
+  // Readers that pinned the stale slot before the previous flip must finish first
+  if (readers[next].load(std::memory_order_seq_cst) != 0) {
+    writerWaits.fetch_add(1, std::memory_order_relaxed);
+    std::unique_lock<std::mutex> wait(drainLock);
+    // seq_cst on both sides: either release() sees the flag, or this check
+    // sees its decrement
+    draining[next].store(true, std::memory_order_seq_cst);
+    drained.wait(wait, [this, next] { return readers[next].load(std::memory_order_seq_cst) == 0; });
+    draining[next].store(false, std::memory_order_relaxed);
+  }
+
+  // Slots are reused, so after warm-up the vectors keep their capacity
+  RuleSnapshot& slot = slots[next];
+  slot.rules.assign(rules, rules + count);
+  std::sort(slot.rules.begin(), slot.rules.end(), ruleHigherPriority);
+  slot.names = names;
+  slot.exceptions.assign(exceptions, exceptions + exceptionCount);
+  std::sort(slot.exceptions.begin(), slot.exceptions.end(), exceptionLess);
+  slot.calendar.compile(slot.rules.data(), count, slot.exceptions.data(), exceptionCount);
+  slot.version = version.load(std::memory_order_relaxed) + 1;
+
+  current.store(next, std::memory_order_seq_cst);
+  version.store(slot.version, std::memory_order_release);
+  return slot.version;
+}
+
+const RuleSnapshot* RuleStore::acquire() {
+  for (;;) {
+    int idx = current.load(std::memory_order_seq_cst);
+    readers[idx].fetch_add(1, std::memory_order_seq_cst);
+    // Still current after pinning: the writer cannot reuse this slot until we release it
+    if (current.load(std::memory_order_seq_cst) == idx) {
+      return &slots[idx];
+    }
+    unpin(idx);
+    readerRetries.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void RuleStore::release(const RuleSnapshot* snapshot) {
+  unpin((snapshot == &slots[0]) ? 0 : 1);
+}
+
+void RuleStore::unpin(int idx) {
+  if (readers[idx].fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+      draining[idx].load(std::memory_order_seq_cst)) {
+    // Taking the lock orders the wake-up after the writer is asleep
+    std::lock_guard<std::mutex> wake(drainLock);
+    drained.notify_one();
+  }
+}
+
+RuleSnapshotCache::RuleSnapshotCache(Serializer serialize) : serialize(serialize), version(0), stats{0, 0, 0, 0} {
+}
+
+RuleSnapshotCache::Text RuleSnapshotCache::get(const RuleSnapshot& snapshot) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (text && snapshot.version == version) {
+    stats.hits++;
+    stats.savedMicros += stats.lastBuildMicros;
+    return text;
+  }
+
+  stats.misses++;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::shared_ptr<std::string> built = std::make_shared<std::string>();
+  serialize(snapshot, *built);
+  uint32_t micros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+  // A reader still holding an older snapshot gets its own text; the cache
+  // keeps the newest version
+  if (!text || snapshot.version > version) {
+    text = built;
+    version = snapshot.version;
+    stats.lastBuildMicros = micros;
+  }
+  return built;
+}
+
+void RuleSnapshotCache::clear() {
+  std::lock_guard<std::mutex> guard(lock);
+  text.reset();
+  version = 0;
+}
+
+size_t RuleSnapshotCache::getMemoryUsage() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return text ? text->capacity() : 0;
+}
+
+RuleSnapshotCacheStats RuleSnapshotCache::getStats() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return stats;
+}
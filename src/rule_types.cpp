@@ -0,0 +1,104 @@
+#include "rule_types.h"
+#include <string.h>
+
+#define NAME_INDEX_EMPTY UINT16_MAX
+
+// FNV-1a, good enough to spread short rule names over the index
+static uint32_t hashName(const char* name) {
+  uint32_t hash = 2166136261u;
+  while (*name) {
+    hash = (hash ^ (uint8_t)*name++) * 16777619u;
+  }
+  return hash;
+}
+
+// Inverse of ruleDayNumber() (civil-from-days)
+void ruleDayToDate(int32_t dayNumber, int& year, int& month, int& day) {
+  int32_t z = dayNumber + 730425;
+  int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+  int32_t dayOfEra = z - era * 146097;
+  int32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int32_t monthIndex = (5 * dayOfYear + 2) / 153;
+  day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+  year = yearOfEra + era * 400 + (month <= 2);
+}
+
+RuleNamePool::RuleNamePool() {
+}
+
+uint16_t RuleNamePool::intern(const char* name) {
+  if (name == nullptr) name = "";
+
+  // Keep the index at most half full so probe chains stay short
+  if ((offsets.size() + 1) * 2 > index.size()) {
+    rebuildIndex();
+  }
+
+  size_t mask = index.size() - 1;
+  size_t slot = hashName(name) & mask;
+  while (index[slot] != NAME_INDEX_EMPTY) {
+    if (strcmp(&text[offsets[index[slot]]], name) == 0) {
+      return index[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+  if (offsets.size() >= NAME_INDEX_EMPTY) {
+    return 0;
+  }
+
+  uint16_t id = (uint16_t)offsets.size();
+  offsets.push_back((uint32_t)text.size());
+  text.insert(text.end(), name, name + strlen(name) + 1);
+  index[slot] = id;
+  return id;
+}
+
+const char* RuleNamePool::get(uint16_t id) const {
+  if (id >= offsets.size()) return "";
+  return &text[offsets[id]];
+}
+
+void RuleNamePool::compact(ACRule rules[], int count) {
+  // Existing names are already unique, so remap handles without comparing strings
+  // (unknown handles all share the last slot and resolve to "")
+  std::vector<uint16_t> remap(offsets.size() + 1, NAME_INDEX_EMPTY);
+  RuleNamePool compacted;
+  for (int i = 0; i < count; i++) {
+    uint16_t id = rules[i].nameId < offsets.size() ? rules[i].nameId : (uint16_t)offsets.size();
+    if (remap[id] == NAME_INDEX_EMPTY) {
+      const char* name = get(id);
+      remap[id] = (uint16_t)compacted.offsets.size();
+      compacted.offsets.push_back((uint32_t)compacted.text.size());
+      compacted.text.insert(compacted.text.end(), name, name + strlen(name) + 1);
+    }
+    rules[i].nameId = remap[id];
+  }
+  text.swap(compacted.text);
+  offsets.swap(compacted.offsets);
+  rebuildIndex();
+}
+
+void RuleNamePool::clear() {
+  text.clear();
+  offsets.clear();
+  index.clear();
+}
+
+void RuleNamePool::rebuildIndex() {
+  size_t capacity = 16;
+  while (capacity < (offsets.size() + 1) * 2) capacity *= 2;
+  index.assign(capacity, NAME_INDEX_EMPTY);
+
+  size_t mask = capacity - 1;
+  for (size_t i = 0; i < offsets.size(); i++) {
+    size_t slot = hashName(&text[offsets[i]]) & mask;
+    while (index[slot] != NAME_INDEX_EMPTY) slot = (slot + 1) & mask;
+    index[slot] = (uint16_t)i;
+  }
+}
+
+size_t RuleNamePool::getMemoryUsage() const {
+  return text.capacity() + offsets.capacity() * sizeof(uint32_t) + index.capacity() * sizeof(uint16_t);
+}
@@ -1,11 +1,25 @@
 #include "sensor.h"
+#include "ac_control.h"
+#include "web_server.h"
+#include "config_store.h"
+#include "ir_transmitter.h"
 #include "SHTSensor.h"
 #include <Wire.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // Global sensor objects - auto-detect SHT sensor type
 SHTSensor sht;
 
+// Last 24 h of temperature and AC state for /api/history. Written by the
+// sensor task, read sample by sample by the web server while it streams.
+static TempHistory tempHistory;
+static SemaphoreHandle_t tempHistoryMutex = NULL;
+
 void initSensors() {
+  tempHistoryMutex = xSemaphoreCreateMutex();
+
   // Initialize I2C with the pins defined in config.h
   Wire.begin(OLED_SDA, OLED_SCL);
   
@@ -104,3 +118,60 @@ float readHumidity() {
   
   return humidity;
 }
+
+// One sample per TEMP_HISTORY_PERIOD_SEC, once NTP has set the clock (an
+// unset clock would date them 1970)
+static void recordTempHistory(float temp) {
+  time_t now = time(nullptr);
+  if (isnan(temp) || now < 1600000000) return;
+
+  static ACState lastAC = AC_STATE_OFF;
+  ACState ac;
+  if (getCurrentACState(ac)) lastAC = ac;   // Busy: the state a moment ago will do
+
+  TempHistorySample sample;
+  sample.time = (uint32_t)now;
+  sample.tempCenti = (int16_t)lroundf(temp * 100.0f);
+  sample.acOn = lastAC.power();
+  sample.setTemp = lastAC.temperature();
+
+  if (tempHistoryMutex == NULL || xSemaphoreTake(tempHistoryMutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+  tempHistory.add(sample);
+  xSemaphoreGive(tempHistoryMutex);
+}
+
+void getTempHistoryRange(uint32_t& first, uint32_t& end) {
+  first = end = 0;
+  if (tempHistoryMutex == NULL || xSemaphoreTake(tempHistoryMutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+  first = tempHistory.first();
+  end = tempHistory.end();
+  xSemaphoreGive(tempHistoryMutex);
+}
+
+bool readTempHistory(uint32_t index, TempHistorySample& sample) {
+  if (tempHistoryMutex == NULL || xSemaphoreTake(tempHistoryMutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+  bool found = tempHistory.get(index, sample);
+  xSemaphoreGive(tempHistoryMutex);
+  return found;
+}
+
+// Sample the temperature and wake the control loop only when the reading
+// leaves the band of the current rule decision. Samples come every
+// SENSOR_SAMPLE_INTERVAL_MS near a band edge and up to a minute apart well
+// inside the band. The control loop may sleep for 15 minutes, so the
+// temperature log is written here, once per sample.
+void sensorTask(void* param) {
+  Serial.println("Sensor Task started on Core " + String(xPortGetCoreID()));
+  configSubscribe(CONFIG_BIT(CONFIG_SENSOR_SAMPLE), xTaskGetCurrentTaskHandle(), 1);
+  
+  for (;;) {
+    currentTemp = readTemperature();
+    uint32_t sleepMs = reportTemperatureSample(currentTemp);
+    if (!isnan(currentTemp)) logToCloud(currentTemp);
+    recordTempHistory(currentTemp);
+    publishStatusEvents();  // Push changes to open dashboard pages
+    // A new interval or a narrower band wakes the wait, so it applies from
+    // the next sample
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs));
+  }
+}
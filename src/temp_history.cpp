@@ -0,0 +1,34 @@
+#include "temp_history.h"
+#include <stdio.h>
+
+TempHistory::TempHistory() : count(0), samples{} {
+}
+
+bool TempHistory::add(const TempHistorySample& sample) {
+  if (count > 0) {
+    const TempHistorySample& last = samples[(count - 1) % TEMP_HISTORY_LENGTH];
+    // A clock stepped back by NTP records at once rather than an hour later
+    if (sample.time >= last.time && sample.time < last.time + TEMP_HISTORY_PERIOD_SEC) return false;
+  }
+  samples[count % TEMP_HISTORY_LENGTH] = sample;
+  count++;
+  return true;
+}
+
+uint32_t TempHistory::first() const {
+  return count > TEMP_HISTORY_LENGTH ? count - TEMP_HISTORY_LENGTH : 0;
+}
+
+bool TempHistory::get(uint32_t index, TempHistorySample& out) const {
+  if (index < first() || index >= count) return false;
+  out = samples[index % TEMP_HISTORY_LENGTH];
+  return true;
+}
+
+int tempHistorySampleJson(const TempHistorySample& sample, char* text, int length) {
+  int written = snprintf(text, length, "{\"time\":%lu,\"temp\":%.2f,\"acOn\":%s,\"setTemp\":%u}",
+                         (unsigned long)sample.time, sample.tempCenti / 100.0, sample.acOn ? "true" : "false",
+                         (unsigned)sample.setTemp);
+  if (written < 0) return 0;
+  return written < length ? written : length - 1;
+}
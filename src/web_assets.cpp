@@ -0,0 +1,34 @@
+#include "web_assets.h"
+#include <Arduino.h>
+#include <string.h>
+
+#ifdef WEB_ASSETS_EMBEDDED
+
+#include "web_assets_data.h"   // Generated in .pio/web_gen by tools/build_web_assets.py
+
+static const int WEB_ASSET_COUNT = sizeof(WEB_ASSET_INDEX) / sizeof(WEB_ASSET_INDEX[0]);
+
+const WebAsset* findWebAsset(const char* path) {
+  if (strcmp(path, "/") == 0) path = "/index.html";
+  // A handful of entries: a scan of the index beats anything fancier
+  for (int i = 0; i < WEB_ASSET_COUNT; i++) {
+    if (strcmp(WEB_ASSET_INDEX[i].path, path) == 0) return &WEB_ASSET_INDEX[i];
+  }
+  return nullptr;
+}
+
+int getWebAssetCount() {
+  return WEB_ASSET_COUNT;
+}
+
+#else
+
+const WebAsset* findWebAsset(const char* path) {
+  return nullptr;
+}
+
+int getWebAssetCount() {
+  return 0;
+}
+
+#endif
@@ -1,12 +1,21 @@
 #include "web_server.h"
 #include "task_manager.h"
 #include "ir_control.h"
+#include "ir_transmitter.h"
 #include "ac_control.h"
+#include "sensor.h"
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
+#include "rule_json.h"
+#include "rule_persist.h"
+#include "config_store.h"
+#include "json_chunk_writer.h"
+#include "http_etag.h"
+#include "web_assets.h"
+#include <algorithm>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
@@ -16,6 +25,77 @@ void handleACControl(AsyncWebServerRequest *request);
 // Global web server object
 AsyncWebServer server(80);
 
+// Largest PUT /api/rules/batch body. It is parsed as it arrives, never held,
+// so this only bounds the work: a MAX_RULES set at ~250 bytes per rule plus
+// room for date exceptions.
+#define RULE_BATCH_MAX_BODY ((size_t)MAX_RULES * 1024)
+#define CONFIG_MAX_BODY 2048
+
+// Push channel for the pages, fed by publishStatusEvents()
+static AsyncEventSource events("/api/events");
+static WebStats webStats = {0, 0, 0, 0, 0, 0, 0, 0};
+static uint32_t lastEventId = 0;
+// Held around every use of events and lastEventId: publishStatusEvents()
+// runs in the sensor task, new clients arrive in the AsyncTCP task
+static SemaphoreHandle_t eventsMutex = NULL;
+
+// The live status the pages show. /api/events pushes the fields that differ
+// from what clients were last sent; /api/snapshot numbers each distinct
+// status so clients can revalidate with If-None-Match.
+struct LiveStatus {
+  int tempTenths;          // Pages show one decimal, finer changes are noise
+  uint32_t acBits;
+  IrTxSource acSource;
+  int ruleId;
+  uint32_t ruleVersion;    // Edits of the active rule change its details
+  int hour;
+};
+static bool eventsPublished = false;
+static LiveStatus published;         // Last pushed to /api/events clients
+static LiveStatus versioned;         // Status that statusVersion describes
+static uint32_t statusVersion = 0;   // 0 = none yet
+static SemaphoreHandle_t statusMutex = NULL;
+
+// Counts every request and lets the real handlers take it. Added before all
+// others, so canHandle() runs once per request, after the request line and
+// before the headers are parsed. The server drops headers nobody asked for,
+// so this is also where If-None-Match is kept for every conditional GET
+// (/api/snapshot, /api/rules and the embedded pages).
+class RequestCounter : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest *request) override {
+        webStats.requests++;
+        request->addInterestingHeader("If-None-Match");
+        return false;
+    }
+};
+static RequestCounter requestCounter;
+
+// Send `doc` as exact-size text: measureJson() sizes the buffer, the
+// document is serialized once and emptied before the response is queued, so
+// the text is all a response holds while it goes out (no String growth, no
+// copy into the response). Lists that grow are not built as one document:
+// /api/rules is cached text, /api/history streams (JsonListStream).
+static AsyncWebServerResponse* beginJsonResponse(AsyncWebServerRequest *request, int code, JsonDocument& doc) {
+  std::shared_ptr<std::string> body = std::make_shared<std::string>();
+  body->reserve(measureJson(doc));
+  serializeJson(doc, *body);
+  doc.clear();
+  if (body->size() > webStats.largestJson) webStats.largestJson = body->size();
+  AsyncWebServerResponse *response = request->beginResponse("application/json", body->size(),
+      [body](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t count = std::min(maxLen, body->size() - index);
+        memcpy(buffer, body->data() + index, count);
+        return count;
+      });
+  response->setCode(code);
+  return response;
+}
+
+static void sendJson(AsyncWebServerRequest *request, int code, JsonDocument& doc) {
+  request->send(beginJsonResponse(request, code, doc));
+}
+
 void initWiFi() {
   Serial.println("Starting ESP32-S3 AC Controller...");
   Serial.printf("ESP32-S3 Chip: %d cores, %d MHz\n", ESP.getChipCores(), ESP.getCpuFreqMHz());
@@ -30,6 +110,20 @@ void initWiFi() {
     attempts++;
   }
   
+  // Credentials saved through /api/config that do not connect must not
+  // leave the device unreachable: fall back to the compiled-in network
+  if (WiFi.status() != WL_CONNECTED && (strcmp(ssid, defaultSsid) != 0 || strcmp(password, defaultPassword) != 0)) {
+    Serial.printf("\n⚠️ No connection to \"%s\", trying the default network\n", ssid);
+    WiFi.disconnect();
+    WiFi.begin(defaultSsid, defaultPassword);
+    attempts = 0;
+    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
+      delay(500);
+      Serial.print(".");
+      attempts++;
+    }
+  }
+  
   if (WiFi.status() == WL_CONNECTED) {
     Serial.println("");
     Serial.println("WiFi connected");
@@ -41,16 +135,301 @@ void initWiFi() {
   }
 }
 
+static String tempEventJson() {
+  JsonDocument doc;
+  doc["currentTemp"] = currentTemp;
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+// AC fields shared by /api/system, /api/snapshot and the "ac" event, so
+// pages can merge any of them into one object
+static void acStatusToJson(JsonDocument& doc, const ACState& state, IrTxSource source) {
+  doc["acOn"] = state.power();
+  doc["acTemp"] = state.temperature();
+  doc["acMode"] = state.mode();
+  doc["acFanSpeed"] = state.fanSpeed();
+  doc["acSource"] = source == IR_TX_MANUAL ? "manual" : "rule";
+}
+
+static String acEventJson(const ACState& state, IrTxSource source) {
+  JsonDocument doc;
+  acStatusToJson(doc, state, source);
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+// The AC state lock timed out (an IR request holds it). Nothing is built on
+// a guessed state, so the client is asked to retry.
+static void sendACStateBusy(AsyncWebServerRequest *request) {
+  JsonDocument doc;
+  doc["success"] = false;
+  doc["message"] = "AC state busy, try again";
+  doc["error"] = "AC_STATE_BUSY";
+  sendJson(request, 503, doc);
+}
+
+// Body of /api/rules/active
+static void activeRuleToJson(JsonDocument& doc) {
+  doc["activeRuleId"] = activeRuleId;
+  doc["currentTemp"] = currentTemp;
+  
+  time_t now = time(nullptr);
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+  doc["currentHour"] = timeinfo.tm_hour;
+  
+  if (activeRuleId != -1) {
+    // Find and return active rule details from the published snapshot
+    RuleSnapshotGuard snapshot(ruleStore);
+    for (const ACRule& r : snapshot->rules) {
+      if (r.id == activeRuleId) {
+        ruleToJson(r, *snapshot, doc["activeRule"].to<JsonObject>());
+        break;
+      }
+    }
+  }
+}
+
+static String ruleEventJson() {
+  JsonDocument doc;
+  activeRuleToJson(doc);
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+// False if the AC state lock timed out
+static bool readLiveStatus(LiveStatus& status) {
+  time_t now = time(nullptr);
+  ACState acState;
+  if (!getCurrentACState(acState, &status.acSource)) return false;
+  status.tempTenths = (int)lroundf(currentTemp * 10);
+  status.acBits = acState.bits;
+  status.ruleId = activeRuleId;
+  status.ruleVersion = ruleStore.getVersion();
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+  status.hour = timeinfo.tm_hour;
+  return true;
+}
+
+static bool sameRuleStatus(const LiveStatus& a, const LiveStatus& b) {
+  return a.ruleId == b.ruleId && a.ruleVersion == b.ruleVersion && a.hour == b.hour;
+}
+
+static bool sameLiveStatus(const LiveStatus& a, const LiveStatus& b) {
+  return a.tempTenths == b.tempTenths && a.acBits == b.acBits && a.acSource == b.acSource &&
+         sameRuleStatus(a, b);
+}
+
+// Version of `status`: the previous one while nothing changed, else the next.
+// Increases monotonically; 0 if the lock was not available.
+static uint32_t liveStatusVersion(const LiveStatus& status) {
+  uint32_t version = 0;
+  if (statusMutex != NULL && xSemaphoreTake(statusMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    if (statusVersion == 0 || !sameLiveStatus(status, versioned)) {
+      versioned = status;
+      statusVersion++;
+    }
+    version = statusVersion;
+    xSemaphoreGive(statusMutex);
+  }
+  return version;
+}
+
+static void sendEvent(const String& json, const char* name) {
+  events.send(json.c_str(), name, ++lastEventId);
+  webStats.eventsSent++;
+  webStats.eventBytes += json.length();
+}
+
+// New (or reconnecting) page: everything at once, whatever was sent before
+static void onEventClientConnect(AsyncEventSourceClient *client) {
+  if (eventsMutex == NULL || xSemaphoreTake(eventsMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    client->close();  // The browser reconnects and gets another try
+    return;
+  }
+  webStats.eventConnects++;
+  client->send(tempEventJson().c_str(), "temp", ++lastEventId, 3000);  // Retry after 3 s if dropped
+  ACState acState;
+  IrTxSource acSource;
+  if (getCurrentACState(acState, &acSource)) {
+    client->send(acEventJson(acState, acSource).c_str(), "ac", ++lastEventId);
+  } else {
+    eventsPublished = false;  // The next publish sends everything, AC state included
+  }
+  client->send(ruleEventJson().c_str(), "rule", ++lastEventId);
+  xSemaphoreGive(eventsMutex);
+}
+
+void publishStatusEvents() {
+  if (eventsMutex == NULL || xSemaphoreTake(eventsMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    return;  // Retried on the next sample
+  }
+  // Nobody listening; a page that connects later gets the full state on connect
+  LiveStatus status;
+  if (events.count() == 0 || !readLiveStatus(status)) {
+    xSemaphoreGive(eventsMutex);
+    return;
+  }
+  bool all = !eventsPublished;
+  
+  if (all || status.tempTenths != published.tempTenths) {
+    sendEvent(tempEventJson(), "temp");
+  }
+  if (all || status.acBits != published.acBits || status.acSource != published.acSource) {
+    ACState acState = {status.acBits};
+    sendEvent(acEventJson(acState, status.acSource), "ac");
+  }
+  if (all || !sameRuleStatus(status, published)) {
+    sendEvent(ruleEventJson(), "rule");
+  }
+  
+  published = status;
+  eventsPublished = true;
+  xSemaphoreGive(eventsMutex);
+}
+
+WebStats getWebStats() {
+  WebStats stats = webStats;
+  stats.eventClients = 0;
+  if (eventsMutex != NULL && xSemaphoreTake(eventsMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    stats.eventClients = events.count();
+    xSemaphoreGive(eventsMutex);
+  }
+  return stats;
+}
+
+// Conditional GET: answers 304 and returns true when the client's copy
+// (If-None-Match, see etagMatches()) is still `etag`
+static bool sendNotModified(AsyncWebServerRequest *request, const String& etag) {
+  AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+  if (ifNoneMatch == nullptr || !etagMatches(ifNoneMatch->value().c_str(), etag.c_str())) {
+    return false;
+  }
+  AsyncWebServerResponse *response = request->beginResponse(304);
+  response->addHeader("ETag", etag);
+  request->send(response);
+  webStats.notModified++;
+  return true;
+}
+
+// no-cache: browsers keep the body but revalidate it with the ETag every time
+static void sendJsonWithETag(AsyncWebServerRequest *request, JsonDocument& doc, const String& etag) {
+  AsyncWebServerResponse *response = beginJsonResponse(request, 200, doc);
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+// Temperature and AC state of the last 24 h, oldest first; ?since=<unix
+// time> leaves out older samples. The full list is ~84 KB of JSON, so it is
+// never built: each send buffer is filled with the next samples, read one at
+// a time under the history lock. A sample overwritten before its turn (a
+// client slower than a minute) is left out.
+void handleGetHistory(AsyncWebServerRequest *request) {
+  uint32_t since = 0;
+  if (request->hasParam("since")) {
+    since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+  }
+  uint32_t first, end;
+  getTempHistoryRange(first, end);
+
+  char prefix[48];
+  snprintf(prefix, sizeof(prefix), "{\"periodSec\":%d,\"samples\":[", TEMP_HISTORY_PERIOD_SEC);
+  std::shared_ptr<JsonListStream> stream = std::make_shared<JsonListStream>(prefix, "]}", first, end);
+  AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      [stream, since](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return stream->fill(buffer, maxLen, [since](uint32_t i, JsonListStream::ItemWriter& out) {
+          TempHistorySample sample;
+          if (!readTempHistory(i, sample) || sample.time < since) return;
+          char text[96];
+          out.write((const uint8_t*)text, tempHistorySampleJson(sample, text, sizeof(text)));
+        });
+      });
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+// Everything the pages show from /api/temp, /api/system and /api/rules/active
+// in one response, versioned by liveStatusVersion(). Memory and uptime are
+// left to /api/system: they change on every call and would defeat the ETag.
+void handleSnapshot(AsyncWebServerRequest *request) {
+  LiveStatus status;
+  if (!readLiveStatus(status)) {
+    sendACStateBusy(request);
+    return;
+  }
+  uint32_t version = liveStatusVersion(status);
+  String etag = "\"s" + String(version) + "\"";
+  if (version != 0 && sendNotModified(request, etag)) return;
+  
+  JsonDocument doc;
+  doc["version"] = version;
+  activeRuleToJson(doc);
+  ACState acState = {status.acBits};
+  acStatusToJson(doc, acState, status.acSource);
+  doc["rulesVersion"] = status.ruleVersion;
+  doc["protocol"] = ACProtocol::name();
+  
+  if (version == 0) {
+    sendJson(request, 200, doc);
+  } else {
+    sendJsonWithETag(request, doc, etag);
+  }
+}
+
+// Pages compiled into the firmware (web_assets.h), sent straight from flash.
+// Registered ahead of serveStatic(), which then only sees other paths.
+class EmbeddedAssetHandler : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest *request) override {
+        return request->method() == HTTP_GET && findWebAsset(request->url().c_str()) != nullptr;
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override {
+        const WebAsset* asset = findWebAsset(request->url().c_str());
+        String etag = String("\"") + asset->hash + "\"";
+        if (sendNotModified(request, etag)) return;
+        AsyncWebServerResponse *response = request->beginResponse_P(200, asset->mimeType, asset->data, asset->length);
+        response->addHeader("Content-Encoding", "gzip");
+        response->addHeader("ETag", etag);
+        // Same policy as the SPIFFS copies: hashed names never change meaning
+        response->addHeader("Cache-Control", request->url().startsWith("/assets/")
+                                                 ? "public, max-age=31536000, immutable" : "no-cache");
+        request->send(response);
+        webStats.flashAssets++;
+    }
+};
+static EmbeddedAssetHandler embeddedAssets;
+
 void setupWebServer() {
   // Note: SPIFFS is now initialized in main.cpp before this function is called
   
+  // Must come first to see every request
+  server.addHandler(&requestCounter);
+  
+  // Versioned live status (conditional GET) and its lock
+  statusMutex = xSemaphoreCreateMutex();
+  server.on("/api/snapshot", HTTP_GET, handleSnapshot);
+  server.on("/api/history", HTTP_GET, handleGetHistory);
+  
+  // Live status for the pages (Server-Sent Events), also sent by the sensor task
+  eventsMutex = xSemaphoreCreateMutex();
+  events.onConnect(onEventClientConnect);
+  server.addHandler(&events);
+  
   // REST API endpoints
   server.on("/api/ac/control", HTTP_POST, handleACControl);
   
   // System and configuration APIs
   server.on("/api/system", HTTP_GET, handleSystemInfo);
   
-  // Rule management APIs
+  // Rule management APIs (the batch path first: "/api/rules" also matches its subpaths)
+  server.on("/api/rules/batch", HTTP_PUT, handleRuleBatch, nullptr, handleRuleBatchBody);
   server.on("/api/rules", HTTP_GET, handleGetRules);
   server.on("/api/rules", HTTP_POST, handleCreateRule);
   server.on("/api/rules", HTTP_PUT, handleUpdateRule);
@@ -66,13 +445,15 @@ void setupWebServer() {
   server.on("/api/debug/mode", HTTP_GET, handleGetDebugMode);
   server.on("/api/debug/mode", HTTP_POST, handleSetDebugMode);
   
+  // Runtime settings, saved in NVS
+  server.on("/api/config", HTTP_GET, handleGetConfig);
+  server.on("/api/config", HTTP_PUT, handleSetConfig, nullptr, handleConfigBody);
+  
   server.on("/api/health", HTTP_GET, [](AsyncWebServerRequest *request) {
     JsonDocument doc;
     doc["status"] = "ok";
     doc["timestamp"] = millis();
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    sendJson(request, 200, doc);
   });
 
   // Simple temperature API
@@ -80,13 +461,22 @@ void setupWebServer() {
     JsonDocument doc;
     doc["temp"] = currentTemp;
     doc["timestamp"] = millis();
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    sendJson(request, 200, doc);
   });
 
-  // Serve static files from SPIFFS
-  server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+  // Builds with -DWEB_ASSETS_EMBEDDED carry the pages in flash and do not
+  // need SPIFFS to show them
+  if (getWebAssetCount() > 0) {
+    server.addHandler(&embeddedAssets);
+    Serial.printf("🌐 %d web assets served from flash\n", getWebAssetCount());
+  }
+  
+  // Serve static files from SPIFFS. tools/build_web_assets.py stores them
+  // minified as <name>.gz, which serveStatic() sends with Content-Encoding: gzip.
+  // Scripts carry a content hash in their name, so a name never changes meaning
+  server.serveStatic("/assets/", SPIFFS, "/assets/").setCacheControl("public, max-age=31536000, immutable");
+  // Pages keep their URLs and are checked again on every visit
+  server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html").setCacheControl("no-cache");
   
   // Handle 404 - Not Found
   server.onNotFound([](AsyncWebServerRequest *request) {
@@ -131,6 +521,19 @@ String getWebContent() {
   return html;
 }
 
+// Same layout as GreeACController::getStateString(), for a state that may still be queued
+static String acStateString(const ACState& state) {
+  static const char* swingNames[] = {"Auto", "Top", "Mid", "Bottom"};
+  String text = "AC State: ";
+  text += (state.power() ? "ON" : "OFF");
+  text += ", Temp: " + String(state.temperature()) + "°C";
+  text += ", Fan: " + String(state.fanSpeed());
+  text += ", Mode: " + String(state.mode());
+  text += ", SwingV: " + String(swingNames[state.vSwing() & 3]);
+  text += ", SwingH: " + String(swingNames[state.hSwing() & 3]);
+  return text;
+}
+
 void handleACControl(AsyncWebServerRequest *request) {
   JsonDocument doc;
   
@@ -138,99 +541,120 @@ void handleACControl(AsyncWebServerRequest *request) {
     doc["success"] = false;
     doc["message"] = "Missing action parameter";
     doc["error"] = "MISSING_PARAMETER";
-    String response;
-    serializeJson(doc, response);
-    request->send(400, "application/json", response);
+    sendJson(request, 400, doc);
     return;
   }
   
   String action = request->getParam("action", true)->value();
   bool success = false;
   
+  // Work from the state the AC is heading to (queued commands included) and
+  // hand the result to irTransmitTask - the AsyncTCP callback never waits on IR
+  ACState state;
+  if (!getCurrentACState(state)) {
+    sendACStateBusy(request);
+    return;
+  }
+  
   if (action == "power_on") {
-    greeAC.powerOn();
-    greeAC.sendCommand();
+    state.setPower(true);
     success = true;
     doc["message"] = "AC powered ON";
   } else if (action == "power_off") {
-    greeAC.powerOff();
-    greeAC.sendCommand();
+    state.setPower(false);
     success = true;
     doc["message"] = "AC powered OFF";
   } else if (action == "temp_up") {
-    uint8_t currentTemp = greeAC.getTemperature();
-    if (currentTemp < 30) {
-      greeAC.setTemperature(currentTemp + 1);
-      greeAC.sendCommand();
+    if (state.temperature() < 30) {
+      state.setTemperature(state.temperature() + 1);
       success = true;
-      doc["message"] = "Temperature increased to " + String(currentTemp + 1) + "°C";
+      doc["message"] = "Temperature increased to " + String(state.temperature()) + "°C";
     } else {
       doc["message"] = "Temperature already at maximum (30°C)";
     }
   } else if (action == "temp_down") {
-    uint8_t currentTemp = greeAC.getTemperature();
-    if (currentTemp > 16) {
-      greeAC.setTemperature(currentTemp - 1);
-      greeAC.sendCommand();
+    if (state.temperature() > 16) {
+      state.setTemperature(state.temperature() - 1);
       success = true;
-      doc["message"] = "Temperature decreased to " + String(currentTemp - 1) + "°C";
+      doc["message"] = "Temperature decreased to " + String(state.temperature()) + "°C";
     } else {
       doc["message"] = "Temperature already at minimum (16°C)";
     }
   } else if (action == "fan_cycle") {
-    uint8_t currentFan = greeAC.getFanSpeed();
-    uint8_t nextFan = (currentFan + 1) % 4; // 0=Auto, 1=Low, 2=Med, 3=High
-    greeAC.setFanSpeed(nextFan);
-    greeAC.sendCommand();
+    state.setFanSpeed((state.fanSpeed() + 1) % 4); // 0=Auto, 1=Low, 2=Med, 3=High
     success = true;
     String fanNames[] = {"Auto", "Low", "Medium", "High"};
-    doc["message"] = "Fan speed set to " + String(fanNames[nextFan]);
+    doc["message"] = "Fan speed set to " + String(fanNames[state.fanSpeed()]);
   } else if (action == "swing_toggle") {
-    bool currentSwing = greeAC.getSwingV();
-    greeAC.setSwingV(!currentSwing);
-    greeAC.sendCommand();
+    // Swing ON = auto sweep, OFF = fixed middle position
+    bool swingOn = state.vSwing() != AC_SWING_V_AUTO;
+    state.setVSwing(swingOn ? AC_SWING_V_AUTO : AC_SWING_V_MID);
     success = true;
-    doc["message"] = "Swing " + String(!currentSwing ? "ON" : "OFF");
+    doc["message"] = "Swing " + String(swingOn ? "ON" : "OFF");
   } else {
     doc["success"] = false;
     doc["message"] = "Unknown action: " + action;
     doc["error"] = "INVALID_ACTION";
-    String response;
-    serializeJson(doc, response);
-    request->send(400, "application/json", response);
+    sendJson(request, 400, doc);
     return;
   }
   
+  IrTxResult result = success ? queueACState(state, IR_TX_MANUAL) : IR_TX_FAILED;
+  if (success && result == IR_TX_FAILED) {
+    success = false;
+    doc["message"] = "IR transmitter not available";
+  }
+  
   doc["success"] = success;
+  doc["sent"] = result == IR_TX_QUEUED;  // false when the AC already had this state
   doc["action"] = action;
-  doc["acState"] = greeAC.getStateString();
+  doc["acState"] = acStateString(state);
+  doc["queueDepth"] = getIrTxStats().queueDepth;
   
-  String response;
-  serializeJson(doc, response);
-  request->send(success ? 200 : 400, "application/json", response);
+  sendJson(request, success ? 200 : 400, doc);
+}
+
+// /api/rules body without the closing activeRuleId, which changes without a
+// new snapshot and is appended per response
+static void serializeRuleList(const RuleSnapshot& snapshot, std::string& out) {
+  // One rule document at a time: the rebuild peaks at the text plus one rule,
+  // not a document of the whole list
+  JsonDocument doc;
+  out = "{\"rules\":[";
+  for (size_t i = 0; i < snapshot.rules.size(); i++) {
+    if (i > 0) out += ',';
+    doc.clear();
+    ruleToJson(snapshot.rules[i], snapshot, doc.to<JsonObject>());
+    serializeJson(doc, out);  // Appends
+  }
+  out += "],\"count\":" + std::to_string(snapshot.rules.size());
+  out += ",\"version\":" + std::to_string(snapshot.version);
 }
 
+static RuleSnapshotCache ruleListCache(serializeRuleList);
+
 void handleSystemInfo(AsyncWebServerRequest *request) {
   JsonDocument doc;
   
   // Current system status
   doc["currentTemp"] = currentTemp;
   
-  // AC Status
-  ACState currentACState = getCurrentACState();
-  doc["acOn"] = currentACState.power;
-  doc["acTemp"] = currentACState.temperature;
-  doc["acMode"] = currentACState.mode;
-  doc["acFanSpeed"] = currentACState.fanSpeed;
+  // AC Status, left out if the state is busy
+  ACState acState;
+  IrTxSource acSource;
+  if (getCurrentACState(acState, &acSource)) acStatusToJson(doc, acState, acSource);
   
   // Time info
   time_t now = time(nullptr);
-  struct tm* timeinfo = localtime(&now);
-  doc["currentHour"] = timeinfo->tm_hour;
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+  doc["currentHour"] = timeinfo.tm_hour;
   
   // System info
   JsonObject system = doc["system"].to<JsonObject>();
   system["freeHeap"] = ESP.getFreeHeap();
+  system["minFreeHeap"] = ESP.getMinFreeHeap();     // Low-water mark since boot
+  system["maxAllocHeap"] = ESP.getMaxAllocHeap();   // Largest free block (fragmentation)
   system["uptime"] = millis();
   system["activeTasks"] = uxTaskGetNumberOfTasks();
   system["chipCores"] = ESP.getChipCores();
@@ -238,109 +662,213 @@ void handleSystemInfo(AsyncWebServerRequest *request) {
   system["flashSize"] = ESP.getFlashChipSize();
   system["psramSize"] = ESP.getPsramSize();
   
+  // Control loop wake-ups (event-driven scheduling)
+  ControlWakeStats wakeStats = getControlWakeStats();
+  JsonObject control = doc["control"].to<JsonObject>();
+  control["samples"] = wakeStats.samples;
+  control["wakeups"] = wakeStats.wakeups;
+  control["timerWakes"] = wakeStats.timerWakes;
+  control["crossingWakes"] = wakeStats.crossingWakes;
+  control["ruleWakes"] = wakeStats.ruleWakes;
+  control["configWakes"] = wakeStats.configWakes;
+  
+  // Web load: polling shows up in requests, the event stream in eventsSent
+  WebStats web = getWebStats();
+  JsonObject webStatus = doc["web"].to<JsonObject>();
+  webStatus["requests"] = web.requests;
+  webStatus["notModified"] = web.notModified;
+  webStatus["largestJson"] = web.largestJson;
+  webStatus["flashAssets"] = web.flashAssets;
+  RuleSnapshotCacheStats listStats = ruleListCache.getStats();
+  JsonObject listCache = webStatus["rulesCache"].to<JsonObject>();
+  listCache["hits"] = listStats.hits;
+  listCache["misses"] = listStats.misses;
+  listCache["lastBuildUs"] = listStats.lastBuildMicros;
+  listCache["savedUs"] = listStats.savedMicros;
+  listCache["bytes"] = ruleListCache.getMemoryUsage();
+  webStatus["eventClients"] = web.eventClients;
+  webStatus["eventConnects"] = web.eventConnects;
+  webStatus["eventsSent"] = web.eventsSent;
+  webStatus["eventBytes"] = web.eventBytes;
+  
+  // Rule saves: flash bytes per edit, log vs full records
+  RulePersistStats persist = getRulePersistStats();
+  JsonObject storage = doc["storage"].to<JsonObject>();
+  storage["saveRequests"] = persist.requests;
+  storage["saves"] = persist.saves;
+  storage["logEntries"] = persist.logEntries;
+  storage["fullRecords"] = persist.fullRecords;
+  storage["bytesWritten"] = persist.bytesWritten;
+  storage["bytesPerEdit"] = persist.requests ? (uint32_t)(persist.bytesWritten / persist.requests) : 0;
+  storage["lastSaveBytes"] = persist.lastSaveBytes;
+  storage["lastSaveUs"] = persist.lastSaveMicros;
+  storage["maxSaveUs"] = persist.maxSaveMicros;
+  storage["logBytes"] = persist.logBytes;
+  storage["fullRecordBytes"] = persist.fullRecordBytes;
+  storage["usedBytes"] = SPIFFS.usedBytes();
+  storage["totalBytes"] = SPIFFS.totalBytes();
+  
   // IR status (Gree AC is always ready)
   JsonObject irStatus = doc["ir"].to<JsonObject>();
   irStatus["ready"] = true;  // Gree AC is always ready
+#ifdef AC_BACKEND_GREE
   irStatus["type"] = "Gree AC Library";  // No IR learning - uses built-in library
+#else
+  irStatus["type"] = "Built-in encoder";  // No IR learning - frames from ac_backend.h
+#endif
+  irStatus["protocol"] = ACProtocol::name();  // Backend this firmware was built for
   irStatus["receiver_required"] = false;  // No IR receiver needed
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  // IR transmit queue
+  IrTxStats txStats = getIrTxStats();
+  irStatus["queueDepth"] = txStats.queueDepth;
+  irStatus["maxQueueDepth"] = txStats.maxQueueDepth;
+  irStatus["commands"] = txStats.commands;
+  irStatus["frames"] = txStats.frames;
+  irStatus["dropped"] = txStats.dropped;
+  irStatus["coalesced"] = txStats.coalesced;
+  irStatus["framesSaved"] = txStats.framesSaved;
+  irStatus["coalesceWindowMs"] = IR_COALESCE_WINDOW_MS;
+  irStatus["unchanged"] = txStats.unchanged;
+  irStatus["suppressed"] = txStats.suppressed;
+  irStatus["lastLatencyMs"] = txStats.lastLatencyMs;
+  irStatus["maxLatencyMs"] = txStats.maxLatencyMs;
+  irStatus["avgLatencyMs"] = txStats.frames ? (uint32_t)(txStats.latencySumMs / txStats.frames) : 0;
+  irStatus["airtimeMs"] = (uint32_t)(txStats.airtimeUs / 1000);
+  irStatus["cachedFrames"] = txStats.cachedFrames;
+  irStatus["libraryFrames"] = txStats.libraryFrames;
+  irStatus["controllerEncodes"] = txStats.controllerEncodes;
+  irStatus["codecMismatches"] = txStats.codecMismatches;
+  JsonObject frameCacheStatus = irStatus["frameCache"].to<JsonObject>();
+  frameCacheStatus["entries"] = txStats.frameCacheEntries;
+  frameCacheStatus["bytes"] = txStats.frameCacheBytes;
+  frameCacheStatus["budgetBytes"] = IR_FRAME_CACHE_BYTES;
+  frameCacheStatus["hits"] = txStats.frameCache.hits;
+  frameCacheStatus["misses"] = txStats.frameCache.misses;
+  frameCacheStatus["evictions"] = txStats.frameCache.evictions;
+  
+  // Recent AC state changes, newest first (dirty = AC_DIRTY_* bits)
+  ACStateChange changes[AC_STATE_HISTORY_LENGTH];
+  int changeCount = getACStateHistory(changes, AC_STATE_HISTORY_LENGTH);
+  JsonArray history = doc["acHistory"].to<JsonArray>();
+  for (int i = 0; i < changeCount; i++) {
+    JsonObject change = history.add<JsonObject>();
+    change["ms"] = changes[i].ms;
+    change["source"] = changes[i].source == IR_TX_MANUAL ? "manual" : "rule";
+    change["dirty"] = changes[i].dirty;
+    change["state"] = acStateString(changes[i].state);
+  }
+  
+  sendJson(request, 200, doc);
 }
 
 // Rule management functions
 void handleGetRules(AsyncWebServerRequest *request) {
-  JsonDocument doc;
-  JsonArray rulesArray = doc["rules"].to<JsonArray>();
-  
-  for (int i = 0; i < ruleCount; i++) {
-    JsonObject rule = rulesArray.add<JsonObject>();
-    rule["id"] = rules[i].id;
-    rule["name"] = rules[i].name;
-    rule["enabled"] = rules[i].enabled;
-    rule["startHour"] = rules[i].startHour;
-    rule["endHour"] = rules[i].endHour;
-    rule["minTemp"] = rules[i].minTemp;
-    rule["maxTemp"] = rules[i].maxTemp;
-    rule["acOn"] = rules[i].acOn;
-    rule["setTemp"] = rules[i].setTemp;
-    rule["fanSpeed"] = rules[i].fanSpeed;
-    rule["mode"] = rules[i].mode;
-    rule["vSwing"] = rules[i].vSwing;
-    rule["hSwing"] = rules[i].hSwing;
-  }
-  
-  doc["count"] = ruleCount;
-  doc["activeRuleId"] = activeRuleId;
-  
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  // Read from the published snapshot - no lock and no torn reads while rules are edited
+  RuleSnapshotGuard snapshot(ruleStore);
+  
+  // The list changes with the snapshot version and the active rule it flags
+  int activeId = activeRuleId;
+  String etag = "\"r" + String(snapshot->version) + "-" + String(activeId) + "\"";
+  if (sendNotModified(request, etag)) return;
+  
+  // Serialized once per rule change; only the active rule ID is per response
+  RuleSnapshotCache::Text text = ruleListCache.get(*snapshot);
+  std::string tail = ",\"activeRuleId\":" + std::to_string(activeId) + "}";
+  
+  AsyncWebServerResponse *response = request->beginResponse("application/json", text->size() + tail.size(),
+      [text, tail](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t written = 0;
+        if (index < text->size()) {
+          written = std::min(maxLen, text->size() - index);
+          memcpy(buffer, text->data() + index, written);
+        }
+        size_t tailIndex = index + written - text->size();
+        if (written < maxLen && tailIndex < tail.size()) {
+          size_t count = std::min(maxLen - written, tail.size() - tailIndex);
+          memcpy(buffer + written, tail.data() + tailIndex, count);
+          written += count;
+        }
+        return written;
+      });
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
 }
 
 void handleCreateRule(AsyncWebServerRequest *request) {
   JsonDocument doc;
   
-  if (ruleCount >= MAX_RULES) {
-    doc["success"] = false;
-    doc["message"] = "Maximum number of rules reached";
-    String response;
-    serializeJson(doc, response);
-    request->send(400, "application/json", response);
-    return;
-  }
-  
   // Acquire mutex for thread-safe rule modification
   if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    // Get next available ID
-    int newId = 1;
-    for (int i = 0; i < ruleCount; i++) {
-      if (rules[i].id >= newId) {
-        newId = rules[i].id + 1;
-      }
+    uint16_t newId = ruleSet.nextId();
+    if (ruleSet.size() >= MAX_RULES || newId == 0) {
+      xSemaphoreGive(rulesMutex);
+      doc["success"] = false;
+      doc["message"] = "Maximum number of rules reached";
+      sendJson(request, 400, doc);
+      return;
     }
     
-    // Add new rule with default values
-    rules[ruleCount] = {
+    // Add new rule with default values, evaluated after all existing rules
+    ruleSet.insert({
       .id = newId,
-      .name = "New Rule",
-      .enabled = true,
-      .startHour = -1,
-      .endHour = -1,
-      .minTemp = -999,
-      .maxTemp = -999,
-      .acOn = true,
-      .setTemp = 25.0,
-      .fanSpeed = 2,
-      .mode = 0,
-      .vSwing = 0,  // Auto vertical swing
-      .hSwing = 0   // Auto horizontal swing
-    };
-    
-    ruleCount++;
+      .nameId = ruleNames.intern("New Rule"),
+      .priority = ruleSet.nextPriority(),
+      .flags = RULE_FLAG_ENABLED | RULE_FLAG_AC_ON,
+      .present = 0,  // Any time, any temperature
+      .startMinute = 0,
+      .endMinute = 0,
+      .weekdays = RULE_ALL_WEEKDAYS,
+      .minTemp = 0,
+      .maxTemp = 0,
+      .setTemp = 2500,
+      .mode = AC_MODE_COOL,
+      .fanSpeed = AC_FAN_MED,
+      .vSwing = AC_SWING_V_AUTO,  // Auto vertical swing
+      .hSwing = AC_SWING_H_AUTO   // Auto horizontal swing
+    });
     
-    // Release mutex before file I/O
+    // Release mutex before publishing
     xSemaphoreGive(rulesMutex);
     
-    // Save rules to persistent storage
-    saveRulesToSPIFFS();
+    // Publish now, save in the background
+    scheduleRulesSave();
     
     // Create response with new rule ID
     doc["success"] = true;
     doc["message"] = "Rule created successfully";
     doc["ruleId"] = newId;
     
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    sendJson(request, 200, doc);
   } else {
     // Failed to acquire mutex
     doc["success"] = false;
     doc["message"] = "Failed to acquire rule lock";
-    String response;
-    serializeJson(doc, response);
-    request->send(500, "application/json", response);
+    sendJson(request, 500, doc);
+  }
+}
+
+// Numeric form fields as JSON for checkRuleFields(): an integer or a number
+// where the text is one, the text itself (failing the type check) otherwise
+static void ruleFormToJson(AsyncWebServerRequest *request, JsonObject out) {
+  static const char* const numeric[] = {"priority", "startMinute", "endMinute", "startHour", "endHour", "weekdays",
+                                        "minTemp", "maxTemp", "setTemp", "fanSpeed", "mode", "vSwing", "hSwing"};
+  for (const char* key : numeric) {
+    if (!request->hasParam(key, true)) continue;
+    const char* text = request->getParam(key, true)->value().c_str();
+    char* end;
+    long integer = strtol(text, &end, 10);
+    if (end != text && *end == '\0') {
+      out[key] = integer;
+      continue;
+    }
+    double number = strtod(text, &end);
+    if (end != text && *end == '\0') {
+      out[key] = number;
+    } else {
+      out[key] = text;
+    }
   }
 }
 
@@ -350,79 +878,116 @@ void handleUpdateRule(AsyncWebServerRequest *request) {
   if (!request->hasParam("id", true)) {
     doc["success"] = false;
     doc["message"] = "Rule ID required";
-    String response;
-    serializeJson(doc, response);
-    request->send(400, "application/json", response);
+    sendJson(request, 400, doc);
     return;
   }
   
   int ruleId = request->getParam("id", true)->value().toInt();
-  int ruleIndex = -1;
   
-  // Find rule by ID
-  for (int i = 0; i < ruleCount; i++) {
-    if (rules[i].id == ruleId) {
-      ruleIndex = i;
-      break;
+  // Same type and range checks as a batch edit, so a typo such as
+  // setTemp=2600 is refused instead of stored
+  {
+    JsonDocument fields;
+    ruleFormToJson(request, fields.to<JsonObject>());
+    char error[80];
+    if (!checkRuleFields(fields.as<JsonObjectConst>(), error, sizeof(error))) {
+      doc["success"] = false;
+      doc["message"] = error;
+      sendJson(request, 400, doc);
+      return;
     }
   }
+
+  // Parse date exceptions before locking so a bad list changes nothing
+  bool hasExceptions = request->hasParam("exceptions", true);
+  std::vector<RuleDateException> exceptions;
+  if (hasExceptions && !exceptionsFromText(request->getParam("exceptions", true)->value().c_str(), exceptions)) {
+    doc["success"] = false;
+    doc["message"] = "Invalid exception dates (use YYYY-MM-DD or YYYY-MM-DD..YYYY-MM-DD)";
+    sendJson(request, 400, doc);
+    return;
+  }
+  
+  // Acquire mutex for thread-safe rule modification
+  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    doc["success"] = false;
+    doc["message"] = "Failed to acquire rule lock";
+    sendJson(request, 500, doc);
+    return;
+  }
+  
+  // Find rule by ID
+  ACRule* rule = (ruleId > 0 && ruleId <= UINT16_MAX) ? ruleSet.find((uint16_t)ruleId) : nullptr;
   
-  if (ruleIndex == -1) {
+  if (rule == nullptr) {
+    xSemaphoreGive(rulesMutex);
     doc["success"] = false;
     doc["message"] = "Rule not found";
-    String response;
-    serializeJson(doc, response);
-    request->send(404, "application/json", response);
+    sendJson(request, 404, doc);
     return;
   }
   
   // Update rule parameters
   if (request->hasParam("name", true)) {
-    rules[ruleIndex].name = request->getParam("name", true)->value();
+    rule->nameId = ruleNames.intern(request->getParam("name", true)->value().c_str());
+  }
+  if (request->hasParam("priority", true)) {
+    ruleSet.setPriority(rule->id, rulePriorityFromInt(request->getParam("priority", true)->value().toInt()));
   }
   if (request->hasParam("enabled", true)) {
-    rules[ruleIndex].enabled = request->getParam("enabled", true)->value() == "true";
+    ruleSetFlag(*rule, RULE_FLAG_ENABLED, request->getParam("enabled", true)->value() == "true");
+  }
+  if (request->hasParam("startMinute", true)) {
+    ruleSetStartMinute(*rule, request->getParam("startMinute", true)->value().toInt());
+  } else if (request->hasParam("startHour", true)) {
+    ruleSetStartHour(*rule, request->getParam("startHour", true)->value().toInt());
+  }
+  if (request->hasParam("endMinute", true)) {
+    ruleSetEndMinute(*rule, request->getParam("endMinute", true)->value().toInt());
+  } else if (request->hasParam("endHour", true)) {
+    ruleSetEndHour(*rule, request->getParam("endHour", true)->value().toInt());
   }
-  if (request->hasParam("startHour", true)) {
-    rules[ruleIndex].startHour = request->getParam("startHour", true)->value().toInt();
+  if (request->hasParam("weekdays", true)) {
+    ruleSetWeekdays(*rule, request->getParam("weekdays", true)->value().toInt());
   }
-  if (request->hasParam("endHour", true)) {
-    rules[ruleIndex].endHour = request->getParam("endHour", true)->value().toInt();
+  if (hasExceptions) {
+    ruleSet.setExceptions(rule->id, exceptions.data(), (int)exceptions.size());
   }
   if (request->hasParam("minTemp", true)) {
-    rules[ruleIndex].minTemp = request->getParam("minTemp", true)->value().toFloat();
+    ruleSetMinTemp(*rule, request->getParam("minTemp", true)->value().toFloat());
   }
   if (request->hasParam("maxTemp", true)) {
-    rules[ruleIndex].maxTemp = request->getParam("maxTemp", true)->value().toFloat();
+    ruleSetMaxTemp(*rule, request->getParam("maxTemp", true)->value().toFloat());
   }
   if (request->hasParam("acOn", true)) {
-    rules[ruleIndex].acOn = request->getParam("acOn", true)->value() == "true";
+    ruleSetFlag(*rule, RULE_FLAG_AC_ON, request->getParam("acOn", true)->value() == "true");
   }
   if (request->hasParam("setTemp", true)) {
-    rules[ruleIndex].setTemp = request->getParam("setTemp", true)->value().toFloat();
+    rule->setTemp = tempToCenti(request->getParam("setTemp", true)->value().toFloat());
   }
   if (request->hasParam("fanSpeed", true)) {
-    rules[ruleIndex].fanSpeed = request->getParam("fanSpeed", true)->value().toInt();
+    rule->fanSpeed = acFanSpeedFromInt(request->getParam("fanSpeed", true)->value().toInt());
   }
   if (request->hasParam("mode", true)) {
-    rules[ruleIndex].mode = request->getParam("mode", true)->value().toInt();
+    rule->mode = acModeFromInt(request->getParam("mode", true)->value().toInt());
   }
   if (request->hasParam("vSwing", true)) {
-    rules[ruleIndex].vSwing = request->getParam("vSwing", true)->value().toInt();
+    rule->vSwing = acSwingVFromInt(request->getParam("vSwing", true)->value().toInt());
   }
   if (request->hasParam("hSwing", true)) {
-    rules[ruleIndex].hSwing = request->getParam("hSwing", true)->value().toInt();
+    rule->hSwing = acSwingHFromInt(request->getParam("hSwing", true)->value().toInt());
   }
   
-  // Save rules to persistent storage
-  saveRulesToSPIFFS();
+  // Release mutex before publishing
+  xSemaphoreGive(rulesMutex);
+  
+  // Publish the new snapshot now, save in the background
+  scheduleRulesSave();
   
   doc["success"] = true;
   doc["message"] = "Rule updated successfully";
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  sendJson(request, 200, doc);
 }
 
 void handleDeleteRule(AsyncWebServerRequest *request) {
@@ -431,80 +996,173 @@ void handleDeleteRule(AsyncWebServerRequest *request) {
   if (!request->hasParam("id", true)) {
     doc["success"] = false;
     doc["message"] = "Rule ID required";
-    String response;
-    serializeJson(doc, response);
-    request->send(400, "application/json", response);
+    sendJson(request, 400, doc);
     return;
   }
   
   int ruleId = request->getParam("id", true)->value().toInt();
-  int ruleIndex = -1;
   
-  // Find rule by ID
-  for (int i = 0; i < ruleCount; i++) {
-    if (rules[i].id == ruleId) {
-      ruleIndex = i;
-      break;
-    }
+  // Acquire mutex for thread-safe rule modification
+  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    doc["success"] = false;
+    doc["message"] = "Failed to acquire rule lock";
+    sendJson(request, 500, doc);
+    return;
   }
   
-  if (ruleIndex == -1) {
+  // Remove rule by ID (evaluation order comes from priorities, not positions)
+  bool removed = ruleId > 0 && ruleId <= UINT16_MAX && ruleSet.remove((uint16_t)ruleId);
+  
+  if (!removed) {
+    xSemaphoreGive(rulesMutex);
     doc["success"] = false;
     doc["message"] = "Rule not found";
-    String response;
-    serializeJson(doc, response);
-    request->send(404, "application/json", response);
+    sendJson(request, 404, doc);
     return;
   }
   
-  // Shift remaining rules
-  for (int i = ruleIndex; i < ruleCount - 1; i++) {
-    rules[i] = rules[i + 1];
-  }
-  ruleCount--;
+  // Release mutex before publishing
+  xSemaphoreGive(rulesMutex);
   
-  // Save rules to persistent storage
-  saveRulesToSPIFFS();
+  // Publish the new snapshot now, save in the background
+  scheduleRulesSave();
   
   doc["success"] = true;
   doc["message"] = "Rule deleted successfully";
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  sendJson(request, 200, doc);
 }
 
-void handleGetActiveRule(AsyncWebServerRequest *request) {
+// Collect a JSON request body of at most `maxBody` bytes. AsyncWebServer
+// releases _tempObject with free() when the request ends, so it is malloc()ed.
+static void collectBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total,
+                        size_t maxBody) {
+  if (index == 0) {
+    if (total > maxBody) return;  // The request handler answers 413
+    request->_tempObject = malloc(total);
+  }
+  if (request->_tempObject != nullptr && index + len <= total) {
+    memcpy((uint8_t*)request->_tempObject + index, data, len);
+  }
+}
+
+// Body of a PUT /api/rules/batch in progress: the stream edits copies of
+// the rules, which replace them only if no other edit was published since
+struct RuleBatchUpload {
+  RuleSet rules;
+  RuleNamePool names;
+  uint32_t baseVersion;     // ruleStore version the copies were taken at
+  RuleBatchStream stream;
+  uint32_t applyMicros;
+
+  RuleBatchUpload() : stream(rules, names, MAX_RULES), applyMicros(0) {}
+};
+
+// _tempObject is free()d by the server, so the upload is deleted here, on
+// every way a request ends
+static void endRuleBatchUpload(AsyncWebServerRequest *request) {
+  delete (RuleBatchUpload*)request->_tempObject;
+  request->_tempObject = nullptr;
+}
+
+void handleRuleBatchBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  if (index == 0) {
+    if (total > RULE_BATCH_MAX_BODY || request->_tempObject != nullptr) return;  // The handler answers 413
+    if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) != pdTRUE) return;       // and 500
+    RuleBatchUpload* upload = new RuleBatchUpload();
+    upload->rules = ruleSet;
+    upload->names = ruleNames;
+    upload->baseVersion = ruleStore.getVersion();
+    xSemaphoreGive(rulesMutex);
+    request->_tempObject = upload;
+    request->onDisconnect([request]() { endRuleBatchUpload(request); });
+  }
+  RuleBatchUpload* upload = (RuleBatchUpload*)request->_tempObject;
+  if (upload == nullptr) return;
+  uint32_t start = micros();
+  upload->stream.feed((const char*)data, len);
+  upload->applyMicros += micros() - start;
+}
+
+// Apply a whole rule set or a list of create/update/delete operations
+// (see applyRuleBatch()) all or nothing, then save once
+void handleRuleBatch(AsyncWebServerRequest *request) {
   JsonDocument doc;
+  RuleBatchUpload* upload = (RuleBatchUpload*)request->_tempObject;
   
-  doc["activeRuleId"] = activeRuleId;
-  doc["currentTemp"] = currentTemp;
+  if (upload == nullptr) {
+    bool tooLarge = request->contentLength() > RULE_BATCH_MAX_BODY;
+    bool empty = request->contentLength() == 0;
+    doc["success"] = false;
+    doc["message"] = tooLarge ? "Batch too large" : empty ? "JSON body required" : "Failed to acquire rule lock";
+    sendJson(request, tooLarge ? 413 : empty ? 400 : 500, doc);
+    return;
+  }
   
-  time_t now = time(nullptr);
-  struct tm* timeinfo = localtime(&now);
-  doc["currentHour"] = timeinfo->tm_hour;
+  bool applied = upload->stream.finish();
+  RuleBatchResult result = upload->stream.getResult();
+  uint32_t applyMicros = upload->applyMicros;
+  if (!applied) {
+    endRuleBatchUpload(request);
+    doc["success"] = false;
+    doc["message"] = result.error;
+    doc["failedOp"] = result.failedOp;
+    sendJson(request, 400, doc);
+    return;
+  }
   
-  if (activeRuleId != -1) {
-    // Find and return active rule details
-    for (int i = 0; i < ruleCount; i++) {
-      if (rules[i].id == activeRuleId) {
-        JsonObject activeRule = doc["activeRule"].to<JsonObject>();
-        activeRule["id"] = rules[i].id;
-        activeRule["name"] = rules[i].name;
-        activeRule["acOn"] = rules[i].acOn;
-        activeRule["setTemp"] = rules[i].setTemp;
-        activeRule["fanSpeed"] = rules[i].fanSpeed;
-        activeRule["mode"] = rules[i].mode;
-        activeRule["vSwing"] = rules[i].vSwing;
-        activeRule["hSwing"] = rules[i].hSwing;
-        break;
-      }
-    }
+  // Acquire mutex for thread-safe rule modification
+  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    endRuleBatchUpload(request);
+    doc["success"] = false;
+    doc["message"] = "Failed to acquire rule lock";
+    sendJson(request, 500, doc);
+    return;
+  }
+  
+  // Edits published while the body arrived are not in the copies
+  bool conflict = ruleStore.getVersion() != upload->baseVersion;
+  if (!conflict) {
+    ruleSet = std::move(upload->rules);
+    ruleNames = std::move(upload->names);
   }
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  // Release mutex before file I/O
+  xSemaphoreGive(rulesMutex);
+  endRuleBatchUpload(request);
+  
+  if (conflict) {
+    doc["success"] = false;
+    doc["message"] = "Rules changed while the batch was uploading, nothing applied";
+    sendJson(request, 409, doc);
+    return;
+  }
+  
+  // One snapshot publish and one save for the whole batch
+  uint32_t start = micros();
+  scheduleRulesSave();
+  uint32_t publishMicros = micros() - start;
+  Serial.printf("📦 Rule batch: %d created, %d updated, %d deleted in %lu us, published in %lu us\n",
+                result.created, result.updated, result.deleted,
+                (unsigned long)applyMicros, (unsigned long)publishMicros);
+  
+  doc["success"] = true;
+  doc["message"] = "Rule batch applied";
+  doc["created"] = result.created;
+  doc["updated"] = result.updated;
+  doc["deleted"] = result.deleted;
+  doc["ruleCount"] = ruleSet.size();
+  doc["applyMicros"] = applyMicros;
+  doc["publishMicros"] = publishMicros;
+  
+  sendJson(request, 200, doc);
+}
+
+void handleGetActiveRule(AsyncWebServerRequest *request) {
+  JsonDocument doc;
+  activeRuleToJson(doc);
+  
+  sendJson(request, 200, doc);
 }
 
 // Rule persistence management functions
@@ -515,12 +1173,10 @@ void handleSaveRules(AsyncWebServerRequest *request) {
   
   doc["success"] = true;
   doc["message"] = "Rules saved to persistent storage";
-  doc["ruleCount"] = ruleCount;
+  doc["ruleCount"] = ruleSet.size();
   doc["timestamp"] = millis();
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  sendJson(request, 200, doc);
 }
 
 void handleLoadRules(AsyncWebServerRequest *request) {
@@ -530,12 +1186,10 @@ void handleLoadRules(AsyncWebServerRequest *request) {
   
   doc["success"] = true;
   doc["message"] = "Rules loaded from persistent storage";
-  doc["ruleCount"] = ruleCount;
+  doc["ruleCount"] = ruleSet.size();
   doc["timestamp"] = millis();
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  sendJson(request, 200, doc);
 }
 
 void handleResetRules(AsyncWebServerRequest *request) {
@@ -547,24 +1201,27 @@ void handleResetRules(AsyncWebServerRequest *request) {
     doc["success"] = false;
     doc["message"] = "Reset confirmation required. Send 'confirm=RESET_TO_DEFAULTS'";
     doc["error"] = "MISSING_CONFIRMATION";
-    String response;
-    serializeJson(doc, response);
-    request->send(400, "application/json", response);
+    sendJson(request, 400, doc);
     return;
   }
   
-  // Reset to default rules
+  // Reset to default rules (the hash index must not be rebuilt under a concurrent edit)
+  if (xSemaphoreTake(rulesMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    doc["success"] = false;
+    doc["message"] = "Failed to acquire rule lock";
+    sendJson(request, 500, doc);
+    return;
+  }
   initDefaultRules();
+  xSemaphoreGive(rulesMutex);
   saveRulesToSPIFFS();
   
   doc["success"] = true;
   doc["message"] = "Rules reset to defaults and saved";
-  doc["ruleCount"] = ruleCount;
+  doc["ruleCount"] = ruleSet.size();
   doc["timestamp"] = millis();
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  sendJson(request, 200, doc);
 }
 
 // Debug mode management functions
@@ -575,9 +1232,7 @@ void handleGetDebugMode(AsyncWebServerRequest *request) {
   doc["description"] = debugMode ? "Debug mode: Force send IR commands" : "Normal mode: Send IR only when state changes";
   doc["timestamp"] = millis();
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  sendJson(request, 200, doc);
 }
 
 void handleSetDebugMode(AsyncWebServerRequest *request) {
@@ -586,24 +1241,89 @@ void handleSetDebugMode(AsyncWebServerRequest *request) {
   if (!request->hasParam("enabled", true)) {
     doc["success"] = false;
     doc["message"] = "Missing enabled parameter";
-    String response;
-    serializeJson(doc, response);
-    request->send(400, "application/json", response);
+    sendJson(request, 400, doc);
     return;
   }
   
-  bool newDebugMode = request->getParam("enabled", true)->value() == "true";
-  debugMode = newDebugMode;
+  // Saved like any other setting, so it survives a reboot
+  JsonDocument setting;
+  setting["debugMode"] = request->getParam("enabled", true)->value() == "true";
+  ConfigApplyResult result;
+  bool saved;
+  if (!updateConfig(setting.as<JsonObjectConst>(), result, saved)) {
+    doc["success"] = false;
+    doc["message"] = result.error;
+    sendJson(request, 500, doc);
+    return;
+  }
   
   doc["success"] = true;
+  doc["saved"] = saved;
   doc["debugMode"] = debugMode;
   doc["message"] = debugMode ? "Debug mode enabled - IR commands will be sent every time" : "Debug mode disabled - IR commands only sent when state changes";
   doc["timestamp"] = millis();
   
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  sendJson(request, 200, doc);
   
   // Log the debug mode change
   Serial.printf("🔧 Debug mode %s\n", debugMode ? "ENABLED" : "DISABLED");
 }
+
+void handleGetConfig(AsyncWebServerRequest *request) {
+  JsonDocument doc;
+  configToJson(doc);
+  sendJson(request, 200, doc);
+}
+
+void handleConfigBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  collectBody(request, data, len, index, total, CONFIG_MAX_BODY);
+}
+
+// Change any subset of the settings: {"displayPeriodMs": 10000, ...}. All
+// fields are checked first; one bad field rejects the whole request.
+void handleSetConfig(AsyncWebServerRequest *request) {
+  JsonDocument doc;
+  
+  if (request->_tempObject == nullptr) {
+    bool tooLarge = request->contentLength() > CONFIG_MAX_BODY;
+    doc["success"] = false;
+    doc["message"] = tooLarge ? "Settings too large" : "JSON body required";
+    sendJson(request, tooLarge ? 413 : 400, doc);
+    return;
+  }
+  
+  JsonDocument body;
+  DeserializationError error = deserializeJson(body, (const char*)request->_tempObject, request->contentLength());
+  free(request->_tempObject);
+  request->_tempObject = nullptr;
+  if (error) {
+    doc["success"] = false;
+    doc["message"] = String("Invalid JSON: ") + error.c_str();
+    sendJson(request, 400, doc);
+    return;
+  }
+  
+  ConfigApplyResult result;
+  bool saved;
+  if (!updateConfig(body.as<JsonObjectConst>(), result, saved)) {
+    doc["success"] = false;
+    doc["message"] = result.error;
+    sendJson(request, 400, doc);
+    return;
+  }
+  
+  doc["success"] = true;
+  doc["message"] = result.changed ? "Settings updated" : "Settings unchanged";
+  doc["saved"] = saved;   // false: live now, but lost at the next reboot
+  JsonArray changed = doc["changed"].to<JsonArray>();
+  bool restartRequired = false;
+  for (int i = 0; i < CONFIG_COUNT; i++) {
+    if (!(result.changed & CONFIG_BIT(i))) continue;
+    changed.add(configSetting((ConfigId)i).name);
+    if (configSetting((ConfigId)i).flags & CONFIG_REBOOT) restartRequired = true;
+  }
+  doc["restartRequired"] = restartRequired;
+  configToJson(doc);
+  
+  sendJson(request, 200, doc);
+}
@@ -0,0 +1,72 @@
+#ifndef HEAP_ACCOUNTING_H
+#define HEAP_ACCOUNTING_H
+
+// Heap accounting for benchmarks: every operator new and every ArduinoJson
+// allocation of a document built with &jsonAllocator goes through
+// heapAlloc(), which keeps the bytes in use and their high-water mark.
+// Replaces the global operator new, so include it from one suite file only.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <ArduinoJson.h>
+
+static size_t heapInUse = 0;
+static size_t heapPeak = 0;
+
+static void* heapAlloc(size_t size) {
+    size_t* block = (size_t*)malloc(size + sizeof(max_align_t));
+    if (block == nullptr) return nullptr;
+    *block = size;
+    heapInUse += size;
+    if (heapInUse > heapPeak) heapPeak = heapInUse;
+    return (char*)block + sizeof(max_align_t);
+}
+
+static void heapFree(void* ptr) {
+    if (ptr == nullptr) return;
+    size_t* block = (size_t*)((uintptr_t)ptr - sizeof(max_align_t));
+    heapInUse -= *block;
+    free(block);
+}
+
+// Start a measurement: the peak from here on, relative to what is in use now
+static inline size_t heapMark() {
+    heapPeak = heapInUse;
+    return heapInUse;
+}
+
+void* operator new(size_t size) {
+    void* ptr = heapAlloc(size);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void* ptr) noexcept {
+    heapFree(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    heapFree(ptr);
+}
+
+struct CountingAllocator : ArduinoJson::Allocator {
+    void* allocate(size_t size) override {
+        return heapAlloc(size);
+    }
+    void deallocate(void* ptr) override {
+        heapFree(ptr);
+    }
+    void* reallocate(void* ptr, size_t size) override {
+        void* moved = heapAlloc(size);
+        if (moved != nullptr && ptr != nullptr) {
+            size_t old = *(size_t*)((uintptr_t)ptr - sizeof(max_align_t));
+            memcpy(moved, ptr, old < size ? old : size);
+            heapFree(ptr);
+        }
+        return moved;
+    }
+};
+
+static CountingAllocator jsonAllocator;
+
+#endif
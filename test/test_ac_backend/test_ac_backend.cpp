@@ -0,0 +1,267 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ac_backend.h"
+#include "ac_frame_cache.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+// Conformance suite: every test below is a template over the backend and
+// runs once per protocol in main(). A new backend passes these before it
+// can be selected in platformio.ini.
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Every state in the backend's temperature range survives bytes -> waveform
+// -> bytes, and decoding to an ACState re-encodes to the same frame
+template <typename Backend>
+void test_round_trip() {
+    int frames = 0;
+    for (int power = 0; power < 2; power++) {
+        for (int temp = Backend::MIN_TEMP; temp <= Backend::MAX_TEMP; temp++) {
+            for (int fan = AC_FAN_AUTO; fan <= AC_FAN_HIGH; fan++) {
+                for (int mode = AC_MODE_COOL; mode <= AC_MODE_AUTO; mode++) {
+                    for (int swing = 0; swing < 4; swing++) {
+                        ACState state = makeACState(power, (uint8_t)temp, (uint8_t)fan, (uint8_t)mode, swing, 3 - swing);
+                        ACFrame<Backend> frame;
+                        uint8_t decoded[Backend::STATE_LENGTH], again[Backend::STATE_LENGTH];
+                        Backend::encodeState(state, frame.state);
+                        TEST_ASSERT_TRUE(Backend::checksumValid(frame.state));
+                        TEST_ASSERT_EQUAL(Backend::FRAME_TIMINGS, Backend::encodeTimings(frame.state, frame.timings));
+                        TEST_ASSERT_TRUE(Backend::decodeTimings(frame.timings, Backend::FRAME_TIMINGS, decoded));
+                        TEST_ASSERT_EQUAL_HEX8_ARRAY(frame.state, decoded, Backend::STATE_LENGTH);
+
+                        ACState decodedState;
+                        Backend::decodeState(decoded, decodedState);
+                        Backend::encodeState(decodedState, again);
+                        TEST_ASSERT_EQUAL_HEX8_ARRAY(frame.state, again, Backend::STATE_LENGTH);
+                        ACState normal = Backend::normalize(state);
+                        TEST_ASSERT_EQUAL_HEX32(normal.bits, Backend::normalize(normal).bits);
+                        frames++;
+                    }
+                }
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(2 * (Backend::MAX_TEMP - Backend::MIN_TEMP + 1) * 4 * 5 * 4, frames);
+}
+
+// The fields every protocol carries come back as they went in: power, mode,
+// and in COOL/HEAT temperature, fan and auto swing. Temperatures clamp.
+template <typename Backend>
+void test_field_mapping() {
+    for (int mode = AC_MODE_COOL; mode <= AC_MODE_AUTO; mode++) {
+        ACState on = Backend::normalize(makeACState(true, 24, AC_FAN_AUTO, (uint8_t)mode, AC_SWING_V_AUTO, AC_SWING_H_AUTO));
+        TEST_ASSERT_TRUE(on.power());
+        TEST_ASSERT_EQUAL(mode, on.mode());
+    }
+    const uint8_t modes[] = {AC_MODE_COOL, AC_MODE_HEAT};
+    for (uint8_t mode : modes) {
+        for (int temp = Backend::MIN_TEMP; temp <= Backend::MAX_TEMP; temp++) {
+            for (int fan = AC_FAN_AUTO; fan <= AC_FAN_HIGH; fan++) {
+                ACState state = makeACState(true, (uint8_t)temp, (uint8_t)fan, mode, AC_SWING_V_AUTO, AC_SWING_H_AUTO);
+                TEST_ASSERT_EQUAL_HEX32(state.bits, Backend::normalize(state).bits);
+            }
+        }
+    }
+
+    ACState off = Backend::normalize(AC_STATE_OFF);
+    TEST_ASSERT_FALSE(off.power());
+    ACState cold = Backend::normalize(makeACState(true, Backend::MIN_TEMP - 1, AC_FAN_LOW, AC_MODE_COOL, 0, 0));
+    ACState hot = Backend::normalize(makeACState(true, Backend::MAX_TEMP + 1, AC_FAN_LOW, AC_MODE_COOL, 0, 0));
+    TEST_ASSERT_EQUAL(Backend::MIN_TEMP, cold.temperature());
+    TEST_ASSERT_EQUAL(Backend::MAX_TEMP, hot.temperature());
+    TEST_ASSERT_TRUE(Backend::supportsTemperature(24));
+    TEST_ASSERT_FALSE(Backend::supportsTemperature(Backend::MAX_TEMP + 1));
+}
+
+// Receiver-style capture: marks stretched, spaces shortened, jitter and no
+// final gap. Noise and bad checksums are rejected.
+template <typename Backend>
+void test_decode_capture() {
+    ACState state = makeACState(true, 26, AC_FAN_MED, AC_MODE_HEAT, AC_SWING_V_AUTO, AC_SWING_H_AUTO);
+    ACFrame<Backend> frame;
+    Backend::encodeFrame(state, frame);
+    for (int i = 0; i < Backend::FRAME_TIMINGS; i++) {
+        int jitter = (i * 37) % 61 - 30;
+        frame.timings[i] = (uint16_t)(frame.timings[i] + (i % 2 == 0 ? 60 : -70) + jitter);
+    }
+    ACState decoded;
+    TEST_ASSERT_TRUE(Backend::decodeFrame(frame.timings, Backend::FRAME_TIMINGS - 1, decoded));
+    TEST_ASSERT_EQUAL_HEX32(Backend::normalize(state).bits, decoded.bits);
+
+    TEST_ASSERT_FALSE(Backend::decodeFrame(frame.timings, Backend::FRAME_TIMINGS / 2, decoded));
+    frame.timings[Backend::FRAME_TIMINGS / 2 + 1] = 3000;
+    TEST_ASSERT_FALSE(Backend::decodeFrame(frame.timings, Backend::FRAME_TIMINGS - 1, decoded));
+
+    uint8_t bytes[Backend::STATE_LENGTH];
+    Backend::encodeState(state, bytes);
+    bytes[1] ^= 0x04;
+    TEST_ASSERT_FALSE(Backend::checksumValid(bytes));
+}
+
+template <typename Backend>
+void test_frame_cache() {
+    ACFrameCache<Backend> cache(3 * ACFrameCache<Backend>::entryBytes());
+    TEST_ASSERT_EQUAL(3, cache.capacity());
+    ACState a = makeACState(true, 24, AC_FAN_LOW, AC_MODE_COOL, 0, 0);
+    ACState b = makeACState(true, 25, AC_FAN_LOW, AC_MODE_COOL, 0, 0);
+    ACState c = makeACState(true, 26, AC_FAN_LOW, AC_MODE_COOL, 0, 0);
+    ACState d = AC_STATE_OFF;
+
+    cache.get(a);
+    cache.get(b);
+    cache.get(c);
+    TEST_ASSERT_NOT_NULL(cache.find(a));   // a is now most recent
+    cache.get(d);                          // Evicts b
+    TEST_ASSERT_NULL(cache.find(b));
+    TEST_ASSERT_EQUAL(3, cache.size());
+    TEST_ASSERT_EQUAL(4, cache.getStats().misses);
+    TEST_ASSERT_EQUAL(1, cache.getStats().evictions);
+
+    ACFrame<Backend> expected;
+    Backend::encodeFrame(d, expected);
+    const ACFrame<Backend>* cached = cache.get(d);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.state, cached->state, Backend::STATE_LENGTH);
+    TEST_ASSERT_EQUAL_MEMORY(expected.timings, cached->timings, sizeof(expected.timings));
+    TEST_ASSERT_TRUE(cache.getMemoryUsage() <= 3 * ACFrameCache<Backend>::entryBytes());
+}
+
+// Benchmark: full encode (state bytes + pulse timings), decode and a cache hit
+template <typename Backend>
+void test_benchmark() {
+    const int iterations = 100000;
+    ACState states[8];
+    for (int i = 0; i < 8; i++) {
+        states[i] = makeACState(i % 2, (uint8_t)(22 + i), (uint8_t)(i % 4), (uint8_t)(i % 5), i % 4, (i + 1) % 4);
+    }
+
+    volatile uint32_t sink = 0;
+    static ACFrame<Backend> frames[8];
+    uint64_t start = benchMicros();
+    for (int i = 0; i < iterations; i++) {
+        Backend::encodeFrame(states[i & 7], frames[i & 7]);
+        sink += frames[i & 7].timings[i % Backend::FRAME_TIMINGS];
+    }
+    uint64_t encodeUs = benchMicros() - start;
+
+    int decoded = 0;
+    start = benchMicros();
+    for (int i = 0; i < iterations; i++) {
+        ACState state;
+        if (Backend::decodeFrame(frames[i & 7].timings, Backend::FRAME_TIMINGS, state)) decoded++;
+        sink += state.bits;
+    }
+    uint64_t decodeUs = benchMicros() - start;
+    TEST_ASSERT_EQUAL(iterations, decoded);
+
+    ACFrameCache<Backend> cache(8 * ACFrameCache<Backend>::entryBytes());
+    for (int i = 0; i < 8; i++) cache.get(states[i]);
+    start = benchMicros();
+    for (int i = 0; i < iterations; i++) {
+        sink += cache.get(states[i & 7])->timings[i % Backend::FRAME_TIMINGS];
+    }
+    uint64_t hitUs = benchMicros() - start;
+    TEST_ASSERT_EQUAL(8, cache.getStats().misses);
+
+    printf("[bench] %s: encode %.1f ns, decode %.1f ns, cache hit %.1f ns, %u bytes per cached frame\n",
+           Backend::name(), encodeUs * 1000.0 / iterations, decodeUs * 1000.0 / iterations,
+           hitUs * 1000.0 / iterations, (unsigned)ACFrameCache<Backend>::entryBytes());
+    TEST_ASSERT_TRUE(hitUs < encodeUs);
+    (void)sink;
+}
+
+// Protocol-specific vectors; Gree's live in test_gree_codec
+
+void test_midea_vectors() {
+    // IRMideaAC::stateReset(): 0xA1826FFFFF62
+    const uint8_t reset[MIDEA_STATE_LENGTH] = {0xA1, 0x82, 0x6F, 0xFF, 0xFF, 0x62};
+    TEST_ASSERT_EQUAL_HEX8(0x62, mideaChecksum(reset));
+
+    uint8_t bytes[MIDEA_STATE_LENGTH];
+    mideaEncodeState(makeACState(true, 24, AC_FAN_HIGH, AC_MODE_HEAT, 0, 0), bytes);
+    TEST_ASSERT_EQUAL_HEX8(MIDEA_HEADER_COMMAND, bytes[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x80 | (MIDEA_FAN_HIGH << 3) | MIDEA_MODE_HEAT, bytes[1]);
+    TEST_ASSERT_EQUAL(24 - MIDEA_MIN_TEMP, bytes[2]);
+
+    // The second copy is the bitwise inverse, sent MSB first
+    uint16_t timings[MIDEA_FRAME_TIMINGS];
+    mideaEncodeTimings(bytes, timings);
+    TEST_ASSERT_EQUAL(MIDEA_ONE_SPACE, timings[3]);                          // Byte 0 bit 7
+    TEST_ASSERT_EQUAL(MIDEA_ZERO_SPACE, timings[MIDEA_FRAME_TIMINGS / 2 + 3]);
+    TEST_ASSERT_EQUAL(MIDEA_MIN_GAP, timings[MIDEA_FRAME_TIMINGS / 2 - 1]);
+
+    // Fahrenheit frames from a physical remote: 77 °F is 25 °C
+    ACState state;
+    const uint8_t fahrenheit[MIDEA_STATE_LENGTH] = {0xA1, 0x82, 0x6F, 0xFF, 0xFF, 0x62};
+    mideaDecodeState(fahrenheit, state);
+    TEST_ASSERT_EQUAL(25, state.temperature());
+    TEST_ASSERT_EQUAL(AC_MODE_AUTO, state.mode());
+}
+
+void test_daikin_vectors() {
+    uint8_t bytes[DAIKIN_STATE_LENGTH];
+    daikinEncodeState(makeACState(true, 24, AC_FAN_AUTO, AC_MODE_COOL, AC_SWING_V_AUTO, AC_SWING_H_MID), bytes);
+    // Sections 1 and 2 are constant, checksums as in IRremoteESP8266's tests
+    const uint8_t section1[DAIKIN_SECTION1_LENGTH] = {0x11, 0xDA, 0x27, 0x00, 0xC5, 0x00, 0x00, 0xD7};
+    const uint8_t section2[DAIKIN_SECTION2_LENGTH] = {0x11, 0xDA, 0x27, 0x00, 0x42, 0x00, 0x00, 0x54};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(section1, bytes, DAIKIN_SECTION1_LENGTH);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(section2, bytes + DAIKIN_SECTION1_LENGTH, DAIKIN_SECTION2_LENGTH);
+    TEST_ASSERT_EQUAL_HEX8(0x39, bytes[21]);   // Power, fixed bit, COOL
+    TEST_ASSERT_EQUAL_HEX8(24 << 1, bytes[22]);
+    TEST_ASSERT_EQUAL_HEX8((DAIKIN_FAN_AUTO << 4) | DAIKIN_SWING_ON, bytes[24]);
+    TEST_ASSERT_EQUAL_HEX8(DAIKIN_SWING_OFF, bytes[25]);
+    TEST_ASSERT_TRUE(daikinChecksumsValid(bytes));
+
+    uint16_t timings[DAIKIN_FRAME_TIMINGS];
+    TEST_ASSERT_EQUAL(DAIKIN_FRAME_TIMINGS, daikinEncodeTimings(bytes, timings));
+    TEST_ASSERT_EQUAL(DAIKIN_ZERO_SPACE + DAIKIN_GAP, timings[11]);   // After the 5 bit leader
+    TEST_ASSERT_EQUAL(DAIKIN_HDR_MARK, timings[12]);
+    TEST_ASSERT_EQUAL(DAIKIN_ONE_SPACE, timings[15]);                 // 0x11 bit 0
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip<GreeBackend>);
+    RUN_TEST(test_round_trip<MideaBackend>);
+    RUN_TEST(test_round_trip<DaikinBackend>);
+    RUN_TEST(test_field_mapping<GreeBackend>);
+    RUN_TEST(test_field_mapping<MideaBackend>);
+    RUN_TEST(test_field_mapping<DaikinBackend>);
+    RUN_TEST(test_decode_capture<GreeBackend>);
+    RUN_TEST(test_decode_capture<MideaBackend>);
+    RUN_TEST(test_decode_capture<DaikinBackend>);
+    RUN_TEST(test_frame_cache<GreeBackend>);
+    RUN_TEST(test_frame_cache<MideaBackend>);
+    RUN_TEST(test_frame_cache<DaikinBackend>);
+    RUN_TEST(test_midea_vectors);
+    RUN_TEST(test_daikin_vectors);
+    RUN_TEST(test_benchmark<GreeBackend>);
+    RUN_TEST(test_benchmark<MideaBackend>);
+    RUN_TEST(test_benchmark<DaikinBackend>);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
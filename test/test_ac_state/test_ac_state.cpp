@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <stdio.h>
+
+#include "ac_state.h"
+#include "rule_types.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_pack_fields() {
+    ACState state = makeACState(true, 26, AC_FAN_HIGH, AC_MODE_HEAT, AC_SWING_V_BOTTOM, AC_SWING_H_RIGHT);
+    TEST_ASSERT_EQUAL(4, sizeof(ACState));
+    TEST_ASSERT_TRUE(state.power());
+    TEST_ASSERT_EQUAL(26, state.temperature());
+    TEST_ASSERT_EQUAL(AC_FAN_HIGH, state.fanSpeed());
+    TEST_ASSERT_EQUAL(AC_MODE_HEAT, state.mode());
+    TEST_ASSERT_EQUAL(AC_SWING_V_BOTTOM, state.vSwing());
+    TEST_ASSERT_EQUAL(AC_SWING_H_RIGHT, state.hSwing());
+
+    // Setters touch only their own field
+    state.setTemperature(18);
+    state.setPower(false);
+    TEST_ASSERT_FALSE(state.power());
+    TEST_ASSERT_EQUAL(18, state.temperature());
+    TEST_ASSERT_EQUAL(AC_FAN_HIGH, state.fanSpeed());
+    TEST_ASSERT_EQUAL(AC_SWING_H_RIGHT, state.hSwing());
+    state.setTemperature(200);   // Out of range values are truncated to the field
+    TEST_ASSERT_EQUAL(200 & 0x7F, state.temperature());
+    TEST_ASSERT_FALSE(state.power());
+
+    ACState off = AC_STATE_OFF;
+    TEST_ASSERT_FALSE(off.power());
+    TEST_ASSERT_EQUAL(24, off.temperature());
+}
+
+void test_diff_and_equality() {
+    ACState a = makeACState(true, 24, AC_FAN_LOW, AC_MODE_COOL, AC_SWING_V_AUTO, AC_SWING_H_AUTO);
+    ACState b = a;
+    TEST_ASSERT_TRUE(acStateEquals(a, b));
+    TEST_ASSERT_EQUAL(0, acStateDiff(a, b));
+
+    b.setTemperature(25);
+    b.setVSwing(AC_SWING_V_MID);
+    TEST_ASSERT_FALSE(acStateEquals(a, b));
+    TEST_ASSERT_EQUAL(AC_DIRTY_TEMP | AC_DIRTY_SWING_V, acStateDiff(a, b));
+
+    b = a;
+    b.setPower(false);
+    b.setMode(AC_MODE_DRY);
+    b.setFanSpeed(AC_FAN_AUTO);
+    b.setHSwing(AC_SWING_H_LEFT);
+    TEST_ASSERT_EQUAL(AC_DIRTY_POWER | AC_DIRTY_MODE | AC_DIRTY_FAN | AC_DIRTY_SWING_H, acStateDiff(a, b));
+}
+
+void test_tracker_history() {
+    ACStateTracker tracker(AC_STATE_OFF);
+    ACState on = makeACState(true, 24, AC_FAN_AUTO, AC_MODE_COOL, 0, 0);
+
+    TEST_ASSERT_EQUAL(0, tracker.update(AC_STATE_OFF, 0, 10));   // No-op: nothing recorded
+    TEST_ASSERT_EQUAL(1, tracker.getNoOps());
+    TEST_ASSERT_EQUAL(0, tracker.getVersion());
+
+    TEST_ASSERT_EQUAL(AC_DIRTY_POWER, tracker.update(on, 0, 20));
+    ACState warmer = on;
+    warmer.setTemperature(26);
+    TEST_ASSERT_EQUAL(AC_DIRTY_TEMP, tracker.update(warmer, 1, 30));
+    TEST_ASSERT_EQUAL(0, tracker.update(warmer, 1, 40));
+    TEST_ASSERT_EQUAL(2, tracker.getVersion());
+    TEST_ASSERT_EQUAL(1, tracker.getLastSource());
+    TEST_ASSERT_TRUE(acStateEquals(warmer, tracker.current()));
+
+    ACStateChange changes[AC_STATE_HISTORY_LENGTH];
+    TEST_ASSERT_EQUAL(2, tracker.getHistory(changes, AC_STATE_HISTORY_LENGTH));
+    TEST_ASSERT_EQUAL(30, changes[0].ms);   // Newest first
+    TEST_ASSERT_EQUAL(AC_DIRTY_TEMP, changes[0].dirty);
+    TEST_ASSERT_EQUAL(20, changes[1].ms);
+    TEST_ASSERT_TRUE(acStateEquals(on, changes[1].state));
+
+    // The ring keeps the latest AC_STATE_HISTORY_LENGTH changes
+    for (int i = 0; i < 40; i++) {
+        ACState next = tracker.current();
+        next.setTemperature(16 + i % 10);
+        if (next.temperature() == tracker.current().temperature()) next.setTemperature(30);
+        tracker.update(next, 0, 100 + i);
+    }
+    TEST_ASSERT_EQUAL(AC_STATE_HISTORY_LENGTH, tracker.getHistory(changes, AC_STATE_HISTORY_LENGTH));
+    TEST_ASSERT_EQUAL(139, changes[0].ms);
+    TEST_ASSERT_EQUAL(139 - AC_STATE_HISTORY_LENGTH + 1, changes[AC_STATE_HISTORY_LENGTH - 1].ms);
+    TEST_ASSERT_EQUAL(3, tracker.getHistory(changes, 3));
+}
+
+// A change whose command was dropped is taken back, so the same request is
+// a change again instead of a no-op
+void test_tracker_revert() {
+    ACStateTracker tracker(AC_STATE_OFF);
+    ACState on = makeACState(true, 24, AC_FAN_AUTO, AC_MODE_COOL, 0, 0);
+    TEST_ASSERT_EQUAL(AC_DIRTY_POWER, tracker.update(on, 0, 10));
+    ACState warmer = on;
+    warmer.setTemperature(26);
+    ACState previous = tracker.current();
+    TEST_ASSERT_EQUAL(AC_DIRTY_TEMP, tracker.update(warmer, 1, 20));
+
+    tracker.revert(previous);
+    TEST_ASSERT_TRUE(acStateEquals(on, tracker.current()));
+    TEST_ASSERT_EQUAL(1, tracker.getVersion());
+    TEST_ASSERT_EQUAL(0, tracker.getLastSource());
+    TEST_ASSERT_EQUAL(AC_DIRTY_TEMP, tracker.update(warmer, 1, 30));
+
+    ACStateChange changes[AC_STATE_HISTORY_LENGTH];
+    TEST_ASSERT_EQUAL(2, tracker.getHistory(changes, AC_STATE_HISTORY_LENGTH));
+    TEST_ASSERT_EQUAL(30, changes[0].ms);
+}
+
+// Benchmark: change detection per control step (diff + record)
+void test_benchmark_update() {
+    const int iterations = 1000000;
+    ACStateTracker tracker(AC_STATE_OFF);
+    ACState states[4] = {
+        makeACState(true, 24, 1, 0, 0, 0), makeACState(true, 24, 1, 0, 0, 0),
+        makeACState(true, 25, 1, 0, 2, 2), makeACState(false, 24, 0, 0, 0, 0)
+    };
+    uint64_t start = benchMicros();
+    uint32_t dirty = 0;
+    for (int i = 0; i < iterations; i++) {
+        dirty += tracker.update(states[i & 3], 0, (uint32_t)i);
+    }
+    uint64_t elapsedUs = benchMicros() - start;
+    TEST_ASSERT_TRUE(dirty > 0);
+    TEST_ASSERT_EQUAL(iterations / 4, tracker.getNoOps());
+    printf("[bench] AC state update: %.1f ns (%u changes, %u no-ops)\n", elapsedUs * 1000.0 / iterations,
+           (unsigned)tracker.getVersion(), (unsigned)tracker.getNoOps());
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_pack_fields);
+    RUN_TEST(test_diff_and_equality);
+    RUN_TEST(test_tracker_history);
+    RUN_TEST(test_tracker_revert);
+    RUN_TEST(test_benchmark_update);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
@@ -0,0 +1,162 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config_registry.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+// A table like the firmware's (config_store.cpp), over local variables
+static char network[33];
+static char secret[65];
+static int32_t offsetSec;
+static bool verbose;
+static uint32_t periodMs;
+
+static const ConfigSetting settings[] = {
+    {"network",  CONFIG_STRING, CONFIG_REBOOT,                 network,    1, 32},
+    {"secret",   CONFIG_STRING, CONFIG_REBOOT | CONFIG_SECRET, secret,     0, 64},
+    {"offsetSec", CONFIG_INT,   0,                             &offsetSec, -43200, 50400},
+    {"verbose",  CONFIG_BOOL,   0,                             &verbose,   0, 1},
+    {"periodMs", CONFIG_UINT,   0,                             &periodMs,  500, 60000},
+};
+static const int SETTING_COUNT = sizeof(settings) / sizeof(settings[0]);
+
+static void resetValues() {
+    strcpy(network, "home");
+    strcpy(secret, "");
+    offsetSec = 28800;
+    verbose = false;
+    periodMs = 5000;
+}
+
+void setUp(void) {
+    resetValues();
+}
+
+void tearDown(void) {
+}
+
+static bool apply(const char* json, ConfigApplyResult& result) {
+    JsonDocument body;
+    if (deserializeJson(body, json)) return false;
+    return configApplyJson(settings, SETTING_COUNT, body.as<JsonObjectConst>(), result);
+}
+
+void test_apply_stores_values_and_reports_changes() {
+    ConfigApplyResult result;
+    TEST_ASSERT_TRUE(apply("{\"network\": \"office\", \"offsetSec\": -18000, \"verbose\": true, "
+                           "\"periodMs\": 500, \"secret\": \"hunter22\"}", result));
+    TEST_ASSERT_EQUAL_STRING("office", network);
+    TEST_ASSERT_EQUAL_STRING("hunter22", secret);
+    TEST_ASSERT_EQUAL(-18000, offsetSec);
+    TEST_ASSERT_TRUE(verbose);
+    TEST_ASSERT_EQUAL_UINT32(500, periodMs);
+    TEST_ASSERT_EQUAL_HEX32(0x1F, result.changed);
+
+    // Same values again: accepted, nothing to save or announce
+    TEST_ASSERT_TRUE(apply("{\"network\": \"office\", \"periodMs\": 500}", result));
+    TEST_ASSERT_EQUAL_HEX32(0, result.changed);
+
+    // Only the fields sent change
+    TEST_ASSERT_TRUE(apply("{\"periodMs\": 60000}", result));
+    TEST_ASSERT_EQUAL_HEX32(1u << 4, result.changed);
+    TEST_ASSERT_EQUAL_STRING("office", network);
+}
+
+void test_invalid_field_changes_nothing() {
+    static const char* const bodies[] = {
+        "{\"periodMs\": 1000, \"offsetSec\": 50401}",       // Out of range
+        "{\"periodMs\": 1000, \"periodMs2\": 1}",           // Unknown name
+        "{\"periodMs\": 499}",
+        "{\"periodMs\": -1}",                               // Negative into uint32_t
+        "{\"periodMs\": 4294968296}",                       // Wraps to 1000 in 32 bits
+        "{\"periodMs\": 1000.5}",
+        "{\"periodMs\": \"1000\"}",
+        "{\"verbose\": 1, \"periodMs\": 1000}",
+        "{\"network\": \"\"}",                              // Shorter than minValue
+        "{\"network\": \"123456789012345678901234567890123\"}",
+        "{\"network\": 5}",
+        "[1, 2]",                                           // Not an object
+    };
+    for (const char* body : bodies) {
+        resetValues();
+        ConfigApplyResult result;
+        TEST_ASSERT_FALSE_MESSAGE(apply(body, result), body);
+        TEST_ASSERT_TRUE_MESSAGE(result.error[0] != '\0', body);
+        TEST_ASSERT_EQUAL_HEX32(0, result.changed);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(5000, periodMs, body);
+        TEST_ASSERT_EQUAL_STRING("home", network);
+        TEST_ASSERT_FALSE(verbose);
+        TEST_ASSERT_EQUAL(28800, offsetSec);
+    }
+
+    resetValues();
+    ConfigApplyResult result;
+    apply("{\"offsetSec\": 90000}", result);
+    TEST_ASSERT_EQUAL_STRING("\"offsetSec\" must be an integer -43200..50400", result.error);
+    apply("{\"timezone\": 8}", result);
+    TEST_ASSERT_EQUAL_STRING("Unknown setting \"timezone\"", result.error);
+}
+
+void test_longest_string_fits() {
+    ConfigApplyResult result;
+    TEST_ASSERT_TRUE(apply("{\"network\": \"12345678901234567890123456789012\"}", result));
+    TEST_ASSERT_EQUAL(32, strlen(network));
+}
+
+void test_json_leaves_secrets_out() {
+    JsonDocument doc;
+    configValuesToJson(settings, SETTING_COUNT, doc["settings"].to<JsonObject>());
+    configSchemaToJson(settings, SETTING_COUNT, doc["schema"].to<JsonArray>());
+    TEST_ASSERT_EQUAL_STRING("home", doc["settings"]["network"].as<const char*>());
+    TEST_ASSERT_EQUAL(28800, doc["settings"]["offsetSec"].as<int>());
+    TEST_ASSERT_TRUE(doc["settings"]["secret"].isNull());
+    TEST_ASSERT_EQUAL(SETTING_COUNT, (int)doc["schema"].size());
+    TEST_ASSERT_EQUAL_STRING("secret", doc["schema"][1]["name"].as<const char*>());
+    TEST_ASSERT_TRUE(doc["schema"][1]["secret"].as<bool>());
+    TEST_ASSERT_FALSE(doc["schema"][1]["set"].as<bool>());
+    TEST_ASSERT_EQUAL(500, doc["schema"][4]["min"].as<int>());
+    TEST_ASSERT_EQUAL_STRING("uint", doc["schema"][4]["type"].as<const char*>());
+
+    strcpy(secret, "hunter22");
+    doc.clear();
+    configValuesToJson(settings, SETTING_COUNT, doc["settings"].to<JsonObject>());
+    configSchemaToJson(settings, SETTING_COUNT, doc["schema"].to<JsonArray>());
+    TEST_ASSERT_TRUE(doc["settings"]["secret"].isNull());
+    TEST_ASSERT_TRUE(doc["schema"][1]["set"].as<bool>());
+
+    // A client may send back what it read
+    char json[512];
+    serializeJson(doc["settings"], json, sizeof(json));
+    ConfigApplyResult result;
+    TEST_ASSERT_TRUE(apply(json, result));
+    TEST_ASSERT_EQUAL_HEX32(0, result.changed);
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_apply_stores_values_and_reports_changes);
+    RUN_TEST(test_invalid_field_changes_nothing);
+    RUN_TEST(test_longest_string_fits);
+    RUN_TEST(test_json_leaves_secrets_out);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
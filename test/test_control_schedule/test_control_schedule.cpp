@@ -0,0 +1,301 @@
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "control_schedule.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+#define DAY_MS 86400000u
+#define SIM_STEP_MS 100u
+#define SIM_DAY 9800   // 2026-10-31, any date works without exceptions
+
+// The simulated day is a Monday
+static int simMinute(uint32_t ms) {
+    return weekMinute(1, 0, 0) + (int)(ms / 60000);
+}
+
+// Same shape as initDefaultRules(): cool day, cool night, off when cool
+static void compileDefaultRules(RuleCalendar& calendar,
+                                const RuleDateException exceptions[] = nullptr, int exceptionCount = 0) {
+    ACRule rules[3] = {
+        makeRule(1, 8, 19, 26.0, -999),
+        makeRule(2, 19, 8, 26.0, -999),
+        makeRule(3, -1, -1, -999, 25.9)
+    };
+    calendar.compile(rules, 3, exceptions, exceptionCount);
+}
+
+// Room temperature over a simulated day: 23-31°C, warmest at 15:00, plus a
+// small deterministic ripple so the reading dithers around thresholds
+static float simTemp(uint32_t ms) {
+    double hours = ms / 3600000.0;
+    double base = 27.0 + 4.0 * sin((hours - 9.0) * M_PI / 12.0);
+    double ripple = 0.04 * sin(ms / 7000.0) + 0.02 * sin(ms / 1300.0);
+    return (float)(base + ripple);
+}
+
+struct SimResult {
+    uint32_t evaluations;   // Rule lookups by the control loop
+    uint32_t wakeups;       // Task wakeups of any kind, sensor samples included
+    uint32_t maxLagMs;      // Longest time the applied rule differed from the ideal one
+};
+
+// Tracks how long the applied decision trails the ideal decision at each step
+struct LagTracker {
+    uint32_t mismatchSince;
+    bool mismatched;
+    uint32_t maxLagMs;
+
+    void update(const RuleCalendar& calendar, uint32_t ms, int applied) {
+        int ideal = calendar.lookup(SIM_DAY, simMinute(ms), tempToCenti(simTemp(ms)));
+        if (applied == ideal) {
+            mismatched = false;
+            return;
+        }
+        if (!mismatched) {
+            mismatched = true;
+            mismatchSince = ms;
+        }
+        if (ms - mismatchSince > maxLagMs) maxLagMs = ms - mismatchSince;
+    }
+};
+
+// Previous behavior: wake every interval, read the sensor and evaluate
+static SimResult simulatePolling(const RuleCalendar& calendar, uint32_t intervalMs) {
+    SimResult result = {0, 0, 0};
+    LagTracker lag = {0, false, 0};
+    int applied = -2;
+    for (uint32_t ms = 0; ms < DAY_MS; ms += SIM_STEP_MS) {
+        if (ms % intervalMs == 0) {
+            applied = calendar.lookup(SIM_DAY, simMinute(ms), tempToCenti(simTemp(ms)));
+            result.evaluations++;
+            result.wakeups++;
+        }
+        lag.update(calendar, ms, applied);
+    }
+    result.maxLagMs = lag.maxLagMs;
+    return result;
+}
+
+// Event-driven: the sensor task samples every sampleMs near a band edge,
+// further apart inside the band, and notifies on a band crossing; otherwise
+// the control loop sleeps until its planned deadline. A new band that needs
+// a sooner sample wakes the sensor task. Both tasks' wakeups are counted.
+static SimResult simulateEventDriven(const RuleCalendar& calendar, uint32_t sampleMs, uint32_t maxSleepMs) {
+    SimResult result = {0, 0, 0};
+    LagTracker lag = {0, false, 0};
+    ControlWakePlan plan = {0, INT32_MAX, INT32_MIN}; // Empty band: first sample wakes
+    uint32_t deadline = 0;
+    uint32_t nextSample = 0;
+    int16_t lastSample = 0;
+    int applied = -2;
+
+    for (uint32_t ms = 0; ms < DAY_MS; ms += SIM_STEP_MS) {
+        bool wake = ms >= deadline;
+        if (ms >= nextSample) {
+            lastSample = tempToCenti(simTemp(ms));
+            wake = wake || controlWakeCrossed(plan, lastSample);
+            nextSample = ms + controlSampleMs(plan, lastSample, sampleMs);
+            result.wakeups++;
+        }
+        if (wake) {
+            int minute = simMinute(ms);
+            int secondsIntoMinute = (ms / 1000) % 60;
+            applied = calendar.lookup(SIM_DAY, minute, lastSample);
+            plan = planControlWake(calendar, SIM_DAY, minute, secondsIntoMinute, lastSample, maxSleepMs);
+            deadline = ms + plan.sleepMs;
+            if (ms + controlSampleMs(plan, lastSample, sampleMs) < nextSample) {
+                nextSample = ms + SIM_STEP_MS;
+            }
+            result.evaluations++;
+            result.wakeups++;
+        }
+        lag.update(calendar, ms, applied);
+    }
+    result.maxLagMs = lag.maxLagMs;
+    return result;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_minutes_until_change() {
+    RuleCalendar calendar;
+    compileDefaultRules(calendar);
+    const RuleDecisionTable& table = calendar.tableFor(SIM_DAY);
+    TEST_ASSERT_EQUAL(9 * 60, table.minutesUntilChange(weekMinute(1, 10, 0)));   // Day row until 19:00
+    TEST_ASSERT_EQUAL(13 * 60, table.minutesUntilChange(weekMinute(1, 19, 0)));  // Night row until 08:00
+    TEST_ASSERT_EQUAL(1, table.minutesUntilChange(weekMinute(1, 7, 59)));
+    TEST_ASSERT_EQUAL(0, calendar.daysUntilChange(SIM_DAY));
+
+    ACRule allDay[1] = {makeRule(1, -1, -1, 26.0, -999)};
+    calendar.compile(allDay, 1, nullptr, 0);
+    TEST_ASSERT_EQUAL(0, calendar.tableFor(SIM_DAY).minutesUntilChange(weekMinute(1, 10, 0)));
+}
+
+void test_temp_band() {
+    RuleCalendar calendar;
+    compileDefaultRules(calendar);
+    const RuleDecisionTable& table = calendar.tableFor(SIM_DAY);
+    int noon = weekMinute(1, 12, 0);
+    int32_t low, high;
+
+    table.getTempBand(noon, 2800, low, high);
+    TEST_ASSERT_EQUAL(2600, low);
+    TEST_ASSERT_EQUAL(INT32_MAX, high);
+
+    table.getTempBand(noon, 2595, low, high);  // Gap between 25.9 and 26.0
+    TEST_ASSERT_EQUAL(2591, low);
+    TEST_ASSERT_EQUAL(2600, high);
+
+    table.getTempBand(noon, 2000, low, high);
+    TEST_ASSERT_EQUAL(INT32_MIN, low);
+    TEST_ASSERT_EQUAL(2591, high);
+}
+
+void test_plan_sleeps_until_boundary() {
+    RuleCalendar calendar;
+    compileDefaultRules(calendar);
+
+    // 18:59:30 -> 30 s until the night row
+    ControlWakePlan plan = planControlWake(calendar, SIM_DAY, weekMinute(1, 18, 59), 30, 2800, 900000);
+    TEST_ASSERT_EQUAL(30000 + CONTROL_WAKE_SLACK_MS, plan.sleepMs);
+    TEST_ASSERT_FALSE(controlWakeCrossed(plan, 3500));
+    TEST_ASSERT_TRUE(controlWakeCrossed(plan, 2599));
+
+    // 10:00 -> boundary is 9 hours away, so the heartbeat caps the sleep
+    plan = planControlWake(calendar, SIM_DAY, weekMinute(1, 10, 0), 0, 2800, 900000);
+    TEST_ASSERT_EQUAL(900000, plan.sleepMs);
+}
+
+// Samples stretch with the distance to the nearest band edge
+void test_sample_period() {
+    ControlWakePlan plan = {0, 2600, 2800};
+    TEST_ASSERT_EQUAL(CONTROL_SAMPLE_MAX_MS, controlSampleMs(plan, 2700, 5000));  // Mid band
+    TEST_ASSERT_EQUAL(5000, controlSampleMs(plan, 2620, 5000));    // Inside the guard
+    TEST_ASSERT_EQUAL(5000, controlSampleMs(plan, 2599, 5000));    // Crossed
+    TEST_ASSERT_EQUAL(5000, controlSampleMs(plan, 2800, 5000));
+    TEST_ASSERT_EQUAL(40000, controlSampleMs(plan, 2650, 5000));   // 20 centi past the guard at 30/min
+    TEST_ASSERT_EQUAL(30000, controlSampleMs(plan, 2640, 30000));  // Never below the base period
+
+    // One open side: only the other edge counts; none: the history minute
+    plan = {0, INT32_MIN, 2600};
+    TEST_ASSERT_EQUAL(CONTROL_SAMPLE_MAX_MS, controlSampleMs(plan, 2000, 5000));
+    TEST_ASSERT_EQUAL(5000, controlSampleMs(plan, 2580, 5000));
+    plan = {0, INT32_MIN, INT32_MAX};
+    TEST_ASSERT_EQUAL(CONTROL_SAMPLE_MAX_MS, controlSampleMs(plan, 2500, 5000));
+    TEST_ASSERT_EQUAL(90000, controlSampleMs(plan, 2500, 90000));  // Base period above the cap
+}
+
+// A holiday starting at midnight is a boundary even inside an unchanged row
+void test_plan_wakes_for_exception() {
+    RuleDateException holiday[1] = {{3, SIM_DAY + 1, SIM_DAY + 1}};
+    RuleCalendar calendar;
+    compileDefaultRules(calendar, holiday, 1);
+
+    ControlWakePlan plan = planControlWake(calendar, SIM_DAY, weekMinute(1, 23, 59), 50, 2500, 900000);
+    TEST_ASSERT_EQUAL(10000 + CONTROL_WAKE_SLACK_MS, plan.sleepMs);
+    TEST_ASSERT_EQUAL(2, calendar.lookup(SIM_DAY, weekMinute(1, 23, 59), 2500));
+    TEST_ASSERT_EQUAL(-1, calendar.lookup(SIM_DAY + 1, weekMinute(2, 0, 0), 2500));
+    // The night rule's holiday starts with its window that evening
+    holiday[0].ruleId = 2;
+    compileDefaultRules(calendar, holiday, 1);
+    TEST_ASSERT_EQUAL(1, calendar.lookup(SIM_DAY + 1, weekMinute(2, 0, 0), 2800));
+    TEST_ASSERT_EQUAL(-1, calendar.lookup(SIM_DAY + 1, weekMinute(2, 19, 0), 2800));
+    TEST_ASSERT_EQUAL(-1, calendar.lookup(SIM_DAY + 2, weekMinute(3, 7, 59), 2800));
+    TEST_ASSERT_EQUAL(1, calendar.lookup(SIM_DAY + 2, weekMinute(3, 19, 0), 2800));
+}
+
+// The shared decision: matched rules send on any change, no match only turns the AC off
+void test_decide_control() {
+    ACRule rules[3] = {
+        makeRule(1, 8, 19, 26.0, -999),
+        makeRule(2, 19, 8, 26.0, -999),
+        makeRule(3, -1, -1, -999, 25.9)
+    };
+    rules[1].fanSpeed = AC_FAN_LOW;
+    ruleSetFlag(rules[2], RULE_FLAG_AC_ON, false);
+    RuleStore store;
+    RuleNamePool names;
+    store.publish(rules, 3, names);
+    RuleSnapshotGuard snapshot(store);
+
+    ControlDecision day = decideControl(*snapshot, SIM_DAY, weekMinute(1, 12, 0), 2800);
+    TEST_ASSERT_EQUAL(1, snapshot->rules[day.ruleIndex].id);
+    TEST_ASSERT_TRUE(day.target.power());
+    TEST_ASSERT_EQUAL(25, day.target.temperature());
+    ACState off = AC_STATE_OFF;
+    TEST_ASSERT_TRUE(controlNeedsCommand(day, off));
+    TEST_ASSERT_FALSE(controlNeedsCommand(day, day.target));
+
+    ControlDecision night = decideControl(*snapshot, SIM_DAY, weekMinute(1, 20, 0), 2800);
+    TEST_ASSERT_TRUE(controlNeedsCommand(night, day.target));   // Only the fan differs
+
+    ControlDecision cool = decideControl(*snapshot, SIM_DAY, weekMinute(1, 12, 0), 2500);
+    TEST_ASSERT_FALSE(cool.target.power());
+    TEST_ASSERT_TRUE(controlNeedsCommand(cool, off));           // Rule state differs from the boot state
+
+    ControlDecision none = decideControl(*snapshot, SIM_DAY, weekMinute(1, 12, 0), 2595);
+    TEST_ASSERT_EQUAL(-1, none.ruleIndex);
+    TEST_ASSERT_TRUE(controlNeedsCommand(none, day.target));
+    TEST_ASSERT_FALSE(controlNeedsCommand(none, cool.target));  // Already off
+}
+
+// Wakeups per simulated day: fixed 5 s poll vs. deadline + crossing
+// notifications with samples stretched away from the thresholds. Rule
+// evaluations drop the most, and the sensor wakeups saved pay for the
+// control loop's own.
+void test_simulated_day_wakeups() {
+    RuleCalendar calendar;
+    compileDefaultRules(calendar);
+
+    SimResult polled = simulatePolling(calendar, 5000);
+    SimResult evented = simulateEventDriven(calendar, 5000, 900000);
+
+    printf("[sim] fixed 5 s poll:  %6u evaluations/day, %6u wakeups/day, max decision lag %5u ms\n",
+           (unsigned)polled.evaluations, (unsigned)polled.wakeups, (unsigned)polled.maxLagMs);
+    printf("[sim] event-driven:    %6u evaluations/day, %6u wakeups/day, max decision lag %5u ms\n",
+           (unsigned)evented.evaluations, (unsigned)evented.wakeups, (unsigned)evented.maxLagMs);
+
+    TEST_ASSERT_EQUAL(17280, polled.wakeups);
+    TEST_ASSERT_TRUE(evented.evaluations * 20 < polled.evaluations);
+    TEST_ASSERT_TRUE(evented.wakeups < polled.wakeups);
+    // Crossings are seen within one sample period, boundaries within the slack
+    TEST_ASSERT_TRUE(evented.maxLagMs < 5000 + SIM_STEP_MS);
+    TEST_ASSERT_TRUE(evented.maxLagMs <= polled.maxLagMs);
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_minutes_until_change);
+    RUN_TEST(test_temp_band);
+    RUN_TEST(test_plan_sleeps_until_boundary);
+    RUN_TEST(test_sample_period);
+    RUN_TEST(test_plan_wakes_for_exception);
+    RUN_TEST(test_decide_control);
+    RUN_TEST(test_simulated_day_wakeups);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
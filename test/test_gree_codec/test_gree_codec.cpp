@@ -0,0 +1,253 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gree_codec.h"
+#include "ac_frame_cache.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+static ACState makeState(bool power, uint8_t temp, uint8_t fan, uint8_t mode, int vSwing, int hSwing) {
+    return makeACState(power, temp, fan, mode, vSwing, hSwing);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_checksum_matches_reset_state() {
+    // IRGreeAC::stateReset() followed by checksum(): 25 °C, light on, fixed bits
+    const uint8_t reset[GREE_STATE_LENGTH] = {0x00, 0x09, 0x20, 0x50, 0x00, 0x20, 0x00, 0x50};
+    TEST_ASSERT_EQUAL_HEX8(0x5, greeChecksum(reset));
+}
+
+void test_encode_state() {
+    uint8_t bytes[GREE_STATE_LENGTH];
+    greeEncodeState(makeState(true, 24, AC_FAN_LOW, AC_MODE_COOL, AC_SWING_V_MID, AC_SWING_H_MID), bytes);
+    const uint8_t expected[GREE_STATE_LENGTH] = {0x19, 0x08, 0x60, 0x50, 0x44, 0x20, 0x00, 0x10};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, bytes, GREE_STATE_LENGTH);
+
+    // Library locks: AUTO runs at 25 °C, DRY at fan 1
+    greeEncodeState(makeState(true, 18, AC_FAN_HIGH, AC_MODE_AUTO, AC_SWING_V_AUTO, AC_SWING_H_AUTO), bytes);
+    TEST_ASSERT_EQUAL_HEX8(0x09, bytes[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x40, bytes[0] & 0x40);  // Vertical auto swing flag
+    greeEncodeState(makeState(true, 26, AC_FAN_HIGH, AC_MODE_DRY, AC_SWING_V_TOP, AC_SWING_H_LEFT), bytes);
+    TEST_ASSERT_EQUAL(1, (bytes[0] >> 4) & 3);
+    TEST_ASSERT_EQUAL(GREE_MODE_DRY, bytes[0] & 7);
+    TEST_ASSERT_EQUAL_HEX8(GREE_SWING_V_UP | (GREE_SWING_H_LEFT << 4), bytes[4]);
+    TEST_ASSERT_EQUAL(greeChecksum(bytes), bytes[7] >> 4);
+
+    greeEncodeState(makeState(false, 24, 0, AC_MODE_COOL, 0, 0), bytes);
+    TEST_ASSERT_EQUAL(0, bytes[0] & 0x08);
+    TEST_ASSERT_EQUAL(0, bytes[2] & 0x40);
+}
+
+void test_encode_timings() {
+    uint8_t bytes[GREE_STATE_LENGTH] = {0x01, 0, 0, 0, 0x80, 0, 0, 0};
+    uint16_t timings[GREE_FRAME_TIMINGS];
+    TEST_ASSERT_EQUAL(GREE_FRAME_TIMINGS, greeEncodeTimings(bytes, timings));
+
+    TEST_ASSERT_EQUAL(GREE_HDR_MARK, timings[0]);
+    TEST_ASSERT_EQUAL(GREE_HDR_SPACE, timings[1]);
+    TEST_ASSERT_EQUAL(GREE_ONE_SPACE, timings[3]);    // Byte 0 bit 0, LSB first
+    TEST_ASSERT_EQUAL(GREE_ZERO_SPACE, timings[5]);
+    // Block footer 0b010 after 32 bits, then the message gap
+    TEST_ASSERT_EQUAL(GREE_ZERO_SPACE, timings[67]);
+    TEST_ASSERT_EQUAL(GREE_ONE_SPACE, timings[69]);
+    TEST_ASSERT_EQUAL(GREE_ZERO_SPACE, timings[71]);
+    TEST_ASSERT_EQUAL(GREE_BIT_MARK, timings[72]);
+    TEST_ASSERT_EQUAL(GREE_MSG_SPACE, timings[73]);
+    TEST_ASSERT_EQUAL(GREE_ONE_SPACE, timings[74 + 15]);   // Byte 4 bit 7
+    TEST_ASSERT_EQUAL(GREE_MSG_SPACE, timings[GREE_FRAME_TIMINGS - 1]);
+    for (int i = 0; i < GREE_FRAME_TIMINGS; i += 2) {
+        if (i > 0) TEST_ASSERT_EQUAL(GREE_BIT_MARK, timings[i]);
+    }
+}
+
+// Every state survives encode -> waveform -> decode, and decoding the bytes
+// back to an ACState re-encodes to the same frame
+void test_decode_round_trip() {
+    int frames = 0;
+    for (int power = 0; power < 2; power++) {
+        for (int temp = GREE_MIN_TEMP; temp <= GREE_MAX_TEMP; temp++) {
+            for (int fan = 0; fan < 4; fan++) {
+                for (int mode = AC_MODE_COOL; mode <= AC_MODE_AUTO; mode++) {
+                    for (int swing = 0; swing < 4; swing++) {
+                        uint8_t bytes[GREE_STATE_LENGTH], decoded[GREE_STATE_LENGTH], again[GREE_STATE_LENGTH];
+                        uint16_t timings[GREE_FRAME_TIMINGS];
+                        greeEncodeState(makeState(power, (uint8_t)temp, (uint8_t)fan, (uint8_t)mode, swing, 3 - swing), bytes);
+                        greeEncodeTimings(bytes, timings);
+                        TEST_ASSERT_TRUE(greeDecodeTimings(timings, GREE_FRAME_TIMINGS, decoded));
+                        TEST_ASSERT_EQUAL_HEX8_ARRAY(bytes, decoded, GREE_STATE_LENGTH);
+
+                        ACState state;
+                        greeDecodeState(decoded, state);
+                        greeEncodeState(state, again);
+                        TEST_ASSERT_EQUAL_HEX8_ARRAY(bytes, again, GREE_STATE_LENGTH);
+                        frames++;
+                    }
+                }
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(2 * 15 * 4 * 5 * 4, frames);
+}
+
+// Receiver-style capture: marks stretched, spaces shortened, jitter and no
+// final gap, as IRrecvDumpV2 prints it
+void test_decode_capture() {
+    uint8_t bytes[GREE_STATE_LENGTH], decoded[GREE_STATE_LENGTH];
+    uint16_t capture[GREE_FRAME_TIMINGS];
+    greeEncodeState(makeState(true, 26, AC_FAN_MED, AC_MODE_HEAT, AC_SWING_V_BOTTOM, AC_SWING_H_RIGHT), bytes);
+    greeEncodeTimings(bytes, capture);
+    for (int i = 0; i < GREE_FRAME_TIMINGS; i++) {
+        int jitter = (i * 37) % 61 - 30;
+        capture[i] = (uint16_t)(capture[i] + (i % 2 == 0 ? 60 : -70) + jitter);
+    }
+    TEST_ASSERT_TRUE(greeDecodeTimings(capture, GREE_FRAME_TIMINGS - 1, decoded));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bytes, decoded, GREE_STATE_LENGTH);
+
+    ACState state;
+    greeDecodeState(decoded, state);
+    TEST_ASSERT_TRUE(state.power());
+    TEST_ASSERT_EQUAL(26, state.temperature());
+    TEST_ASSERT_EQUAL(AC_FAN_MED, state.fanSpeed());
+    TEST_ASSERT_EQUAL(AC_MODE_HEAT, state.mode());
+    TEST_ASSERT_EQUAL(AC_SWING_V_BOTTOM, state.vSwing());
+    TEST_ASSERT_EQUAL(AC_SWING_H_RIGHT, state.hSwing());
+
+    // A flipped data bit breaks the checksum; truncation and noise are rejected
+    uint16_t saved = capture[3];
+    capture[3] = capture[3] > 1000 ? GREE_ZERO_SPACE : GREE_ONE_SPACE;
+    TEST_ASSERT_FALSE(greeDecodeTimings(capture, GREE_FRAME_TIMINGS - 1, decoded));
+    capture[3] = saved;
+    TEST_ASSERT_FALSE(greeDecodeTimings(capture, 100, decoded));
+    capture[40] = 3000;
+    TEST_ASSERT_FALSE(greeDecodeTimings(capture, GREE_FRAME_TIMINGS - 1, decoded));
+}
+
+void test_cache_lru_and_budget() {
+    ACFrameCache<GreeBackend> cache(3 * (sizeof(ACFrame<GreeBackend>) + 8));
+    TEST_ASSERT_EQUAL(3, cache.capacity());
+    ACState a = makeState(true, 24, 1, 0, 0, 0);
+    ACState b = makeState(true, 25, 1, 0, 0, 0);
+    ACState c = makeState(true, 26, 1, 0, 0, 0);
+    ACState d = makeState(false, 24, 0, 0, 0, 0);
+
+    cache.get(a);
+    cache.get(b);
+    cache.get(c);
+    TEST_ASSERT_NOT_NULL(cache.find(a));   // a is now most recent
+    cache.get(d);                                        // Evicts b
+    TEST_ASSERT_NULL(cache.find(b));
+    TEST_ASSERT_NOT_NULL(cache.find(a));
+    TEST_ASSERT_EQUAL(3, cache.size());
+    TEST_ASSERT_EQUAL(4, cache.getStats().misses);
+    TEST_ASSERT_EQUAL(1, cache.getStats().evictions);
+
+    // The cached frame is the encoder's output
+    uint8_t bytes[GREE_STATE_LENGTH];
+    greeEncodeState(d, bytes);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bytes, cache.get(d)->state, GREE_STATE_LENGTH);
+
+    cache.setBudget(sizeof(ACFrame<GreeBackend>) + 8);   // Keeps only the most recent (d)
+    TEST_ASSERT_EQUAL(1, cache.size());
+    TEST_ASSERT_NOT_NULL(cache.find(d));
+    TEST_ASSERT_TRUE(cache.getMemoryUsage() <= sizeof(ACFrame<GreeBackend>) + 8);
+
+    cache.setBudget(0);
+    TEST_ASSERT_EQUAL(0, cache.size());
+    TEST_ASSERT_NULL(cache.get(a));
+}
+
+// Benchmark: waveform -> protocol bytes, the host check on every simulated frame
+void test_benchmark_decode() {
+    const int iterations = 200000;
+    uint16_t timings[8][GREE_FRAME_TIMINGS];
+    for (int i = 0; i < 8; i++) {
+        uint8_t bytes[GREE_STATE_LENGTH];
+        greeEncodeState(makeState(i % 2, (uint8_t)(20 + i), (uint8_t)(i % 4), (uint8_t)(i % 5), i % 4, i % 4), bytes);
+        greeEncodeTimings(bytes, timings[i]);
+    }
+
+    volatile uint32_t sink = 0;
+    int decoded = 0;
+    uint64_t start = benchMicros();
+    for (int i = 0; i < iterations; i++) {
+        uint8_t bytes[GREE_STATE_LENGTH];
+        if (greeDecodeTimings(timings[i & 7], GREE_FRAME_TIMINGS, bytes)) decoded++;
+        sink += bytes[1];
+    }
+    uint64_t elapsedUs = benchMicros() - start;
+    TEST_ASSERT_EQUAL(iterations, decoded);
+    printf("[bench] gree decode: %.1f ns per frame\n", elapsedUs * 1000.0 / iterations);
+    (void)sink;
+}
+
+// Benchmark: full encode (state bytes + pulse timings) vs a cache hit
+void test_benchmark_encode_vs_hit() {
+    const int iterations = 200000;
+    ACState states[8];
+    for (int i = 0; i < 8; i++) {
+        states[i] = makeState(i % 2, (uint8_t)(22 + i), (uint8_t)(i % 4), (uint8_t)(i % 5), i % 4, (i + 1) % 4);
+    }
+
+    volatile uint32_t sink = 0;
+    ACFrame<GreeBackend> frame;
+    uint64_t start = benchMicros();
+    for (int i = 0; i < iterations; i++) {
+        greeEncodeState(states[i & 7], frame.state);
+        greeEncodeTimings(frame.state, frame.timings);
+        sink += frame.timings[i % GREE_FRAME_TIMINGS];
+    }
+    uint64_t encodeUs = benchMicros() - start;
+
+    ACFrameCache<GreeBackend> cache(4096);
+    for (int i = 0; i < 8; i++) cache.get(states[i]);
+    start = benchMicros();
+    for (int i = 0; i < iterations; i++) {
+        sink += cache.get(states[i & 7])->timings[i % GREE_FRAME_TIMINGS];
+    }
+    uint64_t hitUs = benchMicros() - start;
+    TEST_ASSERT_EQUAL(8, cache.getStats().misses);
+
+    printf("[bench] gree frame: encode %.1f ns, cache hit %.1f ns, %d entries in %u bytes\n",
+           encodeUs * 1000.0 / iterations, hitUs * 1000.0 / iterations, cache.capacity(),
+           (unsigned)cache.getMemoryUsage());
+    TEST_ASSERT_TRUE(hitUs < encodeUs);
+    (void)sink;
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_checksum_matches_reset_state);
+    RUN_TEST(test_encode_state);
+    RUN_TEST(test_encode_timings);
+    RUN_TEST(test_decode_round_trip);
+    RUN_TEST(test_decode_capture);
+    RUN_TEST(test_cache_lru_and_budget);
+    RUN_TEST(test_benchmark_encode_vs_hit);
+    RUN_TEST(test_benchmark_decode);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
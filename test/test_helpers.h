@@ -0,0 +1,97 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+// Shared by the test suites: benchmark clock, a reproducible random
+// generator and the rule builders and comparisons the rule tests use
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rule_types.h"
+#include "rule_set.h"
+
+#ifdef UNIT_TEST
+#include <chrono>
+static inline uint64_t benchMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+#include <Arduino.h>
+static inline uint64_t benchMicros() {
+    return micros();
+}
+#endif
+
+// Deterministic pseudo-random generator so failures are reproducible; suites
+// that depend on the sequence reseed it in setUp()
+static uint32_t rngState = 12345;
+static inline void seedRandom(uint32_t seed) {
+    rngState = seed;
+}
+static inline uint32_t nextRandom() {
+    rngState = rngState * 1664525u + 1013904223u;
+    return rngState >> 8;
+}
+
+// Enabled rule that turns the AC on at 25°C; an hour of -1 or a temperature
+// of RULE_ANY_TEMP leaves the condition out
+static inline ACRule makeRule(int id, int startHour = -1, int endHour = -1, float minTemp = RULE_ANY_TEMP,
+                              float maxTemp = RULE_ANY_TEMP) {
+    ACRule rule = {};
+    rule.id = (uint16_t)id;
+    rule.priority = (uint16_t)id;
+    rule.flags = RULE_FLAG_ENABLED | RULE_FLAG_AC_ON;
+    ruleSetStartHour(rule, startHour);
+    ruleSetEndHour(rule, endHour);
+    ruleSetMinTemp(rule, minTemp);
+    ruleSetMaxTemp(rule, maxTemp);
+    rule.setTemp = 2500;
+    return rule;
+}
+
+// Named rule like the ones users build: random window, threshold, mode and fan
+static inline ACRule makeRandomRule(int id, RuleNamePool& names) {
+    char name[24];
+    snprintf(name, sizeof(name), "Rule %d", id);
+    ACRule rule = makeRule(id);
+    rule.nameId = names.intern(name);
+    rule.priority = (uint16_t)(id * 10);
+    ruleSetStartMinute(rule, (int)(nextRandom() % MINUTES_PER_DAY));
+    ruleSetEndMinute(rule, (int)(nextRandom() % MINUTES_PER_DAY));
+    ruleSetMinTemp(rule, 24.0f + (nextRandom() % 40) / 10.0f);
+    rule.setTemp = tempToCenti(26.0f);
+    rule.mode = acModeFromInt(nextRandom() % 5);
+    rule.fanSpeed = acFanSpeedFromInt(nextRandom() % 4);
+    return rule;
+}
+
+// Field by field: ACRule has padding, and name handles differ between pools
+static inline bool sameRule(const ACRule& a, const RuleNamePool& aNames, const ACRule& b,
+                            const RuleNamePool& bNames) {
+    return a.id == b.id && strcmp(aNames.get(a.nameId), bNames.get(b.nameId)) == 0 && a.priority == b.priority &&
+           a.flags == b.flags && a.present == b.present && a.startMinute == b.startMinute &&
+           a.endMinute == b.endMinute && a.weekdays == b.weekdays && a.minTemp == b.minTemp &&
+           a.maxTemp == b.maxTemp && a.setTemp == b.setTemp && a.mode == b.mode && a.fanSpeed == b.fanSpeed &&
+           a.vSwing == b.vSwing && a.hSwing == b.hSwing;
+}
+
+static inline bool sameRules(const RuleSet& a, const RuleNamePool& aNames, const RuleSet& b,
+                             const RuleNamePool& bNames) {
+    if (a.size() != b.size() || a.exceptionCount() != b.exceptionCount()) return false;
+    for (int i = 0; i < a.size(); i++) {
+        const ACRule* other = b.find(a[i].id);
+        if (other == nullptr || !sameRule(a[i], aNames, *other, bNames)) return false;
+    }
+    for (int i = 0; i < a.exceptionCount(); i++) {
+        const RuleDateException& left = a.exceptionData()[i];
+        const RuleDateException& right = b.exceptionData()[i];
+        if (left.ruleId != right.ruleId || left.firstDay != right.firstDay || left.lastDay != right.lastDay) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include <unity.h>
+
+#include "http_etag.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// /api/snapshot and /api/rules revalidation: the browser sends back the ETag
+// of its copy and gets a 304 while the version is unchanged
+void test_matching_tag_is_not_modified() {
+    TEST_ASSERT_TRUE(etagMatches("\"s42\"", "\"s42\""));
+    TEST_ASSERT_TRUE(etagMatches("\"r7\"", "\"r7\""));
+    TEST_ASSERT_FALSE(etagMatches("\"s41\"", "\"s42\""));
+    TEST_ASSERT_FALSE(etagMatches("\"s4\"", "\"s42\""));     // Prefix of the current tag
+    TEST_ASSERT_FALSE(etagMatches("\"s420\"", "\"s42\""));
+    TEST_ASSERT_FALSE(etagMatches("s42", "\"s42\""));        // Quotes are part of the tag
+}
+
+void test_tag_lists_and_wildcard() {
+    TEST_ASSERT_TRUE(etagMatches("\"a1\", \"s42\"", "\"s42\""));
+    TEST_ASSERT_TRUE(etagMatches("\"s42\",\"a1\"", "\"s42\""));
+    TEST_ASSERT_TRUE(etagMatches(" \"a1\" ,\t\"s42\" ", "\"s42\""));
+    TEST_ASSERT_FALSE(etagMatches("\"a1\", \"b2\"", "\"s42\""));
+    TEST_ASSERT_TRUE(etagMatches("*", "\"s42\""));
+}
+
+// If-None-Match compares weakly: W/ on either side does not matter
+void test_weak_tags() {
+    TEST_ASSERT_TRUE(etagMatches("W/\"s42\"", "\"s42\""));
+    TEST_ASSERT_TRUE(etagMatches("\"s42\"", "W/\"s42\""));
+    TEST_ASSERT_TRUE(etagMatches("\"a1\", W/\"s42\"", "\"s42\""));
+    TEST_ASSERT_FALSE(etagMatches("W/\"s41\"", "\"s42\""));
+}
+
+void test_missing_or_malformed_header() {
+    TEST_ASSERT_FALSE(etagMatches(nullptr, "\"s42\""));
+    TEST_ASSERT_FALSE(etagMatches("", "\"s42\""));
+    TEST_ASSERT_FALSE(etagMatches(" , ,", "\"s42\""));
+    TEST_ASSERT_FALSE(etagMatches("\"s42", "\"s42\""));      // Unterminated
+    TEST_ASSERT_FALSE(etagMatches("W/", "\"s42\""));
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_matching_tag_is_not_modified);
+    RUN_TEST(test_tag_lists_and_wildcard);
+    RUN_TEST(test_weak_tags);
+    RUN_TEST(test_missing_or_malformed_header);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
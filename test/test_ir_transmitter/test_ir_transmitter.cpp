@@ -0,0 +1,85 @@
+#include <unity.h>
+#include <freertos/queue.h>
+
+#include "ir_control.h"
+#include "ir_transmitter.h"
+#include "test_helpers.h"
+
+// Runs against the simulator's shims (pio test -e sim_test), which share
+// the device's queue semantics and can make a send fail on demand
+
+void simIrFrameSent(const uint16_t*, uint16_t, uint16_t) {}
+
+static ACState coolAt(uint8_t temperature) {
+    return makeACState(true, temperature, AC_FAN_AUTO, AC_MODE_COOL, 0, 0);
+}
+
+static void drainQueue() {
+    while (serviceIrTransmitQueue(0)) {}
+}
+
+void setUp(void) {
+    simQueueFailSends = 0;
+    drainQueue();
+}
+
+void tearDown(void) {
+}
+
+// A full queue drops its oldest request; the new state is always queued
+void test_full_queue_drops_oldest() {
+    for (int i = 0; i < IR_TX_QUEUE_LENGTH; i++) {
+        TEST_ASSERT_EQUAL(IR_TX_QUEUED, queueACState(coolAt(17 + i), IR_TX_RULE));
+    }
+    uint32_t dropped = getIrTxStats().dropped;
+    TEST_ASSERT_EQUAL(IR_TX_QUEUED, queueACState(coolAt(28), IR_TX_RULE));
+    TEST_ASSERT_EQUAL(dropped + 1, getIrTxStats().dropped);
+}
+
+// A request that never reached the queue leaves the tracked state as it
+// was, so asking for the same state again queues it instead of reporting it
+// unchanged
+void test_failed_send_is_retried() {
+    for (int i = 0; i < IR_TX_QUEUE_LENGTH; i++) {
+        queueACState(coolAt(17 + i), IR_TX_RULE);
+    }
+    ACState before;
+    TEST_ASSERT_TRUE(getCurrentACState(before));
+
+    simQueueFailSends = 2;   // The first send and the one after dropping the oldest
+    TEST_ASSERT_EQUAL(IR_TX_FAILED, queueACState(coolAt(30), IR_TX_MANUAL));
+    ACState after;
+    TEST_ASSERT_TRUE(getCurrentACState(after));
+    TEST_ASSERT_TRUE(acStateEquals(before, after));
+
+    TEST_ASSERT_EQUAL(IR_TX_QUEUED, queueACState(coolAt(30), IR_TX_MANUAL));
+    TEST_ASSERT_TRUE(getCurrentACState(after));
+    TEST_ASSERT_TRUE(acStateEquals(coolAt(30), after));
+    TEST_ASSERT_EQUAL(IR_TX_UNCHANGED, queueACState(coolAt(30), IR_TX_MANUAL));
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    initIrTransmitter();
+    acController.init();
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_full_queue_drops_oldest);
+    RUN_TEST(test_failed_send_is_retried);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
@@ -0,0 +1,285 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "json_chunk_writer.h"
+#include "rule_json.h"
+#include "rule_set.h"
+#include "rule_store.h"
+#include "temp_history.h"
+#include "test_helpers.h"
+#include "heap_accounting.h"
+
+#define SEND_BUFFER 1436   // One TCP segment, what AsyncTCP usually offers a filler
+
+static void publishRules(RuleStore& store, int count) {
+    RuleSet rules;
+    RuleNamePool names;
+    for (int i = 1; i <= count; i++) {
+        rules.insert(makeRandomRule(i, names));
+    }
+    store.publish(rules.data(), rules.size(), names, rules.exceptionData(), rules.exceptionCount());
+}
+
+// The rule list as one document, the way handlers built responses before
+static void ruleListDocument(const RuleSnapshot& snapshot, JsonDocument& doc) {
+    JsonArray rules = doc["rules"].to<JsonArray>();
+    for (size_t i = 0; i < snapshot.rules.size(); i++) {
+        ruleToJson(snapshot.rules[i], snapshot, rules.add<JsonObject>());
+    }
+}
+
+// Drain a stream the way AsyncWebServer calls a chunked filler: one send
+// buffer per call until a call returns 0. `carried` gets the most the stream
+// held between calls.
+template <typename WriteItem>
+static std::string drain(JsonListStream& stream, size_t chunk, WriteItem writeItem, size_t* carried = nullptr) {
+    std::vector<uint8_t> buffer(chunk);
+    std::string sent;
+    for (;;) {
+        size_t length = stream.fill(buffer.data(), chunk, writeItem);
+        if (length == 0) break;
+        sent.append((const char*)buffer.data(), length);
+        if (carried && stream.carried() > *carried) *carried = stream.carried();
+    }
+    return sent;
+}
+
+static void fillHistory(TempHistory& history, int samples) {
+    for (int i = 0; i < samples; i++) {
+        TempHistorySample sample = {1760000000u + (uint32_t)i * TEMP_HISTORY_PERIOD_SEC,
+                                    (int16_t)(2650 + (int)(nextRandom() % 300)), (uint8_t)(i % 7 != 0), 26};
+        history.add(sample);
+    }
+}
+
+void setUp(void) {
+    seedRandom(18);
+}
+
+void tearDown(void) {
+}
+
+void test_writer_carries_overflow() {
+    uint8_t buffer[8];
+    std::string carry;
+    JsonChunkWriter out(buffer, sizeof(buffer), carry);
+    out.write((const uint8_t*)"01234", 5);
+    TEST_ASSERT_FALSE(out.full());
+    out.write((const uint8_t*)"56789ABCDEF", 11);
+    out.write((uint8_t)'G');
+    TEST_ASSERT_EQUAL(8, out.copied());
+    TEST_ASSERT_TRUE(out.full());
+    TEST_ASSERT_EQUAL_MEMORY("01234567", buffer, 8);
+    TEST_ASSERT_TRUE(carry == "89ABCDEFG");
+}
+
+// Every send-buffer size yields the body a whole document would serialize to
+void test_stream_matches_document() {
+    RuleStore store;
+    publishRules(store, 40);
+    RuleSnapshotGuard snapshot(store);
+
+    JsonDocument whole;
+    ruleListDocument(*snapshot, whole);
+    std::string expected;
+    serializeJson(whole, expected);
+
+    JsonDocument item;
+    auto writeRule = [&](uint32_t i, JsonListStream::ItemWriter& out) {
+        item.clear();
+        ruleToJson(snapshot->rules[i], *snapshot, item.to<JsonObject>());
+        serializeJson(item, out);
+    };
+    const size_t chunks[] = {1, 7, 64, 536, SEND_BUFFER, 65536};
+    for (size_t chunk : chunks) {
+        JsonListStream stream("{\"rules\":[", "]}", 0, snapshot->rules.size());
+        std::string sent = drain(stream, chunk, writeRule);
+        TEST_ASSERT_EQUAL(expected.size(), sent.size());
+        TEST_ASSERT_TRUE(sent == expected);
+        TEST_ASSERT_EQUAL(40, stream.itemsWritten());
+    }
+}
+
+// Items that write nothing (filtered, or overwritten before their turn)
+// leave no stray commas
+void test_skipped_items() {
+    auto evenOnly = [](uint32_t i, JsonListStream::ItemWriter& out) {
+        if (i % 2 == 0) out.write(std::to_string(i).c_str());
+    };
+    JsonListStream stream("[", "]", 1, 8);
+    TEST_ASSERT_TRUE(drain(stream, 3, evenOnly) == "[2,4,6]");
+
+    auto none = [](uint32_t, JsonListStream::ItemWriter&) {};
+    JsonListStream empty("{\"samples\":[", "]}", 0, 5);
+    TEST_ASSERT_TRUE(drain(empty, 4, none) == "{\"samples\":[]}");
+    JsonListStream noItems("[", "]", 0, 0);
+    TEST_ASSERT_TRUE(drain(noItems, SEND_BUFFER, none) == "[]");
+}
+
+void test_history_export() {
+    TempHistory history;
+    fillHistory(history, TEMP_HISTORY_LENGTH + 100);
+    TEST_ASSERT_EQUAL(100, history.first());
+
+    auto writeSample = [&](uint32_t i, JsonListStream::ItemWriter& out) {
+        TempHistorySample sample;
+        if (!history.get(i, sample)) return;
+        char text[96];
+        out.write((const uint8_t*)text, tempHistorySampleJson(sample, text, sizeof(text)));
+    };
+    JsonListStream stream("{\"periodSec\":60,\"samples\":[", "]}", history.first(), history.end());
+    std::string sent = drain(stream, SEND_BUFFER, writeSample);
+
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, sent.c_str()));
+    JsonArray samples = doc["samples"].as<JsonArray>();
+    TEST_ASSERT_EQUAL(TEMP_HISTORY_LENGTH, samples.size());
+    TEST_ASSERT_EQUAL(1760000000u + 100 * TEMP_HISTORY_PERIOD_SEC, samples[0]["time"].as<uint32_t>());
+}
+
+// Time and heap to send the rule list and the history. Heap counts every
+// allocation made while the body is built and sent (documents via
+// jsonAllocator, text and stream state via operator new) but not the
+// server's send buffer. "document + String" is what handlers did before;
+// "exact text" is sendJson(); "stream" is JsonListStream, which never holds
+// more than one item.
+void test_benchmark_heap_high_water() {
+    const int sizes[] = {4, 100, 500};
+    for (int count : sizes) {
+        RuleStore store;
+        publishRules(store, count);
+        RuleSnapshotGuard snapshot(store);
+
+        size_t base = heapMark();
+        uint64_t start = benchMicros();
+        std::string assembled;
+        {
+            JsonDocument doc(&jsonAllocator);
+            ruleListDocument(*snapshot, doc);
+            serializeJson(doc, assembled);
+        }
+        uint64_t stringUs = benchMicros() - start;
+        size_t stringPeak = heapPeak - base;
+        size_t body = assembled.size();
+        assembled = std::string();
+
+        base = heapMark();
+        start = benchMicros();
+        std::string exact;
+        {
+            JsonDocument doc(&jsonAllocator);
+            ruleListDocument(*snapshot, doc);
+            exact.reserve(measureJson(doc));
+            serializeJson(doc, exact);
+        }
+        uint64_t exactUs = benchMicros() - start;
+        size_t exactPeak = heapPeak - base;
+        TEST_ASSERT_EQUAL(body, exact.size());
+        exact = std::string();
+
+        std::vector<uint8_t> buffer(SEND_BUFFER);
+        base = heapMark();
+        start = benchMicros();
+        size_t sent = 0;
+        {
+            JsonDocument item(&jsonAllocator);
+            auto writeRule = [&](uint32_t i, JsonListStream::ItemWriter& out) {
+                item.clear();
+                ruleToJson(snapshot->rules[i], *snapshot, item.to<JsonObject>());
+                serializeJson(item, out);
+            };
+            JsonListStream stream("{\"rules\":[", "]}", 0, snapshot->rules.size());
+            for (size_t length; (length = stream.fill(buffer.data(), buffer.size(), writeRule)) > 0;) {
+                sent += length;
+            }
+        }
+        uint64_t streamUs = benchMicros() - start;
+        size_t streamPeak = heapPeak - base;
+        TEST_ASSERT_EQUAL(body, sent);
+        if (count >= 100) TEST_ASSERT_TRUE(streamPeak * 4 < exactPeak);
+
+        printf("[bench] %d rules, %zu B: document + String peak %zu B, %llu us; exact text %zu B, %llu us; "
+               "stream %zu B, %llu us\n",
+               count, body, stringPeak, (unsigned long long)stringUs, exactPeak, (unsigned long long)exactUs,
+               streamPeak, (unsigned long long)streamUs);
+    }
+
+    TempHistory* history = new TempHistory();
+    fillHistory(*history, TEMP_HISTORY_LENGTH);
+    char text[96];
+
+    size_t base = heapMark();
+    uint64_t start = benchMicros();
+    size_t body;
+    {
+        JsonDocument doc(&jsonAllocator);
+        doc["periodSec"] = TEMP_HISTORY_PERIOD_SEC;
+        JsonArray samples = doc["samples"].to<JsonArray>();
+        for (uint32_t i = history->first(); i < history->end(); i++) {
+            TempHistorySample sample;
+            history->get(i, sample);
+            JsonObject item = samples.add<JsonObject>();
+            item["time"] = sample.time;
+            item["temp"] = sample.tempCenti / 100.0;
+            item["acOn"] = sample.acOn != 0;
+            item["setTemp"] = sample.setTemp;
+        }
+        std::string assembled;
+        serializeJson(doc, assembled);
+        body = assembled.size();
+    }
+    uint64_t documentUs = benchMicros() - start;
+    size_t documentPeak = heapPeak - base;
+
+    std::vector<uint8_t> buffer(SEND_BUFFER);
+    base = heapMark();
+    start = benchMicros();
+    size_t sent = 0;
+    {
+        auto writeSample = [&](uint32_t i, JsonListStream::ItemWriter& out) {
+            TempHistorySample sample;
+            if (history->get(i, sample)) out.write((const uint8_t*)text, tempHistorySampleJson(sample, text, sizeof(text)));
+        };
+        JsonListStream stream("{\"periodSec\":60,\"samples\":[", "]}", history->first(), history->end());
+        for (size_t length; (length = stream.fill(buffer.data(), buffer.size(), writeSample)) > 0;) {
+            sent += length;
+        }
+    }
+    uint64_t streamUs = benchMicros() - start;
+    size_t streamPeak = heapPeak - base;
+    TEST_ASSERT_TRUE(streamPeak * 20 < documentPeak);
+    TEST_ASSERT_TRUE(sent > body * 9 / 10);   // Number formatting differs slightly
+
+    printf("[bench] history %d samples, %zu B: document + String peak %zu B, %llu us; stream %zu B, %llu us\n",
+           TEMP_HISTORY_LENGTH, sent, documentPeak, (unsigned long long)documentUs, streamPeak,
+           (unsigned long long)streamUs);
+    delete history;
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_writer_carries_overflow);
+    RUN_TEST(test_stream_matches_document);
+    RUN_TEST(test_skipped_items);
+    RUN_TEST(test_history_export);
+    RUN_TEST(test_benchmark_heap_high_water);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
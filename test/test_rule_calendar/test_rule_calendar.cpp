@@ -0,0 +1,120 @@
+#include <unity.h>
+#include <stdio.h>
+
+#include "rule_calendar.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_day_numbers() {
+    TEST_ASSERT_EQUAL(0, ruleDayNumber(2000, 1, 1));
+    TEST_ASSERT_EQUAL(59, ruleDayNumber(2000, 2, 29));  // Leap century
+    TEST_ASSERT_EQUAL(9800, ruleDayNumber(2026, 10, 31));
+    TEST_ASSERT_EQUAL(-1, ruleDayNumber(1999, 12, 31));
+
+    // Round trip over every day the exception records can hold
+    for (int32_t day = 0; day <= RULE_MAX_DAY; day++) {
+        int year, month, date;
+        ruleDayToDate(day, year, month, date);
+        TEST_ASSERT_EQUAL(day, ruleDayNumber(year, month, date));
+    }
+
+    // 2000-01-01 was a Saturday; weekdays follow from the day number
+    TEST_ASSERT_EQUAL(6, (ruleDayNumber(2000, 1, 1) + 6) % 7);
+    TEST_ASSERT_EQUAL(6, (ruleDayNumber(2026, 10, 31) + 6) % 7);
+}
+
+void test_exceptions_switch_tables() {
+    ACRule rules[3] = {makeRule(1, 8, 18), makeRule(2, -1, -1), makeRule(3, -1, -1)};
+    // Rule 1 off for a week, rule 2 off for two days inside it, unknown rule 9 ignored
+    RuleDateException exceptions[3] = {{1, 100, 106}, {2, 103, 104}, {9, 50, 60}};
+    RuleCalendar calendar;
+    calendar.compile(rules, 3, exceptions, 3);
+
+    int noon = weekMinute(2, 12, 0);
+    TEST_ASSERT_EQUAL(3, calendar.getTableCount());  // None, {1}, {1, 2}
+    TEST_ASSERT_EQUAL(4, calendar.getSpanCount());   // 100, 103, 105, 107
+    TEST_ASSERT_EQUAL(0, calendar.lookup(55, noon, 2500));
+    TEST_ASSERT_EQUAL(0, calendar.lookup(99, noon, 2500));
+    TEST_ASSERT_EQUAL(1, calendar.lookup(100, noon, 2500));
+    TEST_ASSERT_EQUAL(2, calendar.lookup(103, noon, 2500));
+    TEST_ASSERT_EQUAL(2, calendar.lookup(104, noon, 2500));
+    TEST_ASSERT_EQUAL(1, calendar.lookup(105, noon, 2500));
+    TEST_ASSERT_EQUAL(0, calendar.lookup(107, noon, 2500));
+
+    TEST_ASSERT_EQUAL(100 - 40, calendar.daysUntilChange(40));
+    TEST_ASSERT_EQUAL(2, calendar.daysUntilChange(101));
+    TEST_ASSERT_EQUAL(2, calendar.daysUntilChange(105));
+    TEST_ASSERT_EQUAL(0, calendar.daysUntilChange(107));
+}
+
+void test_adjacent_exceptions_merge() {
+    ACRule rules[2] = {makeRule(1, -1, -1), makeRule(2, -1, -1)};
+    RuleDateException exceptions[2] = {{1, 10, 12}, {1, 13, 15}};
+    RuleCalendar calendar;
+    calendar.compile(rules, 2, exceptions, 2);
+
+    // Back-to-back ranges with the same excluded set are one span
+    TEST_ASSERT_EQUAL(2, calendar.getTableCount());
+    TEST_ASSERT_EQUAL(2, calendar.getSpanCount());
+    TEST_ASSERT_EQUAL(6, calendar.daysUntilChange(10));
+    TEST_ASSERT_EQUAL(1, calendar.lookup(14, 0, 2500));
+}
+
+// An overnight window belongs to the day it starts on: excepting Christmas
+// Eve drops the night from 22:00 on the 24th to 06:00 on the 25th
+void test_overnight_exception() {
+    ACRule rules[2] = {makeRule(1, 22, 6), makeRule(2, -1, -1)};
+    int32_t eve = ruleDayNumber(2026, 12, 24);   // Thursday
+    RuleDateException exceptions[1] = {{1, (uint16_t)eve, (uint16_t)eve}};
+    RuleCalendar calendar;
+    calendar.compile(rules, 2, exceptions, 1);
+
+    TEST_ASSERT_EQUAL(0, calendar.lookup(eve, weekMinute(4, 5, 0), 2500));       // The 23rd's night
+    TEST_ASSERT_EQUAL(1, calendar.lookup(eve, weekMinute(4, 12, 0), 2500));
+    TEST_ASSERT_EQUAL(1, calendar.lookup(eve, weekMinute(4, 23, 0), 2500));      // Excepted night
+    TEST_ASSERT_EQUAL(1, calendar.lookup(eve + 1, weekMinute(5, 3, 0), 2500));
+    TEST_ASSERT_EQUAL(1, calendar.lookup(eve + 1, weekMinute(5, 6, 0), 2500));
+    TEST_ASSERT_EQUAL(0, calendar.lookup(eve + 1, weekMinute(5, 22, 0), 2500));  // The 25th's night
+    TEST_ASSERT_EQUAL(0, calendar.lookup(eve + 2, weekMinute(6, 3, 0), 2500));
+    TEST_ASSERT_EQUAL(0, calendar.lookup(eve - 1, weekMinute(3, 23, 0), 2500));
+
+    // Evening off, then morning off, then back to the full week
+    TEST_ASSERT_EQUAL(3, calendar.getSpanCount());
+    TEST_ASSERT_EQUAL(1, calendar.daysUntilChange(eve));
+    TEST_ASSERT_EQUAL(1, calendar.daysUntilChange(eve + 1));
+    TEST_ASSERT_EQUAL(0, calendar.daysUntilChange(eve + 2));
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_day_numbers);
+    RUN_TEST(test_exceptions_switch_tables);
+    RUN_TEST(test_adjacent_exceptions_merge);
+    RUN_TEST(test_overnight_exception);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
@@ -0,0 +1,285 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "rule_engine.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+// Weekday used by the single-day tests (Monday)
+static int atHour(int hour) {
+    return weekMinute(1, hour, 0);
+}
+
+static ACRule disabled(ACRule rule) {
+    ruleSetFlag(rule, RULE_FLAG_ENABLED, false);
+    return rule;
+}
+
+// Random rule set mixing any-time/any-temp sentinels, overnight windows,
+// quarter-hour edges, weekday masks and shared thresholds so slots and
+// buckets get exercised at their boundaries
+static void makeRandomRules(std::vector<ACRule>& out, int count) {
+    out.clear();
+    for (int i = 0; i < count; i++) {
+        int startHour = (nextRandom() % 5 == 0) ? -1 : (int)(nextRandom() % 24);
+        int endHour = (startHour == -1) ? -1 : (int)(nextRandom() % 24);
+        float minTemp = (nextRandom() % 3 == 0) ? -999 : 18.0f + (nextRandom() % 120) / 10.0f;
+        float maxTemp = (nextRandom() % 3 == 0) ? -999 : 20.0f + (nextRandom() % 120) / 10.0f;
+        bool enabled = (nextRandom() % 10) != 0;
+        ACRule rule = makeRule(i + 1, startHour, endHour, minTemp, maxTemp);
+        ruleSetFlag(rule, RULE_FLAG_ENABLED, enabled);
+        if (startHour != -1) {
+            ruleSetStartMinute(rule, startHour * 60 + (nextRandom() % 4) * 15);
+        }
+        if (nextRandom() % 3 == 0) {
+            ruleSetWeekdays(rule, 1 + nextRandom() % RULE_ALL_WEEKDAYS);
+        }
+        out.push_back(rule);
+    }
+}
+
+void setUp(void) {
+    seedRandom(12345);
+}
+
+void tearDown(void) {
+}
+
+void test_default_rules_lookup() {
+    ACRule rules[3] = {
+        makeRule(1, 8, 19, 26.0, -999),
+        makeRule(2, 19, 8, 26.0, -999),
+        makeRule(3, -1, -1, -999, 25.9)
+    };
+    RuleDecisionTable table;
+    table.compile(rules, 3);
+
+    TEST_ASSERT_EQUAL(0, table.lookup(atHour(12), 2800));   // Day, hot
+    TEST_ASSERT_EQUAL(1, table.lookup(atHour(23), 2600));   // Night, exactly at minTemp
+    TEST_ASSERT_EQUAL(1, table.lookup(atHour(3), 3000));    // Overnight wrap
+    TEST_ASSERT_EQUAL(2, table.lookup(atHour(12), 2590));   // Exactly at maxTemp
+    TEST_ASSERT_EQUAL(-1, table.lookup(atHour(12), 2595));  // Gap between 25.9 and 26.0
+}
+
+void test_first_match_priority() {
+    ACRule rules[3] = {
+        disabled(makeRule(1)),                 // Disabled catch-all
+        makeRule(2, 8, 18, 20, 30),
+        makeRule(3, -1, -1, -999, -999)    // Fallback
+    };
+    RuleDecisionTable table;
+    table.compile(rules, 3);
+
+    TEST_ASSERT_EQUAL(1, table.lookup(atHour(10), 2500));
+    TEST_ASSERT_EQUAL(2, table.lookup(atHour(10), 3100));
+    TEST_ASSERT_EQUAL(2, table.lookup(atHour(20), 2500));
+}
+
+void test_empty_rule_set() {
+    RuleDecisionTable table;
+    TEST_ASSERT_EQUAL(-1, table.lookup(atHour(10), 2500));
+    table.compile(nullptr, 0);
+    TEST_ASSERT_TRUE(table.isCompiled());
+    TEST_ASSERT_EQUAL(1, table.getBucketCount());
+    TEST_ASSERT_EQUAL(-1, table.lookup(atHour(10), 2500));
+}
+
+void test_table_matches_linear_scan() {
+    std::vector<ACRule> rules;
+    for (int round = 0; round < 20; round++) {
+        makeRandomRules(rules, 1 + round * 3);
+        RuleDecisionTable table;
+        table.compile(rules.data(), (int)rules.size());
+
+        // Every quarter hour of the week hits every window edge generated above
+        for (int minute = 0; minute < MINUTES_PER_WEEK; minute += 15) {
+            // 0.05°C steps hit every threshold generated above exactly
+            for (int16_t temp = 1500; temp <= 3500; temp += 5) {
+                TEST_ASSERT_EQUAL(findMatchingRuleLinear(rules.data(), (int)rules.size(), minute, temp),
+                                  table.lookup(minute, temp));
+            }
+        }
+    }
+}
+
+void test_identical_hours_share_segments() {
+    ACRule rules[3] = {
+        makeRule(1, 8, 19, 26.0, -999),
+        makeRule(2, 19, 8, 26.0, -999),
+        makeRule(3, -1, -1, -999, 25.9)
+    };
+    RuleDecisionTable table;
+    table.compile(rules, 3);
+
+    // Two distinct rows (day, night), three segments each: off, gap, cool,
+    // alternating over the week and wrapping from Saturday night into Sunday
+    TEST_ASSERT_EQUAL(3, table.getBucketCount());
+    TEST_ASSERT_EQUAL(2, table.getRowCount());
+    TEST_ASSERT_EQUAL(6, table.getSegmentCount());
+    TEST_ASSERT_EQUAL(15, table.getSlotCount());
+    TEST_ASSERT_EQUAL(2, table.lookup(atHour(0), -3000));
+    TEST_ASSERT_EQUAL(1, table.lookup(atHour(0), 3000));
+    TEST_ASSERT_EQUAL(0, table.lookup(atHour(18), 3000));
+}
+
+void test_weekday_minute_windows() {
+    // Weekdays 07:30-08:45, Friday overnight 22:15-01:00, fallback
+    ACRule rules[3] = {
+        makeRule(1, -1, -1, -999, -999),
+        makeRule(2, -1, -1, -999, -999),
+        makeRule(3, -1, -1, -999, -999)
+    };
+    ruleSetStartMinute(rules[0], 7 * 60 + 30);
+    ruleSetEndMinute(rules[0], 8 * 60 + 45);
+    ruleSetWeekdays(rules[0], 0x3E);  // Monday-Friday
+    ruleSetStartMinute(rules[1], 22 * 60 + 15);
+    ruleSetEndMinute(rules[1], 60);
+    ruleSetWeekdays(rules[1], 1 << 5);
+    RuleDecisionTable table;
+    table.compile(rules, 3);
+
+    TEST_ASSERT_EQUAL(2, table.lookup(weekMinute(1, 7, 29), 2500));
+    TEST_ASSERT_EQUAL(0, table.lookup(weekMinute(1, 7, 30), 2500));
+    TEST_ASSERT_EQUAL(0, table.lookup(weekMinute(5, 8, 44), 2500));
+    TEST_ASSERT_EQUAL(2, table.lookup(weekMinute(5, 8, 45), 2500));
+    TEST_ASSERT_EQUAL(2, table.lookup(weekMinute(6, 7, 45), 2500));  // Saturday
+    TEST_ASSERT_EQUAL(1, table.lookup(weekMinute(5, 23, 0), 2500));
+    TEST_ASSERT_EQUAL(1, table.lookup(weekMinute(6, 0, 59), 2500));  // Belongs to Friday
+    TEST_ASSERT_EQUAL(2, table.lookup(weekMinute(4, 23, 0), 2500));
+
+    // Next change is the nearest edge, across the end of the week if needed
+    TEST_ASSERT_EQUAL(1, table.minutesUntilChange(weekMinute(1, 7, 29)));
+    TEST_ASSERT_EQUAL(75, table.minutesUntilChange(weekMinute(1, 7, 30)));
+    TEST_ASSERT_EQUAL(22 * 60 + 15 - 9 * 60, table.minutesUntilChange(weekMinute(5, 9, 0)));
+    TEST_ASSERT_EQUAL(60 + MINUTES_PER_DAY + 7 * 60 + 30, table.minutesUntilChange(weekMinute(6, 23, 0)));
+
+    ACRule allWeek[1] = {makeRule(1, -1, -1, 26.0, -999)};
+    table.compile(allWeek, 1);
+    TEST_ASSERT_EQUAL(0, table.minutesUntilChange(weekMinute(3, 10, 0)));
+}
+
+void test_name_pool_interning() {
+    RuleNamePool names;
+    uint16_t day = names.intern("Cool Day");
+    uint16_t night = names.intern("Cool Night");
+    TEST_ASSERT_EQUAL(day, names.intern("Cool Day"));
+    TEST_ASSERT_NOT_EQUAL(day, night);
+    TEST_ASSERT_EQUAL_STRING("Cool Night", names.get(night));
+    TEST_ASSERT_EQUAL_STRING("", names.get(99));
+
+    // Compaction drops unreferenced names and remaps the survivors
+    ACRule rules[1] = {makeRule(1, -1, -1, -999, -999)};
+    rules[0].nameId = night;
+    names.compact(rules, 1);
+    TEST_ASSERT_EQUAL(1, names.size());
+    TEST_ASSERT_EQUAL_STRING("Cool Night", names.get(rules[0].nameId));
+    TEST_ASSERT_EQUAL(rules[0].nameId, names.intern("Cool Night"));
+
+    // Enough names to force the hash index to grow several times
+    char name[16];
+    for (int i = 0; i < 2000; i++) {
+        snprintf(name, sizeof(name), "Rule %d", i);
+        TEST_ASSERT_EQUAL(i + 1, names.intern(name));
+    }
+    TEST_ASSERT_EQUAL(1234 + 1, names.intern("Rule 1234"));
+    TEST_ASSERT_EQUAL_STRING("Rule 1999", names.get(2000));
+}
+
+void test_packed_rule_accessors() {
+    ACRule rule = makeRule(1, 19, -1, 26.0, -999);
+    TEST_ASSERT_EQUAL(19 * 60, ruleStartMinute(rule));
+    TEST_ASSERT_EQUAL(-1, ruleEndMinute(rule));
+    TEST_ASSERT_EQUAL(2600, rule.minTemp);
+    TEST_ASSERT_EQUAL_FLOAT(-999, ruleMaxTemp(rule));
+    TEST_ASSERT_TRUE(ruleActiveAt(rule, atHour(3))); // Window needs both ends
+    TEST_ASSERT_EQUAL(RULE_ALL_WEEKDAYS, ruleWeekdays(rule));  // Zeroed mask = every day
+
+    ruleSetMaxTemp(rule, 25.9);
+    TEST_ASSERT_EQUAL(2590, rule.maxTemp);
+    TEST_ASSERT_EQUAL_FLOAT(25.9, ruleMaxTemp(rule));
+    TEST_ASSERT_EQUAL(AC_FAN_AUTO, acFanSpeedFromInt(7));
+
+    // Out-of-range temperatures saturate instead of wrapping around
+    ruleSetMinTemp(rule, 400.0f);
+    TEST_ASSERT_EQUAL(INT16_MAX, rule.minTemp);
+    ruleSetMaxTemp(rule, -500.0f);
+    TEST_ASSERT_EQUAL(INT16_MIN, rule.maxTemp);
+    TEST_ASSERT_EQUAL(INT16_MAX, tempToCenti(1e30f));
+    TEST_ASSERT_EQUAL(-32767, tempToCenti(-327.67f));
+    TEST_ASSERT_EQUAL(0, tempToCenti(NAN));
+}
+
+// Benchmark: linear scan vs decision table lookup at several rule-set sizes
+void test_benchmark_linear_vs_table() {
+    const int sizes[] = {10, 100, 1000};
+    const int lookups = 200000;
+    std::vector<ACRule> rules;
+
+    for (int s = 0; s < 3; s++) {
+        makeRandomRules(rules, sizes[s]);
+        // Keep the scan honest: no catch-all rules, so misses walk the full list
+        for (size_t i = 0; i < rules.size(); i++) {
+            if (!(rules[i].present & (RULE_HAS_MIN_TEMP | RULE_HAS_MAX_TEMP))) ruleSetMinTemp(rules[i], 60);
+        }
+
+        RuleDecisionTable table;
+        uint64_t start = benchMicros();
+        table.compile(rules.data(), (int)rules.size());
+        uint64_t compileUs = benchMicros() - start;
+
+        volatile int sink = 0;
+        start = benchMicros();
+        for (int i = 0; i < lookups; i++) {
+            sink += findMatchingRuleLinear(rules.data(), (int)rules.size(), (i * 61) % MINUTES_PER_WEEK,
+                                           (int16_t)(1500 + (i % 300) * 10));
+        }
+        uint64_t linearUs = benchMicros() - start;
+
+        start = benchMicros();
+        for (int i = 0; i < lookups; i++) {
+            sink += table.lookup((i * 61) % MINUTES_PER_WEEK, (int16_t)(1500 + (i % 300) * 10));
+        }
+        uint64_t tableUs = benchMicros() - start;
+
+        printf("[bench] %4d rules: linear %7.1f ns/eval, table %6.1f ns/eval, compile %6llu us, %d buckets, %d segments, %u bytes\n",
+               sizes[s], linearUs * 1000.0 / lookups, tableUs * 1000.0 / lookups,
+               (unsigned long long)compileUs, table.getBucketCount(), table.getSegmentCount(),
+               (unsigned)table.getMemoryUsage());
+        (void)sink;
+    }
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_default_rules_lookup);
+    RUN_TEST(test_first_match_priority);
+    RUN_TEST(test_empty_rule_set);
+    RUN_TEST(test_identical_hours_share_segments);
+    RUN_TEST(test_name_pool_interning);
+    RUN_TEST(test_packed_rule_accessors);
+    RUN_TEST(test_weekday_minute_windows);
+    RUN_TEST(test_table_matches_linear_scan);
+    RUN_TEST(test_benchmark_linear_vs_table);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
@@ -0,0 +1,310 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "rule_image.h"
+#include "rule_journal.h"
+#include "rule_json.h"
+#include "rule_set.h"
+#include "rule_store.h"
+#include "test_helpers.h"
+#include "heap_accounting.h"
+
+// A rule set like the ones users build: varied names, windows and a few holidays
+static void makeRules(int count, RuleSet& rules, RuleNamePool& names) {
+    rules.clear();
+    names.clear();
+    for (int i = 1; i <= count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Bedroom rule %d", i);
+        ACRule rule = makeRule(i);
+        rule.nameId = names.intern(name);
+        rule.priority = (uint16_t)(count - i);
+        ruleSetFlag(rule, RULE_FLAG_AC_ON, i % 3 != 0);
+        ruleSetStartMinute(rule, (int)(nextRandom() % MINUTES_PER_DAY));
+        ruleSetEndMinute(rule, (int)(nextRandom() % MINUTES_PER_DAY));
+        ruleSetWeekdays(rule, 1 + (int)(nextRandom() % RULE_ALL_WEEKDAYS));
+        ruleSetMinTemp(rule, 25.0f + (nextRandom() % 30) / 10.0f);
+        if (i % 4 == 0) ruleSetMaxTemp(rule, 23.5f);
+        rule.setTemp = tempToCenti(26.0f);
+        rule.mode = acModeFromInt(nextRandom() % 5);
+        rule.fanSpeed = acFanSpeedFromInt(nextRandom() % 4);
+        rules.insert(rule);
+        if (i % 5 == 0) {
+            RuleDateException holidays[] = {{0, 20454, 20460}, {0, 20600, 20600}};
+            rules.setExceptions(rule.id, holidays, 2);
+        }
+    }
+}
+
+static void publish(RuleStore& store, const RuleSet& rules, const RuleNamePool& names) {
+    store.publish(rules.data(), rules.size(), names, rules.exceptionData(), rules.exceptionCount());
+}
+
+static void putLE16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void putLE32(uint8_t* p, uint32_t value) {
+    putLE16(p, (uint16_t)value);
+    putLE16(p + 2, (uint16_t)(value >> 16));
+}
+
+static void resealImage(std::vector<uint8_t>& image) {
+    uint32_t crc = journalCrc32(0, image.data(), 28);
+    putLE32(image.data() + 28, journalCrc32(crc, image.data() + RULE_IMAGE_HEADER_SIZE,
+                                            image.size() - RULE_IMAGE_HEADER_SIZE));
+}
+
+void setUp(void) {
+    seedRandom(99);
+}
+
+void tearDown(void) {
+}
+
+void test_image_roundtrip() {
+    RuleSet rules;
+    RuleNamePool names;
+    makeRules(40, rules, names);
+    ruleSetMaxTemp(rules[3], -12.5f);
+    rules[7].nameId = names.intern("Nuit \xe2\x9d\x84");
+    names.compact(rules.data(), rules.size());
+    RuleStore store;
+    publish(store, rules, names);
+
+    std::vector<uint8_t> image;
+    {
+        RuleSnapshotGuard snapshot(store);
+        ruleImageEncode(*snapshot, image);
+    }
+    RuleImage view;
+    TEST_ASSERT_TRUE(ruleImageOpen(image.data(), image.size(), view));
+    TEST_ASSERT_EQUAL(40, view.ruleCount);
+    TEST_ASSERT_EQUAL(16, view.exceptionCount);
+
+    RuleSet loaded;
+    RuleNamePool loadedNames;
+    TEST_ASSERT_TRUE(ruleImageLoad(view, loaded, loadedNames));
+    TEST_ASSERT_TRUE(sameRules(rules, names, loaded, loadedNames));
+}
+
+// Records are in evaluation order and names point into the buffer
+void test_image_reads_in_place() {
+    RuleSet rules;
+    RuleNamePool names;
+    makeRules(10, rules, names);
+    RuleStore store;
+    publish(store, rules, names);
+    std::vector<uint8_t> image;
+    {
+        RuleSnapshotGuard snapshot(store);
+        ruleImageEncode(*snapshot, image);
+    }
+
+    RuleImage view;
+    TEST_ASSERT_TRUE(ruleImageOpen(image.data(), image.size(), view));
+    for (int i = 0; i < view.ruleCount; i++) {
+        ACRule rule;
+        const char* name;
+        TEST_ASSERT_TRUE(ruleImageRule(view, i, rule, name));
+        TEST_ASSERT_EQUAL(i, rule.priority);          // makeRules() numbers priorities backwards
+        TEST_ASSERT_EQUAL(10 - i, rule.id);
+        TEST_ASSERT_EQUAL_STRING(names.get(rules.find(rule.id)->nameId), name);
+        TEST_ASSERT_TRUE(name > (const char*)image.data() && name < (const char*)image.data() + image.size());
+    }
+    RuleDateException exception = ruleImageException(view, 0);
+    TEST_ASSERT_EQUAL(5, exception.ruleId);
+    TEST_ASSERT_EQUAL(20454, exception.firstDay);
+}
+
+void test_damaged_image_is_rejected() {
+    RuleSet rules;
+    RuleNamePool names;
+    makeRules(6, rules, names);
+    RuleStore store;
+    publish(store, rules, names);
+    std::vector<uint8_t> image;
+    {
+        RuleSnapshotGuard snapshot(store);
+        ruleImageEncode(*snapshot, image);
+    }
+    RuleImage view;
+    for (size_t size = 0; size < image.size(); size++) {
+        TEST_ASSERT_FALSE(ruleImageOpen(image.data(), size, view));
+    }
+    for (size_t i = 0; i < image.size(); i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            image[i] ^= (uint8_t)(1 << bit);
+            TEST_ASSERT_FALSE(ruleImageOpen(image.data(), image.size(), view));
+            image[i] ^= (uint8_t)(1 << bit);
+        }
+    }
+
+    // A newer layout is refused even with a valid CRC; so is JSON
+    image[4] = RULE_IMAGE_VERSION + 1;
+    resealImage(image);
+    TEST_ASSERT_FALSE(ruleImageOpen(image.data(), image.size(), view));
+    const char* json = "{\"rules\":[],\"version\":2}";
+    TEST_ASSERT_FALSE(ruleImageOpen((const uint8_t*)json, strlen(json), view));
+
+    // An image in a longer buffer (a flash partition) opens
+    image[4] = RULE_IMAGE_VERSION;
+    resealImage(image);
+    image.resize(image.size() + 100, 0xFF);
+    TEST_ASSERT_TRUE(ruleImageOpen(image.data(), image.size(), view));
+}
+
+// Fields appended to records by a later version are skipped
+void test_longer_records_are_read() {
+    RuleSet rules;
+    RuleNamePool names;
+    makeRules(5, rules, names);
+    RuleStore store;
+    publish(store, rules, names);
+    std::vector<uint8_t> image;
+    {
+        RuleSnapshotGuard snapshot(store);
+        ruleImageEncode(*snapshot, image);
+    }
+
+    const int extra = 4;
+    const size_t recordsEnd = RULE_IMAGE_HEADER_SIZE + 5 * RULE_IMAGE_RECORD_SIZE;
+    std::vector<uint8_t> wider(image.begin(), image.begin() + RULE_IMAGE_HEADER_SIZE);
+    for (int i = 0; i < 5; i++) {
+        const uint8_t* record = image.data() + RULE_IMAGE_HEADER_SIZE + i * RULE_IMAGE_RECORD_SIZE;
+        wider.insert(wider.end(), record, record + RULE_IMAGE_RECORD_SIZE);
+        wider.insert(wider.end(), extra, 0xA5);
+    }
+    wider.insert(wider.end(), image.begin() + recordsEnd, image.end());
+    putLE16(wider.data() + 10, RULE_IMAGE_RECORD_SIZE + extra);
+    putLE32(wider.data() + 24, (uint32_t)wider.size());
+    resealImage(wider);
+
+    RuleImage view;
+    TEST_ASSERT_TRUE(ruleImageOpen(wider.data(), wider.size(), view));
+    RuleSet loaded;
+    RuleNamePool loadedNames;
+    TEST_ASSERT_TRUE(ruleImageLoad(view, loaded, loadedNames));
+    TEST_ASSERT_TRUE(sameRules(rules, names, loaded, loadedNames));
+}
+
+// Same parsing as loadRulesFromSPIFFS() does for JSON records
+static void loadJson(const std::vector<uint8_t>& file, RuleSet& rules, RuleNamePool& names) {
+    JsonDocument doc(&jsonAllocator);
+    deserializeJson(doc, (const char*)file.data(), file.size());
+    JsonArrayConst rulesArray = doc["rules"];
+    rules.clear();
+    rules.reserve(rulesArray.size());
+    names.clear();
+    int position = 0;
+    for (JsonObjectConst rule : rulesArray) {
+        ACRule loaded;
+        std::vector<RuleDateException> exceptions;
+        ruleFromJson(rule, loaded, names, position + 1, position);
+        exceptionsFromJson(rule["exceptions"], exceptions);
+        rules.insert(loaded);
+        rules.setExceptions(loaded.id, exceptions.data(), (int)exceptions.size());
+        position++;
+    }
+}
+
+// Boot-time load of a saved rule set: the record as read from flash, decoded
+// into the editable RuleSet. Peak heap counts the file buffer, the parser's
+// document and the rules being built.
+void test_benchmark_load_json_vs_image() {
+    const int counts[] = {10, 50, 200};
+    for (int count : counts) {
+        RuleSet rules;
+        RuleNamePool names;
+        makeRules(count, rules, names);
+        RuleStore store;
+        publish(store, rules, names);
+
+        std::string json;
+        std::vector<uint8_t> image;
+        {
+            RuleSnapshotGuard snapshot(store);
+            JsonDocument doc;
+            JsonArray rulesArray = doc["rules"].to<JsonArray>();
+            for (const ACRule& r : snapshot->rules) {
+                ruleToJson(r, *snapshot, rulesArray.add<JsonObject>());
+            }
+            doc["count"] = count;
+            doc["version"] = RULES_FILE_VERSION;
+            serializeJson(doc, json);
+            ruleImageEncode(*snapshot, image);
+        }
+
+        const int rounds = 50;
+        uint64_t jsonMicros = 0, imageMicros = 0;
+        size_t jsonPeak = 0, imagePeak = 0;
+        for (int round = 0; round < rounds; round++) {
+            RuleSet loaded;
+            RuleNamePool loadedNames;
+            size_t base = heapMark();
+            uint64_t start = benchMicros();
+            {
+                std::vector<uint8_t> file(json.begin(), json.end());   // readFileBytes()
+                loadJson(file, loaded, loadedNames);
+            }
+            jsonMicros += benchMicros() - start;
+            if (heapPeak - base > jsonPeak) jsonPeak = heapPeak - base;
+            if (round == 0) TEST_ASSERT_TRUE(sameRules(rules, names, loaded, loadedNames));
+        }
+        for (int round = 0; round < rounds; round++) {
+            RuleSet loaded;
+            RuleNamePool loadedNames;
+            size_t base = heapMark();
+            uint64_t start = benchMicros();
+            {
+                std::vector<uint8_t> file(image.begin(), image.end());
+                RuleImage view;
+                TEST_ASSERT_TRUE(ruleImageOpen(file.data(), file.size(), view));
+                TEST_ASSERT_TRUE(ruleImageLoad(view, loaded, loadedNames));
+            }
+            imageMicros += benchMicros() - start;
+            if (heapPeak - base > imagePeak) imagePeak = heapPeak - base;
+            if (round == 0) TEST_ASSERT_TRUE(sameRules(rules, names, loaded, loadedNames));
+        }
+
+        printf("[bench] load %d rules: JSON %u B, %.1f us, peak heap %u B; image %u B, %.1f us, "
+               "peak heap %u B (%.1fx faster, %.1fx less heap)\n",
+               count, (unsigned)json.size(), (double)jsonMicros / rounds, (unsigned)jsonPeak,
+               (unsigned)image.size(), (double)imageMicros / rounds, (unsigned)imagePeak,
+               (double)jsonMicros / imageMicros, (double)jsonPeak / imagePeak);
+        TEST_ASSERT_LESS_THAN(json.size(), image.size());
+        TEST_ASSERT_LESS_THAN(jsonPeak, imagePeak);
+    }
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_image_roundtrip);
+    RUN_TEST(test_image_reads_in_place);
+    RUN_TEST(test_damaged_image_is_rejected);
+    RUN_TEST(test_longer_records_are_read);
+    RUN_TEST(test_benchmark_load_json_vs_image);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
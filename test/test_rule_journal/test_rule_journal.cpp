@@ -0,0 +1,233 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "rule_journal.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+// Stand-in for a SPIFFS File opened with "w"
+struct MemoryFile {
+    std::vector<uint8_t> bytes;
+    size_t write(const uint8_t* data, size_t length) {
+        bytes.insert(bytes.end(), data, data + length);
+        return length;
+    }
+};
+
+// A file that fills up after `capacity` bytes, like a full partition
+struct FullFile {
+    size_t capacity;
+    size_t used;
+    size_t write(const uint8_t* data, size_t length) {
+        (void)data;
+        size_t count = length < capacity - used ? length : capacity - used;
+        used += count;
+        return count;
+    }
+};
+
+// Rules document of roughly the size the firmware saves
+static std::string rulesText(int rules, int tag) {
+    std::string text = "{\"rules\":[";
+    char rule[200];
+    for (int i = 0; i < rules; i++) {
+        snprintf(rule, sizeof(rule),
+                 "%s{\"id\":%d,\"name\":\"Rule %d/%d\",\"priority\":%d,\"enabled\":true,\"startMinute\":480,"
+                 "\"endMinute\":1140,\"weekdays\":127,\"minTemp\":26.5,\"maxTemp\":-999,\"setTemp\":27}",
+                 i ? "," : "", i + 1, i + 1, tag, i);
+        text += rule;
+    }
+    text += "],\"version\":2}";
+    return text;
+}
+
+static std::vector<uint8_t> makeRecord(const std::string& payload, uint32_t sequence) {
+    MemoryFile file;
+    JournalWriter<MemoryFile> out(file);
+    out.write((const uint8_t*)payload.data(), payload.size());
+    return out.finish(sequence) ? file.bytes : std::vector<uint8_t>();
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_crc32_known_value() {
+    const char* check = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, journalCrc32(0, (const uint8_t*)check, 9));
+    // Running CRC over pieces equals the one-shot value
+    uint32_t crc = journalCrc32(0, (const uint8_t*)check, 4);
+    crc = journalCrc32(crc, (const uint8_t*)check + 4, 5);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc);
+    TEST_ASSERT_EQUAL_HEX32(0, journalCrc32(0, nullptr, 0));
+}
+
+void test_record_roundtrip() {
+    std::string payload = rulesText(3, 1);
+    std::vector<uint8_t> record = makeRecord(payload, 42);
+    TEST_ASSERT_EQUAL(payload.size() + JOURNAL_TRAILER_SIZE, record.size());
+    TEST_ASSERT_EQUAL_MEMORY(payload.data(), record.data(), payload.size());
+
+    JournalRecord info = {0, 0};
+    TEST_ASSERT_TRUE(journalCheck(record.data(), record.size(), info));
+    TEST_ASSERT_EQUAL(42, info.sequence);
+    TEST_ASSERT_EQUAL(payload.size(), info.length);
+
+    // Empty payload is a valid record too
+    std::vector<uint8_t> empty = makeRecord("", 1);
+    TEST_ASSERT_TRUE(journalCheck(empty.data(), empty.size(), info));
+    TEST_ASSERT_EQUAL(0, info.length);
+
+    // A short write (full partition) is reported
+    FullFile full = {100, 0};
+    JournalWriter<FullFile> out(full);
+    out.write((const uint8_t*)payload.data(), payload.size());
+    TEST_ASSERT_FALSE(out.finish(43));
+}
+
+// Power cut while saving: the new record (slot 1) ends at every possible
+// byte. Recovery must always find the previous save in slot 0, and the new
+// one only once it is complete.
+void test_truncation_at_every_offset() {
+    std::vector<uint8_t> previous = makeRecord(rulesText(4, 7), 7);
+    std::vector<uint8_t> next = makeRecord(rulesText(5, 8), 8);
+
+    JournalRecord records[JOURNAL_SLOT_COUNT];
+    bool valid[JOURNAL_SLOT_COUNT];
+    valid[0] = journalCheck(previous.data(), previous.size(), records[0]);
+    TEST_ASSERT_TRUE(valid[0]);
+
+    int recovered = 0;
+    for (size_t cut = 0; cut <= next.size(); cut++) {
+        records[1] = {0, 0};
+        valid[1] = journalCheck(next.data(), cut, records[1]);
+        int slot = journalNewestSlot(valid, records);
+        if (cut < next.size()) {
+            TEST_ASSERT_FALSE(valid[1]);
+            TEST_ASSERT_EQUAL(0, slot);
+            TEST_ASSERT_EQUAL(7, records[slot].sequence);
+            recovered++;
+        } else {
+            TEST_ASSERT_EQUAL(1, slot);
+            TEST_ASSERT_EQUAL(8, records[slot].sequence);
+        }
+        // The next save must not overwrite what recovery picked
+        TEST_ASSERT_NOT_EQUAL(slot, journalNextSlot(slot));
+    }
+    TEST_ASSERT_EQUAL(next.size(), recovered);
+
+    // Overwritten in place without truncating: the old trailer must not
+    // vouch for the new bytes
+    std::vector<uint8_t> overwritten = previous;
+    memcpy(overwritten.data(), next.data(), std::min(next.size(), overwritten.size()) / 2);
+    TEST_ASSERT_FALSE(journalCheck(overwritten.data(), overwritten.size(), records[1]));
+}
+
+// Flash bit errors: any single flipped bit fails the record
+void test_corruption_is_detected() {
+    std::vector<uint8_t> record = makeRecord(rulesText(2, 3), 3);
+    JournalRecord info;
+    for (size_t i = 0; i < record.size(); i++) {
+        for (int bit = 0; bit < 8; bit += 3) {
+            record[i] ^= (uint8_t)(1 << bit);
+            TEST_ASSERT_FALSE(journalCheck(record.data(), record.size(), info));
+            record[i] ^= (uint8_t)(1 << bit);
+        }
+    }
+    TEST_ASSERT_TRUE(journalCheck(record.data(), record.size(), info));
+
+    // Neither slot valid: nothing to recover
+    JournalRecord records[JOURNAL_SLOT_COUNT] = {{1, 0}, {2, 0}};
+    bool valid[JOURNAL_SLOT_COUNT] = {false, false};
+    TEST_ASSERT_EQUAL(-1, journalNewestSlot(valid, records));
+    TEST_ASSERT_EQUAL(0, journalNextSlot(-1));
+}
+
+void test_sequence_wraparound() {
+    TEST_ASSERT_TRUE(journalNewer(2, 1));
+    TEST_ASSERT_FALSE(journalNewer(1, 2));
+    TEST_ASSERT_FALSE(journalNewer(5, 5));
+    TEST_ASSERT_TRUE(journalNewer(0, 0xFFFFFFFFu));
+    TEST_ASSERT_TRUE(journalNewer(3, 0xFFFFFFF0u));
+
+    JournalRecord records[JOURNAL_SLOT_COUNT] = {{0xFFFFFFFFu, 0}, {0, 0}};
+    bool valid[JOURNAL_SLOT_COUNT] = {true, true};
+    TEST_ASSERT_EQUAL(1, journalNewestSlot(valid, records));
+}
+
+// Time to build a record (CRC included) and to check it at load, in memory
+// and through a host file. On the device the SPIFFS write dominates; the
+// firmware logs the full commit time with each save.
+void test_benchmark_commit_latency() {
+    const int sizes[] = {3, 50, 200};
+    for (int rules : sizes) {
+        std::string payload = rulesText(rules, 1);
+        const int rounds = 200;
+
+        uint64_t start = benchMicros();
+        std::vector<uint8_t> record;
+        for (int i = 0; i < rounds; i++) {
+            record = makeRecord(payload, (uint32_t)i);
+        }
+        uint64_t encodeUs = benchMicros() - start;
+
+        JournalRecord info;
+        start = benchMicros();
+        for (int i = 0; i < rounds; i++) {
+            TEST_ASSERT_TRUE(journalCheck(record.data(), record.size(), info));
+        }
+        uint64_t checkUs = benchMicros() - start;
+
+        uint64_t fileUs = 0;
+        FILE* file = tmpfile();
+        if (file) {
+            start = benchMicros();
+            for (int i = 0; i < rounds; i++) {
+                rewind(file);
+                fwrite(record.data(), 1, record.size(), file);
+                fflush(file);
+            }
+            fileUs = benchMicros() - start;
+            fclose(file);
+        }
+
+        printf("[bench] %d rules, %zu B record: encode %.1f us, check %.1f us, host file write %.1f us per commit\n",
+               rules, record.size(), (double)encodeUs / rounds, (double)checkUs / rounds, (double)fileUs / rounds);
+    }
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_crc32_known_value);
+    RUN_TEST(test_record_roundtrip);
+    RUN_TEST(test_truncation_at_every_offset);
+    RUN_TEST(test_corruption_is_detected);
+    RUN_TEST(test_sequence_wraparound);
+    RUN_TEST(test_benchmark_commit_latency);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
@@ -0,0 +1,321 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+#include "rule_json.h"
+#include "rule_set.h"
+#include "rule_store.h"
+#include "test_helpers.h"
+
+#define MAX_RULES 50
+#define DEVICE_MAX_RULES 1024   // config.h's MAX_RULES
+
+static RuleSet rules;
+static RuleNamePool names;
+static RuleBatchResult result;
+
+static bool applyBatch(const std::string& body) {
+    JsonDocument doc;
+    if (deserializeJson(doc, body.c_str())) {
+        snprintf(result.error, sizeof(result.error), "test body is not JSON");
+        result.failedOp = -2;   // Fails every expectation
+        return false;
+    }
+    return applyRuleBatch(doc.as<JsonObjectConst>(), rules, names, MAX_RULES, result);
+}
+
+// `fields` on a created rule and on an update of rule 1, after a valid op
+static bool applyFields(const char* fields, bool update) {
+    std::string rule = std::string("{") + fields + "}";
+    if (update) {
+        return applyBatch("{\"ops\": [{\"op\": \"update\", \"id\": 1, \"rule\": {\"enabled\": true}},"
+                          "{\"op\": \"update\", \"id\": 1, \"rule\": " + rule + "}]}");
+    }
+    return applyBatch("{\"ops\": [{\"op\": \"create\", \"rule\": {\"name\": \"ok\"}},"
+                      "{\"op\": \"create\", \"rule\": " + rule + "}]}");
+}
+
+// Rejected as the second operation, naming the field, on create and update;
+// the rule set the batch worked on is unchanged
+static void expectRejected(const char* fields, const char* field) {
+    const bool modes[] = {false, true};
+    for (bool update : modes) {
+        setUp();
+        ACRule before = *rules.find(1);
+        char message[96];
+        snprintf(message, sizeof(message), "%s (%s)", fields, update ? "update" : "create");
+        TEST_ASSERT_FALSE_MESSAGE(applyFields(fields, update), message);
+        TEST_ASSERT_EQUAL_MESSAGE(1, result.failedOp, message);
+        TEST_ASSERT_NOT_NULL_MESSAGE(strstr(result.error, field), message);
+        if (!update) continue;
+        TEST_ASSERT_TRUE_MESSAGE(sameRule(before, names, *rules.find(1), names), message);
+    }
+}
+
+static void expectAccepted(const char* fields) {
+    const bool modes[] = {false, true};
+    for (bool update : modes) {
+        setUp();
+        TEST_ASSERT_TRUE_MESSAGE(applyFields(fields, update), result.error);
+    }
+}
+
+void setUp(void) {
+    rules.clear();
+    names.clear();
+    ACRule rule = makeRule(1, 8, 19, 26.0f);
+    rule.nameId = names.intern("Day");
+    rules.insert(rule);
+    result = RuleBatchResult();
+}
+
+void tearDown(void) {
+}
+
+void test_valid_batch_applies() {
+    TEST_ASSERT_TRUE(applyBatch("{\"ops\": [{\"op\": \"create\", \"rule\": {\"name\": \"Night\", \"startMinute\": 1140,"
+                                "\"endMinute\": 480, \"weekdays\": 62, \"fanSpeed\": 3, \"mode\": 4, \"vSwing\": 3,"
+                                "\"hSwing\": 3, \"priority\": 65535}},"
+                                "{\"op\": \"update\", \"id\": 1, \"rule\": {\"startHour\": -1, \"endHour\": 23}}]}"));
+    TEST_ASSERT_EQUAL(1, result.created);
+    TEST_ASSERT_EQUAL(1, result.updated);
+    TEST_ASSERT_EQUAL(-1, result.failedOp);
+    const ACRule* night = rules.find(2);
+    TEST_ASSERT_NOT_NULL(night);
+    TEST_ASSERT_EQUAL(AC_FAN_HIGH, night->fanSpeed);
+    TEST_ASSERT_EQUAL(AC_MODE_AUTO, night->mode);
+    TEST_ASSERT_EQUAL(62, ruleWeekdays(*night));
+    TEST_ASSERT_EQUAL(65535, night->priority);
+    TEST_ASSERT_EQUAL(RULE_ANY_MINUTE, ruleStartMinute(*rules.find(1)));
+}
+
+void test_fan_speed_range() {
+    expectAccepted("\"fanSpeed\": 0");
+    expectAccepted("\"fanSpeed\": 3");
+    expectRejected("\"fanSpeed\": 4", "fanSpeed");
+    expectRejected("\"fanSpeed\": -1", "fanSpeed");
+    expectRejected("\"fanSpeed\": \"high\"", "fanSpeed");
+}
+
+void test_mode_range() {
+    expectAccepted("\"mode\": 4");
+    expectRejected("\"mode\": 5", "mode");
+    expectRejected("\"mode\": -1", "mode");
+}
+
+void test_swing_ranges() {
+    expectAccepted("\"vSwing\": 3, \"hSwing\": 3");
+    expectRejected("\"vSwing\": 4", "vSwing");
+    expectRejected("\"vSwing\": -1", "vSwing");
+    expectRejected("\"hSwing\": 4", "hSwing");
+    expectRejected("\"hSwing\": -1", "hSwing");
+}
+
+void test_weekdays_range() {
+    expectAccepted("\"weekdays\": 1");
+    expectAccepted("\"weekdays\": 127");
+    expectRejected("\"weekdays\": 0", "weekdays");
+    expectRejected("\"weekdays\": 128", "weekdays");
+    expectRejected("\"weekdays\": -1", "weekdays");
+}
+
+void test_hour_ranges() {
+    expectAccepted("\"startHour\": -1, \"endHour\": 23");
+    expectRejected("\"startHour\": 24", "startHour");
+    expectRejected("\"startHour\": -2", "startHour");
+    expectRejected("\"endHour\": 24", "endHour");
+    expectRejected("\"endHour\": -2", "endHour");
+}
+
+void test_minute_ranges() {
+    expectAccepted("\"startMinute\": 0, \"endMinute\": 1439");
+    expectAccepted("\"startMinute\": -1, \"endMinute\": -1");
+    expectRejected("\"startMinute\": 1440", "startMinute");
+    expectRejected("\"startMinute\": -2", "startMinute");
+    expectRejected("\"endMinute\": 1440", "endMinute");
+    expectRejected("\"endMinute\": -2", "endMinute");
+}
+
+void test_priority_range() {
+    expectAccepted("\"priority\": 0");
+    expectAccepted("\"priority\": 65535");
+    expectRejected("\"priority\": -1", "priority");
+    expectRejected("\"priority\": 65536", "priority");
+    expectRejected("\"priority\": 1.5", "priority");
+}
+
+// The setpoint goes to the AC, so it has no "any" value and no room beyond
+// the controller's range
+void test_set_temp_range() {
+    expectAccepted("\"setTemp\": 16");
+    expectAccepted("\"setTemp\": 30");
+    expectAccepted("\"setTemp\": 25.5");
+    expectRejected("\"setTemp\": -999", "setTemp");
+    expectRejected("\"setTemp\": 15", "setTemp");
+    expectRejected("\"setTemp\": 31", "setTemp");
+    expectRejected("\"setTemp\": -50", "setTemp");
+    expectRejected("\"setTemp\": 2600", "setTemp");
+    expectRejected("\"setTemp\": \"cold\"", "setTemp");
+}
+
+void test_threshold_ranges() {
+    expectAccepted("\"minTemp\": -999, \"maxTemp\": -999");
+    expectAccepted("\"minTemp\": -50, \"maxTemp\": 100");
+    expectRejected("\"minTemp\": -51", "minTemp");
+    expectRejected("\"maxTemp\": 400", "maxTemp");
+}
+
+// The form-encoded PUT /api/rules checks its fields with checkRuleFields():
+// numbers arrive as integers or floats, anything else as text
+void test_check_rule_fields() {
+    JsonDocument doc;
+    char error[80];
+    doc["setTemp"] = 26.5;
+    doc["minTemp"] = -999;
+    doc["fanSpeed"] = 2;
+    TEST_ASSERT_TRUE(checkRuleFields(doc.as<JsonObjectConst>(), error, sizeof(error)));
+
+    doc["setTemp"] = 2600;   // Centi-degrees typed as degrees
+    TEST_ASSERT_FALSE(checkRuleFields(doc.as<JsonObjectConst>(), error, sizeof(error)));
+    TEST_ASSERT_NOT_NULL(strstr(error, "setTemp"));
+
+    doc["setTemp"] = 26;
+    doc["maxTemp"] = "warm";
+    TEST_ASSERT_FALSE(checkRuleFields(doc.as<JsonObjectConst>(), error, sizeof(error)));
+    TEST_ASSERT_NOT_NULL(strstr(error, "maxTemp"));
+
+    // Every weekday box cleared: 0 would be stored as "every day"
+    doc["maxTemp"] = 30;
+    doc["weekdays"] = 0;
+    TEST_ASSERT_FALSE(checkRuleFields(doc.as<JsonObjectConst>(), error, sizeof(error)));
+    TEST_ASSERT_NOT_NULL(strstr(error, "weekdays"));
+    doc["weekdays"] = 62;
+    TEST_ASSERT_TRUE(checkRuleFields(doc.as<JsonObjectConst>(), error, sizeof(error)));
+}
+
+// `body` fed `chunk` bytes at a time into a stream over copies of the rules
+static bool streamBatch(const std::string& body, size_t chunk, RuleSet& out, RuleNamePool& outNames,
+                        RuleBatchResult& streamed, int maxRules = MAX_RULES) {
+    out = rules;
+    outNames = names;
+    RuleBatchStream stream(out, outNames, maxRules);
+    for (size_t i = 0; i < body.size(); i += chunk) {
+        stream.feed(body.data() + i, std::min(chunk, body.size() - i));
+    }
+    bool applied = stream.finish();
+    streamed = stream.getResult();
+    return applied;
+}
+
+// A full device-sized set goes through in pieces and ends up as the whole
+// document would leave it
+void test_stream_full_rule_set() {
+    RuleSet source;
+    RuleNamePool sourceNames;
+    seedRandom(21);
+    for (int i = 1; i <= DEVICE_MAX_RULES; i++) {
+        source.insert(makeRandomRule(i, sourceNames));
+    }
+    RuleStore store;
+    store.publish(source.data(), source.size(), sourceNames, source.exceptionData(), source.exceptionCount());
+    std::string body;
+    {
+        RuleSnapshotGuard snapshot(store);
+        JsonDocument doc;
+        JsonArray list = doc["rules"].to<JsonArray>();
+        for (const ACRule& rule : snapshot->rules) {
+            ruleToJson(rule, *snapshot, list.add<JsonObject>());
+        }
+        serializeJson(doc, body);
+    }
+
+    JsonDocument whole;
+    TEST_ASSERT_FALSE(deserializeJson(whole, body.c_str()));
+    TEST_ASSERT_TRUE(applyRuleBatch(whole.as<JsonObjectConst>(), rules, names, DEVICE_MAX_RULES, result));
+    TEST_ASSERT_EQUAL(DEVICE_MAX_RULES, rules.size());
+    RuleSet expected = rules;
+    RuleNamePool expectedNames = names;
+
+    const size_t chunks[] = {1, 7, 536, body.size()};
+    for (size_t chunk : chunks) {
+        setUp();
+        RuleSet streamed;
+        RuleNamePool streamedNames;
+        RuleBatchResult streamedResult;
+        TEST_ASSERT_TRUE_MESSAGE(streamBatch(body, chunk, streamed, streamedNames, streamedResult, DEVICE_MAX_RULES),
+                                 streamedResult.error);
+        TEST_ASSERT_EQUAL(DEVICE_MAX_RULES, streamedResult.created);
+        TEST_ASSERT_TRUE(sameRules(expected, expectedNames, streamed, streamedNames));
+    }
+}
+
+void test_stream_ops_and_errors() {
+    RuleSet out;
+    RuleNamePool outNames;
+    RuleBatchResult streamed;
+    std::string ops = "{\"ops\": [{\"op\": \"create\", \"rule\": {\"name\": \"A \\\"]}\\\" B\", \"setTemp\": 22}},"
+                      " {\"op\": \"update\", \"id\": 1, \"rule\": {\"setTemp\": 24}},"
+                      " {\"op\": \"delete\", \"id\": 2}]}";
+    TEST_ASSERT_TRUE_MESSAGE(streamBatch(ops, 3, out, outNames, streamed), streamed.error);
+    TEST_ASSERT_EQUAL(1, streamed.created);
+    TEST_ASSERT_EQUAL(1, streamed.updated);
+    TEST_ASSERT_EQUAL(1, streamed.deleted);
+    TEST_ASSERT_EQUAL(2400, out.find(1)->setTemp);
+    TEST_ASSERT_NULL(out.find(2));
+
+    // Same failedOp and message as the whole-document path
+    std::string bad = "{\"ops\": [{\"op\": \"delete\", \"id\": 1}, {\"op\": \"update\", \"id\": 1, \"rule\": {}}]}";
+    TEST_ASSERT_FALSE(streamBatch(bad, 5, out, outNames, streamed));
+    TEST_ASSERT_FALSE(applyBatch(bad));
+    TEST_ASSERT_EQUAL(result.failedOp, streamed.failedOp);
+    TEST_ASSERT_EQUAL_STRING(result.error, streamed.error);
+
+    const char* invalid[] = {
+        "{\"rules\": [{\"name\": \"cut\"",       // Cut short
+        "{\"other\": [1, 2]}",                  // No list
+        "[{\"name\": \"x\"}]",                    // Not an object
+        "{\"rules\": [{\"x\": }]}",               // Element is not JSON
+        "{\"rules\": [], \"ops\": []}",           // Both lists
+        "{\"rules\": [7]}",                     // Element is not a rule
+        "",
+    };
+    for (const char* body : invalid) {
+        TEST_ASSERT_FALSE_MESSAGE(streamBatch(body, 4, out, outNames, streamed), body);
+    }
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_valid_batch_applies);
+    RUN_TEST(test_fan_speed_range);
+    RUN_TEST(test_mode_range);
+    RUN_TEST(test_swing_ranges);
+    RUN_TEST(test_weekdays_range);
+    RUN_TEST(test_hour_ranges);
+    RUN_TEST(test_minute_ranges);
+    RUN_TEST(test_priority_range);
+    RUN_TEST(test_set_temp_range);
+    RUN_TEST(test_threshold_ranges);
+    RUN_TEST(test_check_rule_fields);
+    RUN_TEST(test_stream_full_rule_set);
+    RUN_TEST(test_stream_ops_and_errors);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
@@ -0,0 +1,324 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "rule_log.h"
+#include "rule_set.h"
+#include "rule_store.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+#define SPIFFS_PAGE_BYTES 256
+
+// SPIFFS programs whole pages and rewrites the file's index page on every
+// write, so a write of n bytes wears about ceil(n / 256) + 1 pages
+static size_t pagesWritten(size_t bytes) {
+    return (bytes + SPIFFS_PAGE_BYTES - 1) / SPIFFS_PAGE_BYTES + 1;
+}
+
+// What the firmware keeps on flash: the full record as of `base` plus the log
+struct Flash {
+    RuleSet baseRules;
+    RuleNamePool baseNames;
+    uint32_t base = 1;
+    std::vector<uint8_t> log;
+    size_t bytesWritten = 0;
+    size_t pages = 0;
+    int compactions = 0;
+};
+
+static size_t fullRecordBytes(const RuleSet& rules, const RuleNamePool& names);
+
+// One save: diff the published set against flash, append or compact
+static void save(Flash& flash, RuleLogTracker& tracker, RuleStore& store, const RuleSet& live,
+                 const RuleNamePool& names) {
+    store.publish(live.data(), live.size(), names, live.exceptionData(), live.exceptionCount());
+    RuleSnapshotGuard snapshot(store);
+    std::vector<uint8_t> entries;
+    if (tracker.diff(*snapshot, flash.base, entries) == 0) return;
+    size_t full = fullRecordBytes(live, names);
+    if (ruleLogNeedsCompaction(flash.log.size(), entries.size(), full)) {
+        flash.baseRules = live;
+        flash.baseNames = names;
+        flash.base++;
+        flash.log.clear();
+        flash.bytesWritten += full;
+        flash.pages += pagesWritten(full) + 1;   // The log is emptied too
+        flash.compactions++;
+        tracker.reset(*snapshot);
+    } else {
+        flash.log.insert(flash.log.end(), entries.begin(), entries.end());
+        flash.bytesWritten += entries.size();
+        flash.pages += pagesWritten(entries.size());
+    }
+}
+
+// Size of the JSON full record the firmware writes: ruleToJson() fields and
+// a 16-byte journal trailer
+static size_t fullRecordBytes(const RuleSet& rules, const RuleNamePool& names) {
+    size_t bytes = 40 + 16;
+    char text[320];
+    for (int i = 0; i < rules.size(); i++) {
+        const ACRule& r = rules[i];
+        bytes += snprintf(text, sizeof(text),
+                          "{\"id\":%d,\"name\":\"%s\",\"priority\":%d,\"enabled\":%s,\"startMinute\":%d,"
+                          "\"endMinute\":%d,\"weekdays\":%d,\"minTemp\":%.1f,\"maxTemp\":%.1f,\"acOn\":%s,"
+                          "\"setTemp\":%.1f,\"fanSpeed\":%d,\"mode\":%d,\"vSwing\":%d,\"hSwing\":%d,\"exceptions\":[]},",
+                          r.id, names.get(r.nameId), r.priority, ruleEnabled(r) ? "true" : "false",
+                          ruleStartMinute(r), ruleEndMinute(r), ruleWeekdays(r), ruleMinTemp(r), ruleMaxTemp(r),
+                          ruleAcOn(r) ? "true" : "false", centiToTemp(r.setTemp), (int)r.fanSpeed, (int)r.mode,
+                          (int)r.vSwing, (int)r.hSwing);
+    }
+    return bytes;
+}
+
+// Load as the firmware does: full record, then the log on top
+static void load(const Flash& flash, RuleSet& rules, RuleNamePool& names, RuleLogReplayResult* result = nullptr) {
+    rules = flash.baseRules;
+    names = flash.baseNames;
+    RuleLogReplayResult replay = ruleLogReplay(flash.log.data(), flash.log.size(), flash.base, rules, names);
+    if (result) *result = replay;
+}
+
+static void startFlash(Flash& flash, RuleLogTracker& tracker, RuleStore& store, RuleSet& live, RuleNamePool& names,
+                       int count) {
+    for (int i = 1; i <= count; i++) {
+        live.insert(makeRandomRule(i, names));
+    }
+    flash.baseRules = live;
+    flash.baseNames = names;
+    store.publish(live.data(), live.size(), names, live.exceptionData(), live.exceptionCount());
+    RuleSnapshotGuard snapshot(store);
+    tracker.reset(*snapshot);
+}
+
+void setUp(void) {
+    seedRandom(2024);
+}
+
+void tearDown(void) {
+}
+
+void test_record_roundtrip() {
+    RuleNamePool names;
+    ACRule rule = makeRandomRule(7, names);
+    ruleSetMaxTemp(rule, -5.5f);
+    rule.vSwing = AC_SWING_V_BOTTOM;
+    RuleDateException exceptions[] = {{7, 9000, 9002}, {7, 9100, 9100}};
+
+    std::vector<uint8_t> record;
+    ruleRecordEncode(rule, "Night \xe2\x9d\x84", exceptions, 2, record);
+    TEST_ASSERT_EQUAL(22 + 1 + 9 + 2 + 8, record.size());
+
+    RuleNamePool decodedNames;
+    ACRule decoded;
+    std::vector<RuleDateException> decodedExceptions;
+    TEST_ASSERT_EQUAL(record.size(), ruleRecordDecode(record.data(), record.size(), decoded, decodedNames,
+                                                      decodedExceptions));
+    TEST_ASSERT_EQUAL_STRING("Night \xe2\x9d\x84", decodedNames.get(decoded.nameId));
+    decoded.nameId = rule.nameId;
+    TEST_ASSERT_EQUAL_MEMORY(&rule, &decoded, sizeof(ACRule));
+    TEST_ASSERT_EQUAL(2, decodedExceptions.size());
+    TEST_ASSERT_EQUAL(9100, decodedExceptions[1].firstDay);
+
+    // Every shorter prefix is rejected
+    for (size_t cut = 0; cut < record.size(); cut++) {
+        TEST_ASSERT_EQUAL(0, ruleRecordDecode(record.data(), cut, decoded, decodedNames, decodedExceptions));
+    }
+}
+
+// Random edits, deletes and creates with a save after each; reloading from
+// the full record plus the log must always give the live rules back
+void test_replay_matches_live_rules() {
+    Flash flash;
+    RuleLogTracker tracker;
+    RuleStore store;
+    RuleSet live;
+    RuleNamePool names;
+    startFlash(flash, tracker, store, live, names, 30);
+
+    for (int step = 0; step < 600; step++) {
+        uint32_t action = nextRandom() % 10;
+        ACRule* rule = live.size() ? &live[(int)(nextRandom() % live.size())] : nullptr;
+        if (action < 5 && rule) {
+            ruleSetFlag(*rule, RULE_FLAG_ENABLED, !ruleEnabled(*rule));
+            rule->setTemp = (int16_t)(2000 + nextRandom() % 1000);
+        } else if (action < 6 && rule) {
+            char name[24];
+            snprintf(name, sizeof(name), "Renamed %d", step);
+            rule->nameId = names.intern(name);
+        } else if (action < 7 && rule) {
+            RuleDateException holiday = {0, (uint16_t)(9000 + step), (uint16_t)(9003 + step)};
+            live.setExceptions(rule->id, &holiday, 1);
+        } else if (action < 8 && rule) {
+            live.remove(rule->id);
+        } else {
+            live.insert(makeRandomRule(live.nextId(), names));
+        }
+        save(flash, tracker, store, live, names);
+
+        RuleSet loaded;
+        RuleNamePool loadedNames;
+        RuleLogReplayResult replay;
+        load(flash, loaded, loadedNames, &replay);
+        TEST_ASSERT_FALSE(replay.torn);
+        TEST_ASSERT_TRUE(sameRules(live, names, loaded, loadedNames));
+    }
+    TEST_ASSERT_GREATER_THAN(0, flash.compactions);
+}
+
+// Reset while appending: replay keeps every complete entry and stops at the cut
+void test_torn_tail_keeps_complete_entries() {
+    Flash flash;
+    RuleLogTracker tracker;
+    RuleStore store;
+    RuleSet live;
+    RuleNamePool names;
+    startFlash(flash, tracker, store, live, names, 5);
+
+    std::vector<size_t> boundaries = {0};
+    for (int i = 1; i <= 5; i++) {
+        live.find((uint16_t)i)->setTemp = (int16_t)(2000 + i);
+        save(flash, tracker, store, live, names);
+        boundaries.push_back(flash.log.size());
+    }
+    std::vector<uint8_t> log = flash.log;
+    for (size_t cut = 0; cut <= log.size(); cut++) {
+        flash.log.assign(log.begin(), log.begin() + cut);
+        RuleSet loaded;
+        RuleNamePool loadedNames;
+        RuleLogReplayResult replay;
+        load(flash, loaded, loadedNames, &replay);
+
+        int complete = 0;
+        while (complete + 1 < (int)boundaries.size() && boundaries[complete + 1] <= cut) complete++;
+        TEST_ASSERT_EQUAL(complete, replay.applied);
+        TEST_ASSERT_EQUAL(boundaries[complete], replay.validBytes);
+        TEST_ASSERT_EQUAL(cut != boundaries[complete], replay.torn);
+        for (int i = 1; i <= 5; i++) {
+            int expected = i <= complete ? 2000 + i : flash.baseRules.find((uint16_t)i)->setTemp;
+            TEST_ASSERT_EQUAL(expected, loaded.find((uint16_t)i)->setTemp);
+        }
+    }
+}
+
+// Entries written against an older full record (compaction interrupted
+// before the log was emptied) are skipped
+void test_stale_entries_are_skipped() {
+    Flash flash;
+    RuleLogTracker tracker;
+    RuleStore store;
+    RuleSet live;
+    RuleNamePool names;
+    startFlash(flash, tracker, store, live, names, 3);
+    live.remove(2);
+    save(flash, tracker, store, live, names);
+    TEST_ASSERT_EQUAL(2, tracker.size());
+
+    RuleSet loaded;
+    RuleNamePool loadedNames;
+    flash.base++;   // The new full record got written, the log was not emptied
+    flash.baseRules = live;
+    flash.baseNames = names;
+    RuleLogReplayResult replay;
+    load(flash, loaded, loadedNames, &replay);
+    TEST_ASSERT_EQUAL(0, replay.applied);
+    TEST_ASSERT_EQUAL(1, replay.stale);
+    TEST_ASSERT_FALSE(replay.torn);
+    TEST_ASSERT_TRUE(sameRules(live, names, loaded, loadedNames));
+}
+
+// Flash bytes per edit for the edits the web UI makes, against rewriting
+// the whole JSON record each time, and what that means for wear
+void test_benchmark_bytes_per_edit() {
+    struct Pattern {
+        const char* name;
+        int edits;
+    };
+    const int ruleCount = 50;
+    const size_t partitionPages = 0x160000 / SPIFFS_PAGE_BYTES;   // SPIFFS in default.csv
+    const double endurance = 100000;                              // Erase cycles per sector
+    const int savesPerDay = 100;
+    const char* labels[] = {"toggle enabled", "edit form", "delete 3 + add 3", "create rule"};
+
+    for (int pattern = 0; pattern < 4; pattern++) {
+        Flash flash;
+        RuleLogTracker tracker;
+        RuleStore store;
+        RuleSet live;
+        RuleNamePool names;
+        startFlash(flash, tracker, store, live, names, ruleCount);
+
+        const int saves = 200;
+        size_t rewriteBytes = 0, rewritePages = 0;
+        uint64_t start = benchMicros();
+        for (int round = 0; round < saves; round++) {
+            if (pattern == 0) {
+                ACRule* rule = &live[round % live.size()];
+                ruleSetFlag(*rule, RULE_FLAG_ENABLED, !ruleEnabled(*rule));
+            } else if (pattern == 1) {
+                ACRule* rule = &live[round % live.size()];
+                rule->setTemp = (int16_t)(2400 + round % 50);
+                ruleSetStartMinute(*rule, round % MINUTES_PER_DAY);
+                rule->nameId = names.intern(round % 2 ? "Evening" : "Morning");
+            } else if (pattern == 2) {
+                for (int i = 0; i < 3; i++) live.remove(live[0].id);
+                for (int i = 0; i < 3; i++) live.insert(makeRandomRule(live.nextId(), names));
+            } else {
+                live.insert(makeRandomRule(live.nextId(), names));
+                if (live.size() > 80) live.remove(live[0].id);
+            }
+            save(flash, tracker, store, live, names);
+            size_t full = fullRecordBytes(live, names);
+            rewriteBytes += full;
+            rewritePages += pagesWritten(full);
+        }
+        uint64_t elapsed = benchMicros() - start;
+
+        double bytesPerSave = (double)flash.bytesWritten / saves;
+        double pagesPerSave = (double)flash.pages / saves;
+        double rewritePagesPerSave = (double)rewritePages / saves;
+        // Wear leveling spreads page writes over the partition; a sector is
+        // erased once per 16 pages written to it
+        double yearsLog = endurance * partitionPages / (pagesPerSave * savesPerDay * 365.0);
+        double yearsRewrite = endurance * partitionPages / (rewritePagesPerSave * savesPerDay * 365.0);
+        printf("[bench] %s (%d rules): %.0f B / %.1f pages per save incl. %d compactions, full rewrite "
+               "%.0f B / %.1f pages (%.1fx the pages), %.1f us/save; %d saves/day wear the partition out in "
+               "%.0f vs %.0f years\n",
+               labels[pattern], ruleCount, bytesPerSave, pagesPerSave, flash.compactions,
+               (double)rewriteBytes / saves, rewritePagesPerSave, rewritePagesPerSave / pagesPerSave,
+               (double)elapsed / saves, savesPerDay, yearsLog, yearsRewrite);
+        TEST_ASSERT_LESS_THAN(rewritePagesPerSave, pagesPerSave);
+    }
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_record_roundtrip);
+    RUN_TEST(test_replay_matches_live_rules);
+    RUN_TEST(test_torn_tail_keeps_complete_entries);
+    RUN_TEST(test_stale_entries_are_skipped);
+    RUN_TEST(test_benchmark_bytes_per_edit);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
@@ -0,0 +1,172 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include <SPIFFS.h>
+#include "config.h"
+#include "rule_image.h"
+#include "rule_journal.h"
+#include "rule_persist.h"
+#include "rule_store.h"
+#include "test_helpers.h"
+
+// Runs against the simulator's shims (pio test -e sim_test): SPIFFS is a
+// temporary directory and a reboot is loadRulesFromSPIFFS() on cleared rules
+
+void simIrFrameSent(const uint16_t*, uint16_t, uint16_t) {}
+
+static std::string spiffsDir;
+
+static std::string spiffsPath(const char* path) {
+    return spiffsDir + path;
+}
+
+static void removeRuleFiles() {
+    const char* paths[] = {"/rules.a", "/rules.b", "/rules.log", "/rules.json"};
+    for (const char* path : paths) {
+        remove(spiffsPath(path).c_str());
+    }
+}
+
+static void reboot() {
+    ruleSet.clear();
+    ruleNames.clear();
+    loadRulesFromSPIFFS();
+}
+
+// A record whose journal and image CRCs check out but whose rules do not
+// load (two rules with ID 1), as a firmware bug could have saved it
+static void writeUnloadableImage(const char* path, uint32_t sequence) {
+    RuleNamePool names;
+    ACRule rules[] = {makeRule(1, 8, 19), makeRule(1, 19, 8)};
+    RuleStore store;
+    store.publish(rules, 2, names, nullptr, 0);
+    std::vector<uint8_t> image;
+    {
+        RuleSnapshotGuard snapshot(store);
+        ruleImageEncode(*snapshot, image);
+    }
+    File file = SPIFFS.open(path, "w");
+    JournalWriter<File> out(file);
+    out.write(image.data(), image.size());
+    out.finish(sequence);
+    file.close();
+}
+
+// The newest slot holds an image that loads, so a boot needs no defaults
+static bool newestImageLoads(RuleSet& rules, RuleNamePool& names) {
+    const char* paths[JOURNAL_SLOT_COUNT] = {"/rules.a", "/rules.b"};
+    std::vector<uint8_t> files[JOURNAL_SLOT_COUNT];
+    JournalRecord records[JOURNAL_SLOT_COUNT];
+    bool valid[JOURNAL_SLOT_COUNT];
+    for (int slot = 0; slot < JOURNAL_SLOT_COUNT; slot++) {
+        File file = SPIFFS.open(paths[slot], "r");
+        valid[slot] = false;
+        if (!file) continue;
+        files[slot].resize(file.size());
+        file.readBytes((char*)files[slot].data(), files[slot].size());
+        file.close();
+        valid[slot] = journalCheck(files[slot].data(), files[slot].size(), records[slot]);
+    }
+    int slot = journalNewestSlot(valid, records);
+    RuleImage image;
+    return slot >= 0 && ruleImageOpen(files[slot].data(), records[slot].length, image) &&
+           ruleImageLoad(image, rules, names);
+}
+
+void setUp(void) {
+    removeRuleFiles();
+}
+
+void tearDown(void) {
+}
+
+// A record that cannot be loaded is replaced by the defaults as a new full
+// record, so later saves are log entries on a record that loads and later
+// boots keep them instead of retrying the bad one
+void test_unloadable_image_replaced_by_defaults() {
+    initDefaultRules();
+    RuleSet defaults = ruleSet;
+    RuleNamePool defaultNames = ruleNames;
+
+    writeUnloadableImage("/rules.a", 7);
+
+    RulePersistStats before = getRulePersistStats();
+    reboot();
+    RulePersistStats booted = getRulePersistStats();
+    TEST_ASSERT_TRUE(sameRules(defaults, defaultNames, ruleSet, ruleNames));
+    TEST_ASSERT_EQUAL(before.fullRecords + 1, booted.fullRecords);
+    TEST_ASSERT_EQUAL(before.logEntries, booted.logEntries);
+    TEST_ASSERT_EQUAL(0, booted.logBytes);
+
+    RuleSet stored;
+    RuleNamePool storedNames;
+    TEST_ASSERT_TRUE(newestImageLoads(stored, storedNames));
+    TEST_ASSERT_TRUE(sameRules(defaults, defaultNames, stored, storedNames));
+
+    // An edit after recovery is a log entry, and two more boots load it
+    ruleSet.find(1)->setTemp = 2300;
+    saveRulesToSPIFFS();
+    RulePersistStats edited = getRulePersistStats();
+    TEST_ASSERT_EQUAL(booted.fullRecords, edited.fullRecords);
+    TEST_ASSERT_EQUAL(booted.logEntries + 1, edited.logEntries);
+
+    for (int boot = 0; boot < 2; boot++) {
+        reboot();
+        TEST_ASSERT_EQUAL(defaults.size(), ruleSet.size());
+        TEST_ASSERT_EQUAL(2300, ruleSet.find(1)->setTemp);
+        TEST_ASSERT_EQUAL(edited.fullRecords, getRulePersistStats().fullRecords);
+        TEST_ASSERT_EQUAL(edited.logBytes, getRulePersistStats().logBytes);
+    }
+}
+
+// Entries appended on top of a good image still replay after a reboot
+void test_log_replayed_on_loadable_image() {
+    reboot();   // Empty filesystem: defaults as the first full record
+    ruleSet.find(2)->fanSpeed = AC_FAN_MED;
+    ruleSet.remove(3);
+    saveRulesToSPIFFS();
+    RuleSet expected = ruleSet;
+    RuleNamePool expectedNames = ruleNames;
+    RulePersistStats saved = getRulePersistStats();
+
+    for (int boot = 0; boot < 2; boot++) {
+        reboot();
+        TEST_ASSERT_TRUE(sameRules(expected, expectedNames, ruleSet, ruleNames));
+        TEST_ASSERT_EQUAL(saved.fullRecords, getRulePersistStats().fullRecords);
+    }
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    char dir[] = "/tmp/rule_persist_XXXXXX";
+    spiffsDir = mkdtemp(dir);
+    SPIFFS.setRoot(spiffsDir.c_str());
+    initRulesMutex();
+    initRulePersistence();
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_unloadable_image_replaced_by_defaults);
+    RUN_TEST(test_log_replayed_on_loadable_image);
+
+    removeRuleFiles();
+    rmdir(spiffsDir.c_str());
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
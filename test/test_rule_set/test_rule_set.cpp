@@ -0,0 +1,278 @@
+#include <unity.h>
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+#include "rule_set.h"
+#include "rule_store.h"
+#include "test_helpers.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+static ACRule makeRuleWithPriority(int id, int priority) {
+    ACRule rule = makeRule(id);
+    rule.priority = (uint16_t)priority;
+    return rule;
+}
+
+// Seasonal/weekday-style rule: a random hour window and temperature band
+static ACRule makeRandomRule(int id) {
+    ACRule rule = makeRuleWithPriority(id, nextRandom() % 500);
+    ruleSetStartHour(rule, nextRandom() % 24);
+    ruleSetEndHour(rule, nextRandom() % 24);
+    ruleSetMinTemp(rule, 18.0f + (nextRandom() % 120) / 10.0f);
+    if (nextRandom() % 2) ruleSetMaxTemp(rule, 24.0f + (nextRandom() % 80) / 10.0f);
+    return rule;
+}
+
+void setUp(void) {
+    seedRandom(12345);
+}
+
+void tearDown(void) {
+}
+
+void test_insert_find_remove() {
+    RuleSet set;
+    TEST_ASSERT_NOT_NULL(set.insert(makeRuleWithPriority(1, 0)));
+    TEST_ASSERT_NOT_NULL(set.insert(makeRuleWithPriority(5, 1)));
+    TEST_ASSERT_NOT_NULL(set.insert(makeRuleWithPriority(3, 2)));
+    TEST_ASSERT_NULL(set.insert(makeRuleWithPriority(5, 3)));  // Duplicate ID
+    TEST_ASSERT_NULL(set.insert(makeRuleWithPriority(0, 3)));  // ID 0 is reserved
+    TEST_ASSERT_EQUAL(3, set.size());
+
+    TEST_ASSERT_EQUAL(1, set.find(5)->priority);
+    TEST_ASSERT_TRUE(set.remove(1));
+    TEST_ASSERT_FALSE(set.remove(1));
+    TEST_ASSERT_NULL(set.find(1));
+
+    // The moved rule must still be reachable through the index
+    TEST_ASSERT_EQUAL(3, set.find(3)->id);
+    TEST_ASSERT_EQUAL(5, set.find(5)->id);
+    TEST_ASSERT_EQUAL(2, set.size());
+}
+
+void test_next_id_and_priority() {
+    RuleSet set;
+    TEST_ASSERT_EQUAL(1, set.nextId());
+    TEST_ASSERT_EQUAL(0, set.nextPriority());
+
+    set.insert(makeRuleWithPriority(7, 4));
+    TEST_ASSERT_EQUAL(8, set.nextId());
+    TEST_ASSERT_EQUAL(5, set.nextPriority());
+
+    // Deleted IDs are not handed out again
+    set.remove(7);
+    TEST_ASSERT_EQUAL(8, set.nextId());
+
+    set.insert(makeRuleWithPriority(8, 0));
+    set.setPriority(8, 40);
+    TEST_ASSERT_EQUAL(41, set.nextPriority());
+
+    set.insert(makeRuleWithPriority(UINT16_MAX, 0));
+    TEST_ASSERT_EQUAL(1, set.nextId());  // Exhausted: reuse the first gap
+}
+
+void test_exceptions_follow_rules() {
+    RuleSet set;
+    set.insert(makeRuleWithPriority(1, 0));
+    set.insert(makeRuleWithPriority(2, 1));
+    RuleDateException holidays[2] = {{0, 300, 310}, {0, 100, 105}};
+    set.setExceptions(2, holidays, 2);
+    set.setExceptions(1, holidays, 1);
+    TEST_ASSERT_EQUAL(3, set.exceptionCount());
+    TEST_ASSERT_EQUAL(1, set.exceptionData()[0].ruleId);
+    TEST_ASSERT_EQUAL(100, set.exceptionData()[1].firstDay);  // Sorted per rule
+    TEST_ASSERT_EQUAL(2, set.exceptionData()[2].ruleId);
+
+    set.setExceptions(2, holidays, 1);  // Replaces, not appends
+    TEST_ASSERT_EQUAL(2, set.exceptionCount());
+    set.remove(1);
+    TEST_ASSERT_EQUAL(1, set.exceptionCount());
+    TEST_ASSERT_EQUAL(2, set.exceptionData()[0].ruleId);
+}
+
+void test_publish_orders_by_priority() {
+    RuleSet set;
+    RuleNamePool names;
+    set.insert(makeRuleWithPriority(1, 20));
+    set.insert(makeRuleWithPriority(2, 10));
+    set.insert(makeRuleWithPriority(3, 10));
+    set.insert(makeRuleWithPriority(4, 0));
+    ruleSetMinTemp(*set.find(4), 30.0);
+
+    RuleStore store;
+    store.publish(set.data(), set.size(), names);
+    RuleSnapshotGuard snapshot(store);
+
+    // Priority first, ties broken by ID
+    TEST_ASSERT_EQUAL(4, snapshot->rules[0].id);
+    TEST_ASSERT_EQUAL(2, snapshot->rules[1].id);
+    TEST_ASSERT_EQUAL(3, snapshot->rules[2].id);
+    TEST_ASSERT_EQUAL(1, snapshot->rules[3].id);
+
+    int noon = weekMinute(1, 12, 0);
+    TEST_ASSERT_EQUAL(0, snapshot->calendar.lookup(0, noon, 3100));  // Rule 4
+    TEST_ASSERT_EQUAL(1, snapshot->calendar.lookup(0, noon, 2500));  // Rule 2 beats 3 and 1
+}
+
+// Benchmark: the edit path (insert, find, delete) and the publish/match path at 1k rules
+void test_benchmark_1k_rules() {
+    const int count = 1000;
+    const int lookups = 200000;
+    std::vector<ACRule> source;
+    for (int i = 0; i < count; i++) {
+        source.push_back(makeRandomRule(i + 1));
+    }
+
+    RuleSet set;
+    uint64_t start = benchMicros();
+    for (int i = 0; i < count; i++) {
+        set.insert(source[i]);
+    }
+    uint64_t insertUs = benchMicros() - start;
+    TEST_ASSERT_EQUAL(count, set.size());
+
+    volatile int sink = 0;
+    start = benchMicros();
+    for (int i = 0; i < lookups; i++) {
+        sink += set.find((uint16_t)(1 + i % count))->priority;
+    }
+    uint64_t findUs = benchMicros() - start;
+
+    RuleStore store;
+    RuleNamePool names;
+    start = benchMicros();
+    store.publish(set.data(), set.size(), names);
+    uint64_t publishUs = benchMicros() - start;
+
+    {
+        RuleSnapshotGuard snapshot(store);
+        start = benchMicros();
+        for (int i = 0; i < lookups; i++) {
+            sink += snapshot->calendar.lookup(0, (i * 61) % MINUTES_PER_WEEK, (int16_t)(1500 + (i % 300) * 10));
+        }
+    }
+    uint64_t matchUs = benchMicros() - start;
+
+    // Delete in an order unrelated to insertion
+    start = benchMicros();
+    for (int i = 0; i < count; i++) {
+        set.remove((uint16_t)(1 + (i * 7919) % count));
+    }
+    uint64_t deleteUs = benchMicros() - start;
+    TEST_ASSERT_EQUAL(0, set.size());
+
+    printf("[bench] %d rules: insert %.0f ns/op, find %.1f ns/op, delete %.0f ns/op, publish %llu us, match %.1f ns/eval\n",
+           count, insertUs * 1000.0 / count, findUs * 1000.0 / lookups, deleteUs * 1000.0 / count,
+           (unsigned long long)publishUs, matchUs * 1000.0 / lookups);
+    (void)sink;
+}
+
+// PUT /api/rules/batch edits copies and assigns them back only if every
+// operation was valid; the live set must not see a half-applied batch
+void test_staged_copy_leaves_original() {
+    RuleSet live;
+    RuleNamePool liveNames;
+    for (int i = 1; i <= 3; i++) {
+        ACRule rule = makeRuleWithPriority(i, i);
+        rule.nameId = liveNames.intern("Live");
+        live.insert(rule);
+    }
+    RuleDateException holiday = {0, 100, 102};
+    live.setExceptions(2, &holiday, 1);
+
+    RuleSet staged = live;
+    RuleNamePool stagedNames = liveNames;
+    staged.remove(2);
+    staged.insert(makeRuleWithPriority(10, 10));
+    staged.find(1)->nameId = stagedNames.intern("Staged");
+    TEST_ASSERT_FALSE(staged.remove(99));  // Batch fails here and is dropped
+
+    TEST_ASSERT_EQUAL(3, live.size());
+    TEST_ASSERT_NOT_NULL(live.find(2));
+    TEST_ASSERT_NULL(live.find(10));
+    TEST_ASSERT_EQUAL(1, live.exceptionCount());
+    TEST_ASSERT_EQUAL(1, (int)liveNames.size());
+    TEST_ASSERT_EQUAL_STRING("Live", liveNames.get(live.find(1)->nameId));
+
+    live = std::move(staged);
+    liveNames = std::move(stagedNames);
+    TEST_ASSERT_EQUAL(3, live.size());
+    TEST_ASSERT_NULL(live.find(2));
+    TEST_ASSERT_EQUAL(0, live.exceptionCount());
+    TEST_ASSERT_EQUAL_STRING("Staged", liveNames.get(live.find(1)->nameId));
+    TEST_ASSERT_EQUAL(11, live.nextId());
+}
+
+// Importing 50 rules one request at a time publishes (and on the device
+// rewrites /rules.json) after every rule; a batch edits a copy and
+// publishes once. File writes are not part of this host measurement.
+void test_benchmark_batch_vs_per_rule() {
+    const int base = 50;
+    const int imported = 50;
+    RuleSet live;
+    RuleNamePool names;
+    for (int i = 0; i < base; i++) {
+        live.insert(makeRandomRule(i + 1));
+    }
+
+    RuleSet perRule = live;
+    RuleStore perRuleStore;
+    uint64_t start = benchMicros();
+    for (int i = 0; i < imported; i++) {
+        ACRule rule = makeRandomRule(perRule.nextId());
+        perRule.insert(rule);
+        perRuleStore.publish(perRule.data(), perRule.size(), names);
+    }
+    uint64_t perRuleUs = benchMicros() - start;
+
+    RuleStore batchStore;
+    start = benchMicros();
+    RuleSet staged = live;
+    for (int i = 0; i < imported; i++) {
+        ACRule rule = makeRandomRule(staged.nextId());
+        staged.insert(rule);
+    }
+    live = std::move(staged);
+    batchStore.publish(live.data(), live.size(), names);
+    uint64_t batchUs = benchMicros() - start;
+
+    TEST_ASSERT_EQUAL(base + imported, live.size());
+    TEST_ASSERT_EQUAL(base + imported, perRule.size());
+    TEST_ASSERT_EQUAL(imported, perRuleStore.getVersion());
+    TEST_ASSERT_EQUAL(1, batchStore.getVersion());
+
+    printf("[bench] import %d rules into %d: per rule %llu us (%d publishes), batch %llu us (1 publish)\n",
+           imported, base, (unsigned long long)perRuleUs, imported, (unsigned long long)batchUs);
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_insert_find_remove);
+    RUN_TEST(test_next_id_and_priority);
+    RUN_TEST(test_exceptions_follow_rules);
+    RUN_TEST(test_publish_orders_by_priority);
+    RUN_TEST(test_staged_copy_leaves_original);
+    RUN_TEST(test_benchmark_1k_rules);
+    RUN_TEST(test_benchmark_batch_vs_per_rule);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
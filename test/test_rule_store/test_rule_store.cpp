@@ -0,0 +1,262 @@
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rule_store.h"
+
+// Host-only stress test: needs std::thread and a steady clock
+#ifdef UNIT_TEST
+
+static uint64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Build a rule set whose every field encodes the same tag, so a reader can
+// detect a torn snapshot (rules from two different publishes).
+// Tags wrap to stay representable in both the uint16 id and the int16 setTemp.
+static void makeTaggedRules(std::vector<ACRule>& out, int count, int tag) {
+    tag %= 30000;
+    out.clear();
+    for (int i = 0; i < count; i++) {
+        ACRule rule = {};
+        rule.id = (uint16_t)tag;
+        rule.flags = RULE_FLAG_ENABLED | RULE_FLAG_AC_ON;
+        ruleSetMinTemp(rule, (float)(tag % 40));
+        rule.setTemp = (int16_t)tag;
+        rule.fanSpeed = acFanSpeedFromInt(tag % 4);
+        rule.mode = acModeFromInt(tag % 5);
+        out.push_back(rule);
+    }
+}
+
+static bool isConsistent(const RuleSnapshot& snapshot) {
+    if (snapshot.rules.empty()) return true;
+    int tag = snapshot.rules[0].id;
+    for (const ACRule& rule : snapshot.rules) {
+        if (rule.id != tag || rule.setTemp != tag) return false;
+    }
+    // The compiled calendar must belong to the same rule set
+    int winner = snapshot.calendar.lookup(0, weekMinute(1, 12, 0), tempToCenti((float)(tag % 40)));
+    return winner == 0;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_publish_bumps_version() {
+    RuleStore store;
+    RuleNamePool names;
+    std::vector<ACRule> rules;
+    TEST_ASSERT_EQUAL(0, store.getVersion());
+
+    makeTaggedRules(rules, 3, 7);
+    TEST_ASSERT_EQUAL(1, store.publish(rules.data(), (int)rules.size(), names));
+    makeTaggedRules(rules, 5, 8);
+    TEST_ASSERT_EQUAL(2, store.publish(rules.data(), (int)rules.size(), names));
+
+    RuleSnapshotGuard snapshot(store);
+    TEST_ASSERT_EQUAL(2, snapshot->version);
+    TEST_ASSERT_EQUAL(5, snapshot->rules.size());
+    TEST_ASSERT_EQUAL(8, snapshot->rules[0].id);
+}
+
+void test_pinned_snapshot_survives_publish() {
+    RuleStore store;
+    RuleNamePool names;
+    std::vector<ACRule> rules;
+    makeTaggedRules(rules, 4, 1);
+    store.publish(rules.data(), (int)rules.size(), names);
+
+    const RuleSnapshot* pinned = store.acquire();
+    makeTaggedRules(rules, 2, 2);
+    store.publish(rules.data(), (int)rules.size(), names); // Writes the other slot
+
+    TEST_ASSERT_EQUAL(1, pinned->rules[0].id);
+    TEST_ASSERT_EQUAL(4, pinned->rules.size());
+    store.release(pinned);
+
+    RuleSnapshotGuard snapshot(store);
+    TEST_ASSERT_EQUAL(2, snapshot->rules[0].id);
+}
+
+void test_publish_sleeps_until_stale_slot_released() {
+    RuleStore store;
+    RuleNamePool names;
+    std::vector<ACRule> rules;
+    makeTaggedRules(rules, 2, 1);
+    store.publish(rules.data(), (int)rules.size(), names);
+
+    const RuleSnapshot* pinned = store.acquire();
+    makeTaggedRules(rules, 2, 2);
+    store.publish(rules.data(), (int)rules.size(), names);  // Other slot, no wait
+
+    // The third publish needs the slot still pinned
+    std::atomic<bool> published(false);
+    std::thread writer([&]() {
+        std::vector<ACRule> next;
+        makeTaggedRules(next, 2, 3);
+        store.publish(next.data(), (int)next.size(), names);
+        published.store(true);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    TEST_ASSERT_FALSE(published.load());
+    TEST_ASSERT_EQUAL(1, pinned->rules[0].id);
+
+    store.release(pinned);
+    writer.join();
+    TEST_ASSERT_TRUE(published.load());
+    TEST_ASSERT_EQUAL(3, store.getVersion());
+    TEST_ASSERT_EQUAL(1, store.getWriterWaits());
+}
+
+// Stands in for the /api/rules JSON: one line per rule
+static int serializeCalls = 0;
+static void serializeIds(const RuleSnapshot& snapshot, std::string& out) {
+    serializeCalls++;
+    for (const ACRule& rule : snapshot.rules) {
+        out += std::to_string(rule.id) + "\n";
+    }
+}
+
+void test_snapshot_cache_rebuilds_once_per_version() {
+    RuleStore store;
+    RuleNamePool names;
+    std::vector<ACRule> rules;
+    RuleSnapshotCache cache(serializeIds);
+    serializeCalls = 0;
+
+    makeTaggedRules(rules, 3, 7);
+    store.publish(rules.data(), (int)rules.size(), names);
+    RuleSnapshotCache::Text first;
+    for (int i = 0; i < 5; i++) {
+        RuleSnapshotGuard snapshot(store);
+        first = cache.get(*snapshot);
+    }
+    TEST_ASSERT_EQUAL(1, serializeCalls);
+    TEST_ASSERT_EQUAL_STRING("7\n7\n7\n", first->c_str());
+
+    makeTaggedRules(rules, 2, 8);
+    store.publish(rules.data(), (int)rules.size(), names);
+    {
+        RuleSnapshotGuard snapshot(store);
+        TEST_ASSERT_EQUAL_STRING("8\n8\n", cache.get(*snapshot)->c_str());
+    }
+    TEST_ASSERT_EQUAL(2, serializeCalls);
+    // Text handed out before the rebuild is still intact
+    TEST_ASSERT_EQUAL_STRING("7\n7\n7\n", first->c_str());
+
+    RuleSnapshotCacheStats stats = cache.getStats();
+    TEST_ASSERT_EQUAL(4, stats.hits);
+    TEST_ASSERT_EQUAL(2, stats.misses);
+    TEST_ASSERT_TRUE(cache.getMemoryUsage() >= 4);
+}
+
+// Hammer the store with concurrent writers and readers, verify every
+// snapshot a reader sees is internally consistent and report acquire latency
+void test_stress_concurrent_readers_writers() {
+    const int writerCount = 2;
+    const int readerCount = 4;
+    const int durationMs = 1500;
+
+    RuleStore store;
+    RuleNamePool names;
+    names.intern("Tagged");
+    std::vector<ACRule> initial;
+    makeTaggedRules(initial, 10, 1);
+    store.publish(initial.data(), (int)initial.size(), names);
+
+    std::atomic<bool> running(true);
+    std::atomic<int> tornReads(0);
+    std::atomic<uint32_t> publishes(0);
+    std::vector<std::vector<uint32_t>> latencies(readerCount);
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writerCount; w++) {
+        threads.emplace_back([&, w]() {
+            std::vector<ACRule> rules;
+            int tag = 100 + w;
+            while (running.load()) {
+                makeTaggedRules(rules, 5 + tag % 20, tag);
+                store.publish(rules.data(), (int)rules.size(), names);
+                publishes.fetch_add(1);
+                tag += writerCount;
+            }
+        });
+    }
+    for (int r = 0; r < readerCount; r++) {
+        threads.emplace_back([&, r]() {
+            std::vector<uint32_t>& samples = latencies[r];
+            samples.reserve(1 << 20);
+            uint32_t lastVersion = 0;
+            while (running.load()) {
+                uint64_t start = nowNanos();
+                const RuleSnapshot* snapshot = store.acquire();
+                uint64_t elapsed = nowNanos() - start;
+                if (!isConsistent(*snapshot) || snapshot->version < lastVersion) {
+                    tornReads.fetch_add(1);
+                }
+                lastVersion = snapshot->version;
+                store.release(snapshot);
+                if (samples.size() < samples.capacity()) {
+                    samples.push_back((uint32_t)std::min<uint64_t>(elapsed, UINT32_MAX));
+                }
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+    running.store(false);
+    for (std::thread& t : threads) t.join();
+
+    std::vector<uint32_t> all;
+    for (const std::vector<uint32_t>& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    TEST_ASSERT_TRUE(!all.empty());
+
+    auto percentile = [&all](double p) {
+        return all[std::min(all.size() - 1, (size_t)(p * all.size()))];
+    };
+    printf("[stress] %d writers, %d readers, %u publishes, %zu reads, %u reader retries, %u writer waits\n",
+           writerCount, readerCount, (unsigned)publishes.load(), all.size(),
+           (unsigned)store.getReaderRetries(), (unsigned)store.getWriterWaits());
+    printf("[stress] reader acquire latency: p50 %u ns, p99 %u ns, p99.9 %u ns, max %u ns\n",
+           percentile(0.50), percentile(0.99), percentile(0.999), all.back());
+
+    TEST_ASSERT_EQUAL(0, tornReads.load());
+    TEST_ASSERT_TRUE(publishes.load() > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_publish_bumps_version);
+    RUN_TEST(test_pinned_snapshot_survives_publish);
+    RUN_TEST(test_publish_sleeps_until_stale_slot_released);
+    RUN_TEST(test_snapshot_cache_rebuilds_once_per_version);
+    RUN_TEST(test_stress_concurrent_readers_writers);
+
+    return UNITY_END();
+}
+
+#else
+
+void setup() {
+    UNITY_BEGIN();
+    UNITY_END(); // Stress test runs on the host only (pio test -e native)
+}
+
+void loop() {
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include <unity.h>
+#include <string.h>
+
+#include "temp_history.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#endif
+
+#define T0 1760000000u
+
+static TempHistorySample sampleAt(uint32_t time, float temp) {
+    TempHistorySample sample = {time, (int16_t)(temp * 100 + (temp < 0 ? -0.5f : 0.5f)), 1, 26};
+    return sample;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// The sensor samples every few seconds; one sample per period is kept
+void test_one_sample_per_period() {
+    static TempHistory history;
+    TEST_ASSERT_EQUAL(0, history.first());
+    TEST_ASSERT_EQUAL(0, history.end());
+
+    TEST_ASSERT_TRUE(history.add(sampleAt(T0, 27.5f)));
+    TEST_ASSERT_FALSE(history.add(sampleAt(T0 + 5, 27.6f)));
+    TEST_ASSERT_FALSE(history.add(sampleAt(T0 + TEMP_HISTORY_PERIOD_SEC - 1, 27.6f)));
+    TEST_ASSERT_TRUE(history.add(sampleAt(T0 + TEMP_HISTORY_PERIOD_SEC, 27.7f)));
+    TEST_ASSERT_EQUAL(2, history.end());
+
+    TempHistorySample sample;
+    TEST_ASSERT_TRUE(history.get(1, sample));
+    TEST_ASSERT_EQUAL(2770, sample.tempCenti);
+    TEST_ASSERT_FALSE(history.get(2, sample));
+
+    // NTP stepping the clock back must not stop the recording for the gap
+    TEST_ASSERT_TRUE(history.add(sampleAt(T0 - 3600, 27.0f)));
+}
+
+// Readers walking [first, end) can tell a sample was overwritten under them
+void test_ring_wraps() {
+    static TempHistory history;
+    for (uint32_t i = 0; i < TEMP_HISTORY_LENGTH + 10; i++) {
+        history.add(sampleAt(T0 + i * TEMP_HISTORY_PERIOD_SEC, 20.0f + (i % 100) / 10.0f));
+    }
+    TEST_ASSERT_EQUAL(10, history.first());
+    TEST_ASSERT_EQUAL(TEMP_HISTORY_LENGTH + 10, history.end());
+
+    TempHistorySample sample;
+    TEST_ASSERT_FALSE(history.get(9, sample));
+    TEST_ASSERT_TRUE(history.get(10, sample));
+    TEST_ASSERT_EQUAL(T0 + 10 * TEMP_HISTORY_PERIOD_SEC, sample.time);
+    TEST_ASSERT_TRUE(history.get(TEMP_HISTORY_LENGTH + 9, sample));
+    TEST_ASSERT_EQUAL(T0 + (TEMP_HISTORY_LENGTH + 9) * TEMP_HISTORY_PERIOD_SEC, sample.time);
+}
+
+void test_sample_json() {
+    char text[96];
+    TempHistorySample on = {T0, 2753, 1, 25};
+    int length = tempHistorySampleJson(on, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("{\"time\":1760000000,\"temp\":27.53,\"acOn\":true,\"setTemp\":25}", text);
+    TEST_ASSERT_EQUAL((int)strlen(text), length);
+
+    TempHistorySample cold = {T0, -505, 0, 0};
+    tempHistorySampleJson(cold, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("{\"time\":1760000000,\"temp\":-5.05,\"acOn\":false,\"setTemp\":0}", text);
+
+    // Truncated, never past the buffer
+    char small[16];
+    TEST_ASSERT_EQUAL(15, tempHistorySampleJson(on, small, sizeof(small)));
+}
+
+#ifdef UNIT_TEST
+int main() {
+#else
+void setup() {
+    delay(2000);
+#endif
+    UNITY_BEGIN();
+
+    RUN_TEST(test_one_sample_per_period);
+    RUN_TEST(test_ring_wraps);
+    RUN_TEST(test_sample_json);
+
+#ifdef UNIT_TEST
+    return UNITY_END();
+#else
+    UNITY_END();
+#endif
+}
+
+#ifndef UNIT_TEST
+void loop() {
+}
+#endif
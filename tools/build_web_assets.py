@@ -0,0 +1,374 @@
+"""
+Build the filesystem image contents from data/.
+
+Pages (*.html) are minified (comments and indentation outside literals) and gzipped under their own names, so the URLs
+stay the same. Scripts and styles they load are minified, gzipped and renamed
+after a hash of their content (/assets/rules.1a2b3c4d.js.gz) and the pages
+are rewritten to match, so the server can mark them immutable. Other files
+(rules.json) are copied as they are; *.md is left out.
+
+AsyncWebServer's serveStatic() finds "<path>.gz" by itself and sends it
+with Content-Encoding: gzip.
+
+PlatformIO runs this before building the filesystem image
+(extra_scripts = pre:tools/build_web_assets.py) and builds the image from
+.pio/web_data instead of data/. It also writes .pio/web_gen/web_assets_data.h,
+the same gzipped files as C arrays with a path/MIME/hash/length index, which
+src/web_assets.cpp compiles into the firmware when WEB_ASSETS_EMBEDDED is
+defined. Run it directly to see bytes per page load:
+
+    python3 tools/build_web_assets.py [data_dir] [out_dir] [header]
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+ASSET_TYPES = (".js", ".css")
+SKIPPED_TYPES = (".md",)
+ASSET_DIR = "assets"
+
+MIME_TYPES = {".html": "text/html", ".js": "application/javascript", ".css": "text/css"}
+
+# src="rules.js", href="/style.css"
+ASSET_REFERENCE = re.compile(r'(src|href)="/?([\w.-]+\.(?:js|css))"')
+
+
+# Words after which "/" starts a regular expression rather than a division
+REGEX_KEYWORDS = {"return", "typeof", "case", "do", "else", "in", "of", "new", "delete", "void", "throw",
+                  "instanceof", "yield", "await"}
+REGEX_AFTER = set("(,=:[!&|?{};+-*%<>~^")
+
+
+def _skip_quoted(text, i, quote):
+    """Index past the string starting at text[i] (a quote character)"""
+    i += 1
+    while i < len(text) and text[i] != quote:
+        i += 2 if text[i] == "\\" else 1
+    return i + 1
+
+
+def _skip_regex(text, i):
+    """Index past the regular expression literal starting at text[i] ("/")"""
+    i += 1
+    in_class = False
+    while i < len(text) and text[i] != "\n":
+        c = text[i]
+        if c == "\\":
+            i += 1
+        elif c == "[":
+            in_class = True
+        elif c == "]":
+            in_class = False
+        elif c == "/" and not in_class:
+            i += 1
+            while i < len(text) and (text[i].isalnum() or text[i] == "_"):
+                i += 1
+            return i
+        i += 1
+    return i
+
+
+def _skip_template(text, i):
+    """Index past the template literal starting at text[i] ("`"), including
+    the code of its ${...} substitutions"""
+    i += 1
+    while i < len(text) and text[i] != "`":
+        if text[i] == "\\":
+            i += 2
+        elif text.startswith("${", i):
+            i = _js_tokens(text, i + 2, [], stop_at_brace=True)
+        else:
+            i += 1
+    return i + 1
+
+
+def _js_tokens(text, i, tokens, stop_at_brace=False):
+    """Split JavaScript into ("code" | "literal" | "comment", text) tokens.
+    Strings, template literals and regular expressions are literals and are
+    never changed. Returns the index where scanning stopped: the end of the
+    text, or past the "}" closing a ${...} substitution."""
+    depth = 0
+    start = i
+    last = ""  # Last significant code character or word, to tell "/" apart
+
+    def flush(end):
+        if end > start:
+            tokens.append(("code", text[start:end]))
+
+    while i < len(text):
+        c = text[i]
+        if c in "'\"`" or (c == "/" and text[i + 1:i + 2] not in ("/", "*") and
+                           (last == "" or last in REGEX_AFTER or last in REGEX_KEYWORDS)):
+            flush(i)
+            end = _skip_template(text, i) if c == "`" else _skip_regex(text, i) if c == "/" else \
+                _skip_quoted(text, i, c)
+            tokens.append(("literal", text[i:end]))
+            i = start = end
+            last = ")"  # A literal is a value: "/" after it divides
+            continue
+        if text.startswith("//", i) or text.startswith("/*", i):
+            flush(i)
+            if text[i + 1] == "/":
+                end = text.find("\n", i)   # The line break stays in the code
+            else:
+                end = text.find("*/", i + 2)
+                end = end + 2 if end != -1 else -1
+            if end == -1:
+                end = len(text)
+            tokens.append(("comment", text[i:end]))
+            i = start = end
+            continue
+        if c == "{":
+            depth += 1
+        elif c == "}":
+            if stop_at_brace and depth == 0:
+                flush(i)
+                return i + 1
+            depth -= 1
+        if c.isalnum() or c in "_$":
+            word_start = i
+            while i < len(text) and (text[i].isalnum() or text[i] in "_$"):
+                i += 1
+            last = text[word_start:i]
+            continue
+        if not c.isspace():
+            last = c
+        i += 1
+    flush(i)
+    return i
+
+
+def _trim_lines(text):
+    """Indentation, trailing blanks and empty lines go; line breaks stay, so
+    automatic semicolon insertion sees the same code"""
+    return "\n".join(line.strip() for line in text.split("\n") if line.strip())
+
+
+def _join(tokens):
+    """Trim the whitespace of the code around literals. Literals may span
+    lines (template literals), so they are swapped for placeholders while the
+    lines are trimmed."""
+    literals = []
+    code = []
+    for kind, part in tokens:
+        if kind == "literal":
+            code.append("\0%d\0" % len(literals))
+            literals.append(part)
+        elif kind == "comment":
+            # Keeps the tokens on both sides apart, and a line break for ASI
+            code.append("\n" if "\n" in part or part.startswith("//") else " ")
+        else:
+            code.append(part)
+    trimmed = _trim_lines("".join(code))
+    return re.sub(r"\0(\d+)\0", lambda m: literals[int(m.group(1))], trimmed)
+
+
+def minify_js(text):
+    tokens = []
+    _js_tokens(text, 0, tokens)
+    return _join(tokens)
+
+
+def minify_css(text):
+    tokens = []
+    i = start = 0
+    while i < len(text):
+        if text[i] in "'\"":
+            tokens.append(("code", text[start:i]))
+            end = _skip_quoted(text, i, text[i])
+            tokens.append(("literal", text[i:end]))
+            i = start = end
+        elif text.startswith("/*", i):
+            tokens.append(("code", text[start:i]))
+            end = text.find("*/", i + 2)
+            end = len(text) if end == -1 else end + 2
+            tokens.append(("comment", text[i:end]))
+            i = start = end
+        else:
+            i += 1
+    tokens.append(("code", text[start:]))
+    return _join(tokens)
+
+
+# Elements whose content is not markup
+HTML_RAW = re.compile(r"<(script|style|pre|textarea)\b[^>]*>(.*?)</\1\s*>", re.S | re.I)
+# A tag with its attributes; quoted values may hold ">" and line breaks
+HTML_TAG = re.compile(r"</?[A-Za-z][^\s/>]*(?:\s+[^\s=>]+(?:\s*=\s*(?:\"[^\"]*\"|'[^']*'|[^\s>]+))?)*\s*/?>")
+
+
+def minify_html(text):
+    """Comments and indentation between tags go. Tags (and so attribute
+    values and inline handlers) are kept as they are, scripts and styles go
+    through minify_js() / minify_css(), <pre> and <textarea> are untouched."""
+    tokens = []
+    i = 0
+    for raw in HTML_RAW.finditer(text):
+        _html_tokens(text[i:raw.start()], tokens)
+        name, body = raw.group(1).lower(), raw.group(2)
+        open_tag = raw.group(0)[:raw.start(2) - raw.start()]
+        close_tag = raw.group(0)[raw.end(2) - raw.start():]
+        if name == "script" and body.strip():
+            body = "\n" + minify_js(body) + "\n"
+        elif name == "style" and body.strip():
+            body = "\n" + minify_css(body) + "\n"
+        tokens.append(("literal", open_tag + body + close_tag))
+        i = raw.end()
+    _html_tokens(text[i:], tokens)
+    return _join(tokens)
+
+
+def _html_tokens(text, tokens):
+    i = start = 0
+    while i < len(text):
+        if text.startswith("<!--", i):
+            tokens.append(("code", text[start:i]))
+            end = text.find("-->", i + 4)
+            end = len(text) if end == -1 else end + 3
+            tokens.append(("comment", text[i:end]))
+            i = start = end
+            continue
+        tag = HTML_TAG.match(text, i) if text[i] == "<" else None
+        if tag:
+            tokens.append(("code", text[start:i]))
+            tokens.append(("literal", tag.group(0)))
+            i = start = tag.end()
+            continue
+        i += 1
+    tokens.append(("code", text[start:]))
+
+
+def minify(text, ext):
+    """Whitespace and comments outside literals go; everything else, in
+    particular strings, template literals, regular expressions and
+    attribute values, is kept byte for byte. gzip does the rest."""
+    if ext == ".js":
+        return minify_js(text) + "\n"
+    if ext == ".css":
+        return minify_css(text) + "\n"
+    return minify_html(text) + "\n"
+
+
+def compress(data):
+    # mtime=0 keeps the output identical for identical input
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def build(data_dir, out_dir):
+    """Write the image contents to out_dir; returns per-page byte counts
+    {page: (raw, minified, gzipped, gzipped_page_only)}."""
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(os.path.join(out_dir, ASSET_DIR))
+
+    names = sorted(os.listdir(data_dir))
+    assets = {}  # name -> (hashed URL, raw bytes, minified bytes, gzipped bytes)
+    for name in names:
+        if not name.endswith(ASSET_TYPES):
+            continue
+        with open(os.path.join(data_dir, name), encoding="utf-8") as f:
+            raw = f.read()
+        small = minify(raw, os.path.splitext(name)[1]).encode("utf-8")
+        digest = hashlib.sha256(small).hexdigest()[:8]
+        stem, ext = os.path.splitext(name)
+        hashed = "%s/%s.%s%s" % (ASSET_DIR, stem, digest, ext)
+        packed = compress(small)
+        with open(os.path.join(out_dir, hashed + ".gz"), "wb") as f:
+            f.write(packed)
+        assets[name] = ("/" + hashed, len(raw.encode("utf-8")), len(small), len(packed))
+
+    pages = {}
+    for name in names:
+        path = os.path.join(data_dir, name)
+        if name.endswith(ASSET_TYPES) or name.endswith(SKIPPED_TYPES) or not os.path.isfile(path):
+            continue
+        if not name.endswith(".html"):
+            shutil.copyfile(path, os.path.join(out_dir, name))
+            continue
+        with open(path, encoding="utf-8") as f:
+            raw = f.read()
+        used = []
+
+        def hashed_reference(match):
+            asset = assets.get(match.group(2))
+            if asset is None:
+                return match.group(0)
+            used.append(asset)
+            return '%s="%s"' % (match.group(1), asset[0])
+
+        small = minify(ASSET_REFERENCE.sub(hashed_reference, raw), ".html").encode("utf-8")
+        packed = compress(small)
+        with open(os.path.join(out_dir, name + ".gz"), "wb") as f:
+            f.write(packed)
+        pages[name] = (len(raw.encode("utf-8")) + sum(a[1] for a in used),
+                       len(small) + sum(a[2] for a in used),
+                       len(packed) + sum(a[3] for a in used),
+                       len(packed))
+    return pages
+
+
+def write_header(out_dir, header):
+    """C index of every gzipped file in out_dir, for web_assets.h"""
+    files = []
+    for root, _, names in os.walk(out_dir):
+        for name in names:
+            if name.endswith(".gz"):
+                files.append(os.path.relpath(os.path.join(root, name), out_dir).replace(os.sep, "/"))
+    files.sort()
+
+    lines = ["// Generated by tools/build_web_assets.py from data/ - do not edit",
+             "// Included by src/web_assets.cpp only", ""]
+    entries = []
+    for i, name in enumerate(files):
+        with open(os.path.join(out_dir, name), "rb") as f:
+            data = f.read()
+        url = "/" + name[:-len(".gz")]
+        mime = MIME_TYPES.get(os.path.splitext(url)[1], "application/octet-stream")
+        digest = hashlib.sha256(data).hexdigest()[:8]
+        lines.append("static const uint8_t WEB_ASSET_%d[] PROGMEM = {  // %s" % (i, url))
+        for offset in range(0, len(data), 16):
+            lines.append("  " + ",".join("0x%02x" % b for b in data[offset:offset + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+        entries.append('  {"%s", "%s", "%s", WEB_ASSET_%d, %d},' % (url, mime, digest, i, len(data)))
+    lines.append("static const WebAsset WEB_ASSET_INDEX[] = {")
+    lines.extend(entries)
+    lines.append("};")
+
+    os.makedirs(os.path.dirname(header), exist_ok=True)
+    with open(header, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    return len(files)
+
+
+def report(pages):
+    print("Web assets, bytes per page load:")
+    print("  %-16s %8s %8s %8s %8s" % ("page", "before", "minified", "gzip", "cached"))
+    for name in sorted(pages):
+        raw, small, packed, page_only = pages[name]
+        print("  %-16s %8d %8d %8d %8d" % (name, raw, small, packed, page_only))
+    print("  (cached: repeat visit, hashed assets come from the browser cache)")
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+except NameError:
+    env = None
+
+if env is not None:
+    pio_dir = os.path.join(env.subst("$PROJECT_DIR"), ".pio")
+    out = os.path.join(pio_dir, "web_data")
+    report(build(env.subst("$PROJECT_DATA_DIR"), out))
+    write_header(out, os.path.join(pio_dir, "web_gen", "web_assets_data.h"))
+    env.Replace(PROJECT_DATA_DIR=out)
+    env.Append(CPPPATH=[os.path.join(pio_dir, "web_gen")])
+elif __name__ == "__main__":
+    here = os.path.dirname(os.path.abspath(__file__))
+    data = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "..", "data")
+    out = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, "..", ".pio", "web_data")
+    header = sys.argv[3] if len(sys.argv) > 3 else os.path.join(here, "..", ".pio", "web_gen", "web_assets_data.h")
+    report(build(data, out))
+    print("%d files indexed in %s" % (write_header(out, header), header))
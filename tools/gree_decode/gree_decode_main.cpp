@@ -0,0 +1,174 @@
+// Gree frame decoder: reads raw IR captures, decodes them with the codec the
+// firmware's frame cache uses and diffs them against the frames we send.
+//
+//   pio run -e gree_decode
+//   .pio/build/gree_decode/program remote_dump.txt
+//   .pio/build/gree_decode/program --state 1,24,1,0,2,2 remote_dump.txt
+//
+// Input is IRrecvDumpV2 output (every decimal "{ ... }" list is one capture) or
+// plain lines of comma/space separated mark and space durations in us.
+//
+// Options:
+//   --state P,T,F,M,V,H  Compare against the frame sent for this ACState
+//                        (power, temperature, fan, mode, vSwing, hSwing as in
+//                        rules.json) instead of the decoded state's own
+//
+// Exit status is 1 if any capture does not decode or differs from ours.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "gree_codec.h"
+
+static const char* modeNames[] = {"cool", "heat", "dry", "fan", "auto"};
+
+static bool readFile(const char* path, std::string& out) {
+  FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (!file) return false;
+  char chunk[4096];
+  size_t got;
+  while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    out.append(chunk, got);
+  }
+  if (file != stdin) fclose(file);
+  return true;
+}
+
+static void parseNumbers(const char* begin, const char* end, std::vector<uint16_t>& out) {
+  const char* p = begin;
+  while (p < end) {
+    if (*p >= '0' && *p <= '9') {
+      unsigned long value = strtoul(p, (char**)&p, 10);
+      out.push_back(value > UINT16_MAX ? UINT16_MAX : (uint16_t)value);
+    } else {
+      p++;
+    }
+  }
+}
+
+// One capture per "{ ... }" list if there are any, else one per line
+static void splitCaptures(const std::string& text, std::vector<std::vector<uint16_t>>& captures) {
+  const char* p = text.c_str();
+  const char* end = p + text.size();
+  bool braces = text.find('{') != std::string::npos;
+  while (p < end) {
+    const char* open = braces ? strchr(p, '{') : p;
+    if (!open) break;
+    if (braces) open++;
+    const char* close = strchr(open, braces ? '}' : '\n');
+    if (!close) close = end;
+    std::vector<uint16_t> timings;
+    std::string list(open, close);
+    if (list.find("0x") == std::string::npos) {   // Skip IRrecvDumpV2's hex state arrays
+      parseNumbers(open, close, timings);
+    }
+    if (!timings.empty()) captures.push_back(timings);
+    p = close + 1;
+  }
+}
+
+static bool parseState(const char* text, ACState& state) {
+  int power, temp, fan, mode, vSwing, hSwing;
+  if (sscanf(text, "%d,%d,%d,%d,%d,%d", &power, &temp, &fan, &mode, &vSwing, &hSwing) != 6) return false;
+  state = makeACState(power != 0, (uint8_t)temp, (uint8_t)fan, (uint8_t)mode, vSwing, hSwing);
+  return true;
+}
+
+static void printBytes(const char* label, const uint8_t bytes[GREE_STATE_LENGTH]) {
+  printf("  %-9s", label);
+  for (int i = 0; i < GREE_STATE_LENGTH; i++) printf(" %02X", bytes[i]);
+  printf("\n");
+}
+
+// Mean and worst deviation of marks and spaces from the nominal waveform
+static void printTimingDeviation(const std::vector<uint16_t>& capture, const uint16_t nominal[GREE_FRAME_TIMINGS]) {
+  long sum[2] = {0, 0}, worst[2] = {0, 0};
+  int count[2] = {0, 0};
+  for (size_t i = 0; i < capture.size(); i++) {
+    if (nominal[i] == GREE_MSG_SPACE) continue;   // Gaps vary freely
+    long delta = (long)capture[i] - nominal[i];
+    int kind = i % 2;
+    sum[kind] += delta;
+    count[kind]++;
+    if (labs(delta) > labs(worst[kind])) worst[kind] = delta;
+  }
+  printf("  timing:   marks %+ld us mean (worst %+ld), spaces %+ld us mean (worst %+ld)\n",
+         count[0] ? sum[0] / count[0] : 0, worst[0], count[1] ? sum[1] / count[1] : 0, worst[1]);
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  ACState reference;
+  bool haveReference = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+      if (!parseState(argv[++i], reference)) {
+        fprintf(stderr, "Invalid state: %s\n", argv[i]);
+        return 2;
+      }
+      haveReference = true;
+    } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+      path = argv[i];
+    } else {
+      path = nullptr;
+      break;
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "Usage: %s [--state P,T,F,M,V,H] CAPTURE_FILE\n", argv[0]);
+    return 2;
+  }
+
+  std::string text;
+  if (!readFile(path, text)) {
+    fprintf(stderr, "❌ Cannot read %s\n", path);
+    return 1;
+  }
+  std::vector<std::vector<uint16_t>> captures;
+  splitCaptures(text, captures);
+  if (captures.empty()) {
+    fprintf(stderr, "❌ No timings found in %s\n", path);
+    return 1;
+  }
+
+  int failures = 0;
+  for (size_t n = 0; n < captures.size(); n++) {
+    const std::vector<uint16_t>& capture = captures[n];
+    printf("Capture %u: %u timings\n", (unsigned)(n + 1), (unsigned)capture.size());
+    uint8_t bytes[GREE_STATE_LENGTH];
+    if (capture.size() > UINT16_MAX || !greeDecodeTimings(capture.data(), (uint16_t)capture.size(), bytes)) {
+      printf("  ❌ not a Gree frame (bad length, timing or checksum)\n");
+      failures++;
+      continue;
+    }
+
+    ACState state;
+    greeDecodeState(bytes, state);
+    printBytes("capture:", bytes);
+    printf("  state:    power=%s temp=%d fan=%d mode=%s vSwing=%d hSwing=%d\n", state.power() ? "on" : "off",
+           state.temperature(), state.fanSpeed(), state.mode() < 5 ? modeNames[state.mode()] : "?", state.vSwing(),
+           state.hSwing());
+
+    uint8_t ours[GREE_STATE_LENGTH];
+    greeEncodeState(haveReference ? reference : state, ours);
+    printBytes("ours:", ours);
+    if (memcmp(bytes, ours, GREE_STATE_LENGTH) != 0) {
+      printf("  ⚠️  differs in byte");
+      for (int i = 0; i < GREE_STATE_LENGTH; i++) {
+        if (bytes[i] != ours[i]) printf(" %d (bits %02X)", i, bytes[i] ^ ours[i]);
+      }
+      printf("\n");
+      failures++;
+    } else {
+      printf("  ✅ identical bytes\n");
+    }
+
+    uint16_t nominal[GREE_FRAME_TIMINGS];
+    greeEncodeTimings(bytes, nominal);
+    printTimingDeviation(capture, nominal);
+  }
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+"""
+Time the web UI as a browser loads it: connect time, time to first byte
+and total time of each page and the scripts it references, first without
+and then with If-None-Match (a repeat visit revalidating its copy).
+
+Compare the SPIFFS and the flash-embedded builds by flashing each and
+running this against the board:
+
+    pio run -e esp32-s3-devkitc-1 -t upload && pio run -t uploadfs
+    python3 tools/measure_page_load.py 192.168.1.50 > spiffs.txt
+    pio run -e esp32-s3-embedded-ui -t upload
+    python3 tools/measure_page_load.py 192.168.1.50 > flash.txt
+
+Every request opens a new connection, as a page load's first request does.
+Prints the median and 90th percentile in milliseconds per URL.
+"""
+
+import argparse
+import gzip
+import http.client
+import re
+import statistics
+import time
+
+PAGES = ["/", "/index.html", "/dashboard.html", "/control.html", "/rules.html", "/settings.html"]
+SCRIPT_REFERENCE = re.compile(rb'(?:src|href)="(/assets/[^"]+)"')
+
+
+def fetch(host, port, path, etag=None, timeout=10.0):
+    """One request on a fresh connection: (status, etag, body, connect_ms,
+    first_byte_ms, total_ms)"""
+    headers = {"Accept-Encoding": "gzip"}
+    if etag:
+        headers["If-None-Match"] = etag
+    start = time.perf_counter()
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.connect()
+        connected = time.perf_counter()
+        conn.request("GET", path, headers=headers)
+        response = conn.getresponse()   # Returns once the status line and headers are in
+        first_byte = time.perf_counter()
+        body = response.read()
+        done = time.perf_counter()
+        return (response.status, response.getheader("ETag"), body, (connected - start) * 1000,
+                (first_byte - start) * 1000, (done - start) * 1000)
+    finally:
+        conn.close()
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(round(fraction * (len(ordered) - 1))))]
+
+
+def measure(host, port, paths, rounds):
+    print("%-34s %-11s %5s %8s %15s %15s" % ("url", "request", "code", "bytes", "first byte ms", "total ms"))
+    for path in paths:
+        etag = None
+        for mode in ("full", "revalidate"):
+            first_bytes, totals = [], []
+            status, size = None, 0
+            for _ in range(rounds):
+                status, tag, body, _, first_byte, total = fetch(host, port, path, etag if mode == "revalidate" else None)
+                if mode == "full":
+                    etag = tag
+                size = len(body)
+                first_bytes.append(first_byte)
+                totals.append(total)
+            if mode == "revalidate" and etag is None:
+                continue   # No ETag, nothing to revalidate
+            print("%-34s %-11s %5d %8d %7.1f / %5.1f %7.1f / %5.1f" % (
+                path, mode, status, size, statistics.median(first_bytes), percentile(first_bytes, 0.9),
+                statistics.median(totals), percentile(totals, 0.9)))
+    print("(median / 90th percentile over %d requests each)" % rounds)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--rounds", type=int, default=20)
+    parser.add_argument("paths", nargs="*", help="URLs to time (default: every page and its scripts)")
+    args = parser.parse_intermixed_args()
+
+    paths = args.paths or list(PAGES)
+    if not args.paths:
+        # Hashed script names change with their content; take them from the pages
+        for page in PAGES:
+            status, _, body, _, _, _ = fetch(args.host, args.port, page)
+            if status == 200 and body[:2] == b"\x1f\x8b":
+                body = gzip.decompress(body)
+            for asset in SCRIPT_REFERENCE.findall(body):
+                if asset.decode() not in paths:
+                    paths.append(asset.decode())
+    measure(args.host, args.port, paths, args.rounds)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,235 @@
+// Trace replay: runs recorded temperature logs through the same decision
+// code controlTask() uses (decideControl() + controlNeedsCommand()) and
+// reports the AC command stream and how often each rule matched.
+//
+//   pio run -e replay
+//   .pio/build/replay/program --rules data/rules.json --commands cmds.csv summer.csv
+//   .pio/build/replay/program --start 2026-07-01 serial.log --write-bin summer.bin
+//
+// Options:
+//   --rules FILE        rules.json to evaluate (default data/rules.json)
+//   --commands FILE     Write the command stream as CSV ("-" = stdout)
+//   --write-bin FILE    Also save the parsed trace in the binary format
+//   --start YYYY-MM-DD  Date of the first line of a serial log capture
+//   --utc-offset HOURS  Local time offset for epoch timestamps (default +8, as gmtOffset_sec)
+//
+// Samples are evaluated one by one as if the control loop woke for each, so
+// the command stream is what the device sends when the trace is sampled at
+// its own sensor interval.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ArduinoJson.h>
+#include "control_schedule.h"
+#include "rule_json.h"
+#include "rule_set.h"
+#include "rule_store.h"
+#include "trace_reader.h"
+
+#define REPLAY_BATCH 65536
+#define SECONDS_PER_DAY 86400
+
+struct RuleHits {
+  uint64_t samples;
+  uint64_t commands;
+};
+
+static bool readFile(const char* path, std::string& out) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return false;
+  char chunk[65536];
+  size_t got;
+  while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    out.append(chunk, got);
+  }
+  fclose(file);
+  return true;
+}
+
+// Same parsing as loadRulesFromSPIFFS(), publishing into a local store
+static bool loadRules(const char* path, RuleStore& store) {
+  std::string text;
+  if (!readFile(path, text)) {
+    fprintf(stderr, "❌ Cannot read %s\n", path);
+    return false;
+  }
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, text);
+  if (error) {
+    fprintf(stderr, "❌ Failed to parse %s: %s\n", path, error.c_str());
+    return false;
+  }
+
+  RuleSet rules;
+  RuleNamePool names;
+  int position = 0;
+  for (JsonObject rule : doc["rules"].as<JsonArray>()) {
+    ACRule loaded;
+    std::vector<RuleDateException> exceptions;
+    ruleFromJson(rule, loaded, names, position + 1, position);
+    exceptionsFromJson(rule["exceptions"], exceptions);
+    if (rules.insert(loaded) == nullptr) {
+      loaded.id = rules.nextId();
+      rules.insert(loaded);
+    }
+    rules.setExceptions(loaded.id, exceptions.data(), (int)exceptions.size());
+    position++;
+  }
+  store.publish(rules.data(), rules.size(), names, rules.exceptionData(), rules.exceptionCount());
+  return true;
+}
+
+static void formatTime(uint32_t localSeconds, char* buffer, size_t size) {
+  int year, month, day;
+  uint32_t secondOfDay = localSeconds % SECONDS_PER_DAY;
+  ruleDayToDate((int32_t)(localSeconds / SECONDS_PER_DAY), year, month, day);
+  snprintf(buffer, size, "%04d-%02d-%02d %02u:%02u:%02u", year, month, day,
+           (unsigned)(secondOfDay / 3600), (unsigned)(secondOfDay / 60 % 60), (unsigned)(secondOfDay % 60));
+}
+
+int main(int argc, char** argv) {
+  const char* rulesPath = "data/rules.json";
+  const char* commandsPath = nullptr;
+  const char* binaryPath = nullptr;
+  const char* tracePath = nullptr;
+  int32_t startDay = -1;
+  int32_t utcOffset = 8 * 3600;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--rules") == 0 && hasValue) {
+      rulesPath = argv[++i];
+    } else if (strcmp(argv[i], "--commands") == 0 && hasValue) {
+      commandsPath = argv[++i];
+    } else if (strcmp(argv[i], "--write-bin") == 0 && hasValue) {
+      binaryPath = argv[++i];
+    } else if (strcmp(argv[i], "--start") == 0 && hasValue) {
+      if (!parseRuleDate(argv[++i], startDay)) {
+        fprintf(stderr, "Invalid start date: %s\n", argv[i]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--utc-offset") == 0 && hasValue) {
+      utcOffset = (int32_t)(atof(argv[++i]) * 3600);
+    } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+      tracePath = argv[i];
+    } else {
+      tracePath = nullptr;
+      break;
+    }
+  }
+  if (!tracePath) {
+    fprintf(stderr, "Usage: %s [--rules FILE] [--commands FILE] [--write-bin FILE] "
+                    "[--start YYYY-MM-DD] [--utc-offset HOURS] TRACE\n", argv[0]);
+    return 2;
+  }
+
+  RuleStore store;
+  if (!loadRules(rulesPath, store)) return 1;
+  TraceReader reader;
+  if (!reader.open(tracePath, utcOffset, startDay)) {
+    fprintf(stderr, "❌ %s: %s\n", tracePath, reader.getError());
+    return 1;
+  }
+  FILE* commands = nullptr;
+  if (commandsPath) {
+    commands = strcmp(commandsPath, "-") == 0 ? stdout : fopen(commandsPath, "w");
+    if (!commands) {
+      fprintf(stderr, "❌ Cannot write %s\n", commandsPath);
+      return 1;
+    }
+    fprintf(commands, "time,rule,power,setTemp,fanSpeed,mode,vSwing,hSwing\n");
+  }
+  TraceWriter writer;
+  if (binaryPath && !writer.open(binaryPath)) {
+    fprintf(stderr, "❌ Cannot write %s\n", binaryPath);
+    return 1;
+  }
+
+  RuleSnapshotGuard snapshot(store);
+  std::vector<RuleHits> hits(snapshot->rules.size() + 1, RuleHits{0, 0});   // Last entry: no rule
+  std::vector<TraceSample> batch(REPLAY_BATCH);
+  ACState current = AC_STATE_OFF;   // Boot state of the firmware's ACStateTracker
+  uint64_t samples = 0, commandCount = 0;
+  uint32_t firstSeconds = 0, lastSeconds = 0;
+  uint64_t humiditySamples = 0, humiditySum = 0;
+  uint16_t humidityMin = UINT16_MAX, humidityMax = 0;
+
+  auto wallStart = std::chrono::steady_clock::now();
+  size_t count;
+  while ((count = reader.read(batch.data(), batch.size())) > 0) {
+    writer.write(batch.data(), count);
+    for (size_t i = 0; i < count; i++) {
+      const TraceSample& sample = batch[i];
+      int32_t day = (int32_t)(sample.localSeconds / SECONDS_PER_DAY);
+      uint32_t secondOfDay = sample.localSeconds % SECONDS_PER_DAY;
+      int minuteOfWeek = weekMinute((day + 6) % 7, 0, (int)(secondOfDay / 60));   // 2000-01-01 was a Saturday
+
+      ControlDecision decision = decideControl(*snapshot, day, minuteOfWeek, sample.tempCenti);
+      RuleHits& ruleHits = decision.ruleIndex != -1 ? hits[decision.ruleIndex] : hits.back();
+      ruleHits.samples++;
+      if (controlNeedsCommand(decision, current)) {
+        current = decision.target;
+        ruleHits.commands++;
+        commandCount++;
+        if (commands) {
+          char time[24];
+          formatTime(sample.localSeconds, time, sizeof(time));
+          int ruleId = decision.ruleIndex != -1 ? snapshot->rules[decision.ruleIndex].id : -1;
+          fprintf(commands, "%s,%d,%d,%d,%d,%d,%d,%d\n", time, ruleId, current.power(), current.temperature(),
+                  current.fanSpeed(), current.mode(), current.vSwing(), current.hSwing());
+        }
+      }
+      if (sample.humidityCenti != TRACE_NO_HUMIDITY) {
+        humiditySamples++;
+        humiditySum += sample.humidityCenti;
+        if (sample.humidityCenti < humidityMin) humidityMin = sample.humidityCenti;
+        if (sample.humidityCenti > humidityMax) humidityMax = sample.humidityCenti;
+      }
+    }
+    if (samples == 0) firstSeconds = batch[0].localSeconds;
+    lastSeconds = batch[count - 1].localSeconds;
+    samples += count;
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  if (reader.getError()) {
+    fprintf(stderr, "❌ %s: %s\n", tracePath, reader.getError());
+    return 1;
+  }
+  if (commands && commands != stdout) fclose(commands);
+  if (!writer.close()) {
+    fprintf(stderr, "❌ Failed writing %s\n", binaryPath);
+    return 1;
+  }
+
+  // Summary goes to stderr when the command stream is on stdout
+  FILE* report = commands == stdout ? stderr : stdout;
+  char from[24], to[24];
+  formatTime(firstSeconds, from, sizeof(from));
+  formatTime(lastSeconds, to, sizeof(to));
+  fprintf(report, "🔁 Replayed %llu samples in %.3f s (%.1f M samples/s), %llu lines skipped\n",
+          (unsigned long long)samples, wallSeconds, samples / wallSeconds / 1e6,
+          (unsigned long long)reader.getSkippedLines());
+  if (samples == 0) return 0;
+  fprintf(report, "📅 %s .. %s, %s trace\n", from, to, reader.isBinary() ? "binary" : "text");
+  fprintf(report, "📡 IR commands: %llu\n", (unsigned long long)commandCount);
+  if (humiditySamples > 0) {
+    fprintf(report, "💧 Humidity: min %.1f%%, mean %.1f%%, max %.1f%%\n", humidityMin / 100.0,
+            humiditySum / 100.0 / humiditySamples, humidityMax / 100.0);
+  }
+  fprintf(report, "\n  Rule  %-28s %12s %7s %9s\n", "Name", "Samples", "Share", "Commands");
+  for (size_t i = 0; i < hits.size(); i++) {
+    bool noRule = i == snapshot->rules.size();
+    if (noRule && hits[i].samples == 0) continue;
+    fprintf(report, "  %4s  %-28s %12llu %6.2f%% %9llu\n",
+            noRule ? "-" : std::to_string(snapshot->rules[i].id).c_str(),
+            noRule ? "(no rule: AC off)" : snapshot->names.get(snapshot->rules[i].nameId),
+            (unsigned long long)hits[i].samples, 100.0 * hits[i].samples / samples,
+            (unsigned long long)hits[i].commands);
+  }
+  return 0;
+}
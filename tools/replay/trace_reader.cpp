@@ -0,0 +1,260 @@
+#include "trace_reader.h"
+#include <string.h>
+#include <stdlib.h>
+#include "rule_types.h"
+
+#define TRACE_BUFFER_SIZE (1 << 20)
+#define SECONDS_PER_DAY 86400
+#define UNIX_2000_01_01 946684800   // ruleDayNumber() epoch in Unix seconds
+#define SERIAL_MARKER "IoT Log - Temp:"
+
+struct TraceHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t recordSize;
+};
+
+// Hand-rolled number parsing: strtod/sscanf dominate the replay time otherwise
+static bool parseDigits(const char*& p, int maxDigits, int64_t& value) {
+  int digits = 0;
+  value = 0;
+  while (*p >= '0' && *p <= '9' && digits < maxDigits) {
+    value = value * 10 + (*p++ - '0');
+    digits++;
+  }
+  return digits > 0;
+}
+
+// "27.5", "-3", "26.125" -> centi-units, rounded half away from zero
+static bool parseCenti(const char*& p, int32_t& centi) {
+  while (*p == ' ' || *p == '"') p++;
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+') p++;
+  int64_t whole = 0;
+  bool hasWhole = parseDigits(p, 6, whole);
+  int32_t fraction = 0;
+  bool hasFraction = false;
+  if (*p == '.') {
+    p++;
+    int scale = 1000;
+    while (*p >= '0' && *p <= '9') {
+      fraction += (*p++ - '0') * scale / 10;
+      scale /= 10;
+      hasFraction = true;
+    }
+  }
+  if (!hasWhole && !hasFraction) return false;
+  int32_t milli = (int32_t)whole * 1000 + fraction;   // Fraction holds thousandths
+  centi = (milli + 5) / 10;
+  if (negative) centi = -centi;
+  return true;
+}
+
+static bool expect(const char*& p, char c) {
+  if (*p != c) return false;
+  p++;
+  return true;
+}
+
+TraceReader::TraceReader()
+    : file(nullptr), binary(false), buffer(nullptr), bufferStart(0), bufferEnd(0),
+      utcOffset(0), serialDay(-1), lastSerialSecond(-1), skippedLines(0), error(nullptr) {
+}
+
+TraceReader::~TraceReader() {
+  if (file) fclose(file);
+  free(buffer);
+}
+
+bool TraceReader::open(const char* path, int32_t utcOffsetSeconds, int32_t startDay) {
+  file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (!file) {
+    error = "cannot open trace";
+    return false;
+  }
+  utcOffset = utcOffsetSeconds;
+  serialDay = startDay;
+
+  // +1 keeps room for the terminator of a final line without a newline
+  buffer = (char*)malloc(TRACE_BUFFER_SIZE + 1);
+  size_t got = fread(buffer, 1, TRACE_BUFFER_SIZE, file);
+  bufferEnd = got;
+  TraceHeader header;
+  if (got >= sizeof(header) && memcmp(buffer, TRACE_MAGIC, 4) == 0) {
+    memcpy(&header, buffer, sizeof(header));
+    if (header.version != TRACE_FORMAT_VERSION || header.recordSize != sizeof(TraceSample)) {
+      error = "unsupported binary trace version";
+      return false;
+    }
+    binary = true;
+    bufferStart = sizeof(header);
+  }
+  return true;
+}
+
+size_t TraceReader::read(TraceSample* out, size_t capacity) {
+  if (!file || error) return 0;
+
+  if (binary) {
+    // Drain what open() buffered, then read records straight into `out`
+    size_t count = 0;
+    size_t buffered = (bufferEnd - bufferStart) / sizeof(TraceSample);
+    if (buffered > 0) {
+      count = buffered < capacity ? buffered : capacity;
+      memcpy(out, buffer + bufferStart, count * sizeof(TraceSample));
+      bufferStart += count * sizeof(TraceSample);
+    }
+    if (count < capacity && bufferStart + sizeof(TraceSample) > bufferEnd) {
+      // A partial record left in the buffer continues in the file
+      size_t partial = bufferEnd - bufferStart;
+      if (partial > 0) {
+        TraceSample sample;
+        memcpy(&sample, buffer + bufferStart, partial);
+        if (fread((char*)&sample + partial, 1, sizeof(sample) - partial, file) == sizeof(sample) - partial) {
+          out[count++] = sample;
+        }
+        bufferStart = bufferEnd;
+      }
+      count += fread(out + count, sizeof(TraceSample), capacity - count, file);
+    }
+    return count;
+  }
+
+  size_t count = 0;
+  while (count < capacity) {
+    char* line = buffer + bufferStart;
+    char* newline = (char*)memchr(line, '\n', bufferEnd - bufferStart);
+    if (!newline) {
+      // Move the partial line to the front and refill
+      size_t partial = bufferEnd - bufferStart;
+      memmove(buffer, line, partial);
+      bufferStart = 0;
+      bufferEnd = partial + fread(buffer + partial, 1, TRACE_BUFFER_SIZE - partial, file);
+      if (bufferEnd == partial) {
+        if (partial == 0) break;
+        newline = buffer + partial;   // Last line without a newline
+      } else {
+        continue;
+      }
+      line = buffer;
+    }
+    *newline = '\0';
+    bufferStart = newline + 1 - buffer;
+    if (bufferStart > bufferEnd) bufferStart = bufferEnd;
+    if (parseLine(line, out[count])) {
+      count++;
+    } else if (error) {
+      break;
+    }
+  }
+  return count;
+}
+
+bool TraceReader::parseLine(const char* line, TraceSample& sample) {
+  const char* p = line;
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p == '\0' || *p == '\r' || *p == '#') return false;
+
+  if (*p < '0' || *p > '9') {
+    const char* marker = strstr(p, SERIAL_MARKER);
+    if (marker) return parseSerialLine(marker, line, sample);
+    skippedLines++;   // CSV header or unrelated serial output
+    return false;
+  }
+
+  int64_t seconds;
+  int64_t first;
+  parseDigits(p, 12, first);
+  if (*p == '-') {
+    // YYYY-MM-DD HH:MM:SS local time
+    int64_t month, dayOfMonth, hour, minute, second = 0;
+    bool ok = expect(p, '-') && parseDigits(p, 2, month) && expect(p, '-') && parseDigits(p, 2, dayOfMonth) &&
+              (expect(p, ' ') || expect(p, 'T')) && parseDigits(p, 2, hour) && expect(p, ':') &&
+              parseDigits(p, 2, minute);
+    if (ok && *p == ':') {
+      p++;
+      ok = parseDigits(p, 2, second);
+    }
+    if (!ok || month < 1 || month > 12 || dayOfMonth < 1 || dayOfMonth > 31 || hour > 23 || minute > 59 ||
+        second > 59) {
+      skippedLines++;
+      return false;
+    }
+    seconds = (int64_t)ruleDayNumber((int)first, (int)month, (int)dayOfMonth) * SECONDS_PER_DAY +
+              hour * 3600 + minute * 60 + second;
+  } else {
+    seconds = first + utcOffset - UNIX_2000_01_01;
+    if (*p == '.') {   // Fractional epoch seconds
+      p++;
+      while (*p >= '0' && *p <= '9') p++;
+    }
+  }
+
+  int32_t temp;
+  if (seconds < 0 || seconds > UINT32_MAX || !expect(p, ',') || !parseCenti(p, temp) ||
+      temp < INT16_MIN || temp > INT16_MAX) {
+    skippedLines++;
+    return false;
+  }
+  sample.localSeconds = (uint32_t)seconds;
+  sample.tempCenti = (int16_t)temp;
+  sample.humidityCenti = TRACE_NO_HUMIDITY;
+
+  int32_t humidity;
+  if (expect(p, ',') && parseCenti(p, humidity) && humidity >= 0 && humidity <= 10000) {
+    sample.humidityCenti = (uint16_t)humidity;
+  }
+  return true;
+}
+
+// "[HH:MM:SS] IoT Log - Temp: 27.5°C". The log has no date, so days are
+// counted from the start date and advance whenever the clock goes backwards.
+bool TraceReader::parseSerialLine(const char* marker, const char* line, TraceSample& sample) {
+  const char* p = strchr(line, '[');
+  int64_t hour, minute, second;
+  if (!p || p > marker || !expect(p, '[') || !parseDigits(p, 2, hour) || !expect(p, ':') ||
+      !parseDigits(p, 2, minute) || !expect(p, ':') || !parseDigits(p, 2, second)) {
+    skippedLines++;
+    return false;
+  }
+  if (serialDay < 0) {
+    error = "serial log lines need a start date (--start)";
+    return false;
+  }
+  int32_t secondOfDay = (int32_t)(hour * 3600 + minute * 60 + second);
+  if (secondOfDay < lastSerialSecond) serialDay++;
+  lastSerialSecond = secondOfDay;
+
+  p = marker + strlen(SERIAL_MARKER);
+  int32_t temp;
+  if (!parseCenti(p, temp) || temp < INT16_MIN || temp > INT16_MAX) {
+    skippedLines++;
+    return false;
+  }
+  sample.localSeconds = (uint32_t)serialDay * SECONDS_PER_DAY + secondOfDay;
+  sample.tempCenti = (int16_t)temp;
+  sample.humidityCenti = TRACE_NO_HUMIDITY;
+  return true;
+}
+
+bool TraceWriter::open(const char* path) {
+  file = fopen(path, "wb");
+  if (!file) return false;
+  TraceHeader header;
+  memcpy(header.magic, TRACE_MAGIC, 4);
+  header.version = TRACE_FORMAT_VERSION;
+  header.recordSize = sizeof(TraceSample);
+  return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+void TraceWriter::write(const TraceSample* samples, size_t count) {
+  if (file) fwrite(samples, sizeof(TraceSample), count, file);
+}
+
+bool TraceWriter::close() {
+  if (!file) return true;
+  bool ok = ferror(file) == 0;
+  ok = fclose(file) == 0 && ok;
+  file = nullptr;
+  return ok;
+}
@@ -0,0 +1,74 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// One recorded sensor reading. Time is local wall-clock seconds since
+// 2000-01-01 00:00 (the epoch of ruleDayNumber()), so the day and minute of
+// week fall out of a division without any time zone handling per sample.
+struct TraceSample {
+  uint32_t localSeconds;
+  int16_t tempCenti;
+  uint16_t humidityCenti;   // Relative humidity in 0.01 %, TRACE_NO_HUMIDITY if not recorded
+};
+
+#define TRACE_NO_HUMIDITY 0xFFFF
+
+// Binary trace: 8 byte header followed by packed little-endian TraceSample records
+#define TRACE_MAGIC "ACTR"
+#define TRACE_FORMAT_VERSION 1
+
+static_assert(sizeof(TraceSample) == 8, "TraceSample is the on-disk record");
+
+// Streams samples from a binary trace or a text file. Text lines may be
+//   CSV:    timestamp,temperature[,humidity]   (epoch seconds or "YYYY-MM-DD HH:MM:SS")
+//   serial: [HH:MM:SS] IoT Log - Temp: 27.5°C  (logToCloud() output, needs a start date)
+// mixed with anything else (headers, comments, other serial output), which is skipped.
+class TraceReader {
+public:
+    TraceReader();
+    ~TraceReader();
+
+    // utcOffsetSeconds converts CSV epoch timestamps to local time.
+    // startDay (ruleDayNumber()) dates serial log lines; -1 if not given.
+    bool open(const char* path, int32_t utcOffsetSeconds, int32_t startDay);
+    bool isBinary() const { return binary; }
+
+    // Fill up to `capacity` samples, returns 0 at end of input
+    size_t read(TraceSample* out, size_t capacity);
+
+    uint64_t getSkippedLines() const { return skippedLines; }
+    const char* getError() const { return error; }
+
+private:
+    bool parseLine(const char* line, TraceSample& sample);
+    bool parseSerialLine(const char* marker, const char* line, TraceSample& sample);
+
+    FILE* file;
+    bool binary;
+    char* buffer;
+    size_t bufferStart;
+    size_t bufferEnd;
+    int32_t utcOffset;
+    int32_t serialDay;
+    int32_t lastSerialSecond;
+    uint64_t skippedLines;
+    const char* error;
+};
+
+// Binary trace writer for converting text logs once and replaying them fast
+class TraceWriter {
+public:
+    TraceWriter() : file(nullptr) {}
+    ~TraceWriter() { close(); }
+
+    bool open(const char* path);
+    void write(const TraceSample* samples, size_t count);
+    bool close();
+
+private:
+    FILE* file;
+};
+
+#endif
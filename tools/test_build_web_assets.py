@@ -0,0 +1,148 @@
+"""
+Checks of the web asset minifier, on tricky snippets and on every page and
+script in data/. Run with:
+
+    python3 -m unittest discover -s tools -p "test_*.py"
+
+The shipped scripts are also syntax-checked with node when it is installed.
+"""
+
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+import build_web_assets as web
+
+DATA_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "data")
+SCRIPT = re.compile(r"<script\b[^>]*>(.*?)</script\s*>", re.S | re.I)
+
+
+def tokens(text):
+    found = []
+    web._js_tokens(text, 0, found)
+    return found
+
+
+def literals(text):
+    return [part for kind, part in tokens(text) if kind == "literal"]
+
+
+def code_without_whitespace(text):
+    return "".join("".join(part.split()) for kind, part in tokens(text) if kind == "code")
+
+
+def node_check(test, source):
+    node = shutil.which("node")
+    if node is None:
+        return
+    with tempfile.NamedTemporaryFile("w", suffix=".js", delete=False, encoding="utf-8") as f:
+        f.write(source)
+    try:
+        result = subprocess.run([node, "--check", f.name], capture_output=True, text=True)
+        test.assertEqual(result.returncode, 0, result.stderr)
+    finally:
+        os.unlink(f.name)
+
+
+class MinifySnippets(unittest.TestCase):
+    def test_template_literals_are_kept(self):
+        source = ("const html = `\n"
+                  "    <!-- stays in the page -->\n"
+                  "    // not a comment\n"
+                  "    ${items.map(i => `<li>${i} // ${'}'}</li>`).join('')}\n"
+                  "`;  // comment\n")
+        small = web.minify_js(source)
+        self.assertIn("    <!-- stays in the page -->\n    // not a comment\n", small)
+        self.assertIn("${items.map(i => `<li>${i} // ${'}'}</li>`).join('')}", small)
+        self.assertNotIn("// comment", small)
+
+    def test_strings_and_regexes_are_kept(self):
+        source = ("  const url = 'http://x/' + \"/*y*/\";  // URL\n"
+                  "  const slashes = /\\/\\/[/]/g; /* gone */ const half = a / 2 / b;\n"
+                  "  return /=>/.test(s) ? `a` : 'b';\n")
+        small = web.minify_js(source)
+        self.assertEqual("const url = 'http://x/' + \"/*y*/\";\n"
+                         "const slashes = /\\/\\/[/]/g;   const half = a / 2 / b;\n"
+                         "return /=>/.test(s) ? `a` : 'b';", small)
+
+    def test_comments_keep_line_breaks(self):
+        # No semicolons: the line break after the comment ends the statement
+        self.assertEqual("let a = 1\nlet b = 2", web.minify_js("let a = 1 /* one\n */ let b = 2"))
+        self.assertEqual("x()\ny()", web.minify_js("x() // first\n\n\n    y()"))
+
+    def test_html(self):
+        source = ("<div>\n"
+                  "    <!-- gone -->\n"
+                  "    <a href=\"//example.com\" title=\"two\n     lines\">link</a>\n"
+                  "    <pre>\n  kept   as is\n</pre>\n"
+                  "    <script>\n"
+                  "        const t = `<!-- kept -->`;  // gone\n"
+                  "    </script>\n"
+                  "</div>\n")
+        small = web.minify_html(source)
+        self.assertNotIn("gone", small)
+        self.assertIn("<a href=\"//example.com\" title=\"two\n     lines\">link</a>", small)
+        self.assertIn("<pre>\n  kept   as is\n</pre>", small)
+        self.assertIn("const t = `<!-- kept -->`;", small)
+
+    def test_css(self):
+        self.assertEqual("a::before {\ncontent: \"/* kept */\";\n}",
+                         web.minify_css("  /* gone */\n  a::before {\n    content: \"/* kept */\";\n  }\n"))
+
+
+class MinifyShippedAssets(unittest.TestCase):
+    """Minifying data/ may only drop comments and whitespace around code"""
+
+    def scripts(self):
+        for name in sorted(os.listdir(DATA_DIR)):
+            with open(os.path.join(DATA_DIR, name), encoding="utf-8") as f:
+                text = f.read()
+            if name.endswith(".js"):
+                yield name, text, web.minify(text, ".js")
+            elif name.endswith(".html"):
+                small = web.minify(text, ".html")
+                before, after = SCRIPT.findall(text), SCRIPT.findall(small)
+                self.assertEqual(len(before), len(after), name)
+                for i, (script, minified) in enumerate(zip(before, after)):
+                    yield "%s <script> %d" % (name, i + 1), script, minified
+
+    def test_scripts_keep_their_tokens(self):
+        count = 0
+        for name, source, small in self.scripts():
+            with self.subTest(script=name):
+                self.assertEqual(literals(source), literals(small))
+                self.assertEqual(code_without_whitespace(source), code_without_whitespace(small))
+                self.assertLess(len(small), len(source) + 2)
+                node_check(self, small)
+                count += 1
+        self.assertGreater(count, 0)
+
+    def test_pages_keep_their_tags(self):
+        for name in sorted(os.listdir(DATA_DIR)):
+            if not name.endswith(".html"):
+                continue
+            with open(os.path.join(DATA_DIR, name), encoding="utf-8") as f:
+                text = f.read()
+            small = web.minify(text, ".html")
+            outside = lambda page: web.HTML_RAW.sub("", re.sub(r"<!--.*?-->", "", page, flags=re.S))
+            with self.subTest(page=name):
+                self.assertEqual(web.HTML_TAG.findall(outside(text)), web.HTML_TAG.findall(outside(small)))
+                self.assertNotIn("<!--", outside(small))
+
+    def test_build(self):
+        out = tempfile.mkdtemp()
+        try:
+            pages = web.build(DATA_DIR, out)
+            self.assertIn("rules.html", pages)
+            for raw, small, packed, page_only in pages.values():
+                self.assertLess(small, raw)
+                self.assertLess(packed, small)
+        finally:
+            shutil.rmtree(out)
+
+
+if __name__ == "__main__":
+    unittest.main()